@@ -9,6 +9,11 @@ extern "C" {
 #include <stdint.h>
 #include <stdio.h>
 
+// 0: Only errors, 1: also debug output, 2: also trace output and events.
+#ifndef QUAPI_TRACE_LEVEL
+#define QUAPI_TRACE_LEVEL 2
+#endif
+
 #ifndef MIN
 #define MIN(a, b)           \
   ({                        \
@@ -32,6 +37,9 @@ extern "C" {
 /// versions were received.
 #define QUAPI_API_VERSION 3
 
+/// Maximum number of nested checkpoints of a solver, see quapi_checkpoint.
+#define QUAPI_MAX_CHECKPOINTS 64
+
 typedef enum quapi_state {
   QUAPI_INPUT,
   QUAPI_INPUT_LITERALS,
@@ -75,6 +83,10 @@ typedef enum quapi_status {
 const char*
 quapi_status_str(quapi_status status);
 
+/* CLOCK_MONOTONIC in ns, shared by solve statistics, traces and timelines. */
+uint64_t
+quapi_now_ns();
+
 typedef struct quapi_msg_header_data {
   int32_t literals;
   int32_t clauses;
@@ -82,6 +94,8 @@ typedef struct quapi_msg_header_data {
   int forked_child_read_pipe[2];
   int forked_child_write_pipe[2];
   int message_to_parent_pipe[2];
+  // Socket the seeding process passes pipes of probe children through.
+  int probe_socket[2];
 } quapi_msg_header_data;
 
 /* Callback for logging data catched from stderr. NULL terminated string. */
@@ -110,10 +124,41 @@ bool
 quapi_check_trace();
 
 void
-trc(const char* format, ...);
+quapi_trc(const char* format, ...);
 
 void
-dbg(const char* format, ...);
+quapi_dbg(const char* format, ...);
+
+/* Debug (QUAPI_DEBUG) and trace (QUAPI_TRACE) output only exists with a
+ * QUAPI_TRACE_LEVEL of at least 1 or 2, arguments are not evaluated if it is
+ * disabled. */
+#if QUAPI_TRACE_LEVEL >= 1
+#define dbg(...)              \
+  do {                        \
+    if(quapi_check_debug())   \
+      quapi_dbg(__VA_ARGS__); \
+  } while(0)
+#else
+#define dbg(...)              \
+  do {                        \
+    if(0)                     \
+      quapi_dbg(__VA_ARGS__); \
+  } while(0)
+#endif
+
+#if QUAPI_TRACE_LEVEL >= 2
+#define trc(...)              \
+  do {                        \
+    if(quapi_check_trace())   \
+      quapi_trc(__VA_ARGS__); \
+  } while(0)
+#else
+#define trc(...)              \
+  do {                        \
+    if(0)                     \
+      quapi_trc(__VA_ARGS__); \
+  } while(0)
+#endif
 
 void
 err(const char* format, ...);
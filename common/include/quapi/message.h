@@ -23,6 +23,13 @@ typedef enum quapi_msg_type {
   QUAPI_MSG_SOLVE,
   QUAPI_MSG_EXIT_CODE,
   QUAPI_MSG_DESTRUCTED,
+  QUAPI_MSG_BEGIN,
+  QUAPI_MSG_CHECKPOINT,
+  QUAPI_MSG_CHECKPOINT_REPORT,
+  QUAPI_MSG_ROLLBACK,
+  QUAPI_MSG_TIMESTAMP,
+  QUAPI_MSG_RUSAGE,
+  QUAPI_MSG_PERF,
 } quapi_msg_type;
 
 typedef uint8_t quapi_msg_type_packed;
@@ -47,6 +54,14 @@ typedef struct quapi_msg_lit {
 
 typedef struct quapi_msg_fork {
   int wait_for_exit_code_and_report : 1;
+  // Fork a probe child with its own pipes, which are sent over the probe
+  // socket. Its PID and exit code are reported through its status pipe.
+  int probe : 1;
+  // The assumptions of the child may already be in the pipe, so older input
+  // is not drained by the seeding process. The child skips everything up to
+  // the BEGIN message with the same fork_id instead.
+  int pipelined : 1;
+  unsigned int fork_id : 29;
 } quapi_msg_fork;
 
 typedef struct quapi_msg_started {
@@ -64,6 +79,93 @@ typedef struct quapi_msg_exit_code {
   int32_t exit_code;
 } quapi_msg_exit_code;
 
+typedef struct quapi_msg_begin {
+  uint32_t fork_id;
+} quapi_msg_begin;
+
+// The seeding process forks, the parent stays as snapshot at the current
+// position in the formula and the child continues as seeding process.
+typedef struct quapi_msg_checkpoint {
+  uint32_t depth;
+} quapi_msg_checkpoint;
+
+typedef struct quapi_msg_checkpoint_report {
+  pid_t seeding_pid;
+} quapi_msg_checkpoint_report;
+
+// Continue from the snapshot of the given depth, or only drop it. Newer
+// snapshots are always dropped.
+typedef struct quapi_msg_rollback {
+  unsigned int depth : 31;
+  unsigned int drop : 1;
+} quapi_msg_rollback;
+
+// Events in the preloaded runtime the library measures solve phases with.
+typedef enum quapi_timestamp_event {
+  // The seeding process read the FORK of a solver child.
+  QUAPI_TIMESTAMP_FORK_READ,
+  // The seeding process returned from fork().
+  QUAPI_TIMESTAMP_FORKED,
+  // The solver child read SOLVE, i.e., all assumptions were parsed.
+  QUAPI_TIMESTAMP_SOLVE_READ,
+  // The seeding process reaped the solver child.
+  QUAPI_TIMESTAMP_CHILD_EXITED,
+} quapi_timestamp_event;
+
+// Only the low bits of CLOCK_MONOTONIC in microseconds fit into a message.
+// They wrap after about 9 minutes, the library restores the rest from the
+// time it receives the message.
+#define QUAPI_TIMESTAMP_BITS 29
+
+typedef struct quapi_msg_timestamp {
+  unsigned int event : 3;
+  unsigned int time_us : QUAPI_TIMESTAMP_BITS;
+} quapi_msg_timestamp;
+
+// Resources a solver child used, as measured by wait4() in the seeding
+// process. Sent as one message per field right before the EXIT_CODE.
+typedef enum quapi_rusage_field {
+  // CPU times in microseconds, split into two messages each.
+  QUAPI_RUSAGE_USER_LOW,
+  QUAPI_RUSAGE_USER_HIGH,
+  QUAPI_RUSAGE_SYSTEM_LOW,
+  QUAPI_RUSAGE_SYSTEM_HIGH,
+  // In KiB.
+  QUAPI_RUSAGE_MAX_RSS,
+  QUAPI_RUSAGE_MINOR_FAULTS,
+  QUAPI_RUSAGE_MAJOR_FAULTS,
+  QUAPI_RUSAGE_VOLUNTARY_SWITCHES,
+  QUAPI_RUSAGE_INVOLUNTARY_SWITCHES,
+  QUAPI_RUSAGE_FIELD_COUNT,
+} quapi_rusage_field;
+
+// Values that do not fit are saturated, except the split CPU times.
+#define QUAPI_RUSAGE_BITS 28
+
+typedef struct quapi_msg_rusage {
+  unsigned int field : 4;
+  unsigned int value : QUAPI_RUSAGE_BITS;
+} quapi_msg_rusage;
+
+// Performance counters of a solver child, only sent if QUAPI_PERF_COUNTERS
+// is set in the seeding process. Follow the RUSAGE messages.
+typedef enum quapi_perf_counter {
+  QUAPI_PERF_CYCLES,
+  QUAPI_PERF_INSTRUCTIONS,
+  QUAPI_PERF_CACHE_MISSES,
+  QUAPI_PERF_PAGE_FAULTS,
+  QUAPI_PERF_COUNTER_COUNT,
+} quapi_perf_counter;
+
+// Every counter is split into a low and a (saturated) high part.
+#define QUAPI_PERF_BITS 28
+
+typedef struct quapi_msg_perf {
+  unsigned int counter : 3;
+  unsigned int high : 1;
+  unsigned int value : QUAPI_PERF_BITS;
+} quapi_msg_perf;
+
 typedef union quapi_msg_data {
   quapi_msg_header header;
   quapi_msg_quantifier quantifier;
@@ -73,6 +175,13 @@ typedef union quapi_msg_data {
   quapi_msg_started started;
   quapi_msg_solve solve;
   quapi_msg_exit_code exit_code;
+  quapi_msg_begin begin;
+  quapi_msg_checkpoint checkpoint;
+  quapi_msg_checkpoint_report checkpoint_report;
+  quapi_msg_rollback rollback;
+  quapi_msg_timestamp timestamp;
+  quapi_msg_rusage rusage;
+  quapi_msg_perf perf;
 } quapi_msg_data;
 
 // Packed, so that only 5 bytes have to be communicated.
@@ -94,6 +203,12 @@ typedef union quapi_msg {
 quapi_status
 quapi_write_msg_to_fd(int fd, quapi_msg* msg, quapi_msg_header_data* hdata);
 
+/** @brief Write several messages (no headers) to a file descriptor using a
+ * single write.
+ */
+quapi_status
+quapi_write_msgs_to_fd(int fd, quapi_msg* msgs, size_t count);
+
 /** @brief Write a message to a file stream. Flushes automatically on SOLVE or
  * FORK.
  *
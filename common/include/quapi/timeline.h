@@ -0,0 +1,60 @@
+#ifndef QUAPI_TIMELINE_H
+#define QUAPI_TIMELINE_H
+
+#include <stdint.h>
+
+/** @file
+ *
+ * Timeline of the solve lifecycle in the Chrome trace event format. If the
+ * QUAPI_TIMELINE_DIR environment variable is set, every process appends its
+ * spans (exec, feed, fork, assumptions, solve, kill, ...) to the file
+ * quapi-timeline-<pid>.json in that directory, one event per line. quapitrace
+ * -c merges the files of a run into one trace for chrome://tracing or
+ * Perfetto.
+ *
+ * Spans carry the fork id of their solver child as solve id, which is the
+ * same in the library, the seeding process and the solver child.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Close the timeline of the calling process. The next event reads
+ * QUAPI_TIMELINE_DIR again, e.g. after tests changed it. No other thread may
+ * add events meanwhile. */
+void
+quapi_timeline_reopen();
+
+/** Name the calling process in the timeline, once per process. */
+void
+quapi_timeline_process_name(const char* name);
+
+/** Name a track of the calling process. */
+void
+quapi_timeline_thread_name(int tid, const char* name);
+
+/** Begin a span on the track of the calling process. Spans that are not
+ * ended, e.g. of killed processes, last until the end of the timeline. A
+ * negative solve id is left out. */
+void
+quapi_timeline_begin(const char* name, int64_t solve);
+
+void
+quapi_timeline_end(const char* name, int64_t solve);
+
+/** Add a span with known CLOCK_MONOTONIC begin and end on the given track. A
+ * child PID of 0 is left out. */
+void
+quapi_timeline_span(const char* name,
+                    int tid,
+                    uint64_t begin_ns,
+                    uint64_t end_ns,
+                    int64_t solve,
+                    int child);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
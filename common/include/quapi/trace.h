@@ -0,0 +1,125 @@
+#ifndef QUAPI_TRACE_H
+#define QUAPI_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef QUAPI_TRACE_LEVEL
+#define QUAPI_TRACE_LEVEL 2
+#endif
+
+/** @file
+ *
+ * Binary tracing of hot paths. Every process (library, seeding process and
+ * solver children) records events into its own ring buffer, a shared mapping
+ * of the file quapi-trace-<pid>.bin in the directory given by the
+ * QUAPI_TRACE_DIR environment variable. The file can be read while the
+ * process runs and survives crashes, quapitrace decodes it. With QUAPI_TRACE,
+ * events are also printed to STDERR like trc().
+ *
+ * Events are compiled out with QUAPI_TRACE_LEVEL below 2.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define QUAPI_TRACE_MAGIC 0x43525451 // "QTRC"
+#define QUAPI_TRACE_VERSION 1
+
+// Records per ring buffer by default, QUAPI_TRACE_EVENTS overrides it. Always
+// a power of two.
+#define QUAPI_TRACE_DEFAULT_EVENTS (1 << 16)
+
+typedef enum quapi_trace_event {
+  QUAPI_TRACE_NONE,
+  // a: message type, b: bytes.
+  QUAPI_TRACE_MSG_WRITE,
+  // a: messages, b: bytes.
+  QUAPI_TRACE_MSGS_WRITE,
+  // a: message type, b: bytes.
+  QUAPI_TRACE_MSG_READ,
+  // a: literals, b: clauses.
+  QUAPI_TRACE_HEADER_READ,
+  // a: state before, b: state after.
+  QUAPI_TRACE_STATE,
+  // a: bytes given to the solver, b: bytes of the buffer.
+  QUAPI_TRACE_SOLVER_READ,
+  // a: bytes written so far, b: bytes added.
+  QUAPI_TRACE_ZEROCOPY_WRITE,
+  // a: buffer, b: bytes in the buffer.
+  QUAPI_TRACE_ZEROCOPY_FLUSH,
+  // a: fd, b: bytes in the buffer.
+  QUAPI_TRACE_ZEROCOPY_SPLICE,
+  QUAPI_TRACE_EVENT_COUNT,
+} quapi_trace_event;
+
+typedef struct quapi_trace_record {
+  // CLOCK_MONOTONIC, comparable between the processes of a machine.
+  uint64_t time_ns;
+  // Low bits of the position in the ring plus one, written last. Records with
+  // another sequence number were overwritten or are being written.
+  uint32_t seq;
+  uint16_t event;
+  uint16_t reserved;
+  int64_t a;
+  int64_t b;
+} quapi_trace_record;
+
+typedef struct quapi_trace_ring {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t capacity;
+  int32_t pid;
+  int32_t ppid;
+  uint32_t reserved;
+  // Records written so far, the next one goes to head % capacity.
+  uint64_t head;
+  quapi_trace_record records[];
+} quapi_trace_ring;
+
+// -1 before the first event of the process, then 0 if neither QUAPI_TRACE_DIR
+// nor QUAPI_TRACE is set.
+extern int quapi_trace_flags;
+
+void
+quapi_trace_record_event(quapi_trace_event event, int64_t a, int64_t b);
+
+#if QUAPI_TRACE_LEVEL >= 2
+#define quapi_trace(EVENT, A, B)                                     \
+  do {                                                               \
+    if(__builtin_expect(quapi_trace_flags != 0, 0))                  \
+      quapi_trace_record_event((EVENT), (int64_t)(A), (int64_t)(B)); \
+  } while(0)
+#else
+#define quapi_trace(EVENT, A, B) \
+  do {                           \
+  } while(0)
+#endif
+
+const char*
+quapi_trace_event_str(quapi_trace_event event);
+
+/** Render the arguments of a record into buf, e.g. "type=LITERAL bytes=5". */
+void
+quapi_trace_format_args(const quapi_trace_record* record,
+                        char* buf,
+                        size_t size);
+
+/** Call cb for copies of all intact records of a ring buffer of the given
+ * size, oldest first. The ring may still be written to. Returns false if the
+ * buffer is no ring buffer. */
+bool
+quapi_trace_ring_foreach(const quapi_trace_ring* ring,
+                         size_t size,
+                         void (*cb)(const quapi_trace_ring* ring,
+                                    const quapi_trace_record* record,
+                                    void* userdata),
+                         void* userdata);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -41,6 +41,10 @@ quapi_zerocopy_pipe_prepare_write(size_t size,
 void
 quapi_zerocopy_pipe_flush(quapi_zerocopy_pipe* pipe);
 
+/* Drop written data that was not flushed yet. */
+void
+quapi_zerocopy_pipe_discard(quapi_zerocopy_pipe* pipe);
+
 void*
 quapi_zerocopy_pipe_read(size_t size, quapi_zerocopy_pipe* pipe);
 
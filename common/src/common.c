@@ -1,5 +1,6 @@
 #include <quapi/definitions.h>
 #include <quapi/message.h>
+#include <quapi/trace.h>
 
 #include <assert.h>
 #include <errno.h>
@@ -9,6 +10,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 const char*
@@ -81,6 +83,13 @@ quapi_status_str(quapi_status status) {
   return "UNKNOWN_STATUS";
 }
 
+uint64_t
+quapi_now_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
 bool
 quapi_msg_is_known(quapi_msg_type t) {
   switch(t) {
@@ -94,6 +103,13 @@ quapi_msg_is_known(quapi_msg_type t) {
     case QUAPI_MSG_STARTED:
     case QUAPI_MSG_EXIT_CODE:
     case QUAPI_MSG_DESTRUCTED:
+    case QUAPI_MSG_BEGIN:
+    case QUAPI_MSG_CHECKPOINT:
+    case QUAPI_MSG_CHECKPOINT_REPORT:
+    case QUAPI_MSG_ROLLBACK:
+    case QUAPI_MSG_TIMESTAMP:
+    case QUAPI_MSG_RUSAGE:
+    case QUAPI_MSG_PERF:
       return true;
   }
   return false;
@@ -122,6 +138,20 @@ quapi_msg_type_str(quapi_msg_type t) {
       return "EXIT CODE";
     case QUAPI_MSG_DESTRUCTED:
       return "DESTRUCTED";
+    case QUAPI_MSG_BEGIN:
+      return "BEGIN";
+    case QUAPI_MSG_CHECKPOINT:
+      return "CHECKPOINT";
+    case QUAPI_MSG_CHECKPOINT_REPORT:
+      return "CHECKPOINT REPORT";
+    case QUAPI_MSG_ROLLBACK:
+      return "ROLLBACK";
+    case QUAPI_MSG_TIMESTAMP:
+      return "TIMESTAMP";
+    case QUAPI_MSG_RUSAGE:
+      return "RUSAGE";
+    case QUAPI_MSG_PERF:
+      return "PERF";
   }
   return "UNKNOWN MESSAGE";
 }
@@ -147,7 +177,7 @@ quapi_check_trace() {
 }
 
 void
-dbg(const char* format, ...) {
+quapi_dbg(const char* format, ...) {
   if(quapi_check_debug()) {
     flockfile(stderr);
     fprintf(stderr, "[QuAPI] [DEBUG] [%d] ", getpid());
@@ -161,7 +191,7 @@ dbg(const char* format, ...) {
 }
 
 void
-trc(const char* format, ...) {
+quapi_trc(const char* format, ...) {
   if(quapi_check_trace()) {
     flockfile(stderr);
     fprintf(stderr, "[QuAPI] [TRACE] [%d] ", getpid());
@@ -203,7 +233,7 @@ serialize_header(quapi_msg* msg,
   int32_t prefixdepth = hdata->prefixdepth;
 
   char* data = malloc(sizeof(quapi_msg_data) + sizeof(quapi_msg_type_packed) +
-                      3 + sizeof(int32_t) * 3 + sizeof(int) * 6);
+                      3 + sizeof(int32_t) * 3 + sizeof(int) * 8);
   if(!data)
     return QUAPI_ALLOC_ERROR;
 
@@ -233,6 +263,8 @@ serialize_header(quapi_msg* msg,
   WRITE_VAR(hdata->forked_child_write_pipe[1]);
   WRITE_VAR(hdata->message_to_parent_pipe[0]);
   WRITE_VAR(hdata->message_to_parent_pipe[1]);
+  WRITE_VAR(hdata->probe_socket[0]);
+  WRITE_VAR(hdata->probe_socket[1]);
 
   *dataptr = data;
   *len = i;
@@ -258,10 +290,7 @@ quapi_write_msg_to_fd(int fd, quapi_msg* msg, quapi_msg_header_data* hdata) {
     data[sizeof(quapi_msg_data)] = type;
   }
 
-  trc("Write message with len %zu of type %s to fd %d",
-      len,
-      quapi_msg_type_str(type),
-      fd);
+  quapi_trace(QUAPI_TRACE_MSG_WRITE, type, len);
   ssize_t r = write(fd, data, len);
 
   if(type == QUAPI_MSG_HEADER && data != msg->arr) {
@@ -281,6 +310,32 @@ quapi_write_msg_to_fd(int fd, quapi_msg* msg, quapi_msg_header_data* hdata) {
   return QUAPI_OTHER_ERROR;
 }
 
+quapi_status
+quapi_write_msgs_to_fd(int fd, quapi_msg* msgs, size_t count) {
+  assert(msgs);
+
+  for(size_t i = 0; i < count; ++i) {
+    assert(msgs[i].msg.type != QUAPI_MSG_HEADER);
+    msgs[i].arr[sizeof(quapi_msg_data)] = msgs[i].msg.type;
+  }
+
+  size_t len = count * sizeof(quapi_msg);
+  quapi_trace(QUAPI_TRACE_MSGS_WRITE, count, len);
+  ssize_t r = write(fd, msgs, len);
+
+  if(r == (ssize_t)len)
+    return QUAPI_OK;
+  else if(r == -1) {
+    err("Could not write %zu messages to fd %d! Error: %s",
+        count,
+        fd,
+        strerror(errno));
+    return QUAPI_WRITE_ERROR;
+  }
+
+  return QUAPI_OTHER_ERROR;
+}
+
 quapi_status
 quapi_write_msg_to_file(ZEROCOPY_PIPE_OR_FILE* f,
                         quapi_msg* msg,
@@ -300,16 +355,10 @@ quapi_write_msg_to_file(ZEROCOPY_PIPE_OR_FILE* f,
     data[sizeof(quapi_msg_data)] = type;
   }
 
+  quapi_trace(QUAPI_TRACE_MSG_WRITE, type, len);
 #ifdef USING_ZEROCOPY
-  trc("Write message with len %zu of type %s to zerocopy pipe",
-      len,
-      quapi_msg_type_str(type));
   ssize_t r = quapi_zerocopy_pipe_write(data, len, 1, f);
 #else
-  trc("Write message with len %zu of type %s to fd %d via FILE",
-      len,
-      quapi_msg_type_str(msg->msg.type),
-      fileno(f));
   ssize_t r = fwrite(data, len, 1, f);
 #endif
 
@@ -323,6 +372,8 @@ quapi_write_msg_to_file(ZEROCOPY_PIPE_OR_FILE* f,
       case QUAPI_MSG_FORK:
       case QUAPI_MSG_SOLVE:
       case QUAPI_MSG_STARTED:
+      case QUAPI_MSG_CHECKPOINT:
+      case QUAPI_MSG_ROLLBACK:
 #ifdef USING_ZEROCOPY
         dbg("Flushing");
         quapi_zerocopy_pipe_flush(f);
@@ -352,7 +403,7 @@ read_trailing_into_header(quapi_msg* msg,
                           fread_t fread_func,
                           ZEROCOPY_PIPE_OR_FILE* f) {
   // The 3 is the padding after a header message.
-  const size_t len = 3 + sizeof(int32_t) * 3 + sizeof(int) * 6;
+  const size_t len = 3 + sizeof(int32_t) * 3 + sizeof(int) * 8;
 
 #ifdef USING_ZEROCOPY
   char trail_backing[len];
@@ -384,6 +435,8 @@ read_trailing_into_header(quapi_msg* msg,
   READ_VAR(hdata->forked_child_write_pipe[1]);
   READ_VAR(hdata->message_to_parent_pipe[0]);
   READ_VAR(hdata->message_to_parent_pipe[1]);
+  READ_VAR(hdata->probe_socket[0]);
+  READ_VAR(hdata->probe_socket[1]);
 }
 
 bool
@@ -409,16 +462,11 @@ quapi_read_msg_from_fd(int fd,
   quapi_msg_type t = msg->arr[sizeof(quapi_msg_data)];
   msg->msg.type = t;
 
-  trc("Read message of type %s (read %d bytes)",
-      quapi_msg_type_str(msg->msg.type),
-      s);
+  quapi_trace(QUAPI_TRACE_MSG_READ, t, s);
 
   if(msg->msg.type == QUAPI_MSG_HEADER) {
     read_trailing_into_header(msg, hdata, read, NULL, NULL);
-
-    trc("Read header message! Literals: %d, Clauses: %d",
-        hdata->literals,
-        hdata->clauses);
+    quapi_trace(QUAPI_TRACE_HEADER_READ, hdata->literals, hdata->clauses);
   }
 
   return true;
@@ -470,16 +518,13 @@ quapi_read_msg_from_file(ZEROCOPY_PIPE_OR_FILE* f,
     exit(-1);
   }
 
-  trc("Read message of type %s (read %d bytes)",
-      quapi_msg_type_str(r->msg.type),
-      s * (sizeof(quapi_msg_data) + sizeof(quapi_msg_type_packed)));
+  quapi_trace(QUAPI_TRACE_MSG_READ,
+              t,
+              s * (sizeof(quapi_msg_data) + sizeof(quapi_msg_type_packed)));
 
   if(r->msg.type == QUAPI_MSG_HEADER) {
     read_trailing_into_header(r, hdata, NULL, fread, f);
-
-    trc("Read header message! Literals: %d, Clauses: %d",
-        hdata->literals,
-        hdata->clauses);
+    quapi_trace(QUAPI_TRACE_HEADER_READ, hdata->literals, hdata->clauses);
   }
 
 #ifdef USING_ZEROCOPY
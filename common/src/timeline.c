@@ -0,0 +1,188 @@
+#include <quapi/definitions.h>
+#include <quapi/timeline.h>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// -2 before the first event of the process, -1 if QUAPI_TIMELINE_DIR is not
+// set.
+static int timeline_fd = -2;
+static int timeline_pid = 0;
+static bool process_named = false;
+static pthread_mutex_t init_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void
+reset_after_fork() {
+  // The child appends to its own file.
+  if(timeline_fd >= 0)
+    close(timeline_fd);
+  timeline_fd = -2;
+  process_named = false;
+  init_mutex = (pthread_mutex_t)PTHREAD_MUTEX_INITIALIZER;
+}
+
+static int
+get_fd() {
+  int fd = __atomic_load_n(&timeline_fd, __ATOMIC_ACQUIRE);
+  if(fd != -2)
+    return fd;
+
+  pthread_mutex_lock(&init_mutex);
+  if(timeline_fd == -2) {
+    static bool atfork_registered = false;
+    if(!atfork_registered) {
+      pthread_atfork(NULL, NULL, &reset_after_fork);
+      atfork_registered = true;
+    }
+
+    fd = -1;
+    timeline_pid = getpid();
+    const char* dir = getenv("QUAPI_TIMELINE_DIR");
+    if(dir && *dir) {
+      char path[PATH_MAX];
+      snprintf(
+        path, sizeof(path), "%s/quapi-timeline-%d.json", dir, timeline_pid);
+      fd = open(
+        path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+      if(fd == -1)
+        err("Could not create timeline %s!", path);
+    }
+    __atomic_store_n(&timeline_fd, fd, __ATOMIC_RELEASE);
+  }
+  fd = timeline_fd;
+  pthread_mutex_unlock(&init_mutex);
+  return fd;
+}
+
+void
+quapi_timeline_reopen() {
+  pthread_mutex_lock(&init_mutex);
+  if(timeline_fd >= 0)
+    close(timeline_fd);
+  process_named = false;
+  __atomic_store_n(&timeline_fd, -2, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&init_mutex);
+}
+
+/* Events are written with a single write() each, so lines of several threads
+ * do not interleave. */
+static void
+write_event(int fd, const char* line, int len) {
+  if(len > 0)
+    write(fd, line, len);
+}
+
+static int
+format_args(char* buf, size_t size, int64_t solve, int child) {
+  if(solve >= 0 && child > 0)
+    return snprintf(buf,
+                    size,
+                    ",\"args\":{\"solve\":%lld,\"child\":%d}",
+                    (long long)solve,
+                    child);
+  if(solve >= 0)
+    return snprintf(
+      buf, size, ",\"args\":{\"solve\":%lld}", (long long)solve);
+  if(child > 0)
+    return snprintf(buf, size, ",\"args\":{\"child\":%d}", child);
+  buf[0] = '\0';
+  return 0;
+}
+
+static void
+metadata(int fd, const char* kind, int tid, const char* name) {
+  char line[256];
+  int len = snprintf(line,
+                     sizeof(line),
+                     "{\"name\":\"%s\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                     "\"args\":{\"name\":\"%s\"}},\n",
+                     kind,
+                     timeline_pid,
+                     tid,
+                     name);
+  write_event(fd, line, len);
+}
+
+void
+quapi_timeline_process_name(const char* name) {
+  int fd = get_fd();
+  if(fd < 0 || process_named)
+    return;
+  process_named = true;
+  metadata(fd, "process_name", timeline_pid, name);
+}
+
+void
+quapi_timeline_thread_name(int tid, const char* name) {
+  int fd = get_fd();
+  if(fd < 0)
+    return;
+  metadata(fd, "thread_name", tid, name);
+}
+
+static void
+phase_event(const char* name, char phase, int64_t solve) {
+  int fd = get_fd();
+  if(fd < 0)
+    return;
+  uint64_t ts = quapi_now_ns();
+  char args[64];
+  format_args(args, sizeof(args), solve, 0);
+  char line[256];
+  int len = snprintf(line,
+                     sizeof(line),
+                     "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu.%03u,"
+                     "\"pid\":%d,\"tid\":%d%s},\n",
+                     name,
+                     phase,
+                     (unsigned long long)(ts / 1000),
+                     (unsigned)(ts % 1000),
+                     timeline_pid,
+                     timeline_pid,
+                     args);
+  write_event(fd, line, len);
+}
+
+void
+quapi_timeline_begin(const char* name, int64_t solve) {
+  phase_event(name, 'B', solve);
+}
+
+void
+quapi_timeline_end(const char* name, int64_t solve) {
+  phase_event(name, 'E', solve);
+}
+
+void
+quapi_timeline_span(const char* name,
+                    int tid,
+                    uint64_t begin_ns,
+                    uint64_t end_ns,
+                    int64_t solve,
+                    int child) {
+  int fd = get_fd();
+  if(fd < 0 || begin_ns == 0 || end_ns < begin_ns)
+    return;
+  uint64_t dur = end_ns - begin_ns;
+  char args[64];
+  format_args(args, sizeof(args), solve, child);
+  char line[256];
+  int len = snprintf(line,
+                     sizeof(line),
+                     "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%llu.%03u,"
+                     "\"dur\":%llu.%03u,\"pid\":%d,\"tid\":%d%s},\n",
+                     name,
+                     (unsigned long long)(begin_ns / 1000),
+                     (unsigned)(begin_ns % 1000),
+                     (unsigned long long)(dur / 1000),
+                     (unsigned)(dur % 1000),
+                     timeline_pid,
+                     tid,
+                     args);
+  write_event(fd, line, len);
+}
@@ -0,0 +1,234 @@
+#include <quapi/definitions.h>
+#include <quapi/message.h>
+#include <quapi/trace.h>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define TRACE_TO_RING 1
+#define TRACE_TO_STDERR 2
+
+int quapi_trace_flags = -1;
+
+static quapi_trace_ring* ring = NULL;
+static size_t ring_size = 0;
+static pthread_mutex_t init_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void
+reset_after_fork() {
+  // The mapping is shared with the parent, the child gets its own ring with
+  // its next event.
+  if(ring)
+    munmap(ring, ring_size);
+  ring = NULL;
+  ring_size = 0;
+  init_mutex = (pthread_mutex_t)PTHREAD_MUTEX_INITIALIZER;
+  quapi_trace_flags = -1;
+}
+
+static uint32_t
+ring_capacity() {
+  const char* events = getenv("QUAPI_TRACE_EVENTS");
+  uint64_t wanted = events ? strtoull(events, NULL, 10) : 0;
+  if(wanted == 0)
+    return QUAPI_TRACE_DEFAULT_EVENTS;
+  uint32_t capacity = 1;
+  while(capacity < wanted && capacity < (1u << 30))
+    capacity <<= 1;
+  return capacity;
+}
+
+static quapi_trace_ring*
+create_ring(const char* dir) {
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s/quapi-trace-%d.bin", dir, getpid());
+
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if(fd == -1) {
+    err("Could not create trace ring buffer %s!", path);
+    return NULL;
+  }
+
+  uint32_t capacity = ring_capacity();
+  size_t size =
+    sizeof(quapi_trace_ring) + capacity * sizeof(quapi_trace_record);
+  quapi_trace_ring* r = MAP_FAILED;
+  if(ftruncate(fd, size) == 0)
+    r = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(r == MAP_FAILED) {
+    err("Could not map trace ring buffer %s!", path);
+    return NULL;
+  }
+
+  r->version = QUAPI_TRACE_VERSION;
+  r->capacity = capacity;
+  r->pid = getpid();
+  r->ppid = getppid();
+  r->head = 0;
+  __atomic_store_n(&r->magic, QUAPI_TRACE_MAGIC, __ATOMIC_RELEASE);
+  ring_size = size;
+  return r;
+}
+
+static void
+init() {
+  // The library may trace from several threads.
+  pthread_mutex_lock(&init_mutex);
+  if(__atomic_load_n(&quapi_trace_flags, __ATOMIC_ACQUIRE) != -1) {
+    pthread_mutex_unlock(&init_mutex);
+    return;
+  }
+
+  static bool atfork_registered = false;
+  if(!atfork_registered) {
+    pthread_atfork(NULL, NULL, &reset_after_fork);
+    atfork_registered = true;
+  }
+
+  int flags = 0;
+  const char* dir = getenv("QUAPI_TRACE_DIR");
+  if(dir && *dir) {
+    ring = create_ring(dir);
+    if(ring)
+      flags |= TRACE_TO_RING;
+  }
+  if(quapi_check_trace())
+    flags |= TRACE_TO_STDERR;
+  __atomic_store_n(&quapi_trace_flags, flags, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&init_mutex);
+}
+
+void
+quapi_trace_record_event(quapi_trace_event event, int64_t a, int64_t b) {
+  if(__atomic_load_n(&quapi_trace_flags, __ATOMIC_ACQUIRE) == -1)
+    init();
+
+  quapi_trace_record rec = { .time_ns = quapi_now_ns(),
+                             .event = event,
+                             .a = a,
+                             .b = b };
+
+  if(quapi_trace_flags & TRACE_TO_RING) {
+    uint64_t n = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED);
+    quapi_trace_record* dst = &ring->records[n & (ring->capacity - 1)];
+    __atomic_store_n(&dst->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    dst->time_ns = rec.time_ns;
+    dst->event = rec.event;
+    dst->a = rec.a;
+    dst->b = rec.b;
+    __atomic_store_n(&dst->seq, (uint32_t)(n + 1), __ATOMIC_RELEASE);
+  }
+
+  if(quapi_trace_flags & TRACE_TO_STDERR) {
+    char args[128];
+    quapi_trace_format_args(&rec, args, sizeof(args));
+    quapi_trc("%s %s", quapi_trace_event_str(event), args);
+  }
+}
+
+const char*
+quapi_trace_event_str(quapi_trace_event event) {
+  switch(event) {
+    case QUAPI_TRACE_NONE:
+      return "NONE";
+    case QUAPI_TRACE_MSG_WRITE:
+      return "MSG_WRITE";
+    case QUAPI_TRACE_MSGS_WRITE:
+      return "MSGS_WRITE";
+    case QUAPI_TRACE_MSG_READ:
+      return "MSG_READ";
+    case QUAPI_TRACE_HEADER_READ:
+      return "HEADER_READ";
+    case QUAPI_TRACE_STATE:
+      return "STATE";
+    case QUAPI_TRACE_SOLVER_READ:
+      return "SOLVER_READ";
+    case QUAPI_TRACE_ZEROCOPY_WRITE:
+      return "ZEROCOPY_WRITE";
+    case QUAPI_TRACE_ZEROCOPY_FLUSH:
+      return "ZEROCOPY_FLUSH";
+    case QUAPI_TRACE_ZEROCOPY_SPLICE:
+      return "ZEROCOPY_SPLICE";
+    case QUAPI_TRACE_EVENT_COUNT:
+      break;
+  }
+  return "UNKNOWN_EVENT";
+}
+
+void
+quapi_trace_format_args(const quapi_trace_record* r, char* buf, size_t size) {
+  long long a = r->a, b = r->b;
+  switch((quapi_trace_event)r->event) {
+    case QUAPI_TRACE_MSG_WRITE:
+    case QUAPI_TRACE_MSG_READ:
+      snprintf(buf, size, "type=%s bytes=%lld", quapi_msg_type_str(a), b);
+      return;
+    case QUAPI_TRACE_MSGS_WRITE:
+      snprintf(buf, size, "messages=%lld bytes=%lld", a, b);
+      return;
+    case QUAPI_TRACE_HEADER_READ:
+      snprintf(buf, size, "literals=%lld clauses=%lld", a, b);
+      return;
+    case QUAPI_TRACE_STATE:
+      snprintf(buf,
+               size,
+               "%s -> %s",
+               quapi_preload_state_str(a),
+               quapi_preload_state_str(b));
+      return;
+    case QUAPI_TRACE_SOLVER_READ:
+      snprintf(buf, size, "bytes=%lld buflen=%lld", a, b);
+      return;
+    case QUAPI_TRACE_ZEROCOPY_WRITE:
+      snprintf(buf, size, "written=%lld added=%lld", a, b);
+      return;
+    case QUAPI_TRACE_ZEROCOPY_FLUSH:
+      snprintf(buf, size, "buffer=%lld bytes=%lld", a, b);
+      return;
+    case QUAPI_TRACE_ZEROCOPY_SPLICE:
+      snprintf(buf, size, "fd=%lld bytes=%lld", a, b);
+      return;
+    default:
+      snprintf(buf, size, "a=%lld b=%lld", a, b);
+      return;
+  }
+}
+
+bool
+quapi_trace_ring_foreach(const quapi_trace_ring* ring,
+                         size_t size,
+                         void (*cb)(const quapi_trace_ring* ring,
+                                    const quapi_trace_record* record,
+                                    void* userdata),
+                         void* userdata) {
+  if(size < sizeof(*ring) || ring->magic != QUAPI_TRACE_MAGIC ||
+     ring->version != QUAPI_TRACE_VERSION || ring->capacity == 0 ||
+     (ring->capacity & (ring->capacity - 1)) ||
+     size < sizeof(*ring) + ring->capacity * sizeof(quapi_trace_record))
+    return false;
+
+  uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  uint64_t n = head > ring->capacity ? head - ring->capacity : 0;
+  for(; n < head; ++n) {
+    const quapi_trace_record* r = &ring->records[n & (ring->capacity - 1)];
+    uint32_t seq = n + 1;
+    if(__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) != seq)
+      continue;
+    // The writer may overwrite the record while it is copied, which then
+    // changed its sequence number.
+    quapi_trace_record copy = *r;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if(__atomic_load_n(&r->seq, __ATOMIC_RELAXED) != seq)
+      continue;
+    cb(ring, &copy, userdata);
+  }
+  return true;
+}
@@ -2,6 +2,7 @@
 
 #include "../include/quapi/zero-copy-pipes-linux.h"
 #include "../include/quapi/definitions.h"
+#include "../include/quapi/trace.h"
 
 #include <assert.h>
 #include <errno.h>
@@ -162,12 +163,7 @@ flush_out(quapi_zerocopy_pipe* p) {
     bufvec.iov_len -= ret;
   }
 
-  trc("Flushed %zu bytes from buffer %d into zerocopy pipe using vmsplice. "
-      "Buffer contained "
-      "%zu written bytes.",
-      buf_size,
-      p->current_buf,
-      written);
+  quapi_trace(QUAPI_TRACE_ZEROCOPY_FLUSH, p->current_buf, written);
 
   {
     // Reset the written counter to 0 in the new current buffer.
@@ -186,6 +182,13 @@ quapi_zerocopy_pipe_flush(quapi_zerocopy_pipe* pipe) {
     flush_out(pipe);
 }
 
+void
+quapi_zerocopy_pipe_discard(quapi_zerocopy_pipe* pipe) {
+  size_t* written = (size_t*)&pipe->buf[pipe->current_buf][0];
+  *written = 0;
+  pipe->prepared = NULL;
+}
+
 static bool
 ensure_space_free(size_t effective_size,
                   char** current_buf,
@@ -217,24 +220,11 @@ quapi_zerocopy_pipe_write(const void* data,
   if(!ensure_space_free(effective_size, &current_buf, &written, pipe))
     return -1;
 
-  trc("Zero Copy Pipe Write: Written: %zu, Additional Effective Size: %zu, "
-      "Buffer: %d",
-      *written,
-      effective_size,
-      pipe->current_buf);
+  quapi_trace(QUAPI_TRACE_ZEROCOPY_WRITE, *written, effective_size);
 
   if(data == pipe->prepared) {
-    trc("Message of effective size %zu being written from already prepared "
-        "memory %p.",
-        effective_size,
-        data);
     pipe->prepared = ((char*)pipe->prepared) + effective_size;
   } else {
-    trc("Message of effective size %zu being written was not prepared! Address "
-        "of data: %p and of prepared %p.",
-        effective_size,
-        data,
-        pipe->prepared);
     memcpy(current_buf + *written, data, effective_size);
   }
   *written += effective_size;
@@ -302,11 +292,7 @@ flush_read(quapi_zerocopy_pipe* pipe) {
   }
 
   size_t* written = (size_t*)&pipe->buf[0][0];
-  trc("Spliced a full %zu B buffer from fd %d into buffer for reading. Buffer "
-      "contains %zu written bytes.",
-      buf_size,
-      pipe->fd,
-      *written);
+  quapi_trace(QUAPI_TRACE_ZEROCOPY_SPLICE, pipe->fd, *written);
 
   return true;
 }
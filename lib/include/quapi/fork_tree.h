@@ -0,0 +1,70 @@
+#ifndef QUAPI_FORK_TREE_H
+#define QUAPI_FORK_TREE_H
+
+#include <quapi/quapi.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A fork tree solves cubes that share prefixes, e.g. the cubes of an
+ * intsplit, without parsing the shared assumptions again for every cube.
+ *
+ * For every proper prefix of a solved cube, an intermediate node is forked
+ * from the seeding process or from the node of the next shorter prefix. Nodes
+ * parse their assumptions as unit clauses and then stay alive to fork the
+ * nodes and solver children of longer prefixes. Cubes only share nodes if
+ * their common assumptions come first and in the same order.
+ *
+ * Nodes without child nodes are evicted in least-recently-used order once the
+ * private memory of all nodes exceeds the memory budget. All nodes are
+ * dropped once clauses are added to the solver, as they would not see them.
+ */
+typedef struct quapi_fork_tree quapi_fork_tree;
+
+/**
+ * Create a fork tree for the solver. memory_budget is in bytes, 0 means no
+ * limit. The tree has to be released before the solver. Returns NULL on
+ * errors.
+ */
+quapi_fork_tree*
+quapi_fork_tree_init(quapi_solver* solver, uint64_t memory_budget);
+
+/**
+ * Kill all nodes and release the tree.
+ */
+void
+quapi_fork_tree_release(quapi_fork_tree* tree);
+
+/**
+ * Solve the formula under the assumptions of the cube, like quapi_solve.
+ * Results are decided by the SAT and UNSAT regex or by the exit code, the
+ * stdout callback is not used. Returns QUAPI_TIMEOUT if the timeout of the
+ * solver passed.
+ *
+ * Required state of the solver: INPUT, INPUT_LITERALS
+ */
+int
+quapi_fork_tree_solve(quapi_fork_tree* tree,
+                      const int32_t* cube,
+                      size_t size);
+
+/**
+ * Return the number of nodes that are currently alive.
+ */
+size_t
+quapi_fork_tree_size(quapi_fork_tree* tree);
+
+#ifdef __cplusplus
+}
+#include <memory>
+
+struct QuAPIForkTreeDeleter {
+  void operator()(quapi_fork_tree* t) { quapi_fork_tree_release(t); }
+};
+
+using QuAPIForkTree = std::unique_ptr<quapi_fork_tree, QuAPIForkTreeDeleter>;
+#endif
+
+#endif
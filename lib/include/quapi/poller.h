@@ -0,0 +1,91 @@
+#ifndef QUAPI_POLLER_H
+#define QUAPI_POLLER_H
+
+#include <quapi/quapi.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A poller drives many non-blocking solves from a single thread. It wraps an
+ * epoll set over the file descriptors of all added solvers and reports
+ * finished solves as events.
+ *
+ * Usage: start a solve with quapi_solve_start, add the solver to the poller
+ * and call quapi_poller_wait until the solver is reported back. Finished
+ * solvers are removed from the poller automatically and can be re-added after
+ * the next quapi_solve_start.
+ */
+typedef struct quapi_poller quapi_poller;
+
+typedef struct quapi_poller_event {
+  quapi_solver* solver;
+  // The userdata given to quapi_poller_add.
+  void* userdata;
+  // Result of the solve, as it would have been returned by quapi_solve.
+  int result;
+  // The solve was ended by quapi_terminate.
+  bool terminated;
+} quapi_poller_event;
+
+/**
+ * Create a new poller. Returns NULL on errors.
+ */
+quapi_poller*
+quapi_poller_init();
+
+/**
+ * Release the poller. Solvers still added to it keep working and have to be
+ * driven by other means or released.
+ */
+void
+quapi_poller_release(quapi_poller* poller);
+
+/**
+ * Add a solver with a running non-blocking solve to the poller. The userdata
+ * is reported back with the event of the solver. Returns false on errors.
+ *
+ * Required state: WORKING, started using quapi_solve_start
+ */
+bool
+quapi_poller_add(quapi_poller* poller, quapi_solver* solver, void* userdata);
+
+/**
+ * Remove a solver from the poller without waiting for its result. Returns
+ * false if the solver was not added to the poller.
+ */
+bool
+quapi_poller_remove(quapi_poller* poller, quapi_solver* solver);
+
+/**
+ * Return the number of solvers currently added to the poller.
+ */
+size_t
+quapi_poller_size(quapi_poller* poller);
+
+/**
+ * Wait at most timeout_ms milliseconds (-1 waits forever) for solvers to
+ * become readable, process their events and write an event for every finished
+ * solve into events. Returns the number of written events, which may be 0 if
+ * the timeout expired or if only intermediate output was processed. Returns
+ * -1 on errors.
+ */
+int
+quapi_poller_wait(quapi_poller* poller,
+                  quapi_poller_event* events,
+                  int max_events,
+                  int timeout_ms);
+
+#ifdef __cplusplus
+}
+#include <memory>
+
+struct QuAPIPollerDeleter {
+  void operator()(quapi_poller* p) { quapi_poller_release(p); }
+};
+
+using QuAPIPoller = std::unique_ptr<quapi_poller, QuAPIPollerDeleter>;
+#endif
+
+#endif
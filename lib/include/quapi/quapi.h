@@ -7,8 +7,149 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
 #include <stdint.h>
 
+/**
+ * Maximum number of file descriptors returned by quapi_get_fds.
+ */
+#define QUAPI_MAX_FDS 5
+
+/**
+ * Returned by quapi_solve if the solve was stopped because its timeout or
+ * deadline passed. Negative, so it cannot collide with exit codes.
+ */
+#define QUAPI_TIMEOUT -1
+
+typedef enum quapi_placement_policy {
+  // Leave placement to the kernel.
+  QUAPI_PLACEMENT_NONE,
+  // Pin solver children to the CPUs of their node in turn.
+  QUAPI_PLACEMENT_ROUND_ROBIN,
+  // Pin solver children to the CPU of their node running the fewest solver
+  // children of this process.
+  QUAPI_PLACEMENT_LEAST_LOADED,
+} quapi_placement_policy;
+
+typedef enum quapi_phase {
+  // The seeding process still parsed clauses after the fork was requested.
+  QUAPI_PHASE_FORMULA,
+  // fork() of the solver child in the seeding process.
+  QUAPI_PHASE_FORK,
+  // Sending and parsing assumptions, until the solver child read SOLVE.
+  QUAPI_PHASE_ASSUMPTIONS,
+  // The solver itself, until it exited or printed the deciding output.
+  QUAPI_PHASE_SOLVER,
+  // Until the library decided the result from the exit code or output.
+  QUAPI_PHASE_RESULT,
+  QUAPI_PHASE_COUNT,
+} quapi_phase;
+
+/**
+ * Buckets of a quapi_histogram. Values below 8 have their own bucket, larger
+ * ones share a bucket with values of less than 12.5% difference.
+ */
+#define QUAPI_HISTOGRAM_BUCKETS 496
+
+typedef struct quapi_histogram {
+  uint64_t count;
+  uint64_t min_ns;
+  uint64_t max_ns;
+  uint64_t sum_ns;
+  uint64_t buckets[QUAPI_HISTOGRAM_BUCKETS];
+} quapi_histogram;
+
+/**
+ * Resources a solver child used, as reported by wait4() in the seeding
+ * process. The maximum RSS of a child starts with the RSS of the seeding
+ * process at the fork, so it includes the parsed formula.
+ */
+typedef struct quapi_rusage {
+  uint64_t user_us;
+  uint64_t system_us;
+  uint64_t max_rss_kib;
+  uint64_t minor_faults;
+  uint64_t major_faults;
+  uint64_t voluntary_switches;
+  uint64_t involuntary_switches;
+} quapi_rusage;
+
+/**
+ * Performance counters of a solver child and everything it started, counted
+ * in user space. Only measured if the QUAPI_PERF_COUNTERS environment variable
+ * is set for the solver. Counters the kernel does not permit (see
+ * perf_event_paranoid) or support are 0.
+ */
+typedef struct quapi_perf_counters {
+  uint64_t cycles;
+  uint64_t instructions;
+  uint64_t cache_misses;
+  uint64_t page_faults;
+} quapi_perf_counters;
+
+typedef struct quapi_solve_stats {
+  // Durations of the phases in ns. Phases that could not be measured (e.g.
+  // forks of pre-forked children) are 0.
+  uint64_t phase_ns[QUAPI_PHASE_COUNT];
+  // From the first assumption (or the solve call) until the result.
+  uint64_t latency_ns;
+  // Messages sent to the seeding process and solver children since the
+  // previous solve ended, including clauses.
+  uint64_t messages_sent;
+  uint64_t bytes_sent;
+  // Bytes of solver child output scanned for results, models or the stdout
+  // callback.
+  uint64_t stdout_bytes;
+  // Only known if the exit of the solver child ended the solve, not if a SAT
+  // regex or the stdout callback decided it before. The total has the
+  // maximum of max_rss_kib instead of the sum.
+  quapi_rusage rusage;
+  // Known in the same cases as rusage.
+  quapi_perf_counters perf;
+  // Placement of the seeding process and the CPU the solver child was pinned
+  // to, see quapi_set_placement. -1 if unplaced. The total has those of the
+  // last solve.
+  int numa_node;
+  int solverchild_cpu;
+} quapi_solve_stats;
+
+typedef struct quapi_stats {
+  // From quapi_init until the seeding process read the header.
+  uint64_t exec_ns;
+  // Finished solves. Solves aborted by quapi_reset_assumptions do not count.
+  uint64_t solves;
+  quapi_solve_stats last;
+  // Sums over all finished solves.
+  quapi_solve_stats total;
+  quapi_histogram phases[QUAPI_PHASE_COUNT];
+  quapi_histogram latency;
+} quapi_stats;
+
+typedef struct quapi_placement {
+  quapi_placement_policy policy;
+  // NUMA node for all seeding processes, or -1 to distribute seeding processes
+  // over the nodes in turn.
+  int numa_node;
+  // Bind the memory of seeding processes and their children to their node.
+  bool bind_memory;
+} quapi_placement;
+
+typedef struct quapi_admission {
+  // Maximum number of concurrently running solver children of this process,
+  // 0 for no limit.
+  unsigned max_children;
+  // Admit no new solver child while the memory pressure (PSI "some avg10", in
+  // percent) is above this value. 0 disables the check.
+  double max_pressure;
+  // Admit no new solver child while MemAvailable minus the private memory of
+  // the largest running child is below this many bytes. 0 disables the check.
+  uint64_t min_available;
+  // Stop the youngest working solver child once MemAvailable drops below this
+  // many bytes, instead of leaving the choice to the OOM killer. 0 disables
+  // the background monitor.
+  uint64_t kill_below_available;
+} quapi_admission;
+
 /**
  * Return the name and the version of the incremental SAT solving library.
  */
@@ -32,6 +173,27 @@ quapi_init(const char* path,
            const char* SAT_regex,
            const char* UNSAT_regex);
 
+/**
+ * Like quapi_init, but reserve reserved_clauses clauses in addition to
+ * clausecount. Clauses added after the first solve are parsed by the seeding
+ * process and inherited by all later solver children, so incremental
+ * workflows do not need a new solver for every refinement. Solver children
+ * pad the budget that is not used yet with filler clauses.
+ *
+ * Required state: N/A
+ * State after: INPUT
+ */
+quapi_solver*
+quapi_init_reserved(const char* path,
+                    const char** argv,
+                    const char** envp,
+                    int litcount,
+                    int clausecount,
+                    int prefixdepth,
+                    int reserved_clauses,
+                    const char* SAT_regex,
+                    const char* UNSAT_regex);
+
 /**
  * Release the solver, i.e., all its resoruces and allocated memory
  * (destructor). The solver pointer cannot be used for any purposes after this
@@ -54,6 +216,10 @@ quapi_release(quapi_solver* solver);
  * have to be smaller or equal to INT32_MAX and strictly larger than INT32_MIN
  * (to avoid negation overflow). This applies to all the literal arguments in
  * API functions.
+ *
+ * At most clausecount clauses plus the clauses reserved in
+ * quapi_init_reserved can be added, also between solves. Literals of further
+ * clauses are dropped and an error is printed.
  */
 void
 quapi_add(quapi_solver* solver, int32_t lit_or_zero);
@@ -95,6 +261,11 @@ quapi_assume(quapi_solver* solver, int32_t lit_or_zero);
  * executed to be able to re-use the same solver later. This is similar to
  * having an empty assumption set.
  *
+ * If a timeout or deadline is set and passes before the result is known, the
+ * solver child receives SIGTERM and, after the kill grace period, SIGKILL. The
+ * function then returns QUAPI_TIMEOUT, unless the solver still reported a
+ * result in between.
+ *
  * Required state: INPUT_LITERALS | INPUT_ASSUMPTIONS
  * State after: INPUT_LITERALS
  */
@@ -108,12 +279,288 @@ quapi_solve(quapi_solver* solver);
 void
 quapi_terminate(quapi_solver* solver);
 
+/**
+ * Set a wall-clock time limit in nanoseconds for every following solve. 0
+ * disables the limit. The limit is enforced by the solving loop itself, no
+ * extra thread is required.
+ */
+void
+quapi_set_timeout(quapi_solver* solver, uint64_t timeout_ns);
+
+/**
+ * Set an absolute deadline (CLOCK_MONOTONIC, in nanoseconds) for the next
+ * solve only. If a timeout is also set, the earlier of both applies. 0 clears
+ * the deadline.
+ */
+void
+quapi_set_deadline(quapi_solver* solver, uint64_t deadline_ns);
+
+/**
+ * Set the time in nanoseconds between SIGTERM and SIGKILL once a solve timed
+ * out. Defaults to one second. With 0, SIGKILL is sent right away.
+ */
+void
+quapi_set_kill_grace_period(quapi_solver* solver, uint64_t grace_ns);
+
+/**
+ * Do not wait for the seeding process to report the PID of a new solver child
+ * before sending its assumptions. FORK is sent at the first assumption (or
+ * solve) and the assumptions are flushed together with SOLVE, while the PID
+ * is read asynchronously once it arrives or is needed. Disabled by default.
+ *
+ * Required state: INPUT | INPUT_LITERALS
+ * State after: Unchanged
+ */
+bool
+quapi_set_pipelined_fork(quapi_solver* solver, bool enable);
+
+/**
+ * Keep count solver children pre-forked from the seeding process, parked
+ * before reading their assumptions. The next solve hands its assumptions to
+ * the oldest of them instead of waiting for a fork, and a replacement is
+ * forked in the background while it solves. 0 disables the pool.
+ *
+ * The pool is filled at the first solve and dropped whenever quapi_add adds
+ * clauses, as its children would not know them. Pool children are killed once
+ * their result was read.
+ *
+ * Required state: INPUT | INPUT_LITERALS
+ * State after: Unchanged
+ */
+bool
+quapi_set_prefork(quapi_solver* solver, unsigned count);
+
+/**
+ * Copy the statistics of all solves since quapi_init or the last
+ * quapi_reset_stats into stats. Phases are measured with timestamps the
+ * seeding process and solver children send to the library.
+ *
+ * Required state: Any
+ * State after: Unchanged
+ */
+void
+quapi_get_stats(quapi_solver* solver, quapi_stats* stats);
+
+/**
+ * Reset all statistics, except the exec time.
+ */
+void
+quapi_reset_stats(quapi_solver* solver);
+
+/**
+ * Record a value in ns in the histogram, which has to be zeroed before the
+ * first value is recorded.
+ */
+void
+quapi_histogram_record(quapi_histogram* histogram, uint64_t ns);
+
+/**
+ * Return an upper bound of the given percentile (0 to 100) of the values
+ * recorded in the histogram, at most 12.5% above the exact value. 0 if the
+ * histogram is empty.
+ */
+uint64_t
+quapi_histogram_percentile(const quapi_histogram* histogram,
+                           double percentile);
+
+/**
+ * Save the formula added so far as a checkpoint. The seeding process forks,
+ * its parent stays as a copy-on-write snapshot and the child continues as
+ * seeding process, so quapi_get_pid changes. Checkpoints nest like a stack.
+ * Returns the number of the checkpoint (1 for the oldest one), 0 on errors.
+ *
+ * Required state: INPUT | INPUT_LITERALS, with no open clause or quantifier
+ * block. At most QUAPI_MAX_CHECKPOINTS checkpoints can exist at once.
+ * State after: Unchanged
+ */
+int
+quapi_checkpoint(quapi_solver* solver);
+
+/**
+ * Drop everything added since the given checkpoint. The current seeding
+ * process and the snapshots of newer checkpoints exit, and a new seeding
+ * process is forked from the snapshot of the checkpoint, which stays
+ * available for further rollbacks. Returns false if the checkpoint does not
+ * exist or could not be resumed.
+ *
+ * Required state: INPUT | INPUT_LITERALS, with no open clause or quantifier
+ * block
+ * State after: The state at the time of the checkpoint
+ */
+bool
+quapi_rollback(quapi_solver* solver, int checkpoint);
+
+/**
+ * Keep everything added since the given checkpoint, but drop its snapshot and
+ * the ones of all newer checkpoints.
+ *
+ * Required state: INPUT | INPUT_LITERALS, with no open clause or quantifier
+ * block
+ * State after: Unchanged
+ */
+bool
+quapi_drop_checkpoint(quapi_solver* solver, int checkpoint);
+
+/**
+ * Start solving like quapi_solve, but return immediately instead of waiting
+ * for the result. Drive the solve by waiting on the file descriptors from
+ * quapi_get_fds and calling quapi_process_events whenever one of them becomes
+ * readable, or let a quapi_poller do this for many solvers at once.
+ *
+ * Returns false if the solve could not be started.
+ *
+ * Required state: INPUT_LITERALS | INPUT_ASSUMPTIONS
+ * State after: WORKING
+ */
+bool
+quapi_solve_start(quapi_solver* solver);
+
+/**
+ * Process all pending events of a solve started with quapi_solve_start without
+ * blocking. Returns true once the solve is done and writes its result (the
+ * same value quapi_solve would have returned) into result, which may be NULL.
+ * Returns false while the solver is still working, or if no non-blocking solve
+ * is running.
+ *
+ * Required state: WORKING
+ * State after: WORKING, or INPUT_LITERALS if true was returned
+ */
+bool
+quapi_process_events(quapi_solver* solver, int* result);
+
+/**
+ * Write the file descriptors a running solve has to be woken up for into fds
+ * and return how many there are, at most QUAPI_MAX_FDS. If fds_size is too
+ * small, only the first fds_size descriptors are written. All descriptors
+ * have to be watched for readability. One of them belongs to the solver child
+ * of the current solve, so they have to be queried again after every
+ * quapi_solve_start. With pipelined forks, the PID of the solver child may not
+ * be known yet. Its descriptor is only added once quapi_process_events read
+ * the fork report, so query the descriptors again whenever
+ * quapi_process_events returned false.
+ */
+size_t
+quapi_get_fds(quapi_solver* solver, int* fds, size_t fds_size);
+
+/**
+ * Return true if the last solve was ended by quapi_terminate.
+ */
+bool
+quapi_was_terminated(quapi_solver* solver);
+
 void
 quapi_reset_assumptions(quapi_solver* solver);
 
 quapi_state
 quapi_get_state(quapi_solver* solver);
 
+/**
+ * Return the PID of the seeding process, i.e., the solver process that holds
+ * the parsed formula and forks a new solving child for every solve call. Can be
+ * used to monitor the resources the seeding process occupies.
+ */
+int
+quapi_get_pid(quapi_solver* solver);
+
+/**
+ * Set the CPU and NUMA placement for all solvers initialized afterwards by
+ * this process. Seeding processes are pinned to the CPUs of one node and may
+ * have their memory bound to it, so copy-on-write pages of forked solver
+ * children stay local. Every solver child is pinned to a single CPU of the
+ * node of its seeding process. NULL disables placement.
+ */
+void
+quapi_set_placement(const quapi_placement* placement);
+
+/**
+ * Return the NUMA node the seeding process was placed on, or -1.
+ */
+int
+quapi_get_numa_node(quapi_solver* solver);
+
+/**
+ * Return the CPU the last solver child was pinned to, or -1.
+ */
+int
+quapi_get_solverchild_cpu(quapi_solver* solver);
+
+/**
+ * Set the admission control for solver children of all solvers in this
+ * process. Solver children are still forked, but only start solving once they
+ * are admitted. quapi_solve waits for the admission. Solves started using
+ * quapi_solve_start never block, they are started by quapi_process_events
+ * once another solver child finished, so single-threaded event loops keep
+ * running. One child is always admitted, so progress is guaranteed. Solves
+ * stopped because memory ran low return 0, like after quapi_terminate. NULL
+ * disables admission control.
+ */
+void
+quapi_set_admission(const quapi_admission* admission);
+
+/**
+ * Return the number of currently admitted solver children of this process.
+ */
+unsigned
+quapi_get_admitted_children();
+
+/**
+ * Return how many solver children were stopped because memory ran low.
+ */
+unsigned
+quapi_get_stopped_children();
+
+/**
+ * Track the model solver children print in SAT competition "v" lines, so it
+ * can be queried using quapi_val. Values are parsed while the output is read
+ * and stored for the variables of the formula. The output of solver children
+ * is read for this. A result of 10 matched by the SAT regex is only returned
+ * once the model was read completely or the solver child exited. Returns
+ * false if the model could not be allocated.
+ *
+ * Required state: INPUT, INPUT_LITERALS
+ */
+bool
+quapi_track_model(quapi_solver* solver, bool enable);
+
+/**
+ * Return lit if it is true in the model of the last solve, -lit if it is
+ * false, and 0 if its value is unknown or models are not tracked. Models are
+ * kept until the next solve starts, like the values of ipasir_val.
+ */
+int32_t
+quapi_val(quapi_solver* solver, int32_t lit);
+
+/**
+ * Compute a subset-minimal set of failed assumptions, like ipasir_failed but
+ * for solvers without incremental interfaces. Up to parallel probes (0 for
+ * the number of online CPUs) solve the formula under subsets of the
+ * assumptions at the same time, each in its own child forked from the parsed
+ * formula. Probes are killed as soon as another probe implies their result.
+ *
+ * Results are decided by the SAT and UNSAT regex or the exit code, the stdout
+ * callback is not used. The timeout of the solver applies to every probe, a
+ * probe without a result keeps its assumptions in the core. Probes count as
+ * solver children for quapi_set_admission, fewer of them run at once if they
+ * are not admitted.
+ *
+ * For QBF, the leading assumptions up to the last one that assigns a
+ * universal quantifier are kept in every probe and are always part of the
+ * core. Only the assumptions after them are deleted.
+ *
+ * Returns true and writes the core to core (room for size assumptions) and
+ * its length to core_size if the assumptions are UNSAT. Returns false if they
+ * are SAT, could not be shown UNSAT or on errors.
+ *
+ * Required state: INPUT, INPUT_LITERALS
+ */
+bool
+quapi_failed_core(quapi_solver* solver,
+                  const int32_t* assumptions,
+                  size_t size,
+                  unsigned parallel,
+                  int32_t* core,
+                  size_t* core_size);
+
 /** @brief Sets a callback function with userdata to process STDOUT.
  *
  * Once the callback function returns != 0, STDOUT handling is stopped (similar
@@ -0,0 +1,97 @@
+#ifndef QUAPI_REACTOR_H
+#define QUAPI_REACTOR_H
+
+#include <quapi/poller.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A reactor is a library-owned thread that drives non-blocking solves in the
+ * background, so the application neither has to block in quapi_solve nor to
+ * integrate a poll loop. Started solves are handed over to the reactor using
+ * quapi_reactor_add. Results are either given to a callback (called from the
+ * reactor thread) or queued until they are fetched with quapi_reactor_wait.
+ */
+typedef struct quapi_reactor quapi_reactor;
+
+typedef enum quapi_reactor_backend {
+  QUAPI_REACTOR_EPOLL,
+  // Falls back to QUAPI_REACTOR_EPOLL if the kernel does not support io_uring.
+  QUAPI_REACTOR_IO_URING,
+} quapi_reactor_backend;
+
+/** @brief Function signature for results delivered by a reactor.
+ *
+ * Called from the reactor thread, which cannot process other solvers while the
+ * callback is running.
+ */
+typedef void (*quapi_reactor_cb)(const quapi_poller_event* event,
+                                 void* userdata);
+
+/**
+ * Create a reactor and start its thread. If cb is NULL, results are queued for
+ * quapi_reactor_wait. Returns NULL on errors.
+ */
+quapi_reactor*
+quapi_reactor_init(quapi_reactor_backend backend,
+                   quapi_reactor_cb cb,
+                   void* cb_userdata);
+
+/**
+ * Stop the reactor thread and release the reactor. Solvers still handed to the
+ * reactor stay WORKING, so all solves should be finished or terminated before.
+ */
+void
+quapi_reactor_release(quapi_reactor* reactor);
+
+/**
+ * Return the backend that is actually used by the reactor.
+ */
+quapi_reactor_backend
+quapi_reactor_get_backend(quapi_reactor* reactor);
+
+/**
+ * Hand a solver with a running non-blocking solve over to the reactor. The
+ * solver must not be used until its result was delivered, except for
+ * quapi_terminate. May be called from any thread. Returns false on errors.
+ *
+ * Required state: WORKING, started using quapi_solve_start
+ */
+bool
+quapi_reactor_add(quapi_reactor* reactor,
+                  quapi_solver* solver,
+                  void* userdata);
+
+/**
+ * Fetch up to max_events queued results, waiting at most timeout_ms
+ * milliseconds (-1 waits forever) if none are available. Returns the number of
+ * fetched results, or -1 on errors. Must not be called from multiple threads
+ * at once.
+ */
+int
+quapi_reactor_wait(quapi_reactor* reactor,
+                   quapi_poller_event* events,
+                   int max_events,
+                   int timeout_ms);
+
+/**
+ * Return a file descriptor that becomes readable when results are queued, to
+ * integrate the reactor into an existing event loop.
+ */
+int
+quapi_reactor_get_fd(quapi_reactor* reactor);
+
+#ifdef __cplusplus
+}
+#include <memory>
+
+struct QuAPIReactorDeleter {
+  void operator()(quapi_reactor* r) { quapi_reactor_release(r); }
+};
+
+using QuAPIReactor = std::unique_ptr<quapi_reactor, QuAPIReactorDeleter>;
+#endif
+
+#endif
@@ -0,0 +1,375 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <quapi_export.h>
+
+#include "admission.h"
+#include "procfs.h"
+#include "stats.h"
+
+// Interval to re-check memory while blocking solves wait for admission.
+#define RECHECK_NS 100000000
+// Interval of the monitor if PSI triggers are not available.
+#define MONITOR_INTERVAL_MS 250
+// Time to let memory recover after stopping a child.
+#define KILL_COOLDOWN_NS 1000000000
+
+typedef struct admitted_child {
+  const void* owner;
+  pid_t pid;
+  uint64_t started_ns;
+  // Eventfd of the owner, which stops the child once woken up. -1 for
+  // children that cannot be stopped.
+  int wakeup_fd;
+  bool stop_requested;
+} admitted_child;
+
+/* Owner whose non-blocking solve waits for admission. */
+typedef struct waiting_owner {
+  const void* owner;
+  int wakeup_fd;
+} waiting_owner;
+
+static pthread_mutex_t admission_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t admission_cond = PTHREAD_COND_INITIALIZER;
+
+static quapi_admission admission;
+
+static admitted_child* children = NULL;
+static size_t children_size = 0;
+static size_t children_capacity = 0;
+
+static waiting_owner* waiting = NULL;
+static size_t waiting_size = 0;
+static size_t waiting_capacity = 0;
+
+static pthread_t monitor;
+static bool monitor_running = false;
+static int monitor_wakeup_fd = -1;
+static uint64_t last_kill_ns = 0;
+static unsigned killed_children = 0;
+
+static uint64_t
+read_mem_available() {
+  FILE* f = fopen("/proc/meminfo", "r");
+  if(!f)
+    return UINT64_MAX;
+  char line[256];
+  uint64_t kb = UINT64_MAX;
+  while(fgets(line, sizeof(line), f)) {
+    unsigned long long v;
+    if(sscanf(line, "MemAvailable: %llu kB", &v) == 1) {
+      kb = v;
+      break;
+    }
+  }
+  fclose(f);
+  return kb == UINT64_MAX ? kb : kb * 1024;
+}
+
+static double
+read_memory_pressure() {
+  FILE* f = fopen("/proc/pressure/memory", "r");
+  if(!f)
+    return 0;
+  double avg10 = 0;
+  if(fscanf(f, "some avg10=%lf", &avg10) != 1)
+    avg10 = 0;
+  fclose(f);
+  return avg10;
+}
+
+static bool
+admissible() {
+  if(admission.max_children > 0 && children_size >= admission.max_children)
+    return false;
+
+  // Always let one child run, otherwise nothing would ever finish.
+  if(children_size == 0)
+    return true;
+
+  if(admission.max_pressure > 0 &&
+     read_memory_pressure() > admission.max_pressure)
+    return false;
+
+  if(admission.min_available > 0) {
+    // Expect the new child to grow as large as the largest running one.
+    uint64_t expected = 0;
+    for(size_t i = 0; i < children_size; ++i) {
+      uint64_t rss = procfs_private_rss(children[i].pid);
+      if(rss > expected)
+        expected = rss;
+    }
+    if(read_mem_available() < admission.min_available + expected)
+      return false;
+  }
+
+  return true;
+}
+
+static void
+write_eventfd(int fd) {
+  uint64_t one = 1;
+  write(fd, &one, sizeof(one));
+}
+
+/* Memory may have been freed, let waiting solves re-check. */
+static void
+wake_waiting() {
+  pthread_cond_broadcast(&admission_cond);
+  for(size_t i = 0; i < waiting_size; ++i)
+    write_eventfd(waiting[i].wakeup_fd);
+}
+
+/* The monitor does not touch solvers of other threads. It asks the owner of
+ * the child to stop it, like quapi_terminate. */
+static void
+kill_youngest_child() {
+  admitted_child* youngest = NULL;
+  for(size_t i = 0; i < children_size; ++i) {
+    admitted_child* c = &children[i];
+    if(c->stop_requested || c->wakeup_fd == -1)
+      continue;
+    if(!youngest || c->started_ns > youngest->started_ns)
+      youngest = c;
+  }
+  if(!youngest)
+    return;
+
+  err("Memory is running low, stopping the youngest solver child %d!",
+      youngest->pid);
+  youngest->stop_requested = true;
+  write_eventfd(youngest->wakeup_fd);
+  last_kill_ns = stats_now_ns();
+  ++killed_children;
+}
+
+static void*
+monitor_main(void* arg) {
+  (void)arg;
+
+  // Wake up early when the kernel reports memory stalls. Unprivileged
+  // triggers need a window of a multiple of 2s.
+  int psi_fd = open("/proc/pressure/memory", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  if(psi_fd != -1) {
+    const char trigger[] = "some 150000 2000000";
+    if(write(psi_fd, trigger, sizeof(trigger)) == -1) {
+      dbg("Could not create PSI trigger: %s", strerror(errno));
+      close(psi_fd);
+      psi_fd = -1;
+    }
+  }
+
+  struct pollfd fds[2] = { { .fd = monitor_wakeup_fd, .events = POLLIN },
+                           { .fd = psi_fd, .events = POLLPRI } };
+
+  for(;;) {
+    poll(fds, psi_fd != -1 ? 2 : 1, MONITOR_INTERVAL_MS);
+
+    pthread_mutex_lock(&admission_mutex);
+    if(admission.kill_below_available == 0) {
+      pthread_mutex_unlock(&admission_mutex);
+      break;
+    }
+    if(stats_now_ns() - last_kill_ns >= KILL_COOLDOWN_NS &&
+       read_mem_available() < admission.kill_below_available)
+      kill_youngest_child();
+
+    wake_waiting();
+    pthread_mutex_unlock(&admission_mutex);
+  }
+
+  if(psi_fd != -1)
+    close(psi_fd);
+  return NULL;
+}
+
+QUAPI_EXPORT void
+quapi_set_admission(const quapi_admission* a) {
+  pthread_mutex_lock(&admission_mutex);
+  if(a)
+    admission = *a;
+  else
+    memset(&admission, 0, sizeof(admission));
+
+  bool start = admission.kill_below_available > 0 && !monitor_running;
+  bool stop = admission.kill_below_available == 0 && monitor_running;
+
+  if(start) {
+    if(monitor_wakeup_fd == -1)
+      monitor_wakeup_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    int e = pthread_create(&monitor, NULL, monitor_main, NULL);
+    if(e != 0)
+      err("Could not start memory monitor! Error: %s", strerror(e));
+    monitor_running = e == 0;
+  }
+
+  wake_waiting();
+  pthread_mutex_unlock(&admission_mutex);
+
+  if(stop) {
+    write_eventfd(monitor_wakeup_fd);
+    pthread_join(monitor, NULL);
+    monitor_running = false;
+  }
+}
+
+QUAPI_EXPORT unsigned
+quapi_get_admitted_children() {
+  pthread_mutex_lock(&admission_mutex);
+  unsigned n = children_size;
+  pthread_mutex_unlock(&admission_mutex);
+  return n;
+}
+
+QUAPI_EXPORT unsigned
+quapi_get_stopped_children() {
+  pthread_mutex_lock(&admission_mutex);
+  unsigned n = killed_children;
+  pthread_mutex_unlock(&admission_mutex);
+  return n;
+}
+
+static void
+remove_waiting(const void* owner) {
+  for(size_t i = 0; i < waiting_size; ++i) {
+    if(waiting[i].owner == owner) {
+      waiting[i] = waiting[--waiting_size];
+      return;
+    }
+  }
+}
+
+/* Admission mutex must be held. */
+static void
+admit(const void* owner, pid_t pid, int wakeup_fd) {
+  remove_waiting(owner);
+
+  if(children_size == children_capacity) {
+    size_t capacity = children_capacity ? children_capacity * 2 : 16;
+    admitted_child* c = realloc(children, capacity * sizeof(admitted_child));
+    if(!c) {
+      err("Could not grow admitted children!");
+      return;
+    }
+    children = c;
+    children_capacity = capacity;
+  }
+  children[children_size++] = (admitted_child){ .owner = owner,
+                                                .pid = pid,
+                                                .started_ns = stats_now_ns(),
+                                                .wakeup_fd = wakeup_fd,
+                                                .stop_requested = false };
+}
+
+void
+admission_acquire(const void* owner, pid_t pid, int wakeup_fd) {
+  pthread_mutex_lock(&admission_mutex);
+
+  bool waited = false;
+  while(!admissible()) {
+    if(!waited) {
+      dbg("Child %d waits for admission.", pid);
+      waited = true;
+    }
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += RECHECK_NS;
+    if(deadline.tv_nsec >= 1000000000) {
+      deadline.tv_nsec -= 1000000000;
+      ++deadline.tv_sec;
+    }
+    pthread_cond_timedwait(&admission_cond, &admission_mutex, &deadline);
+  }
+  admit(owner, pid, wakeup_fd);
+
+  pthread_mutex_unlock(&admission_mutex);
+}
+
+static bool
+add_waiting(const void* owner, pid_t pid, int wakeup_fd) {
+  for(size_t i = 0; i < waiting_size; ++i)
+    if(waiting[i].owner == owner)
+      return true;
+
+  if(waiting_size == waiting_capacity) {
+    size_t capacity = waiting_capacity ? waiting_capacity * 2 : 16;
+    waiting_owner* w = realloc(waiting, capacity * sizeof(waiting_owner));
+    if(!w)
+      return false;
+    waiting = w;
+    waiting_capacity = capacity;
+  }
+  dbg("Child %d waits for admission.", pid);
+  waiting[waiting_size++] =
+    (waiting_owner){ .owner = owner, .wakeup_fd = wakeup_fd };
+  return true;
+}
+
+bool
+admission_try_acquire(const void* owner, pid_t pid, int wakeup_fd) {
+  pthread_mutex_lock(&admission_mutex);
+
+  bool admitted = admissible();
+  if(!admitted && wakeup_fd != -1 && !add_waiting(owner, pid, wakeup_fd)) {
+    // Without wakeups, the solve would never start.
+    err("Could not grow waiting solvers, admitting anyway!");
+    admitted = true;
+  }
+  if(admitted)
+    admit(owner, pid, wakeup_fd);
+
+  pthread_mutex_unlock(&admission_mutex);
+  return admitted;
+}
+
+void
+admission_child_started(const void* owner, pid_t pid) {
+  pthread_mutex_lock(&admission_mutex);
+  for(size_t i = 0; i < children_size; ++i) {
+    if(children[i].owner == owner) {
+      children[i].pid = pid;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&admission_mutex);
+}
+
+bool
+admission_stop_requested(const void* owner) {
+  pthread_mutex_lock(&admission_mutex);
+  bool stop = false;
+  for(size_t i = 0; i < children_size; ++i) {
+    if(children[i].owner == owner) {
+      stop = children[i].stop_requested;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&admission_mutex);
+  return stop;
+}
+
+void
+admission_release(const void* owner) {
+  pthread_mutex_lock(&admission_mutex);
+  remove_waiting(owner);
+  for(size_t i = 0; i < children_size; ++i) {
+    if(children[i].owner == owner) {
+      children[i] = children[--children_size];
+      break;
+    }
+  }
+  wake_waiting();
+  pthread_mutex_unlock(&admission_mutex);
+}
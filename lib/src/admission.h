@@ -0,0 +1,40 @@
+#ifndef QUAPI_ADMISSION_H
+#define QUAPI_ADMISSION_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include <quapi/quapi.h>
+
+/* Memory-pressure-aware admission control for solver children, configured
+ * process-wide using quapi_set_admission. Children are identified by their
+ * owner, the solver of a regular solver child or the probe of a probe child.
+ * Probe children have no wakeup_fd (-1), they are never stopped. */
+
+/* Wait until the child of the owner may start solving. Once admitted, the
+ * child may be asked to stop by writing to wakeup_fd, see
+ * admission_stop_requested. */
+void
+admission_acquire(const void* owner, pid_t pid, int wakeup_fd);
+
+/* Admit the child of the owner without waiting if possible. Otherwise the
+ * owner waits for admission and wakeup_fd is written to whenever it should try
+ * again. Owners without wakeup_fd do not wait. */
+bool
+admission_try_acquire(const void* owner, pid_t pid, int wakeup_fd);
+
+/* The admitted child was forked with the given PID. */
+void
+admission_child_started(const void* owner, pid_t pid);
+
+/* The admitted child of the owner has to be stopped because memory runs
+ * low. */
+bool
+admission_stop_requested(const void* owner);
+
+/* The child of the owner finished or does not wait for admission any more,
+ * admit the next one. */
+void
+admission_release(const void* owner);
+
+#endif
@@ -0,0 +1,226 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <quapi/quapi.h>
+#include <quapi_export.h>
+
+#include "probe.h"
+#include "stats.h"
+
+/* Failed assumption cores by parallel deletion.
+ *
+ * Every round tests nested prefixes at the current position: probe m solves
+ * without the m assumptions starting at pos, for m = 1 .. k. Removing more
+ * assumptions can only make the formula easier to satisfy, so if probe m is
+ * UNSAT, all probes with fewer removals are UNSAT too, and if it is SAT, all
+ * probes with more removals are SAT. Probes whose answer is implied that way
+ * are killed right away. Once the round is decided, the longest prefix that
+ * keeps the formula UNSAT is dropped and the assumption after it is part of
+ * the core. Probe 0 checks the full set in the first round.
+ *
+ * Probes without a result (timeouts, unknown exit codes) keep their
+ * assumptions, so the core may be larger than necessary but is never wrong
+ * if probe 0 or a later probe was UNSAT.
+ *
+ * Assumptions for universal quantifiers are never deleted: removing one does
+ * not make the formula easier, and quapi_solve requires them as a prefix.
+ *
+ * Probes are subject to admission control. The first probe of a round waits
+ * for its admission, the others are only started while they are admitted
+ * right away, which makes the round smaller. Waiting for them could block
+ * forever, as the probes of the round are only reaped by this loop. */
+
+static quapi_probe*
+start_deletion_probe(quapi_solver* s,
+                     const int32_t* cur,
+                     size_t n,
+                     size_t pos,
+                     size_t m,
+                     int32_t* scratch,
+                     bool wait,
+                     bool* admitted) {
+  memcpy(scratch, cur, pos * sizeof(int32_t));
+  memcpy(scratch + pos, cur + pos + m, (n - pos - m) * sizeof(int32_t));
+  return probe_start(s, scratch, n - m, wait, admitted);
+}
+
+/* Wait for events of the running probes and settle the ones that finished
+ * or passed their deadline. Returns false on poll errors. */
+static bool
+wait_for_probes(quapi_probe** probes,
+                size_t count,
+                struct pollfd* pfds,
+                ssize_t* lo,
+                size_t* hi) {
+  uint64_t deadline = 0;
+  for(size_t m = 0; m < count; ++m) {
+    struct pollfd* p = &pfds[m * PROBE_POLLFDS];
+    if(!probes[m]) {
+      for(size_t i = 0; i < PROBE_POLLFDS; ++i)
+        p[i] = (struct pollfd){ .fd = -1, .events = 0, .revents = 0 };
+      continue;
+    }
+    probe_get_pollfds(probes[m], p);
+    uint64_t d = probe_deadline(probes[m]);
+    if(d > 0 && (deadline == 0 || d < deadline))
+      deadline = d;
+  }
+
+  int timeout = -1;
+  if(deadline > 0) {
+    uint64_t now = stats_now_ns();
+    timeout = deadline > now ? (deadline - now + 999999) / 1000000 : 0;
+  }
+
+  int r = poll(pfds, count * PROBE_POLLFDS, timeout);
+  if(r == -1 && errno != EINTR) {
+    err("poll() for probes failed! Error: %s", strerror(errno));
+    return false;
+  }
+
+  uint64_t now = stats_now_ns();
+  for(size_t m = 0; m < count; ++m) {
+    if(!probes[m])
+      continue;
+
+    int result = 0;
+    if(probe_process(probes[m], &pfds[m * PROBE_POLLFDS]))
+      result = probe_result(probes[m]);
+    else if(probe_deadline(probes[m]) == 0 || probe_deadline(probes[m]) > now)
+      continue;
+
+    probe_release(probes[m]);
+    probes[m] = NULL;
+    if(result == 20)
+      *lo = MAX(*lo, (ssize_t)m);
+    else
+      *hi = MIN(*hi, m);
+  }
+  return true;
+}
+
+QUAPI_EXPORT bool
+quapi_failed_core(quapi_solver* s,
+                  const int32_t* assumptions,
+                  size_t size,
+                  unsigned parallel,
+                  int32_t* core,
+                  size_t* core_size) {
+  assert(s);
+  assert(assumptions || size == 0);
+  assert(core || size == 0);
+  assert(core_size);
+
+  if(parallel == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    parallel = cpus > 0 ? cpus : 1;
+  }
+
+  int32_t* cur = malloc(sizeof(int32_t) * (size + 1));
+  int32_t* scratch = malloc(sizeof(int32_t) * (size + 1));
+  quapi_probe** probes = calloc(parallel + 1, sizeof(quapi_probe*));
+  struct pollfd* pfds =
+    malloc(sizeof(struct pollfd) * PROBE_POLLFDS * (parallel + 1));
+  bool found = false;
+  if(!cur || !scratch || !probes || !pfds) {
+    err("Could not allocate memory for core extraction!");
+    goto DONE;
+  }
+
+  memcpy(cur, assumptions, sizeof(int32_t) * size);
+  size_t n = size;
+  size_t pos = MIN(size, probe_universal_assumptions(s));
+  bool verified = false;
+
+  while(!verified || pos < n) {
+    // The check of the full set takes one of the parallel slots.
+    size_t k = MIN(n - pos, verified ? parallel : parallel - 1);
+    size_t count = k + 1;
+
+    // All probes removing at most lo assumptions are UNSAT, all removing at
+    // least hi are SAT or unknown.
+    ssize_t lo = verified ? 0 : -1;
+    size_t hi = count;
+
+    size_t first = verified ? 1 : 0;
+    for(size_t m = first; m < count; ++m) {
+      bool admitted;
+      probes[m] = start_deletion_probe(
+        s, cur, n, pos, m, scratch, m == first, &admitted);
+      if(!probes[m] && !admitted) {
+        count = hi = m;
+        break;
+      }
+      if(!probes[m]) {
+        hi = MIN(hi, m);
+        break;
+      }
+    }
+
+    for(;;) {
+      // Kill probes with implied answers.
+      bool running = false;
+      for(size_t m = 0; m < count; ++m) {
+        if(!probes[m])
+          continue;
+        if((ssize_t)m <= lo || m >= hi) {
+          probe_release(probes[m]);
+          probes[m] = NULL;
+        } else {
+          running = true;
+        }
+      }
+      if(!running)
+        break;
+
+      if(!wait_for_probes(probes, count, pfds, &lo, &hi)) {
+        for(size_t m = 0; m < count; ++m) {
+          probe_release(probes[m]);
+          probes[m] = NULL;
+        }
+        goto DONE;
+      }
+    }
+
+    if(lo < 0) {
+      dbg("Assumptions are not UNSAT, there is no failed core.");
+      goto DONE;
+    }
+    verified = true;
+
+    memmove(cur + pos, cur + pos + lo, sizeof(int32_t) * (n - pos - lo));
+    n -= lo;
+    // Probes may contradict each other if some of them timed out. The next
+    // assumption is only known to be necessary if the probe right after the
+    // dropped prefix was not UNSAT.
+    if(hi == (size_t)lo + 1 && hi < count)
+      ++pos;
+
+    dbg("Failed core round removed %zd assumptions, %zu of %zu remain, %zu "
+        "are necessary.",
+        lo,
+        n,
+        size,
+        pos);
+  }
+
+  memcpy(core, cur, sizeof(int32_t) * n);
+  *core_size = n;
+  found = true;
+
+DONE:
+  free(cur);
+  free(scratch);
+  free(probes);
+  free(pfds);
+  return found;
+}
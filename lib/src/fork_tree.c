@@ -0,0 +1,334 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <quapi/fork_tree.h>
+#include <quapi_export.h>
+
+#include "probe.h"
+#include "procfs.h"
+#include "stats.h"
+
+// File descriptors every node holds: input, output, status and pidfd.
+#define NODE_FDS 4
+// File descriptors left to the rest of the process when limiting nodes.
+#define RESERVED_FDS 64
+
+typedef struct tree_node {
+  quapi_probe* probe;
+  // NULL for nodes forked from the seeding process or if the parent was
+  // dropped.
+  struct tree_node* parent;
+  // Assumptions from the root to this node.
+  int32_t* prefix;
+  size_t depth;
+  uint64_t hash;
+  // Next node in the same hash bucket.
+  struct tree_node* next;
+  // Child nodes that are alive. Only nodes without children are evicted.
+  size_t children;
+  uint64_t last_used;
+} tree_node;
+
+typedef struct quapi_fork_tree {
+  quapi_solver* solver;
+  uint64_t memory_budget;
+  size_t max_nodes;
+  // Formula version of the solver when the nodes were forked.
+  uint64_t formula_version;
+
+  tree_node** nodes;
+  size_t nodes_size;
+  size_t nodes_capacity;
+
+  // The nodes indexed by the hash of their prefix. The number of buckets is a
+  // power of two and twice the capacity of nodes.
+  tree_node** buckets;
+  size_t buckets_size;
+
+  uint64_t use_clock;
+} quapi_fork_tree;
+
+static uint64_t
+hash_prefix(const int32_t* cube, size_t depth) {
+  // FNV-1a
+  uint64_t h = 14695981039346656037ULL;
+  for(size_t i = 0; i < depth; ++i) {
+    h ^= (uint32_t)cube[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+static tree_node**
+bucket_of(quapi_fork_tree* t, uint64_t hash) {
+  return &t->buckets[hash & (t->buckets_size - 1)];
+}
+
+static bool
+rehash(quapi_fork_tree* t, size_t buckets_size) {
+  tree_node** buckets = calloc(buckets_size, sizeof(tree_node*));
+  if(!buckets)
+    return false;
+  free(t->buckets);
+  t->buckets = buckets;
+  t->buckets_size = buckets_size;
+  for(size_t i = 0; i < t->nodes_size; ++i) {
+    tree_node** b = bucket_of(t, t->nodes[i]->hash);
+    t->nodes[i]->next = *b;
+    *b = t->nodes[i];
+  }
+  return true;
+}
+
+static tree_node*
+find_node(quapi_fork_tree* t, const int32_t* cube, size_t depth) {
+  if(!t->buckets)
+    return NULL;
+  uint64_t hash = hash_prefix(cube, depth);
+  for(tree_node* n = *bucket_of(t, hash); n; n = n->next) {
+    if(n->depth == depth && n->hash == hash &&
+       memcmp(n->prefix, cube, depth * sizeof(int32_t)) == 0)
+      return n;
+  }
+  return NULL;
+}
+
+static void
+remove_node(quapi_fork_tree* t, tree_node* n) {
+  tree_node** link = bucket_of(t, n->hash);
+  while(*link != n)
+    link = &(*link)->next;
+  *link = n->next;
+
+  for(size_t i = 0; i < t->nodes_size; ++i) {
+    if(t->nodes[i] == n) {
+      t->nodes[i] = t->nodes[--t->nodes_size];
+      --i;
+    } else if(t->nodes[i]->parent == n) {
+      t->nodes[i]->parent = NULL;
+    }
+  }
+  if(n->parent)
+    --n->parent->children;
+
+  dbg("Dropping fork tree node %d of depth %zu", probe_pid(n->probe), n->depth);
+  probe_release(n->probe);
+  free(n->prefix);
+  free(n);
+}
+
+static void
+clear_nodes(quapi_fork_tree* t) {
+  while(t->nodes_size > 0)
+    remove_node(t, t->nodes[t->nodes_size - 1]);
+}
+
+static tree_node*
+add_node(quapi_fork_tree* t,
+         tree_node* parent,
+         const int32_t* cube,
+         size_t depth) {
+  if(t->nodes_size == t->nodes_capacity) {
+    size_t capacity = t->nodes_capacity ? t->nodes_capacity * 2 : 16;
+    tree_node** nodes = realloc(t->nodes, capacity * sizeof(tree_node*));
+    if(!nodes)
+      return NULL;
+    t->nodes = nodes;
+    t->nodes_capacity = capacity;
+    if(!rehash(t, 2 * capacity))
+      return NULL;
+  }
+
+  tree_node* n = malloc(sizeof(tree_node));
+  int32_t* prefix = malloc(depth * sizeof(int32_t));
+  if(!n || !prefix) {
+    free(n);
+    free(prefix);
+    return NULL;
+  }
+
+  size_t parent_depth = parent ? parent->depth : 0;
+  n->probe = probe_fork(t->solver,
+                        parent ? parent->probe : NULL,
+                        cube + parent_depth,
+                        depth - parent_depth,
+                        false);
+  if(!n->probe) {
+    free(n);
+    free(prefix);
+    return NULL;
+  }
+
+  memcpy(prefix, cube, depth * sizeof(int32_t));
+  n->parent = parent;
+  n->prefix = prefix;
+  n->depth = depth;
+  n->hash = hash_prefix(cube, depth);
+  n->children = 0;
+  n->last_used = t->use_clock;
+  if(parent)
+    ++parent->children;
+
+  tree_node** b = bucket_of(t, n->hash);
+  n->next = *b;
+  *b = n;
+  t->nodes[t->nodes_size++] = n;
+  return n;
+}
+
+/* Evict idle nodes in LRU order until the nodes fit into the memory budget.
+ * Nodes used for the current cube are always kept. */
+static void
+evict(quapi_fork_tree* t) {
+  uint64_t total = 0;
+  if(t->memory_budget > 0) {
+    for(size_t i = 0; i < t->nodes_size; ++i)
+      total += procfs_private_rss(probe_pid(t->nodes[i]->probe));
+  }
+
+  while((t->memory_budget > 0 && total > t->memory_budget) ||
+        t->nodes_size > t->max_nodes) {
+    tree_node* lru = NULL;
+    for(size_t i = 0; i < t->nodes_size; ++i) {
+      tree_node* n = t->nodes[i];
+      if(n->children == 0 && n->last_used != t->use_clock &&
+         (!lru || n->last_used < lru->last_used))
+        lru = n;
+    }
+    if(!lru)
+      break;
+
+    if(t->memory_budget > 0) {
+      uint64_t rss = procfs_private_rss(probe_pid(lru->probe));
+      total = rss < total ? total - rss : 0;
+    }
+    remove_node(t, lru);
+  }
+}
+
+/* Find the deepest alive node for a prefix of the cube of at most depth
+ * assumptions and mark it and its parents as used. */
+static tree_node*
+find_deepest_node(quapi_fork_tree* t, const int32_t* cube, size_t depth) {
+  tree_node* node = NULL;
+  for(size_t d = depth; d > 0 && !node; --d) {
+    node = find_node(t, cube, d);
+    if(node && !probe_alive(node->probe)) {
+      remove_node(t, node);
+      node = NULL;
+    }
+  }
+  for(tree_node* n = node; n; n = n->parent)
+    n->last_used = t->use_clock;
+  return node;
+}
+
+static int
+wait_for_probe(quapi_probe* p) {
+  struct pollfd pfds[PROBE_POLLFDS];
+  for(;;) {
+    int timeout = -1;
+    uint64_t deadline = probe_deadline(p);
+    if(deadline > 0) {
+      uint64_t now = stats_now_ns();
+      if(now >= deadline)
+        return QUAPI_TIMEOUT;
+      timeout = (deadline - now + 999999) / 1000000;
+    }
+
+    probe_get_pollfds(p, pfds);
+    int r = poll(pfds, PROBE_POLLFDS, timeout);
+    if(r == -1 && errno != EINTR) {
+      err("poll() for fork tree solve failed! Error: %s", strerror(errno));
+      return 0;
+    }
+    if(probe_process(p, pfds))
+      return probe_result(p);
+  }
+}
+
+QUAPI_EXPORT quapi_fork_tree*
+quapi_fork_tree_init(quapi_solver* solver, uint64_t memory_budget) {
+  assert(solver);
+  quapi_fork_tree* t = calloc(1, sizeof(quapi_fork_tree));
+  if(!t) {
+    err("Could not allocate fork tree!");
+    return NULL;
+  }
+  t->solver = solver;
+  t->memory_budget = memory_budget;
+  t->formula_version = probe_formula_version(solver);
+
+  // Every node holds open file descriptors, do not run out of them.
+  struct rlimit limit;
+  t->max_nodes = 256;
+  if(getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+    t->max_nodes = limit.rlim_cur > RESERVED_FDS
+                     ? (limit.rlim_cur - RESERVED_FDS) / NODE_FDS
+                     : 0;
+  return t;
+}
+
+QUAPI_EXPORT void
+quapi_fork_tree_release(quapi_fork_tree* t) {
+  if(!t)
+    return;
+  clear_nodes(t);
+  free(t->nodes);
+  free(t->buckets);
+  free(t);
+}
+
+QUAPI_EXPORT int
+quapi_fork_tree_solve(quapi_fork_tree* t, const int32_t* cube, size_t size) {
+  assert(t);
+  assert(cube || size == 0);
+
+  if(probe_formula_version(t->solver) != t->formula_version) {
+    dbg("The formula changed, dropping all fork tree nodes.");
+    clear_nodes(t);
+    t->formula_version = probe_formula_version(t->solver);
+  }
+
+  ++t->use_clock;
+
+  // The last assumption is added by the solver child itself.
+  size_t depth = size > 0 ? size - 1 : 0;
+  tree_node* node = find_deepest_node(t, cube, depth);
+  for(size_t d = node ? node->depth + 1 : 1; d <= depth; ++d) {
+    tree_node* child = add_node(t, node, cube, d);
+    if(!child)
+      break;
+    node = child;
+  }
+  evict(t);
+
+  size_t node_depth = node ? node->depth : 0;
+  quapi_probe* p = probe_fork(t->solver,
+                              node ? node->probe : NULL,
+                              cube + node_depth,
+                              size - node_depth,
+                              true);
+  if(!p)
+    return 0;
+
+  int result = wait_for_probe(p);
+  probe_release(p);
+  return result;
+}
+
+QUAPI_EXPORT size_t
+quapi_fork_tree_size(quapi_fork_tree* t) {
+  assert(t);
+  return t->nodes_size;
+}
@@ -0,0 +1,105 @@
+#include <string.h>
+
+#include "model.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define MODEL_SWAR
+#endif
+
+#ifdef MODEL_SWAR
+/* Number of leading digit characters in the 8 bytes of chunk, the first
+ * character being the lowest byte. */
+static inline unsigned
+digit_run(uint64_t chunk) {
+  // Digits become 0x00 to 0x09. Every other byte gets a set bit in its high
+  // nibble, either directly or after adding 6 to its low nibble.
+  uint64_t t = chunk ^ 0x3030303030303030ULL;
+  uint64_t nondigit = (t & 0xF0F0F0F0F0F0F0F0ULL) |
+                      (((t & 0x0F0F0F0F0F0F0F0FULL) + 0x0606060606060606ULL) &
+                       0xF0F0F0F0F0F0F0F0ULL);
+  if(!nondigit)
+    return 8;
+  return __builtin_ctzll(nondigit) / 8;
+}
+
+/* Convert the first 1 to 8 digit characters of chunk into their value. */
+static inline uint64_t
+digits_value(uint64_t chunk, unsigned digits) {
+  // Move the digits to the top, the freed bytes read as leading zeros.
+  chunk <<= 8 * (8 - digits);
+  chunk = ((chunk & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+  chunk = ((chunk & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+  return ((chunk & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+}
+#endif
+
+static const uint64_t pow10[9] = { 1,      10,      100,      1000,     10000,
+                                   100000, 1000000, 10000000, 100000000 };
+
+/* Parse the digits at *p, at most up to end, and advance *p behind them.
+ * Returns the number of digits. Values above UINT32_MAX saturate. */
+static size_t
+parse_number(const char** p, const char* end, uint64_t* value) {
+  const char* begin = *p;
+  uint64_t v = 0;
+
+#ifdef MODEL_SWAR
+  while(end - *p >= 8) {
+    uint64_t chunk;
+    memcpy(&chunk, *p, sizeof(chunk));
+    unsigned digits = digit_run(chunk);
+    if(digits > 0)
+      v = v * pow10[digits] + digits_value(chunk, digits);
+    *p += digits;
+    if(v > UINT32_MAX)
+      v = UINT32_MAX;
+    if(digits < 8) {
+      *value = v;
+      return *p - begin;
+    }
+  }
+#endif
+
+  while(*p < end && **p >= '0' && **p <= '9') {
+    v = v * 10 + (**p - '0');
+    if(v > UINT32_MAX)
+      v = UINT32_MAX;
+    ++*p;
+  }
+  *value = v;
+  return *p - begin;
+}
+
+bool
+model_parse_value_line(const char* line,
+                       size_t length,
+                       int8_t* values,
+                       size_t values_size) {
+  const char* p = line;
+  const char* end = line + length;
+
+  while(p < end) {
+    if(*p == ' ' || *p == '\t' || *p == '\r') {
+      ++p;
+      continue;
+    }
+
+    bool negative = *p == '-';
+    if(negative)
+      ++p;
+
+    uint64_t var;
+    if(!parse_number(&p, end, &var)) {
+      // Not a literal, skip the token.
+      while(p < end && *p != ' ' && *p != '\t')
+        ++p;
+      continue;
+    }
+
+    if(var == 0)
+      return true;
+    if(var < values_size)
+      values[var] = negative ? -1 : 1;
+  }
+  return false;
+}
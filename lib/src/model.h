@@ -0,0 +1,18 @@
+#ifndef QUAPI_MODEL_H
+#define QUAPI_MODEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Parse the literals of a SAT competition value line after the leading 'v'
+ * into values, which holds 1 (true) or -1 (false) for every variable below
+ * values_size. Larger variables are skipped. Returns true once the
+ * terminating 0 of the model was read. */
+bool
+model_parse_value_line(const char* line,
+                       size_t length,
+                       int8_t* values,
+                       size_t values_size);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef QUAPI_MPSC_H
+#define QUAPI_MPSC_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+/* Intrusive lock-free multi-producer single-consumer queue (Vyukov). Nodes
+ * are embedded into the queued structs. Pushing is wait-free, popping may
+ * report an empty queue while a push is in progress. */
+
+typedef struct mpsc_node {
+  _Atomic(struct mpsc_node*) next;
+} mpsc_node;
+
+typedef struct mpsc_queue {
+  _Atomic(mpsc_node*) head;
+  mpsc_node* tail;
+  mpsc_node stub;
+} mpsc_queue;
+
+static inline void
+mpsc_init(mpsc_queue* q) {
+  atomic_init(&q->stub.next, NULL);
+  atomic_init(&q->head, &q->stub);
+  q->tail = &q->stub;
+}
+
+static inline void
+mpsc_push(mpsc_queue* q, mpsc_node* n) {
+  atomic_store_explicit(&n->next, NULL, memory_order_relaxed);
+  mpsc_node* prev = atomic_exchange_explicit(&q->head, n, memory_order_acq_rel);
+  atomic_store_explicit(&prev->next, n, memory_order_release);
+}
+
+static inline mpsc_node*
+mpsc_pop(mpsc_queue* q) {
+  mpsc_node* tail = q->tail;
+  mpsc_node* next = atomic_load_explicit(&tail->next, memory_order_acquire);
+
+  if(tail == &q->stub) {
+    if(!next)
+      return NULL;
+    q->tail = next;
+    tail = next;
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+  }
+
+  if(next) {
+    q->tail = next;
+    return tail;
+  }
+
+  if(tail != atomic_load_explicit(&q->head, memory_order_acquire))
+    return NULL;
+
+  mpsc_push(q, &q->stub);
+
+  next = atomic_load_explicit(&tail->next, memory_order_acquire);
+  if(next) {
+    q->tail = next;
+    return tail;
+  }
+  return NULL;
+}
+
+#endif
@@ -0,0 +1,250 @@
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <errno.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <quapi_export.h>
+
+#include "placement.h"
+
+#define MAX_NODES 64
+#define NODEMASK_LONGS (MAX_NODES / (8 * sizeof(unsigned long)))
+
+typedef struct topology_node {
+  int id;
+  cpu_set_t cpus;
+  size_t next_cpu;
+} topology_node;
+
+static pthread_mutex_t placement_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static quapi_placement placement = { .policy = QUAPI_PLACEMENT_NONE,
+                                     .numa_node = -1,
+                                     .bind_memory = false };
+
+static bool topology_loaded = false;
+static bool numa_available = false;
+static topology_node nodes[MAX_NODES];
+static size_t nodes_size = 0;
+static size_t next_node = 0;
+
+// Solver children of this process currently pinned to every CPU.
+static unsigned children_per_cpu[CPU_SETSIZE];
+
+static bool
+parse_cpulist(const char* list, cpu_set_t* set) {
+  CPU_ZERO(set);
+  const char* p = list;
+  while(*p && *p != '\n') {
+    char* end;
+    long from = strtol(p, &end, 10);
+    if(end == p)
+      return false;
+    long to = from;
+    p = end;
+    if(*p == '-') {
+      ++p;
+      to = strtol(p, &end, 10);
+      if(end == p)
+        return false;
+      p = end;
+    }
+    for(long cpu = from; cpu <= to && cpu < CPU_SETSIZE; ++cpu)
+      CPU_SET(cpu, set);
+    if(*p == ',')
+      ++p;
+  }
+  return true;
+}
+
+static bool
+read_node_cpus(int id, cpu_set_t* set) {
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", id);
+  FILE* f = fopen(path, "r");
+  if(!f)
+    return false;
+  char buf[4096];
+  bool ok = fgets(buf, sizeof(buf), f) && parse_cpulist(buf, set);
+  fclose(f);
+  return ok;
+}
+
+static void
+add_node(int id, const cpu_set_t* cpus) {
+  // Keep nodes sorted by their id, readdir returns them in any order.
+  size_t i = nodes_size++;
+  for(; i > 0 && nodes[i - 1].id > id; --i)
+    nodes[i] = nodes[i - 1];
+  nodes[i] = (topology_node){ .id = id, .cpus = *cpus, .next_cpu = 0 };
+}
+
+static void
+load_topology() {
+  topology_loaded = true;
+
+  cpu_set_t allowed;
+  if(sched_getaffinity(0, sizeof(allowed), &allowed) == -1) {
+    err("Could not get CPU affinity! Error: %s", strerror(errno));
+    return;
+  }
+
+  DIR* d = opendir("/sys/devices/system/node");
+  if(d) {
+    struct dirent* e;
+    while((e = readdir(d)) && nodes_size < MAX_NODES) {
+      int id;
+      if(sscanf(e->d_name, "node%d", &id) != 1 || id >= MAX_NODES)
+        continue;
+      cpu_set_t cpus;
+      if(!read_node_cpus(id, &cpus))
+        continue;
+      CPU_AND(&cpus, &cpus, &allowed);
+      if(CPU_COUNT(&cpus) > 0)
+        add_node(id, &cpus);
+    }
+    closedir(d);
+  }
+
+  if(nodes_size > 0) {
+    numa_available = true;
+  } else {
+    // No NUMA information, treat all allowed CPUs as one node.
+    add_node(0, &allowed);
+  }
+
+  dbg("Found %zu NUMA nodes for placement.", nodes_size);
+}
+
+static topology_node*
+find_node(int id) {
+  for(size_t i = 0; i < nodes_size; ++i)
+    if(nodes[i].id == id)
+      return &nodes[i];
+  return NULL;
+}
+
+QUAPI_EXPORT void
+quapi_set_placement(const quapi_placement* p) {
+  pthread_mutex_lock(&placement_mutex);
+  if(p) {
+    placement = *p;
+  } else {
+    placement.policy = QUAPI_PLACEMENT_NONE;
+  }
+  pthread_mutex_unlock(&placement_mutex);
+}
+
+bool
+placement_choose_node(placement_node* n) {
+  pthread_mutex_lock(&placement_mutex);
+  if(placement.policy == QUAPI_PLACEMENT_NONE) {
+    pthread_mutex_unlock(&placement_mutex);
+    return false;
+  }
+
+  if(!topology_loaded)
+    load_topology();
+
+  topology_node* t = NULL;
+  if(placement.numa_node >= 0) {
+    t = find_node(placement.numa_node);
+    if(!t)
+      err("NUMA node %d does not exist or has no usable CPUs!",
+          placement.numa_node);
+  } else if(nodes_size > 0) {
+    t = &nodes[next_node++ % nodes_size];
+  }
+
+  if(t) {
+    n->policy = placement.policy;
+    n->node = t->id;
+    n->cpus = t->cpus;
+    n->bind_memory = placement.bind_memory && numa_available;
+  }
+
+  pthread_mutex_unlock(&placement_mutex);
+  return t;
+}
+
+void
+placement_apply_node(const placement_node* n) {
+  if(sched_setaffinity(0, sizeof(cpu_set_t), &n->cpus) == -1)
+    err("Could not pin seeding process to NUMA node %d! Error: %s",
+        n->node,
+        strerror(errno));
+
+  if(n->bind_memory) {
+    unsigned long mask[NODEMASK_LONGS];
+    memset(mask, 0, sizeof(mask));
+    const size_t bits = 8 * sizeof(unsigned long);
+    mask[n->node / bits] |= 1ul << (n->node % bits);
+
+    // The kernel reads one bit less than maxnode.
+    if(syscall(SYS_set_mempolicy, MPOL_BIND, mask, MAX_NODES + 1) == -1)
+      err("Could not bind memory to NUMA node %d! Error: %s",
+          n->node,
+          strerror(errno));
+  }
+}
+
+int
+placement_pin_child(pid_t pid, int node, quapi_placement_policy policy) {
+  pthread_mutex_lock(&placement_mutex);
+  topology_node* t = find_node(node);
+  if(!t || policy == QUAPI_PLACEMENT_NONE) {
+    pthread_mutex_unlock(&placement_mutex);
+    return -1;
+  }
+
+  int cpu = -1;
+  size_t count = CPU_COUNT(&t->cpus);
+  size_t rr = t->next_cpu++ % count;
+  size_t i = 0;
+  for(int c = 0; c < CPU_SETSIZE; ++c) {
+    if(!CPU_ISSET(c, &t->cpus))
+      continue;
+    if(policy == QUAPI_PLACEMENT_ROUND_ROBIN) {
+      if(i++ == rr) {
+        cpu = c;
+        break;
+      }
+    } else if(cpu == -1 || children_per_cpu[c] < children_per_cpu[cpu]) {
+      cpu = c;
+    }
+  }
+  ++children_per_cpu[cpu];
+  pthread_mutex_unlock(&placement_mutex);
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if(sched_setaffinity(pid, sizeof(set), &set) == -1) {
+    dbg("Could not pin solver child %d to CPU %d! Error: %s",
+        pid,
+        cpu,
+        strerror(errno));
+    placement_unpin_child(cpu);
+    return -1;
+  }
+
+  dbg("Pinned solver child %d to CPU %d on NUMA node %d.", pid, cpu, node);
+  return cpu;
+}
+
+void
+placement_unpin_child(int cpu) {
+  if(cpu < 0)
+    return;
+  pthread_mutex_lock(&placement_mutex);
+  if(children_per_cpu[cpu] > 0)
+    --children_per_cpu[cpu];
+  pthread_mutex_unlock(&placement_mutex);
+}
@@ -0,0 +1,39 @@
+#ifndef QUAPI_PLACEMENT_H
+#define QUAPI_PLACEMENT_H
+
+#include <sched.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include <quapi/quapi.h>
+
+/* CPU and NUMA placement of seeding processes and their solver children,
+ * configured process-wide using quapi_set_placement. */
+
+typedef struct placement_node {
+  quapi_placement_policy policy;
+  int node;
+  cpu_set_t cpus;
+  bool bind_memory;
+} placement_node;
+
+/* Choose the node for a new seeding process. Returns false if placement is
+ * disabled or the node does not exist. */
+bool
+placement_choose_node(placement_node* n);
+
+/* Apply the node to the calling process. Called in the forked child before
+ * exec, both the affinity and the memory policy survive the exec. */
+void
+placement_apply_node(const placement_node* n);
+
+/* Pin a freshly forked solver child to one CPU of the node, chosen using the
+ * policy. Returns the CPU or -1 if it could not be pinned. */
+int
+placement_pin_child(pid_t pid, int node, quapi_placement_policy policy);
+
+/* The child pinned to the CPU finished. */
+void
+placement_unpin_child(int cpu);
+
+#endif
@@ -0,0 +1,221 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <quapi/poller.h>
+#include <quapi_export.h>
+
+#define POLLER_MAX_READY 64
+
+typedef struct poller_entry {
+  quapi_solver* solver;
+  void* userdata;
+  int fds[QUAPI_MAX_FDS];
+  size_t fds_size;
+  bool done;
+} poller_entry;
+
+typedef struct quapi_poller {
+  int epfd;
+
+  poller_entry** entries;
+  size_t entries_size;
+  size_t entries_capacity;
+} quapi_poller;
+
+QUAPI_EXPORT quapi_poller*
+quapi_poller_init() {
+  quapi_poller* p = calloc(1, sizeof(quapi_poller));
+  if(!p) {
+    err("Could not allocate poller!");
+    return NULL;
+  }
+  p->epfd = epoll_create1(EPOLL_CLOEXEC);
+  if(p->epfd == -1) {
+    err("Could not create epoll instance! Error: %s", strerror(errno));
+    free(p);
+    return NULL;
+  }
+  return p;
+}
+
+QUAPI_EXPORT void
+quapi_poller_release(quapi_poller* p) {
+  assert(p);
+  for(size_t i = 0; i < p->entries_size; ++i)
+    free(p->entries[i]);
+  free(p->entries);
+  close(p->epfd);
+  free(p);
+}
+
+static void
+unregister_entry(quapi_poller* p, poller_entry* e) {
+  for(size_t i = 0; i < e->fds_size; ++i)
+    epoll_ctl(p->epfd, EPOLL_CTL_DEL, e->fds[i], NULL);
+}
+
+static void
+remove_entry_at(quapi_poller* p, size_t i) {
+  p->entries[i] = p->entries[--p->entries_size];
+}
+
+/* The pidfd of a pipelined solver child is only known once its fork report
+ * was processed, watch descriptors that were added since. */
+static void
+watch_new_fds(quapi_poller* p, poller_entry* e) {
+  int fds[QUAPI_MAX_FDS];
+  size_t fds_size = quapi_get_fds(e->solver, fds, QUAPI_MAX_FDS);
+  for(size_t i = 0; i < fds_size && e->fds_size < QUAPI_MAX_FDS; ++i) {
+    bool known = false;
+    for(size_t j = 0; j < e->fds_size && !known; ++j)
+      known = e->fds[j] == fds[i];
+    if(known)
+      continue;
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = e };
+    if(epoll_ctl(p->epfd, EPOLL_CTL_ADD, fds[i], &ev) == -1) {
+      err("Could not add fd %d to epoll instance! Error: %s",
+          fds[i],
+          strerror(errno));
+      continue;
+    }
+    e->fds[e->fds_size++] = fds[i];
+  }
+}
+
+QUAPI_EXPORT bool
+quapi_poller_add(quapi_poller* p, quapi_solver* s, void* userdata) {
+  assert(p);
+  assert(s);
+
+  if(quapi_get_state(s) != QUAPI_WORKING) {
+    err("Solver is in invalid state %s for adding it to a poller!",
+        quapi_state_str(quapi_get_state(s)));
+    return false;
+  }
+
+  if(p->entries_size == p->entries_capacity) {
+    size_t capacity = p->entries_capacity ? p->entries_capacity * 2 : 16;
+    poller_entry** entries =
+      realloc(p->entries, capacity * sizeof(poller_entry*));
+    if(!entries) {
+      err("Could not grow poller to %zu entries!", capacity);
+      return false;
+    }
+    p->entries = entries;
+    p->entries_capacity = capacity;
+  }
+
+  poller_entry* e = calloc(1, sizeof(poller_entry));
+  if(!e) {
+    err("Could not allocate poller entry!");
+    return false;
+  }
+  e->solver = s;
+  e->userdata = userdata;
+  e->fds_size = quapi_get_fds(s, e->fds, QUAPI_MAX_FDS);
+
+  for(size_t i = 0; i < e->fds_size; ++i) {
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = e };
+    if(epoll_ctl(p->epfd, EPOLL_CTL_ADD, e->fds[i], &ev) == -1) {
+      err("Could not add fd %d to epoll instance! Error: %s",
+          e->fds[i],
+          strerror(errno));
+      e->fds_size = i;
+      unregister_entry(p, e);
+      free(e);
+      return false;
+    }
+  }
+
+  p->entries[p->entries_size++] = e;
+  return true;
+}
+
+QUAPI_EXPORT bool
+quapi_poller_remove(quapi_poller* p, quapi_solver* s) {
+  assert(p);
+  for(size_t i = 0; i < p->entries_size; ++i) {
+    poller_entry* e = p->entries[i];
+    if(e->solver == s) {
+      unregister_entry(p, e);
+      remove_entry_at(p, i);
+      free(e);
+      return true;
+    }
+  }
+  return false;
+}
+
+QUAPI_EXPORT size_t
+quapi_poller_size(quapi_poller* p) {
+  assert(p);
+  return p->entries_size;
+}
+
+QUAPI_EXPORT int
+quapi_poller_wait(quapi_poller* p,
+                  quapi_poller_event* events,
+                  int max_events,
+                  int timeout_ms) {
+  assert(p);
+  assert(events);
+
+  // Every ready solver produces at most one event, so never ask for more
+  // solvers than there is space for events.
+  struct epoll_event ready[POLLER_MAX_READY];
+  int ready_max = max_events < POLLER_MAX_READY ? max_events : POLLER_MAX_READY;
+  if(ready_max <= 0)
+    return 0;
+
+  int r = epoll_wait(p->epfd, ready, ready_max, timeout_ms);
+  if(r == -1) {
+    if(errno == EINTR)
+      return 0;
+    err("epoll_wait() failed! Error: %s", strerror(errno));
+    return -1;
+  }
+
+  int events_size = 0;
+  for(int i = 0; i < r; ++i) {
+    poller_entry* e = ready[i].data.ptr;
+
+    // Multiple fds of the same solver may be ready at once.
+    if(e->done)
+      continue;
+
+    int result;
+    if(!quapi_process_events(e->solver, &result)) {
+      watch_new_fds(p, e);
+      continue;
+    }
+
+    e->done = true;
+    unregister_entry(p, e);
+
+    quapi_poller_event* ev = &events[events_size++];
+    ev->solver = e->solver;
+    ev->userdata = e->userdata;
+    ev->result = result;
+    ev->terminated = quapi_was_terminated(e->solver);
+  }
+
+  // Entries are only freed now, as ready may still point to them.
+  for(size_t i = 0; i < p->entries_size;) {
+    poller_entry* e = p->entries[i];
+    if(e->done) {
+      remove_entry_at(p, i);
+      free(e);
+    } else {
+      ++i;
+    }
+  }
+
+  return events_size;
+}
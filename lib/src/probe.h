@@ -0,0 +1,86 @@
+#ifndef QUAPI_PROBE_H
+#define QUAPI_PROBE_H
+
+#include <poll.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <quapi/quapi.h>
+
+/* Probes are additional solver children of a solver, forked from the same
+ * seeding process as regular solver children. Every probe has its own pipes,
+ * so several of them can solve under different assumptions at once. Probes
+ * can only be started in state INPUT or INPUT_LITERALS and ignore the stdout
+ * callback and model tracking. */
+
+typedef struct quapi_probe quapi_probe;
+
+/* Number of pollfds of a probe. */
+#define PROBE_POLLFDS 2
+
+/* Fork a probe solving under the given assumptions. Probes solve once
+ * admission control admits them, see quapi_set_admission. Without wait,
+ * *admitted is set to false and NULL is returned if the probe is not admitted
+ * right away. Returns NULL on errors. */
+quapi_probe*
+probe_start(quapi_solver* s,
+            const int32_t* assumptions,
+            size_t size,
+            bool wait,
+            bool* admitted);
+
+/* Fork a probe from the seeding process or from a parent node, adding the
+ * given assumptions to the ones of the parent. Without solve, the probe is a
+ * node: it parses the assumptions as unit clauses and then waits for forks
+ * of its own, so its children do not parse them again. Solving probes wait
+ * for their admission. */
+quapi_probe*
+probe_fork(quapi_solver* s,
+           quapi_probe* parent,
+           const int32_t* assumptions,
+           size_t size,
+           bool solve);
+
+/* The probe child did not exit yet. */
+bool
+probe_alive(const quapi_probe* p);
+
+pid_t
+probe_pid(const quapi_probe* p);
+
+/* Version of the formula of the seeding process, which changes whenever
+ * clauses are added or rolled back. Nodes only know the version they were
+ * forked from. */
+uint64_t
+probe_formula_version(const quapi_solver* s);
+
+/* Number of leading assumptions up to the last one that assigns a universal
+ * quantifier of the prefix, 0 if there is none. */
+size_t
+probe_universal_assumptions(const quapi_solver* s);
+
+/* Fill PROBE_POLLFDS pollfds to wait for events of the probe. */
+void
+probe_get_pollfds(const quapi_probe* p, struct pollfd* pfds);
+
+/* Handle the events poll() reported in the pollfds. Returns true once the
+ * result of the probe is known. */
+bool
+probe_process(quapi_probe* p, const struct pollfd* pfds);
+
+/* 10 or 20, 0 if unknown. */
+int
+probe_result(const quapi_probe* p);
+
+/* Absolute deadline (CLOCK_MONOTONIC) of the probe in ns, derived from the
+ * timeout of the solver. 0 if there is none. */
+uint64_t
+probe_deadline(const quapi_probe* p);
+
+/* Kill the probe child if it still runs and free the probe. */
+void
+probe_release(quapi_probe* p);
+
+#endif
@@ -0,0 +1,20 @@
+#include <stdio.h>
+#include <unistd.h>
+
+#include "procfs.h"
+
+uint64_t
+procfs_private_rss(pid_t pid) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/statm", pid);
+  FILE* f = fopen(path, "r");
+  if(!f)
+    return 0;
+  unsigned long size, resident, shared;
+  uint64_t rss = 0;
+  if(fscanf(f, "%lu %lu %lu", &size, &resident, &shared) == 3 &&
+     resident > shared)
+    rss = (uint64_t)(resident - shared) * sysconf(_SC_PAGESIZE);
+  fclose(f);
+  return rss;
+}
@@ -0,0 +1,12 @@
+#ifndef QUAPI_PROCFS_H
+#define QUAPI_PROCFS_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/* Private resident memory of a forked process in bytes, which is what it does
+ * not share with its parent through copy-on-write. 0 if the process is gone. */
+uint64_t
+procfs_private_rss(pid_t pid);
+
+#endif
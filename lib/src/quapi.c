@@ -13,12 +13,16 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdio_ext.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/eventfd.h>
 #include <sys/poll.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
-#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <time.h>
 #include <unistd.h>
 
 #if __linux__
@@ -32,14 +36,83 @@
 #endif
 
 #include <quapi/quapi.h>
+#include <quapi/timeline.h>
 #include <quapi/zero-copy-pipes-linux.h>
 #include <quapi_export.h>
 
+#include "admission.h"
+#include "model.h"
+#include "placement.h"
+#include "probe.h"
+#include "stats.h"
+
 extern char** environ;
 
 #define MYPOLL_CHILD 0
 #define MYPOLL_EVENTFD 1
 #define MYPOLL_SOLVERCHILD 2
+#define MYPOLL_TIMERFD 3
+#define MYPOLL_PIDFD 4
+
+#define DEFAULT_KILL_GRACE_NS 1000000000
+
+// Minimum free space for a single read() of solver child output.
+#define OUTBUF_CHUNK (1 << 16)
+
+typedef struct S_data S_data;
+typedef void*(S_state)(S_data*);
+
+// Output of a child, complete lines are terminated in place and handed out
+// without copying.
+typedef struct line_buffer {
+  char* data;
+  size_t size;
+  // Bytes of an incomplete line at the start of the buffer.
+  size_t len;
+} line_buffer;
+
+typedef bool (*line_handler)(void* ctx, const char* line, size_t length);
+
+typedef struct S_data {
+  struct quapi_solver* s;
+
+  int retcode;
+
+  struct pollfd* active_pfd;
+
+  // State to continue with, NULL if no solve is running.
+  S_state* S;
+  // Wait in poll() instead of returning to the caller once no events are
+  // ready. Non-blocking solves are driven by quapi_process_events.
+  bool blocking;
+  bool polled;
+  // The solve was ended by quapi_terminate.
+  bool terminated;
+  // The deadline passed and SIGTERM was sent to the solver child.
+  bool timed_out;
+  // Result matched by a regex while the model is still being read.
+  int pending_result;
+  // The terminating 0 of the model was read.
+  bool model_done;
+} S_data;
+
+#ifndef WITHOUT_PCRE2
+typedef struct regex_literal {
+  // NULL if the regex does not require a literal.
+  char* text;
+  size_t len;
+  // The literal has to be at the start of the line.
+  bool anchored;
+} regex_literal;
+#endif
+
+// State of the library at a checkpoint, restored by quapi_rollback.
+typedef struct checkpoint_state {
+  quapi_state state;
+  int32_t written_clauses;
+  int32_t written_quantifier_literals;
+  int universal_prefix_depth;
+} checkpoint_state;
 
 typedef struct quapi_solver {
   quapi_config config;
@@ -57,27 +130,121 @@ typedef struct quapi_solver {
 #else
   FILE* write_pipe_stream;
   FILE* solverchild_write_pipe_stream;
+  char solverchild_write_buf[BUFSIZ / sizeof(quapi_msg) * sizeof(quapi_msg)];
 #endif
 
+  // Clauses that may be added using quapi_add, including reserved ones.
+  int32_t clause_budget;
   int32_t written_clauses;
   int32_t written_assumptions;
   int32_t written_quantifier_literals;
+  // Changes whenever the formula of the seeding process changes, i.e., when
+  // clauses are added or rolled back.
+  uint64_t formula_version;
+  // A clause or quantifier block was started, but not ended with 0 yet.
+  bool clause_open;
+
+  // Statistics of finished solves, the volume sent since the last one and
+  // the timestamps of the running one.
+  quapi_stats stats;
+  quapi_solve_stats current_stats;
+  solve_times times;
+  // Fork id of the current solver child, -1 for pool children. Identifies the
+  // solve in the timelines of all processes.
+  int64_t solve_id;
+  // First signal to stop the current solver child.
+  uint64_t kill_ns;
+  // Timeline track of this solver, the PID of the first seeding process.
+  int timeline_tid;
+
+  // Checkpoints from quapi_checkpoint, oldest first.
+  checkpoint_state checkpoints[QUAPI_MAX_CHECKPOINTS];
+  size_t checkpoints_size;
 
   pid_t solverchild_pid;
+  // pidfd of the solver child, -1 if there is none. Also in out_pollfds if
+  // it is watched.
+  int solverchild_pidfd;
+  // Send FORK without waiting for its report, see quapi_set_pipelined_fork.
+  bool pipelined_fork;
+  // The report with the PID of the current solver child was not read yet.
+  bool fork_report_pending;
+  uint32_t fork_id;
+  // Pre-forked solver children, oldest first, and forks that were requested
+  // from the seeding process but whose pipes were not received yet.
+  quapi_probe** pool;
+  size_t pool_size;
+  unsigned pool_target;
+  unsigned pool_pending;
+  // Pool child solving the current assumptions, NULL for solver children
+  // forked on demand. Its stream replaces the shared one while it runs.
+  quapi_probe* solverchild_probe;
+#ifdef USING_ZEROCOPY
+  quapi_zerocopy_pipe* shared_solverchild_write_pipe_stream;
+#else
+  FILE* shared_solverchild_write_pipe_stream;
+#endif
+
   quapi_stdout_cb stdout_cb;
   void* stdout_cb_userdata;
 
-  struct pollfd out_pollfds[3];
+  struct pollfd out_pollfds[QUAPI_MAX_FDS];
+
+  S_data solve;
+
+  // Output of solver children, kept over solves.
+  line_buffer out;
+
+  // Values of the model of the last solve by variable, 1, -1 or 0 for
+  // unknown. NULL if models are not tracked.
+  int8_t* model;
+  size_t model_size;
+
+  // Relative timeout for every solve and absolute deadline (CLOCK_MONOTONIC)
+  // for the next solve only, both in ns. 0 means none.
+  uint64_t timeout_ns;
+  uint64_t deadline_ns;
+  uint64_t kill_grace_ns;
+
+  // NUMA node of the seeding process and CPU of the last solver child, -1 if
+  // not placed.
+  int numa_node;
+  int solverchild_cpu;
+  bool solverchild_cpu_pinned;
+  quapi_placement_policy placement_policy;
+
+  // The solver holds an admission for its current solver child, or its
+  // non-blocking solve waits for one and did not send SOLVE yet.
+  bool admitted;
+  bool admission_waiting;
+  // Set by quapi_terminate before it writes to the eventfd, which also wakes
+  // up solves waiting for admission.
+  bool terminate_requested;
 
 #ifndef WITHOUT_PCRE2
   pcre2_code* re_SAT;
   pcre2_match_data* re_SAT_match_data;
   pcre2_code* re_UNSAT;
   pcre2_match_data* re_UNSAT_match_data;
+  // Both regexes as one alternation "(SAT)|(UNSAT)", NULL if they could not
+  // be combined.
+  pcre2_code* re_result;
+  pcre2_match_data* re_result_match_data;
+  // Literal text required by the SAT and UNSAT regex, used to skip lines
+  // that cannot match without running PCRE2.
+  regex_literal re_literals[2];
 #else
 #endif
 } quapi_solver;
 
+// Pre-forked solver children, implemented next to the probes they are made of.
+static bool
+adopt_pooled_child(quapi_solver* s);
+static void
+release_pooled_child(quapi_solver* s);
+static void
+pool_clear(quapi_solver* s);
+
 static bool
 file_exists(const char* path) {
   struct stat buffer;
@@ -137,11 +304,18 @@ static bool
 fork_and_exec(quapi_solver* s) {
   // Inspired from https://stackoverflow.com/q/19191030
 
-  pipe(s->read_pipe);
-  pipe(s->write_pipe);
-  pipe(s->config.header.forked_child_read_pipe);
-  pipe(s->config.header.forked_child_write_pipe);
-  pipe(s->config.header.message_to_parent_pipe);
+  // All pipes are close-on-exec, so that solvers started later from the same
+  // process (e.g. multiple solvers in one program) do not inherit them. Such
+  // inherited write ends would keep pipes of other solvers open forever.
+  pipe2(s->read_pipe, O_CLOEXEC);
+  pipe2(s->write_pipe, O_CLOEXEC);
+  pipe2(s->config.header.forked_child_read_pipe, O_CLOEXEC);
+  pipe2(s->config.header.forked_child_write_pipe, O_CLOEXEC);
+  pipe2(s->config.header.message_to_parent_pipe, O_CLOEXEC);
+  socketpair(AF_UNIX,
+             SOCK_SEQPACKET | SOCK_CLOEXEC,
+             0,
+             s->config.header.probe_socket);
 
   {
     int fd = s->config.header.forked_child_write_pipe[0];
@@ -153,6 +327,9 @@ fork_and_exec(quapi_solver* s) {
     }
   }
 
+  placement_node node;
+  bool placed = placement_choose_node(&node);
+
   s->pid = fork();
 
   if(s->pid > 0) {// Parent
@@ -160,6 +337,7 @@ fork_and_exec(quapi_solver* s) {
     close(CHILD_WRITE);
     close(s->config.header.forked_child_read_pipe[0]);
     close(s->config.header.forked_child_write_pipe[1]);
+    close(s->config.header.probe_socket[1]);
 
 #ifdef USING_ZEROCOPY
     s->write_pipe_stream = quapi_zerocopy_pipe_fdopen(PARENT_WRITE, "wb");
@@ -169,16 +347,31 @@ fork_and_exec(quapi_solver* s) {
     s->write_pipe_stream = fdopen(PARENT_WRITE, "wb");
     s->solverchild_write_pipe_stream =
       fdopen(s->config.header.forked_child_read_pipe[1], "wb");
+    // Full buffers are flushed at message boundaries. Pipelined solver
+    // children skip the input of aborted ones message by message, so no
+    // partial message may stay in the pipe when the rest is purged.
+    if(s->solverchild_write_pipe_stream)
+      setvbuf(s->solverchild_write_pipe_stream,
+              s->solverchild_write_buf,
+              _IOFBF,
+              sizeof(s->solverchild_write_buf));
 #endif
 
     dbg("Fork successful! New pid: %d", s->pid);
 
+    if(placed) {
+      s->numa_node = node.node;
+      s->placement_policy = node.policy;
+      dbg("Seeding process %d placed on NUMA node %d", s->pid, node.node);
+    }
+
     return true;
   } else if(s->pid == 0) {// Child
     close(PARENT_READ);
     close(PARENT_WRITE);
     close(s->config.header.forked_child_read_pipe[1]);
     close(s->config.header.forked_child_write_pipe[0]);
+    close(s->config.header.probe_socket[0]);
 
     const char* path = s->config.executable_path;
     char* const* argv = s->config.executable_argv;
@@ -203,6 +396,23 @@ fork_and_exec(quapi_solver* s) {
     if(r == -1)
       err("Could not run close(CHILD_READ)! Error: %s", strerror(errno));
 
+    // The preloaded runtime receives these through the header, so they have to
+    // survive the exec. STDIN and STDOUT already lost O_CLOEXEC through dup2.
+    const int inherited_fds[] = { s->config.header.forked_child_read_pipe[0],
+                                  s->config.header.forked_child_write_pipe[1],
+                                  s->config.header.message_to_parent_pipe[1],
+                                  s->config.header.probe_socket[1] };
+    for(size_t i = 0; i < sizeof(inherited_fds) / sizeof(int); ++i) {
+      r = fcntl(inherited_fds[i], F_SETFD, 0);
+      if(r == -1)
+        err("Could not clear FD_CLOEXEC of fd %d! Error: %s",
+            inherited_fds[i],
+            strerror(errno));
+    }
+
+    if(placed)
+      placement_apply_node(&node);
+
     int e = execvpe(path, argv, envp);
     if(e == -1) {
       err("Could not execvpe! Killing this process. Error: %s",
@@ -278,7 +488,7 @@ get_preload_so_path() {
 
 static bool
 setup_eventfd(quapi_solver* s) {
-  int fd = eventfd(0, 0);
+  int fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
   if(fd == -1) {
     err("Could not create eventfd! Error: %s", strerror(errno));
     return false;
@@ -290,7 +500,154 @@ setup_eventfd(quapi_solver* s) {
   return true;
 }
 
+static bool
+setup_timerfd(quapi_solver* s) {
+  int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+  if(fd == -1) {
+    err("Could not create timerfd! Error: %s", strerror(errno));
+    return false;
+  }
+  struct pollfd* pfd = &s->out_pollfds[MYPOLL_TIMERFD];
+  pfd->fd = fd;
+  pfd->events = POLLIN;
+  pfd->revents = 0;
+  return true;
+}
+
+static void
+close_solverchild_pidfd(quapi_solver* s) {
+  struct pollfd* pfd = &s->out_pollfds[MYPOLL_PIDFD];
+  if(s->solverchild_pidfd != -1)
+    close(s->solverchild_pidfd);
+  s->solverchild_pidfd = -1;
+  pfd->fd = -1;
+  pfd->events = 0;
+}
+
+/* Returns false if the child already exited and was reaped. */
+static bool
+open_solverchild_pidfd(quapi_solver* s) {
+  // The pidfd of the last child is kept open until now, so that pollers
+  // watching it could still remove it after the last solve finished.
+  close_solverchild_pidfd(s);
+
+#ifdef SYS_pidfd_open
+  int fd = syscall(SYS_pidfd_open, s->solverchild_pid, 0);
+#else
+  int fd = -1;
+  errno = ENOSYS;
+#endif
+  if(fd == -1) {
+    // Older kernels, fall back to kill() with the plain PID.
+    dbg("Could not open pidfd for solver child %d! Error: %s",
+        s->solverchild_pid,
+        strerror(errno));
+    return errno != ESRCH;
+  }
+
+  s->solverchild_pidfd = fd;
+
+  struct pollfd* pfd = &s->out_pollfds[MYPOLL_PIDFD];
+  // Without a SAT regex, the seeding process reaps the child and reports its
+  // exit code. Otherwise, the pidfd is the only notice of a child that died
+  // without a result, e.g. by a signal. An unwatched pidfd is left out of
+  // poll(), which would report POLLHUP once the child was reaped and spin
+  // until the exit code arrives.
+  pfd->events = s->config.SAT_regex ? POLLIN : 0;
+  pfd->fd = pfd->events ? fd : -1;
+  pfd->revents = 0;
+  return true;
+}
+
+static void
+signal_child(int pidfd, pid_t pid, int sig) {
+#ifdef SYS_pidfd_send_signal
+  // The pidfd always refers to the same process, even if the PID was reused
+  // after the seeding process reaped the child.
+  if(pidfd != -1 && syscall(SYS_pidfd_send_signal, pidfd, sig, NULL, 0) == 0)
+    return;
+  if(pidfd != -1 && errno == ESRCH)
+    return;
+#endif
+  kill(pid, sig);
+}
+
+/* Set up everything that needs the PID of a new solver child. Returns false
+ * if the child already exited, which pipelined forks may only notice late. */
+static bool
+solverchild_started(quapi_solver* s, pid_t pid) {
+  s->solverchild_pid = pid;
+  s->fork_report_pending = false;
+  dbg("Solverchild has PID %d", s->solverchild_pid);
+
+  bool alive = open_solverchild_pidfd(s);
+
+  admission_child_started(s, s->solverchild_pid);
+
+  if(s->numa_node >= 0) {
+    s->solverchild_cpu = placement_pin_child(
+      s->solverchild_pid, s->numa_node, s->placement_policy);
+    s->solverchild_cpu_pinned = s->solverchild_cpu >= 0;
+  }
+  return alive;
+}
+
+/* Read messages from the seeding process up to the next one of the given
+ * type. Earlier messages belong to solver children that were aborted. */
+static bool
+read_seeding_msg(quapi_solver* s, quapi_msg_type type, quapi_msg* msg) {
+  bool success;
+  do {
+    success = quapi_read_msg_from_fd(
+      s->config.header.message_to_parent_pipe[0], msg, NULL, &read);
+    if(success && msg->msg.type == QUAPI_MSG_TIMESTAMP)
+      stats_record_timestamp(
+        &s->times, msg->msg.data.timestamp, stats_now_ns());
+  } while(success && msg->msg.type != type);
+  return success;
+}
+
+static bool
+read_fork_report(quapi_solver* s, pid_t* pid) {
+  quapi_msg fork_result_msg;
+  if(!read_seeding_msg(s, QUAPI_MSG_FORK_REPORT, &fork_result_msg)) {
+    err("Could not read fork report message!");
+    return false;
+  }
+
+  *pid = fork_result_msg.msg.data.fork_report.solver_child_pid;
+  return true;
+}
+
+/* Block until the PID of a pipelined solver child is known. */
+static void
+await_fork_report(quapi_solver* s) {
+  pid_t pid;
+  if(s->fork_report_pending && read_fork_report(s, &pid))
+    solverchild_started(s, pid);
+  s->fork_report_pending = false;
+}
+
+static void
+signal_solverchild(quapi_solver* s, int sig) {
+  if(!s->kill_ns)
+    s->kill_ns = stats_now_ns();
+  await_fork_report(s);
+  signal_child(s->solverchild_pidfd, s->solverchild_pid, sig);
+}
+
 #ifndef WITHOUT_PCRE2
+static void
+jit_compile_regex(pcre2_code* c, const char* regex) {
+  // pcre2_match uses the JIT code if there is some. Without JIT support, the
+  // interpreter is used.
+  int r = pcre2_jit_compile(c, PCRE2_JIT_COMPLETE);
+  if(r != 0)
+    dbg("PCRE2 JIT compilation of %s failed with %d, using the interpreter.",
+        regex,
+        r);
+}
+
 static bool
 compile_regex(const char* regex,
               pcre2_code** tgt,
@@ -315,6 +672,8 @@ compile_regex(const char* regex,
     return false;
   }
 
+  jit_compile_regex(c, regex);
+
   *tgt = c;
 
   *tgt_match_data = pcre2_match_data_create_from_pattern(c, NULL);
@@ -322,6 +681,78 @@ compile_regex(const char* regex,
   return true;
 }
 
+static bool
+has_backrefs(const pcre2_code* c) {
+  uint32_t backrefmax = 0;
+  pcre2_pattern_info(c, PCRE2_INFO_BACKREFMAX, &backrefmax);
+  return backrefmax > 0;
+}
+
+/* Combine SAT and UNSAT regex into one pattern, so that every line is only
+ * matched once. The SAT regex is capture group 1. Numbered back references
+ * would be shifted and quoting or comments could swallow the added groups,
+ * so such regexes are matched separately. */
+static void
+setup_combined_regex(quapi_solver* s) {
+  const char* sat = s->config.SAT_regex;
+  const char* unsat = s->config.UNSAT_regex;
+  if(has_backrefs(s->re_SAT) || has_backrefs(s->re_UNSAT) ||
+     strstr(sat, "\\Q") || strstr(unsat, "\\Q") || strchr(sat, '#') ||
+     strchr(unsat, '#'))
+    return;
+
+  size_t size = strlen(sat) + strlen(unsat) + 6;
+  char* combined = malloc(size);
+  if(!combined)
+    return;
+  snprintf(combined, size, "(%s)|(%s)", sat, unsat);
+
+  int errornumber;
+  size_t erroroffset;
+  pcre2_code* c = pcre2_compile((const unsigned char*)combined,
+                                PCRE2_ZERO_TERMINATED,
+                                0,
+                                &errornumber,
+                                &erroroffset,
+                                NULL);
+  if(!c) {
+    dbg("Could not combine regexes into %s, matching them separately.",
+        combined);
+    free(combined);
+    return;
+  }
+
+  jit_compile_regex(c, combined);
+  free(combined);
+
+  s->re_result = c;
+  s->re_result_match_data = pcre2_match_data_create_from_pattern(c, NULL);
+}
+
+/* Find literal text every line matching the regex contains, e.g. "s " at the
+ * start of the line for "^s SATISFIABLE". Alternations and leading groups
+ * are not looked into. */
+static void
+find_regex_literal(const char* regex, regex_literal* literal) {
+  literal->text = NULL;
+  literal->len = 0;
+  literal->anchored = regex[0] == '^';
+  if(strchr(regex, '|'))
+    return;
+
+  const char* begin = regex + (literal->anchored ? 1 : 0);
+  size_t len = strcspn(begin, "\\^$.[|()?*+{");
+  // A following quantifier may make the last character optional.
+  char next = begin[len];
+  if(len > 0 && (next == '?' || next == '*' || next == '{'))
+    --len;
+  if(len == 0)
+    return;
+
+  literal->text = strndup(begin, len);
+  literal->len = literal->text ? len : 0;
+}
+
 static bool
 setup_regex(quapi_solver* s) {
   assert(!s->re_SAT);
@@ -333,6 +764,10 @@ setup_regex(quapi_solver* s) {
        s->config.UNSAT_regex, &s->re_UNSAT, &s->re_UNSAT_match_data))
     return false;
 
+  setup_combined_regex(s);
+  find_regex_literal(s->config.SAT_regex, &s->re_literals[0]);
+  find_regex_literal(s->config.UNSAT_regex, &s->re_literals[1]);
+
   return true;
 }
 #endif
@@ -346,10 +781,31 @@ quapi_init(const char* path,
            int maxassumptions,
            const char* SAT_regex,
            const char* UNSAT_regex) {
+  return quapi_init_reserved(path,
+                             argv,
+                             envp,
+                             litcount,
+                             clausecount,
+                             maxassumptions,
+                             0,
+                             SAT_regex,
+                             UNSAT_regex);
+}
+
+QUAPI_EXPORT quapi_solver*
+quapi_init_reserved(const char* path,
+                    const char** argv,
+                    const char** envp,
+                    int litcount,
+                    int clausecount,
+                    int maxassumptions,
+                    int reserved_clauses,
+                    const char* SAT_regex,
+                    const char* UNSAT_regex) {
   if(!path)
     return NULL;
 
-  if(maxassumptions < 0)
+  if(maxassumptions < 0 || reserved_clauses < 0)
     return NULL;
 
   const char* preload_path = get_preload_so_path();
@@ -380,15 +836,52 @@ quapi_init(const char* path,
   s->written_assumptions = 0;
   s->written_quantifier_literals = 0;
   s->universal_prefix_depth = -1;
+  s->formula_version = 0;
+  s->clause_open = false;
+  s->checkpoints_size = 0;
+  memset(&s->stats, 0, sizeof(s->stats));
+  s->current_stats = (quapi_solve_stats){ 0 };
+  s->times = (solve_times){ 0 };
+  s->solve_id = -1;
+  s->kill_ns = 0;
+  s->timeline_tid = 0;
   s->config.log_cb = log_cb_stderr;
   s->config.executable_path = path;
   s->config.header.literals = litcount;
-  s->config.header.clauses = clausecount;
+  s->config.header.clauses = clausecount + reserved_clauses;
+  s->clause_budget = clausecount + reserved_clauses;
   s->config.header.prefixdepth = maxassumptions;
   s->write_pipe_stream = NULL;
   s->solverchild_write_pipe_stream = NULL;
+  s->pool = NULL;
+  s->pool_size = 0;
+  s->pool_target = 0;
+  s->pool_pending = 0;
+  s->solverchild_probe = NULL;
+  s->shared_solverchild_write_pipe_stream = NULL;
   s->stdout_cb = NULL;
   s->stdout_cb_userdata = NULL;
+  s->solve = (S_data){ .s = s, .S = NULL };
+  s->out = (line_buffer){ .data = NULL, .size = 0, .len = 0 };
+  s->model = NULL;
+  s->model_size = 0;
+  s->timeout_ns = 0;
+  s->deadline_ns = 0;
+  s->kill_grace_ns = DEFAULT_KILL_GRACE_NS;
+  s->numa_node = -1;
+  s->solverchild_cpu = -1;
+  s->solverchild_cpu_pinned = false;
+  s->placement_policy = QUAPI_PLACEMENT_NONE;
+  s->admitted = false;
+  s->admission_waiting = false;
+  s->terminate_requested = false;
+  s->out_pollfds[MYPOLL_TIMERFD].fd = -1;
+  s->solverchild_pidfd = -1;
+  s->pipelined_fork = false;
+  s->fork_report_pending = false;
+  s->fork_id = 0;
+  s->out_pollfds[MYPOLL_PIDFD].fd = -1;
+  s->out_pollfds[MYPOLL_PIDFD].events = 0;
 
   if(maxassumptions > 0) {
     s->config.header.clauses += maxassumptions;
@@ -399,6 +892,10 @@ quapi_init(const char* path,
   s->re_UNSAT = NULL;
   s->re_SAT_match_data = NULL;
   s->re_UNSAT_match_data = NULL;
+  s->re_result = NULL;
+  s->re_result_match_data = NULL;
+  s->re_literals[0].text = NULL;
+  s->re_literals[1].text = NULL;
 #endif
 
   if(SAT_regex) {
@@ -481,7 +978,12 @@ quapi_init(const char* path,
   if(!setup_eventfd(s))
     goto ERROR;
 
+  // Setup a timerfd for solve timeouts.
+  if(!setup_timerfd(s))
+    goto ERROR;
+
   // Fork and Execute subprocess!
+  uint64_t exec_start = stats_now_ns();
   bool forked = fork_and_exec(s);
   if(!forked)
     goto ERROR;
@@ -526,6 +1028,16 @@ quapi_init(const char* path,
         quapi_msg_type_str(start_msg.msg.type));
     goto ERROR;
   }
+  uint64_t started = stats_now_ns();
+  s->stats.exec_ns = started - exec_start;
+
+  // Every solver gets its own track in the timeline of this process.
+  s->timeline_tid = s->pid;
+  char track[32];
+  snprintf(track, sizeof(track), "solver %d", s->pid);
+  quapi_timeline_process_name("QuAPI library");
+  quapi_timeline_thread_name(s->timeline_tid, track);
+  quapi_timeline_span("exec", s->timeline_tid, exec_start, started, -1, 0);
 
   return s;
 ERROR:
@@ -537,6 +1049,14 @@ QUAPI_EXPORT void
 quapi_release(quapi_solver* s) {
   assert(s);
 
+  if(s->admitted || s->admission_waiting)
+    admission_release(s);
+
+  release_pooled_child(s);
+  for(size_t i = 0; i < s->pool_size; ++i)
+    probe_release(s->pool[i]);
+  free(s->pool);
+
   free(s->config.SAT_regex);
   free(s->config.UNSAT_regex);
 #ifndef WITHOUT_PCRE2
@@ -548,6 +1068,12 @@ quapi_release(quapi_solver* s) {
     pcre2_code_free(s->re_SAT);
   if(s->re_UNSAT)
     pcre2_code_free(s->re_UNSAT);
+  if(s->re_result_match_data)
+    pcre2_match_data_free(s->re_result_match_data);
+  if(s->re_result)
+    pcre2_code_free(s->re_result);
+  free(s->re_literals[0].text);
+  free(s->re_literals[1].text);
 #endif
 
 #ifdef USING_ZEROCOPY
@@ -561,6 +1087,11 @@ quapi_release(quapi_solver* s) {
 #endif
 
   close(s->out_pollfds[MYPOLL_EVENTFD].fd);
+  if(s->out_pollfds[MYPOLL_TIMERFD].fd != -1)
+    close(s->out_pollfds[MYPOLL_TIMERFD].fd);
+  close_solverchild_pidfd(s);
+  free(s->out.data);
+  free(s->model);
 
   free_str_array(s->config.executable_envp);
   s->config.executable_envp = NULL;
@@ -571,6 +1102,15 @@ quapi_release(quapi_solver* s) {
   free(s);
 }
 
+/* Write a message to the seeding process or a solver child, counting it for
+ * the statistics. */
+static quapi_status
+send_msg(quapi_solver* s, ZEROCOPY_PIPE_OR_FILE* f, quapi_msg* msg) {
+  ++s->current_stats.messages_sent;
+  s->current_stats.bytes_sent += sizeof(msg->arr);
+  return quapi_write_msg_to_file(f, msg, NULL);
+}
+
 QUAPI_EXPORT void
 quapi_quantify(quapi_solver* s, int32_t lit_or_zero) {
   assert(s->state == QUAPI_INPUT);
@@ -592,8 +1132,9 @@ quapi_quantify(quapi_solver* s, int32_t lit_or_zero) {
   msg->msg.type = QUAPI_MSG_QUANTIFIER;
   msg->msg.data.quantifier.lit = lit_or_zero;
 
-  quapi_write_msg_to_file(s->write_pipe_stream, msg, NULL);
+  send_msg(s, s->write_pipe_stream, msg);
 
+  s->clause_open = lit_or_zero != 0;
   if(lit_or_zero != 0) {
     ++s->written_quantifier_literals;
   }
@@ -603,57 +1144,87 @@ QUAPI_EXPORT void
 quapi_add(quapi_solver* s, int32_t lit_or_zero) {
   assert(s->state == QUAPI_INPUT_LITERALS || s->state == QUAPI_INPUT);
 
+  // The solver would read more clauses than the header announced.
+  if(s->written_clauses >= s->clause_budget) {
+    if(lit_or_zero == 0)
+      err("Dropped clause %d, there are only %d clauses and reserved "
+          "clauses! Reserve more clauses using quapi_init_reserved.",
+          s->written_clauses + 1,
+          s->clause_budget);
+    return;
+  }
+
   s->state = QUAPI_INPUT_LITERALS;
 
+  // Pool children were forked without the new clause.
+  if(s->pool_size > 0 || s->pool_pending > 0)
+    pool_clear(s);
+
   QUAPI_GIVE_MSGS(msg, 1, s->write_pipe_stream)
 
   msg->msg.type = QUAPI_MSG_LITERAL;
   msg->msg.data.literal.lit = lit_or_zero;
 
-  quapi_write_msg_to_file(s->write_pipe_stream, msg, NULL);
+  send_msg(s, s->write_pipe_stream, msg);
 
+  s->clause_open = lit_or_zero != 0;
   if(lit_or_zero == 0) {
     ++s->written_clauses;
+    ++s->formula_version;
   }
 }
 
 static bool
-make_solvable(quapi_solver* s) {
-  if(s->state == QUAPI_INPUT_LITERALS || s->state == QUAPI_INPUT) {
-    s->state = QUAPI_INPUT_ASSUMPTIONS;
-
-    // Wait for exit code and report only if there is no SAT_regex to match
-    // against.
-    QUAPI_GIVE_MSGS(fork_msg, 1, s->write_pipe_stream)
-    fork_msg->msg.type = QUAPI_MSG_FORK;
-    fork_msg->msg.data.fork.wait_for_exit_code_and_report =
-      s->config.SAT_regex ? 0 : 1;
+fork_solverchild(quapi_solver* s) {
+  // Wait for exit code and report only if there is no SAT_regex to match
+  // against.
+  QUAPI_GIVE_MSGS(fork_msg, 1, s->write_pipe_stream)
+  fork_msg->msg.type = QUAPI_MSG_FORK;
+  fork_msg->msg.data.fork =
+    (quapi_msg_fork){ .wait_for_exit_code_and_report =
+                        s->config.SAT_regex ? 0 : 1,
+                      .pipelined = s->pipelined_fork,
+                      .fork_id = s->fork_id };
+  s->solve_id = s->fork_id;
+  s->fork_id = (s->fork_id + 1) & ((1u << 29) - 1);
+
+  // The seeding process may read the request before the write returns.
+  s->times.fork_sent = stats_now_ns();
+  quapi_status status;
+  status = send_msg(s, s->write_pipe_stream, fork_msg);
+
+  if(status != QUAPI_OK) {
+    return false;
+  }
 
-    quapi_status status;
-    status = quapi_write_msg_to_file(s->write_pipe_stream, fork_msg, NULL);
+  if(s->pipelined_fork) {
+    // The assumptions follow right away and are flushed together with SOLVE.
+    // The report is read once the PID is needed.
+    QUAPI_GIVE_MSGS(begin_msg, 1, s->solverchild_write_pipe_stream)
+    begin_msg->msg.type = QUAPI_MSG_BEGIN;
+    begin_msg->msg.data.begin.fork_id = s->solve_id;
+    s->fork_report_pending = true;
+    return send_msg(s, s->solverchild_write_pipe_stream, begin_msg) ==
+           QUAPI_OK;
+  }
 
-    if(status != QUAPI_OK) {
-      return false;
-    }
+  pid_t pid;
+  if(!read_fork_report(s, &pid))
+    return false;
+  solverchild_started(s, pid);
+  return true;
+}
 
-    quapi_msg fork_result_msg;
+static bool
+make_solvable(quapi_solver* s) {
+  if(s->state == QUAPI_INPUT_LITERALS || s->state == QUAPI_INPUT) {
+    s->times = (solve_times){ .start = stats_now_ns() };
 
-    bool success;
-    do {
-      success =
-        quapi_read_msg_from_fd(s->config.header.message_to_parent_pipe[0],
-                               &fork_result_msg,
-                               NULL,
-                               &read);
-    } while(success && fork_result_msg.msg.type != QUAPI_MSG_FORK_REPORT);
+    s->state = QUAPI_INPUT_ASSUMPTIONS;
 
-    if(!success) {
-      err("Could not read fork report message!");
+    // Fall back to forking on demand if no pool child could be started.
+    if(!(s->pool_target > 0 && adopt_pooled_child(s)) && !fork_solverchild(s))
       return false;
-    }
-
-    s->solverchild_pid = fork_result_msg.msg.data.fork_report.solver_child_pid;
-    dbg("Solverchild has PID %d", s->solverchild_pid);
   }
 
   return true;
@@ -694,7 +1265,7 @@ quapi_assume(quapi_solver* s, int32_t lit_or_zero) {
     lit_msg->msg.type = QUAPI_MSG_LITERAL;
     lit_msg->msg.data.literal.lit = lit_or_zero;
     quapi_status status =
-      quapi_write_msg_to_file(s->solverchild_write_pipe_stream, lit_msg, NULL);
+      send_msg(s, s->solverchild_write_pipe_stream, lit_msg);
     if(status != QUAPI_OK)
       return false;
   }
@@ -703,8 +1274,8 @@ quapi_assume(quapi_solver* s, int32_t lit_or_zero) {
     QUAPI_GIVE_MSGS(endclause_lit_msg, 1, s->solverchild_write_pipe_stream)
     endclause_lit_msg->msg.type = QUAPI_MSG_LITERAL;
     endclause_lit_msg->msg.data.literal.lit = 0;
-    quapi_status status = quapi_write_msg_to_file(
-      s->solverchild_write_pipe_stream, endclause_lit_msg, NULL);
+    quapi_status status =
+      send_msg(s, s->solverchild_write_pipe_stream, endclause_lit_msg);
     if(status != QUAPI_OK)
       return false;
   }
@@ -717,16 +1288,72 @@ quapi_assume(quapi_solver* s, int32_t lit_or_zero) {
 
 static void
 abort_solverchild(quapi_solver* s) {
-  kill(s->solverchild_pid, SIGKILL);
+  signal_solverchild(s, SIGKILL);
+}
+
+static void
+release_solverchild(quapi_solver* s) {
+  if(s->solverchild_cpu_pinned) {
+    placement_unpin_child(s->solverchild_cpu);
+    s->solverchild_cpu_pinned = false;
+  }
+  if(s->admitted || s->admission_waiting) {
+    admission_release(s);
+    s->admitted = false;
+    s->admission_waiting = false;
+  }
+}
+
+/* Block until a killed solver child exited. Before that, it may still read
+ * messages that are already meant for the next child. */
+static void
+await_solverchild_exit(quapi_solver* s) {
+  if(s->solverchild_pidfd == -1)
+    return;
+  struct pollfd pfd = { .fd = s->solverchild_pidfd, .events = POLLIN };
+  while(poll(&pfd, 1, -1) == -1 && errno == EINTR)
+    ;
+}
+
+/* Add the spans of the current solve to the timeline. */
+static void
+timeline_solve(quapi_solver* s, const char* name) {
+  uint64_t now = stats_now_ns();
+  int tid = s->timeline_tid;
+  int child = s->solverchild_pid;
+  quapi_timeline_span(name, tid, s->times.start, now, s->solve_id, child);
+  quapi_timeline_span(
+    "assumptions", tid, s->times.start, s->times.solve_sent, s->solve_id, 0);
+  quapi_timeline_span("kill", tid, s->kill_ns, now, s->solve_id, child);
+  s->kill_ns = 0;
 }
 
 QUAPI_EXPORT void
 quapi_reset_assumptions(quapi_solver* s) {
   if(s->state == QUAPI_INPUT_ASSUMPTIONS) {
+    // The child is reaped by the seeding process, there is no need to wait
+    // for it here. Pipelined children do not wait for the seeding process
+    // though, so the next one could lose its input to the killed one.
     abort_solverchild(s);
+    if(s->pipelined_fork)
+      await_solverchild_exit(s);
+    close_solverchild_pidfd(s);
+    release_solverchild(s);
+
+    // Assumptions that were not flushed yet must not reach the next child.
+    // Flushed ones are dropped by the seeding process before it forks.
+#ifdef USING_ZEROCOPY
+    quapi_zerocopy_pipe_discard(s->solverchild_write_pipe_stream);
+#else
+    __fpurge(s->solverchild_write_pipe_stream);
+#endif
+    release_pooled_child(s);
 
-    // Wait for child to exit.
-    waitpid(s->solverchild_pid, NULL, 0);
+    // The aborted solve is not part of the statistics.
+    timeline_solve(s, "aborted solve");
+    s->times = (solve_times){ 0 };
+    s->current_stats.rusage = (quapi_rusage){ 0 };
+    s->current_stats.perf = (quapi_perf_counters){ 0 };
 
     // Reset clauses and stuff.
     s->written_clauses -= s->written_assumptions;
@@ -737,48 +1364,6 @@ quapi_reset_assumptions(quapi_solver* s) {
   }
 }
 
-static size_t
-read_all_available_into_buffer(int fd,
-                               char** buf,
-                               size_t* datalen,
-                               size_t* buflen) {
-  size_t linecount = 0;
-  if(!*buf) {
-    *buflen = 1024;
-    *buf = malloc(*buflen);
-    if(!*buf) {
-      err("Could not malloc buffer of size %d for reading from solver child!",
-          *buflen);
-      exit(-1);
-    }
-  }
-  assert(*buf);
-  FILE* f = fdopen(fd, "r");
-  int c;
-  char* b = *buf;
-  while((c = fgetc(f)) != EOF && c != 0) {
-    if(c == '\n')
-      ++linecount;
-    // else
-    //   dbg("Got character %c in line %zu", c, linecount);
-
-    (*buf)[(*datalen)++] = c;
-    if(*datalen + 1 == *buflen) {
-      *buflen *= 2;
-      *buf = realloc(*buf, *buflen);
-      if(!*buf) {
-        err("Could not malloc buffer of size %d for reading from solver child!",
-            *buflen);
-        exit(-1);
-      }
-    }
-  }
-  (*buf)[*datalen] = '\0';
-  // Purely for debugging:
-  // dbg("Done reading. Datalen: %d. Data: %s", *datalen, *buf);
-  return linecount;
-}
-
 #ifndef WITHOUT_PCRE2
 static bool
 match_regex(pcre2_code* re,
@@ -798,36 +1383,68 @@ match_regex(pcre2_code* re,
 
   return rc >= 0;
 }
-#endif
 
-typedef struct S_data {
-  quapi_solver* s;
+static bool
+contains_literal(const char* line, size_t length, const regex_literal* l) {
+  if(l->anchored)
+    return length >= l->len && memcmp(line, l->text, l->len) == 0;
+  return memmem(line, length, l->text, l->len) != NULL;
+}
 
-  int retcode;
+/* Match a line against the SAT and UNSAT regex. Returns 10 or 20 for a match,
+ * 0 otherwise. */
+static int
+match_result(quapi_solver* s, const char* line, size_t length) {
+  // Most lines are comments or values and cannot match.
+  const regex_literal* l = s->re_literals;
+  if(l[0].text && l[1].text && !contains_literal(line, length, &l[0]) &&
+     !contains_literal(line, length, &l[1]))
+    return 0;
 
-  struct pollfd* active_pfd;
+  if(s->re_result) {
+    int rc = pcre2_match(s->re_result,
+                         (const unsigned char*)line,
+                         length,
+                         0,
+                         0,
+                         s->re_result_match_data,
+                         NULL);
+    if(rc < 0)
+      return 0;
+    PCRE2_SIZE* ovector = pcre2_get_ovector_pointer(s->re_result_match_data);
+    return ovector[2] != PCRE2_UNSET ? 10 : 20;
+  }
 
-  char* buf;
-  size_t datalen;
-  size_t buflen;
-} S_data;
+  if(match_regex(s->re_SAT, s->re_SAT_match_data, line, length))
+    return 10;
+  if(match_regex(s->re_UNSAT, s->re_UNSAT_match_data, line, length))
+    return 20;
+  return 0;
+}
+#endif
 
 static void*
 S_POLL(S_data* d);
 static void*
+S_YIELD(S_data* d);
+static void*
 S_HANDLE_CHILD(S_data* d);
 static void*
 S_HANDLE_EVENTFD(S_data* d);
 static void*
 S_HANDLE_SOLVERCHILD(S_data* d);
-
-typedef void*(S_state)(S_data*);
+static void*
+S_HANDLE_TIMERFD(S_data* d);
+static void*
+S_HANDLE_PIDFD(S_data* d);
 
 static void*
 S_POLL(S_data* d) {
   S_state* actions[] = { S_HANDLE_CHILD,
                          S_HANDLE_EVENTFD,
-                         S_HANDLE_SOLVERCHILD };
+                         S_HANDLE_SOLVERCHILD,
+                         S_HANDLE_TIMERFD,
+                         S_HANDLE_PIDFD };
   const size_t fds = sizeof(actions) / sizeof(actions[0]);
 
   // Handle events from last call to poll.
@@ -841,8 +1458,16 @@ S_POLL(S_data* d) {
     }
   }
 
+  // Non-blocking solves poll exactly once per call, afterwards control goes
+  // back to the caller until new events arrive.
+  if(!d->blocking) {
+    if(d->polled)
+      return S_YIELD;
+    d->polled = true;
+  }
+
   // Poll again.
-  int r = poll(d->s->out_pollfds, fds, -1);
+  int r = poll(d->s->out_pollfds, fds, d->blocking ? -1 : 0);
   if(r == -1) {
     switch(errno) {
       case EFAULT:
@@ -866,6 +1491,49 @@ S_POLL(S_data* d) {
   return S_POLL;
 }
 
+static void*
+S_YIELD(S_data* d) {
+  // Marker state, never executed. The state machine stops here and continues
+  // with S_POLL on the next call.
+  (void)d;
+  return S_POLL;
+}
+
+static void*
+S_HANDLE_SOLVERCHILD(S_data* d);
+
+/* Handle output an exited solver child left in the pipe. Returns true if it
+ * decided the result. */
+static bool
+read_remaining_output(S_data* d) {
+  struct pollfd* out = &d->s->out_pollfds[MYPOLL_SOLVERCHILD];
+  if(!(out->events & POLLIN))
+    return false;
+  d->active_pfd = out;
+  return S_HANDLE_SOLVERCHILD(d) == NULL;
+}
+
+static void*
+handle_child_destructed(S_data* d) {
+  if(read_remaining_output(d))
+    return NULL;
+  dbg("Solver child was destructed before a valid result was read from "
+      "STDOUT!");
+  d->retcode = d->pending_result;
+  return NULL;
+}
+
+/* Timestamps and resource usages are written together with the message they
+ * belong to, which non-blocking solves would otherwise only see on their next
+ * step. */
+static void*
+handle_next_child_msg(S_data* d) {
+  struct pollfd pfd = { .fd = d->active_pfd->fd, .events = POLLIN };
+  if(poll(&pfd, 1, 0) == 1 && pfd.revents & POLLIN)
+    return S_HANDLE_CHILD;
+  return S_POLL;
+}
+
 static void*
 S_HANDLE_CHILD(S_data* d) {
   quapi_msg msg;
@@ -873,18 +1541,45 @@ S_HANDLE_CHILD(S_data* d) {
   if(!s)
     return S_POLL;
 
+  if(msg.msg.type == QUAPI_MSG_TIMESTAMP) {
+    stats_record_timestamp(
+      &d->s->times, msg.msg.data.timestamp, stats_now_ns());
+    return handle_next_child_msg(d);
+  }
+
+  if(d->s->fork_report_pending) {
+    // Messages before the report belong to solver children that were
+    // aborted.
+    if(msg.msg.type != QUAPI_MSG_FORK_REPORT)
+      return S_POLL;
+    pid_t pid = msg.msg.data.fork_report.solver_child_pid;
+    // A child that was already reaped has no pidfd to report its exit.
+    if(!solverchild_started(d->s, pid) && d->s->config.SAT_regex)
+      return S_HANDLE_PIDFD;
+    return S_POLL;
+  }
+
   switch(msg.msg.type) {
+    case QUAPI_MSG_RUSAGE:
+      stats_record_rusage(&d->s->current_stats.rusage, msg.msg.data.rusage);
+      return handle_next_child_msg(d);
+    case QUAPI_MSG_PERF:
+      stats_record_perf(&d->s->current_stats.perf, msg.msg.data.perf);
+      return handle_next_child_msg(d);
     case QUAPI_MSG_DESTRUCTED:
-      dbg("Solver child was destructed before a valid result was read from "
-          "STDOUT!");
-      d->retcode = 0;
-      return NULL;
+      return handle_child_destructed(d);
     case QUAPI_MSG_EXIT_CODE:
+      // Pool children are reported by their waiter, also with a SAT regex.
+      if(d->s->config.SAT_regex)
+        return handle_child_destructed(d);
       dbg("Solver child exited with exit code %d, received a message from "
           "child.",
           msg.msg.data.exit_code.exit_code);
+      // The model may still be in the pipe.
+      if(d->s->model && read_remaining_output(d))
+        return NULL;
       if(msg.msg.data.exit_code.exit_code == 0 && d->retcode == 0 &&
-         d->s->stdout_cb) {
+         d->s->stdout_cb && !d->timed_out) {
         /* There is some more data! The real exit code will be given by the
          * callback function. */
         dbg("There is a callback function for string output set! Proceed "
@@ -902,115 +1597,316 @@ S_HANDLE_CHILD(S_data* d) {
   }
 }
 
-static size_t
-cutout_line_from_buf(S_data* d) {
-  assert(d->buf);
-  char* linefeed = strchr(d->buf, '\n');
-  if(!linefeed)
-    return 0;
-  *linefeed = '\0';
-  return linefeed - d->buf + 1;
-}
-
-static void
-move_next_line_to_front(S_data* d, size_t linelength) {
-  memmove(d->buf, d->buf + linelength, d->datalen - linelength);
-  d->datalen -= linelength;
-}
+/* Match a single line of solver child output. Returns true if the line
+ * decided the result of the solve. */
+static bool
+handle_line(void* ctx, const char* line, size_t length) {
+  S_data* d = ctx;
+  quapi_solver* s = d->s;
 
-static void*
-S_HANDLE_SOLVERCHILD(S_data* d) {
-  size_t lines = read_all_available_into_buffer(
-    d->active_pfd->fd, &d->buf, &d->datalen, &d->buflen);
+  s->current_stats.stdout_bytes += length + 1;
 
-  while(lines > 0) {
-    assert(d->buf);
-    size_t linelength = cutout_line_from_buf(d);
-    // dbg("Line Length: %d of buf %s", linelength, d->buf);
-    assert(linelength);
-    --lines;
+  if(s->model && !d->model_done && line[0] == 'v')
+    d->model_done = model_parse_value_line(
+      line + 1, length - 1, s->model, s->model_size);
 
 #ifndef WITHOUT_PCRE2
-    bool sat =
-      match_regex(d->s->re_SAT, d->s->re_SAT_match_data, d->buf, linelength);
-    if(sat) {
-      d->retcode = 10;
-      return NULL;
-    }
+  if(s->re_SAT && !d->pending_result)
+    d->pending_result = match_result(s, line, length);
 
-    bool unsat = match_regex(
-      d->s->re_UNSAT, d->s->re_UNSAT_match_data, d->buf, linelength);
-    if(unsat) {
-      d->retcode = 20;
-      return NULL;
-    }
+  // The model is printed after the result line, wait for it.
+  if(d->pending_result &&
+     (d->pending_result != 10 || !s->model || d->model_done)) {
+    d->retcode = d->pending_result;
+    return true;
+  }
 #endif
 
-    if(d->s->stdout_cb) {
-      int ret = d->s->stdout_cb(d->buf, d->s->stdout_cb_userdata);
-      if(ret != 0) {
-        d->retcode = ret;
-        return NULL;
-      }
+  if(d->s->stdout_cb) {
+    int ret = d->s->stdout_cb(line, d->s->stdout_cb_userdata);
+    if(ret != 0) {
+      d->retcode = ret;
+      return true;
     }
+  }
+  return false;
+}
 
-    move_next_line_to_front(d, linelength);
+static bool
+reserve_line_buffer(line_buffer* b) {
+  if(b->size - b->len > OUTBUF_CHUNK)
+    return true;
+
+  size_t size = b->size ? b->size * 2 : OUTBUF_CHUNK * 2;
+  while(size - b->len <= OUTBUF_CHUNK)
+    size *= 2;
+
+  char* data = realloc(b->data, size);
+  if(!data) {
+    err("Could not allocate buffer of size %zu for reading from solver child!",
+        size);
+    return false;
   }
+  b->data = data;
+  b->size = size;
+  return true;
+}
 
-  return S_POLL;
+/* Read lines from a non-blocking fd until it is empty and hand them to the
+ * handler. Returns 1 once the handler returned true, 0 if the fd is drained
+ * and -1 on errors.
+ *
+ * Reads happen in large chunks. Only the incomplete last line is moved to the
+ * front after each chunk, so every byte is scanned once, no matter how long
+ * the lines are. */
+static int
+read_lines(int fd, line_buffer* b, line_handler handler, void* ctx) {
+  for(;;) {
+    if(!reserve_line_buffer(b))
+      return -1;
+
+    ssize_t r = read(fd, b->data + b->len, b->size - b->len);
+    if(r == -1 && errno == EINTR)
+      continue;
+    if(r <= 0)
+      return 0;
+
+    char* line = b->data;
+    char* end = b->data + b->len + r;
+    // The incomplete line from before contains no line feed.
+    char* lf = memchr(line + b->len, '\n', r);
+    while(lf) {
+      *lf = '\0';
+      if(handler(ctx, line, lf - line)) {
+        b->len = 0;
+        return 1;
+      }
+      line = lf + 1;
+      lf = memchr(line, '\n', end - line);
+    }
+
+    b->len = end - line;
+    if(line != b->data)
+      memmove(b->data, line, b->len);
+  }
 }
 
 static void*
-S_HANDLE_EVENTFD(S_data* d) {
-  dbg("Received an abort via eventfd! revents: %d", d->active_pfd->revents);
+S_HANDLE_SOLVERCHILD(S_data* d) {
+  d->s->times.output_read = stats_now_ns();
+  switch(read_lines(d->active_pfd->fd, &d->s->out, handle_line, d)) {
+    case 1:
+      return NULL;
+    case -1:
+      d->retcode = 0;
+      return NULL;
+    default:
+      return S_POLL;
+  }
+}
 
+static bool
+send_solve(quapi_solver* s) {
+  QUAPI_GIVE_MSGS(solve_msg, 1, s->solverchild_write_pipe_stream)
+  solve_msg->msg.type = QUAPI_MSG_SOLVE;
+  if(send_msg(s, s->solverchild_write_pipe_stream, solve_msg) != QUAPI_OK)
+    return false;
+  s->times.solve_sent = stats_now_ns();
+  return true;
+}
+
+/* Solver children are forked right away, but only receive SOLVE once they
+ * are admitted. Blocking solves wait for the admission, non-blocking ones are
+ * woken up through the eventfd to try again. */
+static bool
+acquire_admission(quapi_solver* s, bool blocking) {
+  pid_t pid = s->fork_report_pending ? 0 : s->solverchild_pid;
+  int fd = s->out_pollfds[MYPOLL_EVENTFD].fd;
+  if(blocking) {
+    admission_acquire(s, pid, fd);
+    s->admitted = true;
+  } else {
+    s->admitted = admission_try_acquire(s, pid, fd);
+  }
+  s->admission_waiting = !s->admitted;
+  return s->admitted;
+}
+
+static void*
+S_HANDLE_EVENTFD(S_data* d) {
   uint64_t evfdval;
   read(d->active_pfd->fd, &evfdval, sizeof(evfdval));
 
-  abort_solverchild(d->s);
+  quapi_solver* s = d->s;
+  bool terminate =
+    __atomic_exchange_n(&s->terminate_requested, false, __ATOMIC_ACQ_REL);
+  if(!terminate && s->admitted)
+    terminate = admission_stop_requested(s);
+
+  if(!terminate) {
+    // Woken up to retry the admission, or left over from a wakeup before.
+    if(s->admission_waiting && acquire_admission(s, false) && !send_solve(s)) {
+      d->retcode = 0;
+      return NULL;
+    }
+    return S_POLL;
+  }
+
+  dbg("Received an abort via eventfd! revents: %d", d->active_pfd->revents);
+  abort_solverchild(s);
 
   d->retcode = 0;
+  d->terminated = true;
   return NULL;
 }
 
-static int
-solve_internal(quapi_solver* s) {
+static void
+arm_timer(quapi_solver* s, uint64_t ns, bool absolute) {
+  struct itimerspec its = { .it_interval = { 0, 0 },
+                            .it_value = { .tv_sec = ns / 1000000000,
+                                          .tv_nsec = ns % 1000000000 } };
+  timerfd_settime(s->out_pollfds[MYPOLL_TIMERFD].fd,
+                  absolute ? TFD_TIMER_ABSTIME : 0,
+                  &its,
+                  NULL);
+}
+
+static void*
+S_HANDLE_TIMERFD(S_data* d) {
+  uint64_t expirations;
+  if(read(d->active_pfd->fd, &expirations, sizeof(expirations)) !=
+     sizeof(expirations))
+    return S_POLL;
+
+  if(!d->timed_out && d->s->kill_grace_ns > 0) {
+    dbg("Solve timed out! Sending SIGTERM to solver child %d.",
+        d->s->solverchild_pid);
+    d->timed_out = true;
+    signal_solverchild(d->s, SIGTERM);
+    arm_timer(d->s, d->s->kill_grace_ns, false);
+    return S_POLL;
+  }
+
+  dbg("Solver child %d did not exit after timeout, sending SIGKILL.",
+      d->s->solverchild_pid);
+  d->timed_out = true;
+  abort_solverchild(d->s);
+  d->retcode = d->pending_result;
+
+  // Without a SAT regex, the seeding process reports the exit code of the
+  // killed child. Wait for it, so it does not end up in the next solve.
+  if(!d->s->config.SAT_regex)
+    return S_POLL;
+  return NULL;
+}
+
+static void*
+S_HANDLE_PIDFD(S_data* d) {
+  dbg("Solver child %d exited.", d->s->solverchild_pid);
+
+  // The child may have written its result right before exiting.
+  if(read_remaining_output(d))
+    return NULL;
+
+  d->retcode = d->pending_result;
+  return NULL;
+}
+
+static bool
+start_solve(quapi_solver* s, bool blocking) {
   if(!(s->state == QUAPI_INPUT || s->state == QUAPI_INPUT_LITERALS ||
        s->state == QUAPI_INPUT_ASSUMPTIONS)) {
     err("Solver is in invalid state %s for solving!",
         quapi_state_str(s->state));
-    return 0;
+    return false;
+  }
+
+  // Drop terminations that arrived after the last solve already ended.
+  {
+    __atomic_store_n(&s->terminate_requested, false, __ATOMIC_RELEASE);
+    uint64_t evfdval;
+    read(s->out_pollfds[MYPOLL_EVENTFD].fd, &evfdval, sizeof(evfdval));
   }
 
   s->state = QUAPI_WORKING;
 
-  {
-    QUAPI_GIVE_MSGS(solve_msg, 1, s->solverchild_write_pipe_stream)
-    solve_msg->msg.type = QUAPI_MSG_SOLVE;
-    quapi_status status = quapi_write_msg_to_file(
-      s->solverchild_write_pipe_stream, solve_msg, NULL);
-    if(status != QUAPI_OK)
-      return 0;
+  if(acquire_admission(s, blocking) && !send_solve(s))
+    return false;
+
+  for(size_t i = 0; i < QUAPI_MAX_FDS; ++i)
+    s->out_pollfds[i].revents = 0;
+
+  uint64_t deadline = s->deadline_ns;
+  if(s->timeout_ns > 0) {
+    uint64_t timeout_deadline = stats_now_ns() + s->timeout_ns;
+    if(deadline == 0 || timeout_deadline < deadline)
+      deadline = timeout_deadline;
   }
+  if(deadline > 0)
+    arm_timer(s, deadline, true);
+
+  s->out.len = 0;
+  s->solve = (S_data){ .s = s,
+                       .active_pfd = NULL,
+                       .retcode = 0,
+                       .S = S_POLL,
+                       .blocking = blocking,
+                       .polled = false,
+                       .terminated = false,
+                       .timed_out = false,
+                       .pending_result = 0,
+                       .model_done = false };
+  if(s->model)
+    memset(s->model, 0, s->model_size);
+  return true;
+}
 
-  s->out_pollfds[0].revents = 0;
-  s->out_pollfds[1].revents = 0;
-  s->out_pollfds[2].revents = 0;
+/* Run the state machine of a started solve. Returns true once the solve is
+ * done, with the result in d->retcode. Non-blocking solves return false as
+ * soon as no more events are ready. */
+static bool
+step_solve(S_data* d) {
+  S_state* S = d->S;
+  while(S && S != S_YIELD)
+    S = S(d);
 
-  S_data d = { .s = s,
-               .buf = NULL,
-               .buflen = 0,
-               .datalen = 0,
-               .active_pfd = NULL,
-               .retcode = 0 };
-  S_state* S = S_POLL;
-  while(S)
-    S = S(&d);
+  d->polled = false;
 
-  if(d.buf)
-    free(d.buf);
+  if(S) {
+    d->S = S_POLL;
+    return false;
+  }
+
+  d->S = NULL;
 
-  return d.retcode;
+  // Disarm the timer, a late expiration must not end the next solve.
+  arm_timer(d->s, 0, false);
+  if(d->timed_out && d->retcode == 0)
+    d->retcode = QUAPI_TIMEOUT;
+  return true;
+}
+
+static void
+finish_solve(quapi_solver* s) {
+  // The result may be printed before the report was read. It must not be
+  // taken for the report of the next child.
+  await_fork_report(s);
+  timeline_solve(s, "solve");
+  if(s->times.solve_sent) {
+    s->current_stats.numa_node = s->numa_node;
+    s->current_stats.solverchild_cpu = s->solverchild_cpu;
+    stats_finish_solve(
+      &s->stats, &s->current_stats, &s->times, stats_now_ns());
+  }
+  s->times = (solve_times){ 0 };
+  s->state = QUAPI_INPUT_LITERALS;
+  s->written_clauses -= s->written_assumptions;
+  s->written_assumptions = 0;
+  s->deadline_ns = 0;
+  // The exited child must not wake up pollers until the next solve.
+  s->out_pollfds[MYPOLL_PIDFD].events = 0;
+  release_solverchild(s);
+  release_pooled_child(s);
 }
 
 static bool
@@ -1019,8 +1915,8 @@ allow_missing_universal_assumptions() {
   return allow;
 }
 
-QUAPI_EXPORT int
-quapi_solve(quapi_solver* s) {
+static bool
+check_universal_assumptions(quapi_solver* s) {
   if(s->written_assumptions < s->universal_prefix_depth &&
      !allow_missing_universal_assumptions()) {
     err("Not enough assumptions to assign all leading universal "
@@ -1030,19 +1926,84 @@ quapi_solve(quapi_solver* s) {
         s->universal_prefix_depth,
         s->config.header.prefixdepth,
         s->written_assumptions);
-    return 0;
+    return false;
   }
+  return true;
+}
+
+QUAPI_EXPORT int
+quapi_solve(quapi_solver* s) {
+  if(!check_universal_assumptions(s))
+    return 0;
 
   if(!make_solvable(s))
     return 0;
 
-  int r = solve_internal(s);
-  s->state = QUAPI_INPUT_LITERALS;
-  s->written_clauses -= s->written_assumptions;
-  s->written_assumptions = 0;
+  int r = 0;
+  if(start_solve(s, true)) {
+    while(!step_solve(&s->solve)) {
+    }
+    r = s->solve.retcode;
+  }
+
+  finish_solve(s);
   return r;
 }
 
+QUAPI_EXPORT bool
+quapi_solve_start(quapi_solver* s) {
+  if(!check_universal_assumptions(s))
+    return false;
+
+  if(!make_solvable(s))
+    return false;
+
+  if(!start_solve(s, false)) {
+    finish_solve(s);
+    return false;
+  }
+  return true;
+}
+
+QUAPI_EXPORT bool
+quapi_process_events(quapi_solver* s, int* result) {
+  assert(s);
+  if(!s->solve.S || s->solve.blocking)
+    return false;
+
+  if(!step_solve(&s->solve))
+    return false;
+
+  if(result)
+    *result = s->solve.retcode;
+
+  finish_solve(s);
+  return true;
+}
+
+QUAPI_EXPORT size_t
+quapi_get_fds(quapi_solver* s, int* fds, size_t fds_size) {
+  assert(s);
+  // The pidfd of a pipelined solver child is left out until its report was
+  // read, which must not block the caller.
+  size_t count = 0;
+  for(size_t i = 0; i < QUAPI_MAX_FDS; ++i) {
+    const struct pollfd* pfd = &s->out_pollfds[i];
+    if(!pfd->events)
+      continue;
+    if(count < fds_size)
+      fds[count] = pfd->fd;
+    ++count;
+  }
+  return count;
+}
+
+QUAPI_EXPORT bool
+quapi_was_terminated(quapi_solver* s) {
+  assert(s);
+  return s->solve.terminated;
+}
+
 QUAPI_EXPORT void
 quapi_terminate(quapi_solver* s) {
   assert(s);
@@ -1053,15 +2014,744 @@ quapi_terminate(quapi_solver* s) {
   union intwrite buf;
   struct pollfd* pfd = &s->out_pollfds[MYPOLL_EVENTFD];
   buf.i = 1;
+  __atomic_store_n(&s->terminate_requested, true, __ATOMIC_RELEASE);
   write(pfd->fd, &buf, sizeof(buf));
 }
 
+QUAPI_EXPORT void
+quapi_set_timeout(quapi_solver* s, uint64_t timeout_ns) {
+  assert(s);
+  s->timeout_ns = timeout_ns;
+}
+
+QUAPI_EXPORT void
+quapi_set_deadline(quapi_solver* s, uint64_t deadline_ns) {
+  assert(s);
+  s->deadline_ns = deadline_ns;
+}
+
+QUAPI_EXPORT void
+quapi_set_kill_grace_period(quapi_solver* s, uint64_t grace_ns) {
+  assert(s);
+  s->kill_grace_ns = grace_ns;
+}
+
+QUAPI_EXPORT bool
+quapi_set_pipelined_fork(quapi_solver* s, bool enable) {
+  assert(s);
+  if(s->state != QUAPI_INPUT && s->state != QUAPI_INPUT_LITERALS) {
+    err("Pipelined forks can only be toggled in state INPUT or "
+        "INPUT_LITERALS, not in state %s!",
+        quapi_state_str(s->state));
+    return false;
+  }
+  s->pipelined_fork = enable;
+  return true;
+}
+
+QUAPI_EXPORT bool
+quapi_set_prefork(quapi_solver* s, unsigned count) {
+  assert(s);
+  if(s->state != QUAPI_INPUT && s->state != QUAPI_INPUT_LITERALS) {
+    err("The pre-forked pool can only be resized in state INPUT or "
+        "INPUT_LITERALS, not in state %s!",
+        quapi_state_str(s->state));
+    return false;
+  }
+
+  pool_clear(s);
+  quapi_probe** pool = realloc(s->pool, count * sizeof(quapi_probe*));
+  if(count > 0 && !pool) {
+    err("Could not allocate pre-forked pool of %u children!", count);
+    return false;
+  }
+  s->pool = count > 0 ? pool : NULL;
+  s->pool_target = count;
+  return true;
+}
+
+static bool
+checkpoint_state_ok(quapi_solver* s) {
+  if(s->state != QUAPI_INPUT && s->state != QUAPI_INPUT_LITERALS) {
+    err("Checkpoints can only be used in state INPUT or INPUT_LITERALS, not "
+        "in state %s!",
+        quapi_state_str(s->state));
+    return false;
+  }
+  if(s->clause_open) {
+    err("Checkpoints cannot be used before the current clause or quantifier "
+        "block was ended with 0!");
+    return false;
+  }
+  return true;
+}
+
+/* Send a CHECKPOINT or ROLLBACK to the seeding process. Unless only dropping
+ * checkpoints, wait for the PID of the seeding process that continues. */
+static bool
+send_checkpoint_msg(quapi_solver* s, quapi_msg_type type, quapi_msg_data data) {
+  QUAPI_GIVE_MSGS(msg, 1, s->write_pipe_stream)
+  msg->msg.type = type;
+  msg->msg.data = data;
+  if(send_msg(s, s->write_pipe_stream, msg) != QUAPI_OK)
+    return false;
+  if(type == QUAPI_MSG_ROLLBACK && data.rollback.drop)
+    return true;
+
+  quapi_msg report_msg;
+  if(!read_seeding_msg(s, QUAPI_MSG_CHECKPOINT_REPORT, &report_msg)) {
+    err("Could not read checkpoint report message!");
+    return false;
+  }
+  pid_t pid = report_msg.msg.data.checkpoint_report.seeding_pid;
+  if(pid <= 0)
+    return false;
+  dbg("Seeding process is now %d", pid);
+  s->pid = pid;
+  return true;
+}
+
+QUAPI_EXPORT int
+quapi_checkpoint(quapi_solver* s) {
+  assert(s);
+  if(!checkpoint_state_ok(s))
+    return 0;
+  if(s->checkpoints_size == QUAPI_MAX_CHECKPOINTS) {
+    err("Cannot create more than %d nested checkpoints!",
+        QUAPI_MAX_CHECKPOINTS);
+    return 0;
+  }
+
+  quapi_msg_data data = { .checkpoint = { .depth = s->checkpoints_size + 1 } };
+  if(!send_checkpoint_msg(s, QUAPI_MSG_CHECKPOINT, data))
+    return 0;
+
+  s->checkpoints[s->checkpoints_size] = (checkpoint_state){
+    .state = s->state,
+    .written_clauses = s->written_clauses,
+    .written_quantifier_literals = s->written_quantifier_literals,
+    .universal_prefix_depth = s->universal_prefix_depth
+  };
+  return ++s->checkpoints_size;
+}
+
+QUAPI_EXPORT bool
+quapi_rollback(quapi_solver* s, int checkpoint) {
+  assert(s);
+  if(!checkpoint_state_ok(s))
+    return false;
+  if(checkpoint < 1 || (size_t)checkpoint > s->checkpoints_size) {
+    err("Cannot roll back to checkpoint %d, there are only %zu!",
+        checkpoint,
+        s->checkpoints_size);
+    return false;
+  }
+
+  // Pool children were forked from the dropped seeding process.
+  pool_clear(s);
+
+  quapi_msg_data data = { .rollback = { .depth = checkpoint, .drop = 0 } };
+  bool success = send_checkpoint_msg(s, QUAPI_MSG_ROLLBACK, data);
+
+  // The seeding process of the dropped branch is gone either way, but the
+  // snapshot may not have been able to fork again.
+  const checkpoint_state* c = &s->checkpoints[checkpoint - 1];
+  s->state = c->state;
+  s->written_clauses = c->written_clauses;
+  s->written_quantifier_literals = c->written_quantifier_literals;
+  s->universal_prefix_depth = c->universal_prefix_depth;
+  s->checkpoints_size = success ? checkpoint : checkpoint - 1;
+  ++s->formula_version;
+  return success;
+}
+
+QUAPI_EXPORT bool
+quapi_drop_checkpoint(quapi_solver* s, int checkpoint) {
+  assert(s);
+  if(!checkpoint_state_ok(s))
+    return false;
+  if(checkpoint < 1 || (size_t)checkpoint > s->checkpoints_size) {
+    err("Cannot drop checkpoint %d, there are only %zu!",
+        checkpoint,
+        s->checkpoints_size);
+    return false;
+  }
+
+  quapi_msg_data data = { .rollback = { .depth = checkpoint, .drop = 1 } };
+  if(!send_checkpoint_msg(s, QUAPI_MSG_ROLLBACK, data))
+    return false;
+  s->checkpoints_size = checkpoint - 1;
+  return true;
+}
+
+QUAPI_EXPORT int
+quapi_get_numa_node(quapi_solver* s) {
+  assert(s);
+  return s->numa_node;
+}
+
+QUAPI_EXPORT int
+quapi_get_solverchild_cpu(quapi_solver* s) {
+  assert(s);
+  return s->solverchild_cpu;
+}
+
 QUAPI_EXPORT quapi_state
 quapi_get_state(quapi_solver* s) {
   assert(s);
   return s->state;
 }
 
+QUAPI_EXPORT void
+quapi_get_stats(quapi_solver* s, quapi_stats* stats) {
+  assert(s);
+  assert(stats);
+  *stats = s->stats;
+}
+
+QUAPI_EXPORT void
+quapi_reset_stats(quapi_solver* s) {
+  assert(s);
+  uint64_t exec_ns = s->stats.exec_ns;
+  memset(&s->stats, 0, sizeof(s->stats));
+  s->stats.exec_ns = exec_ns;
+}
+
+QUAPI_EXPORT int
+quapi_get_pid(quapi_solver* s) {
+  assert(s);
+  return s->pid;
+}
+
+QUAPI_EXPORT bool
+quapi_track_model(quapi_solver* s, bool enable) {
+  assert(s);
+  if(s->state != QUAPI_INPUT && s->state != QUAPI_INPUT_LITERALS) {
+    err("Models can only be tracked in state INPUT or INPUT_LITERALS, not in "
+        "state %s!",
+        quapi_state_str(s->state));
+    return false;
+  }
+
+  struct pollfd* pfd = &s->out_pollfds[MYPOLL_SOLVERCHILD];
+  if(!enable) {
+    free(s->model);
+    s->model = NULL;
+    s->model_size = 0;
+    pfd->events = s->config.SAT_regex || s->stdout_cb ? POLLIN : 0;
+    return true;
+  }
+
+  if(!s->model) {
+    size_t size = (size_t)s->config.header.literals + 1;
+    s->model = calloc(size, sizeof(int8_t));
+    if(!s->model) {
+      err("Could not allocate model for %zu variables!", size);
+      return false;
+    }
+    s->model_size = size;
+  }
+  pfd->events = POLLIN;
+  return true;
+}
+
+QUAPI_EXPORT int32_t
+quapi_val(quapi_solver* s, int32_t lit) {
+  assert(s);
+  if(lit == 0 || !s->model)
+    return 0;
+  size_t var = lit < 0 ? -(int64_t)lit : lit;
+  if(var >= s->model_size || !s->model[var])
+    return 0;
+  return (s->model[var] > 0) == (lit > 0) ? lit : -lit;
+}
+
+struct quapi_probe {
+  quapi_solver* s;
+  pid_t pid;
+  int pidfd;
+  int out_fd;
+  int status_fd;
+  // Input of nodes, which wait for forks instead of solving. NULL for
+  // probes that solve.
+  ZEROCOPY_PIPE_OR_FILE* in_stream;
+  // Assumptions of the probe, including the ones of its parent nodes.
+  size_t depth;
+  line_buffer out;
+  uint64_t deadline_ns;
+  // 10 or 20, 0 if unknown.
+  int result;
+  // The result is known.
+  bool done;
+  // The waiter reported the exit of the probe child.
+  bool exited;
+  // The probe child holds an admission, see admission.h.
+  bool admitted;
+};
+
+/* Receive the pipes of a forked probe. Returns 1 if they were received, 0 if
+ * none are ready and wait is false and -1 on errors. */
+static int
+recv_probe_fds(quapi_solver* s, int* fds, bool wait) {
+  char byte;
+  struct iovec iov = { .iov_base = &byte, .iov_len = 1 };
+  union {
+    char buf[CMSG_SPACE(sizeof(int) * 3)];
+    struct cmsghdr align;
+  } control;
+  struct msghdr msg = { .msg_iov = &iov,
+                        .msg_iovlen = 1,
+                        .msg_control = control.buf,
+                        .msg_controllen = sizeof(control.buf) };
+
+  ssize_t r;
+  do {
+    r = recvmsg(s->config.header.probe_socket[0],
+                &msg,
+                MSG_CMSG_CLOEXEC | (wait ? 0 : MSG_DONTWAIT));
+  } while(r == -1 && errno == EINTR);
+  if(r == -1 && !wait && (errno == EAGAIN || errno == EWOULDBLOCK))
+    return 0;
+  if(r == -1) {
+    err("Could not receive probe fds! Error: %s", strerror(errno));
+    return -1;
+  }
+
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  if(!cmsg || cmsg->cmsg_level != SOL_SOCKET ||
+     cmsg->cmsg_type != SCM_RIGHTS ||
+     cmsg->cmsg_len != CMSG_LEN(sizeof(int) * 3)) {
+    err("Seeding process could not start a probe!");
+    return -1;
+  }
+  memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * 3);
+  return 1;
+}
+
+static quapi_status
+write_probe_msg(ZEROCOPY_PIPE_OR_FILE* f, quapi_msg_type type, int32_t lit) {
+  QUAPI_GIVE_MSGS(msg, 1, f)
+  msg->msg.type = type;
+  msg->msg.data.literal.lit = lit;
+  return quapi_write_msg_to_file(f, msg, NULL);
+}
+
+static void
+close_probe_stream(ZEROCOPY_PIPE_OR_FILE* f) {
+#ifdef USING_ZEROCOPY
+  quapi_zerocopy_pipe_close(f);
+#else
+  fclose(f);
+#endif
+}
+
+static ZEROCOPY_PIPE_OR_FILE*
+open_probe_stream(int fd) {
+#ifdef USING_ZEROCOPY
+  ZEROCOPY_PIPE_OR_FILE* f = quapi_zerocopy_pipe_fdopen(fd, "wb");
+#else
+  ZEROCOPY_PIPE_OR_FILE* f = fdopen(fd, "wb");
+#endif
+  if(!f)
+    close(fd);
+  return f;
+}
+
+/* Create a probe from the pipes sent by the seeding process. The input pipe
+ * fds[0] stays with the caller. */
+static quapi_probe*
+new_probe(quapi_solver* s, const int* fds, size_t depth) {
+  quapi_probe* p = malloc(sizeof(quapi_probe));
+  if(!p) {
+    close(fds[0]);
+    close(fds[1]);
+    close(fds[2]);
+    return NULL;
+  }
+  *p = (quapi_probe){ .s = s,
+                      .pid = -1,
+                      .pidfd = -1,
+                      .out_fd = fds[1],
+                      .status_fd = fds[2],
+                      .in_stream = NULL,
+                      .depth = depth,
+                      .out = { .data = NULL, .size = 0, .len = 0 },
+                      .deadline_ns = 0,
+                      .result = 0,
+                      .done = false,
+                      .exited = false,
+                      .admitted = false };
+  return p;
+}
+
+/* The waiter reports the PID of the probe child right after forking it. */
+static bool
+read_probe_report(quapi_probe* p) {
+  quapi_msg report;
+  if(!quapi_read_msg_from_fd(p->status_fd, &report, NULL, &read) ||
+     report.msg.type != QUAPI_MSG_FORK_REPORT) {
+    err("Could not read fork report of probe!");
+    return false;
+  }
+  p->pid = report.msg.data.fork_report.solver_child_pid;
+#ifdef SYS_pidfd_open
+  p->pidfd = syscall(SYS_pidfd_open, p->pid, 0);
+#endif
+  fcntl(p->out_fd, F_SETFL, fcntl(p->out_fd, F_GETFL) | O_NONBLOCK);
+  dbg("Probe child has PID %d", p->pid);
+  return true;
+}
+
+/* Write the assumptions as unit clauses, followed by SOLVE for probes that
+ * solve. Nodes keep their stream to receive further forks. */
+static bool
+write_probe_assumptions(quapi_probe* p,
+                        int fd,
+                        const int32_t* assumptions,
+                        size_t size,
+                        bool solve) {
+  ZEROCOPY_PIPE_OR_FILE* f = open_probe_stream(fd);
+  if(!f)
+    return false;
+
+  quapi_status status = QUAPI_OK;
+  for(size_t i = 0; i < size && status == QUAPI_OK; ++i) {
+    status = write_probe_msg(f, QUAPI_MSG_LITERAL, assumptions[i]);
+    if(status == QUAPI_OK)
+      status = write_probe_msg(f, QUAPI_MSG_LITERAL, 0);
+  }
+
+  if(!solve && status == QUAPI_OK) {
+    // Let the node parse its units right away.
+#ifdef USING_ZEROCOPY
+    quapi_zerocopy_pipe_flush(f);
+#else
+    fflush(f);
+#endif
+    p->in_stream = f;
+    return true;
+  }
+
+  if(status == QUAPI_OK)
+    status = write_probe_msg(f, QUAPI_MSG_SOLVE, 0);
+  close_probe_stream(f);
+  return status == QUAPI_OK;
+}
+
+/* Receive the pipes of requested pool children until there are at least min
+ * of them or none are pending, then take the ones that are ready already. */
+static void
+pool_collect(quapi_solver* s, size_t min) {
+  while(s->pool_pending > 0) {
+    int fds[3];
+    int r = recv_probe_fds(s, fds, s->pool_size < min);
+    if(r == 0)
+      break;
+    --s->pool_pending;
+    if(r == -1)
+      continue;
+
+    quapi_probe* p = new_probe(s, fds, 0);
+    if(!p)
+      continue;
+    p->in_stream = open_probe_stream(fds[0]);
+    if(!p->in_stream) {
+      probe_release(p);
+      continue;
+    }
+    s->pool[s->pool_size++] = p;
+  }
+}
+
+/* Ask the seeding process for pool children until the pool is full again.
+ * The forks happen in the background, their pipes are received later. */
+static void
+pool_refill(quapi_solver* s) {
+  while(s->pool_size + s->pool_pending < s->pool_target) {
+    QUAPI_GIVE_MSGS(fork_msg, 1, s->write_pipe_stream)
+    fork_msg->msg.type = QUAPI_MSG_FORK;
+    fork_msg->msg.data.fork = (quapi_msg_fork){ .probe = 1 };
+    if(send_msg(s, s->write_pipe_stream, fork_msg) != QUAPI_OK)
+      return;
+    ++s->pool_pending;
+  }
+}
+
+static void
+pool_clear(quapi_solver* s) {
+  pool_collect(s, SIZE_MAX);
+  for(size_t i = 0; i < s->pool_size; ++i)
+    probe_release(s->pool[i]);
+  s->pool_size = 0;
+}
+
+/* Hand the current assumptions to the oldest pool child instead of forking a
+ * new solver child. Returns false if there is none. */
+static bool
+adopt_pooled_child(quapi_solver* s) {
+  pool_refill(s);
+  pool_collect(s, 1);
+
+  while(s->pool_size > 0) {
+    quapi_probe* p = s->pool[0];
+    memmove(s->pool, s->pool + 1, --s->pool_size * sizeof(quapi_probe*));
+    if(!read_probe_report(p) || !probe_alive(p)) {
+      probe_release(p);
+      continue;
+    }
+
+    s->solverchild_probe = p;
+    s->solve_id = -1;
+    s->shared_solverchild_write_pipe_stream = s->solverchild_write_pipe_stream;
+    s->solverchild_write_pipe_stream = p->in_stream;
+    s->out_pollfds[MYPOLL_CHILD].fd = p->status_fd;
+    // Unlike the shared pipe, the output pipe hangs up once the child exits.
+    // If it is not watched, poll() would spin on POLLHUP until the waiter
+    // reports the exit.
+    struct pollfd* out = &s->out_pollfds[MYPOLL_SOLVERCHILD];
+    out->fd = out->events ? p->out_fd : -1;
+    solverchild_started(s, p->pid);
+
+    // Replace the child while this one solves.
+    pool_refill(s);
+    return true;
+  }
+  return false;
+}
+
+static void
+release_pooled_child(quapi_solver* s) {
+  quapi_probe* p = s->solverchild_probe;
+  if(!p)
+    return;
+  s->solverchild_write_pipe_stream = s->shared_solverchild_write_pipe_stream;
+  s->out_pollfds[MYPOLL_CHILD].fd = s->config.header.message_to_parent_pipe[0];
+  s->out_pollfds[MYPOLL_SOLVERCHILD].fd =
+    s->config.header.forked_child_write_pipe[0];
+  s->solverchild_probe = NULL;
+  probe_release(p);
+}
+
+/* Solving probes only receive SOLVE once they are admitted. Without wait,
+ * probes that are not admitted right away are released again and *admitted
+ * is set to false. */
+static quapi_probe*
+fork_probe(quapi_solver* s,
+           quapi_probe* parent,
+           const int32_t* assumptions,
+           size_t size,
+           bool solve,
+           bool wait,
+           bool* admitted) {
+  assert(s);
+  assert(!parent || parent->in_stream);
+  if(s->state != QUAPI_INPUT && s->state != QUAPI_INPUT_LITERALS) {
+    err("Probes can only be started in state INPUT or INPUT_LITERALS, not in "
+        "state %s!",
+        quapi_state_str(s->state));
+    return NULL;
+  }
+  size_t depth = (parent ? parent->depth : 0) + size;
+  if(s->written_clauses + depth >
+     (size_t)s->config.header.clauses + s->config.header.prefixdepth) {
+    err("Probe with %zu assumptions exceeds the maximum assumption count %d!",
+        depth,
+        s->config.header.prefixdepth);
+    return NULL;
+  }
+  if(solve && (int)depth < s->universal_prefix_depth &&
+     !allow_missing_universal_assumptions()) {
+    dbg("Probe with %zu assumptions does not assign all leading universal "
+        "quantifiers.",
+        depth);
+    return NULL;
+  }
+
+  // Pipes of all forks arrive on the same socket, in order.
+  pool_collect(s, SIZE_MAX);
+
+  ZEROCOPY_PIPE_OR_FILE* fork_stream =
+    parent ? parent->in_stream : s->write_pipe_stream;
+  QUAPI_GIVE_MSGS(fork_msg, 1, fork_stream)
+  fork_msg->msg.type = QUAPI_MSG_FORK;
+  fork_msg->msg.data.fork = (quapi_msg_fork){ .probe = 1 };
+  if(quapi_write_msg_to_file(fork_stream, fork_msg, NULL) != QUAPI_OK)
+    return NULL;
+
+  int fds[3];
+  if(recv_probe_fds(s, fds, true) != 1)
+    return NULL;
+
+  quapi_probe* p = new_probe(s, fds, depth);
+  if(!p)
+    return NULL;
+  if(!read_probe_report(p)) {
+    close(fds[0]);
+    probe_release(p);
+    return NULL;
+  }
+
+  if(solve && wait) {
+    admission_acquire(p, p->pid, -1);
+    p->admitted = true;
+  } else if(solve) {
+    p->admitted = admission_try_acquire(p, p->pid, -1);
+    if(!p->admitted) {
+      dbg("Probe child %d was not admitted.", p->pid);
+      *admitted = false;
+      close(fds[0]);
+      probe_release(p);
+      return NULL;
+    }
+  }
+
+  if(!write_probe_assumptions(p, fds[0], assumptions, size, solve)) {
+    err("Could not write assumptions to probe child %d!", p->pid);
+    probe_release(p);
+    return NULL;
+  }
+
+  if(solve && s->timeout_ns > 0)
+    p->deadline_ns = stats_now_ns() + s->timeout_ns;
+  return p;
+}
+
+quapi_probe*
+probe_fork(quapi_solver* s,
+           quapi_probe* parent,
+           const int32_t* assumptions,
+           size_t size,
+           bool solve) {
+  return fork_probe(s, parent, assumptions, size, solve, true, NULL);
+}
+
+quapi_probe*
+probe_start(quapi_solver* s,
+            const int32_t* assumptions,
+            size_t size,
+            bool wait,
+            bool* admitted) {
+  assert(wait || admitted);
+  if(admitted)
+    *admitted = true;
+  return fork_probe(s, NULL, assumptions, size, true, wait, admitted);
+}
+
+size_t
+probe_universal_assumptions(const quapi_solver* s) {
+  return s->universal_prefix_depth >= 0 ? s->universal_prefix_depth + 1 : 0;
+}
+
+bool
+probe_alive(const quapi_probe* p) {
+  if(p->exited)
+    return false;
+  if(p->pidfd == -1)
+    return kill(p->pid, 0) == 0;
+  // A pidfd becomes readable once the process exited.
+  struct pollfd pfd = { .fd = p->pidfd, .events = POLLIN, .revents = 0 };
+  return poll(&pfd, 1, 0) == 0;
+}
+
+pid_t
+probe_pid(const quapi_probe* p) {
+  return p->pid;
+}
+
+uint64_t
+probe_formula_version(const quapi_solver* s) {
+  return s->formula_version;
+}
+
+void
+probe_get_pollfds(const quapi_probe* p, struct pollfd* pfds) {
+  pfds[0] = (struct pollfd){ .fd = p->out_fd, .events = POLLIN, .revents = 0 };
+  pfds[1] =
+    (struct pollfd){ .fd = p->status_fd, .events = POLLIN, .revents = 0 };
+}
+
+static bool
+handle_probe_line(void* ctx, const char* line, size_t length) {
+#ifndef WITHOUT_PCRE2
+  quapi_probe* p = ctx;
+  if(p->s->re_SAT)
+    p->result = match_result(p->s, line, length);
+  return p->result != 0;
+#else
+  (void)ctx;
+  (void)line;
+  (void)length;
+  return false;
+#endif
+}
+
+bool
+probe_process(quapi_probe* p, const struct pollfd* pfds) {
+  if(p->done)
+    return true;
+
+  // Output is always drained, so the probe child never blocks on a full
+  // pipe. Only a SAT regex decides the result from it.
+  if(pfds[0].revents & (POLLIN | POLLHUP) &&
+     read_lines(p->out_fd, &p->out, handle_probe_line, p) != 0) {
+    p->done = true;
+    return true;
+  }
+
+  if(!(pfds[1].revents & (POLLIN | POLLHUP)))
+    return false;
+
+  // Probes have no statistics, their resource usage is skipped.
+  quapi_msg msg;
+  bool read_msg;
+  do
+    read_msg = quapi_read_msg_from_fd(p->status_fd, &msg, NULL, &read);
+  while(read_msg && (msg.msg.type == QUAPI_MSG_RUSAGE ||
+                     msg.msg.type == QUAPI_MSG_PERF));
+  if(read_msg && msg.msg.type == QUAPI_MSG_EXIT_CODE) {
+    p->exited = true;
+    // Everything the child printed is in the pipe by now.
+    if(read_lines(p->out_fd, &p->out, handle_probe_line, p) == 0 &&
+       !p->s->config.SAT_regex) {
+      int code = msg.msg.data.exit_code.exit_code;
+      p->result = code == 10 || code == 20 ? code : 0;
+    }
+  } else {
+    // The waiter is gone without a report.
+    p->exited = true;
+  }
+  p->done = true;
+  return true;
+}
+
+int
+probe_result(const quapi_probe* p) {
+  return p->result;
+}
+
+uint64_t
+probe_deadline(const quapi_probe* p) {
+  return p->deadline_ns;
+}
+
+void
+probe_release(quapi_probe* p) {
+  if(!p)
+    return;
+  if(!p->exited && p->pid > 0)
+    signal_child(p->pidfd, p->pid, SIGKILL);
+  if(p->pidfd != -1)
+    close(p->pidfd);
+  if(p->in_stream)
+    close_probe_stream(p->in_stream);
+  close(p->out_fd);
+  close(p->status_fd);
+  free(p->out.data);
+  if(p->admitted)
+    admission_release(p);
+  free(p);
+}
+
 QUAPI_EXPORT void
 quapi_set_stdout_cb(quapi_solver* s,
                     quapi_stdout_cb stdout_cb,
@@ -1069,6 +2759,8 @@ quapi_set_stdout_cb(quapi_solver* s,
   // Set the POLLIN flag, it is required now.
   struct pollfd* pfd = &s->out_pollfds[MYPOLL_SOLVERCHILD];
   pfd->events = POLLIN;
+  if(s->solverchild_probe)
+    pfd->fd = s->solverchild_probe->out_fd;
 
   s->stdout_cb = stdout_cb;
   s->stdout_cb_userdata = userdata;
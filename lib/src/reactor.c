@@ -0,0 +1,707 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(SYS_io_uring_setup)
+#include <linux/io_uring.h>
+#define HAVE_IO_URING
+#endif
+#endif
+
+#include <quapi/reactor.h>
+#include <quapi_export.h>
+
+#include "mpsc.h"
+
+#define REACTOR_MAX_READY 64
+#define REACTOR_URING_ENTRIES 256
+
+// Tags identify the fd an event belongs to. Solver fds are tagged with their
+// slot, the index of the fd in the slot and the generation of the slot, so
+// that late events of already finished solves can be told apart.
+#define TAG_WAKEUP UINT64_MAX
+#define TAG_IGNORE (UINT64_MAX - 1)
+
+typedef struct reactor_slot {
+  quapi_solver* solver;
+  void* userdata;
+  int fds[QUAPI_MAX_FDS];
+  size_t fds_size;
+  uint32_t generation;
+  bool active;
+} reactor_slot;
+
+typedef enum reactor_command_type {
+  REACTOR_COMMAND_ADD,
+  REACTOR_COMMAND_STOP
+} reactor_command_type;
+
+typedef struct reactor_command {
+  mpsc_node node;
+  reactor_command_type type;
+  quapi_solver* solver;
+  void* userdata;
+} reactor_command;
+
+typedef struct reactor_result {
+  mpsc_node node;
+  quapi_poller_event event;
+} reactor_result;
+
+typedef struct reactor_ready {
+  uint64_t tag;
+  // The poll on the fd ended and has to be armed again.
+  bool rearm;
+} reactor_ready;
+
+#ifdef HAVE_IO_URING
+typedef struct uring {
+  int fd;
+
+  void* sq_ring;
+  size_t sq_ring_size;
+  void* cq_ring;
+  size_t cq_ring_size;
+  struct io_uring_sqe* sqes;
+  size_t sqes_size;
+
+  unsigned* sq_head;
+  unsigned* sq_tail;
+  unsigned* sq_array;
+  unsigned sq_mask;
+  unsigned sq_entries;
+
+  unsigned* cq_head;
+  unsigned* cq_tail;
+  unsigned cq_mask;
+  struct io_uring_cqe* cqes;
+
+  unsigned to_submit;
+
+  // Multishot polls are not supported by the kernel, re-arm after each event.
+  bool oneshot;
+} uring;
+#endif
+
+typedef struct quapi_reactor {
+  quapi_reactor_backend backend;
+  int epfd;
+#ifdef HAVE_IO_URING
+  uring ring;
+#endif
+
+  pthread_t thread;
+  bool thread_started;
+  bool stopping;
+
+  // Signalled after pushing to commands.
+  int wakeup_fd;
+  mpsc_queue commands;
+
+  // Signalled after pushing to results.
+  int results_fd;
+  mpsc_queue results;
+
+  quapi_reactor_cb cb;
+  void* cb_userdata;
+
+  // Only accessed from the reactor thread.
+  reactor_slot* slots;
+  size_t slots_size;
+} quapi_reactor;
+
+static uint64_t
+make_tag(uint32_t generation, size_t slot, size_t fd_index) {
+  return ((uint64_t)generation << 32) | ((uint64_t)slot << 3) | fd_index;
+}
+
+static void
+signal_eventfd(int fd) {
+  uint64_t one = 1;
+  write(fd, &one, sizeof(one));
+}
+
+static void
+drain_eventfd(int fd) {
+  uint64_t val;
+  read(fd, &val, sizeof(val));
+}
+
+#ifdef HAVE_IO_URING
+static void
+uring_release(uring* u) {
+  if(u->sqes)
+    munmap(u->sqes, u->sqes_size);
+  if(u->cq_ring && u->cq_ring != u->sq_ring)
+    munmap(u->cq_ring, u->cq_ring_size);
+  if(u->sq_ring)
+    munmap(u->sq_ring, u->sq_ring_size);
+  if(u->fd != -1)
+    close(u->fd);
+  memset(u, 0, sizeof(uring));
+  u->fd = -1;
+}
+
+static void*
+uring_mmap(int fd, size_t size, off_t offset) {
+  void* p = mmap(
+    NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+  return p == MAP_FAILED ? NULL : p;
+}
+
+static bool
+uring_setup(uring* u) {
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+
+  u->fd = syscall(SYS_io_uring_setup, REACTOR_URING_ENTRIES, &p);
+  if(u->fd == -1) {
+    dbg("io_uring is not available: %s", strerror(errno));
+    return false;
+  }
+
+  u->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  u->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+  if(single_mmap) {
+    u->sq_ring_size = MAX(u->sq_ring_size, u->cq_ring_size);
+    u->cq_ring_size = u->sq_ring_size;
+  }
+
+  u->sq_ring = uring_mmap(u->fd, u->sq_ring_size, IORING_OFF_SQ_RING);
+  if(!u->sq_ring)
+    goto ERROR;
+
+  if(single_mmap)
+    u->cq_ring = u->sq_ring;
+  else
+    u->cq_ring = uring_mmap(u->fd, u->cq_ring_size, IORING_OFF_CQ_RING);
+  if(!u->cq_ring)
+    goto ERROR;
+
+  u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+  u->sqes = uring_mmap(u->fd, u->sqes_size, IORING_OFF_SQES);
+  if(!u->sqes)
+    goto ERROR;
+
+  char* sq = u->sq_ring;
+  u->sq_head = (unsigned*)(sq + p.sq_off.head);
+  u->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+  u->sq_array = (unsigned*)(sq + p.sq_off.array);
+  u->sq_mask = *(unsigned*)(sq + p.sq_off.ring_mask);
+  u->sq_entries = p.sq_entries;
+
+  char* cq = u->cq_ring;
+  u->cq_head = (unsigned*)(cq + p.cq_off.head);
+  u->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+  u->cq_mask = *(unsigned*)(cq + p.cq_off.ring_mask);
+  u->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+
+  return true;
+
+ERROR:
+  err("Could not map io_uring rings! Error: %s", strerror(errno));
+  uring_release(u);
+  return false;
+}
+
+static int
+uring_enter(uring* u, unsigned min_complete) {
+  unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+  int r = syscall(
+    SYS_io_uring_enter, u->fd, u->to_submit, min_complete, flags, NULL, 0);
+  if(r > 0)
+    u->to_submit -= r;
+  return r;
+}
+
+/* The returned entry is published right away. This is fine, as the kernel
+ * only looks at submitted entries during uring_enter, which is only called
+ * from the reactor thread. */
+static struct io_uring_sqe*
+uring_get_sqe(uring* u) {
+  unsigned tail = *u->sq_tail;
+  unsigned head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+  if(tail - head >= u->sq_entries) {
+    // Make room by submitting everything that is queued.
+    uring_enter(u, 0);
+    head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+    if(tail - head >= u->sq_entries)
+      return NULL;
+  }
+
+  unsigned index = tail & u->sq_mask;
+  struct io_uring_sqe* sqe = &u->sqes[index];
+  memset(sqe, 0, sizeof(struct io_uring_sqe));
+  u->sq_array[index] = index;
+  __atomic_store_n(u->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  ++u->to_submit;
+  return sqe;
+}
+
+static bool
+uring_poll_add(uring* u, int fd, uint64_t tag) {
+  struct io_uring_sqe* sqe = uring_get_sqe(u);
+  if(!sqe)
+    return false;
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = POLLIN;
+  sqe->len = u->oneshot ? 0 : IORING_POLL_ADD_MULTI;
+  sqe->user_data = tag;
+  return true;
+}
+
+static void
+uring_poll_remove(uring* u, uint64_t tag) {
+  struct io_uring_sqe* sqe = uring_get_sqe(u);
+  if(!sqe)
+    return;
+  sqe->opcode = IORING_OP_POLL_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = tag;
+  sqe->user_data = TAG_IGNORE;
+}
+
+static int
+uring_wait(uring* u, reactor_ready* ready, int max) {
+  int r = uring_enter(u, 1);
+  if(r == -1 && errno != EINTR)
+    return -1;
+
+  unsigned head = *u->cq_head;
+  unsigned tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+  int n = 0;
+  for(; head != tail && n < max; ++head) {
+    struct io_uring_cqe* cqe = &u->cqes[head & u->cq_mask];
+    if(cqe->user_data == TAG_IGNORE)
+      continue;
+
+    if(cqe->res == -EINVAL && !u->oneshot) {
+      dbg("Multishot polls not supported by io_uring, re-arming polls.");
+      u->oneshot = true;
+    } else if(cqe->res < 0) {
+      // Cancelled or failed poll.
+      continue;
+    }
+
+    ready[n].tag = cqe->user_data;
+    ready[n].rearm = !(cqe->flags & IORING_CQE_F_MORE);
+    ++n;
+  }
+  __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+  return n;
+}
+#endif
+
+static bool
+backend_add(quapi_reactor* r, int fd, uint64_t tag) {
+#ifdef HAVE_IO_URING
+  if(r->backend == QUAPI_REACTOR_IO_URING)
+    return uring_poll_add(&r->ring, fd, tag);
+#endif
+  struct epoll_event ev = { .events = EPOLLIN, .data.u64 = tag };
+  return epoll_ctl(r->epfd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+static void
+backend_remove(quapi_reactor* r, int fd, uint64_t tag) {
+#ifdef HAVE_IO_URING
+  if(r->backend == QUAPI_REACTOR_IO_URING) {
+    uring_poll_remove(&r->ring, tag);
+    return;
+  }
+#endif
+  (void)tag;
+  epoll_ctl(r->epfd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+static void
+backend_rearm(quapi_reactor* r, int fd, uint64_t tag) {
+#ifdef HAVE_IO_URING
+  if(r->backend == QUAPI_REACTOR_IO_URING)
+    uring_poll_add(&r->ring, fd, tag);
+#else
+  (void)r;
+  (void)fd;
+  (void)tag;
+#endif
+}
+
+static int
+backend_wait(quapi_reactor* r, reactor_ready* ready, int max) {
+#ifdef HAVE_IO_URING
+  if(r->backend == QUAPI_REACTOR_IO_URING)
+    return uring_wait(&r->ring, ready, max);
+#endif
+  struct epoll_event evs[REACTOR_MAX_READY];
+  int n = epoll_wait(r->epfd, evs, MIN(max, REACTOR_MAX_READY), -1);
+  for(int i = 0; i < n; ++i) {
+    ready[i].tag = evs[i].data.u64;
+    ready[i].rearm = false;
+  }
+  return n;
+}
+
+static void
+deliver(quapi_reactor* r, const quapi_poller_event* ev) {
+  if(r->cb) {
+    r->cb(ev, r->cb_userdata);
+    return;
+  }
+
+  reactor_result* res = malloc(sizeof(reactor_result));
+  if(!res) {
+    err("Could not allocate result of solver %p!", (void*)ev->solver);
+    return;
+  }
+  res->event = *ev;
+  mpsc_push(&r->results, &res->node);
+  signal_eventfd(r->results_fd);
+}
+
+static reactor_slot*
+get_free_slot(quapi_reactor* r, size_t* index) {
+  for(size_t i = 0; i < r->slots_size; ++i) {
+    if(!r->slots[i].active) {
+      *index = i;
+      return &r->slots[i];
+    }
+  }
+
+  size_t size = r->slots_size ? r->slots_size * 2 : 16;
+  reactor_slot* slots = realloc(r->slots, size * sizeof(reactor_slot));
+  if(!slots)
+    return NULL;
+  memset(slots + r->slots_size, 0, (size - r->slots_size) * sizeof(*slots));
+  r->slots = slots;
+  *index = r->slots_size;
+  r->slots_size = size;
+  return &r->slots[*index];
+}
+
+static void
+unregister_slot(quapi_reactor* r, reactor_slot* slot, size_t index) {
+  for(size_t i = 0; i < slot->fds_size; ++i)
+    backend_remove(r, slot->fds[i], make_tag(slot->generation, index, i));
+  slot->active = false;
+  ++slot->generation;
+}
+
+static void
+add_solver(quapi_reactor* r, quapi_solver* s, void* userdata) {
+  size_t index;
+  reactor_slot* slot = get_free_slot(r, &index);
+  if(!slot) {
+    err("Could not grow reactor slots!");
+    goto ERROR;
+  }
+
+  slot->solver = s;
+  slot->userdata = userdata;
+  slot->fds_size = quapi_get_fds(s, slot->fds, QUAPI_MAX_FDS);
+  slot->active = true;
+
+  for(size_t i = 0; i < slot->fds_size; ++i) {
+    if(!backend_add(r, slot->fds[i], make_tag(slot->generation, index, i))) {
+      err("Could not watch fd %d of solver %p!", slot->fds[i], (void*)s);
+      slot->fds_size = i;
+      unregister_slot(r, slot, index);
+      goto ERROR;
+    }
+  }
+  return;
+
+ERROR:
+  // Report the solver back, so that the application does not wait forever.
+  {
+    quapi_poller_event ev = {
+      .solver = s, .userdata = userdata, .result = 0, .terminated = false
+    };
+    deliver(r, &ev);
+  }
+}
+
+/* The pidfd of a pipelined solver child is only known once its fork report
+ * was processed, watch descriptors that were added since. */
+static void
+watch_new_fds(quapi_reactor* r, reactor_slot* slot, size_t index) {
+  int fds[QUAPI_MAX_FDS];
+  size_t fds_size = quapi_get_fds(slot->solver, fds, QUAPI_MAX_FDS);
+  for(size_t i = 0; i < fds_size && slot->fds_size < QUAPI_MAX_FDS; ++i) {
+    bool known = false;
+    for(size_t j = 0; j < slot->fds_size && !known; ++j)
+      known = slot->fds[j] == fds[i];
+    if(known)
+      continue;
+
+    if(!backend_add(
+         r, fds[i], make_tag(slot->generation, index, slot->fds_size))) {
+      err("Could not watch fd %d of solver %p!", fds[i], (void*)slot->solver);
+      continue;
+    }
+    slot->fds[slot->fds_size++] = fds[i];
+  }
+}
+
+static void
+handle_commands(quapi_reactor* r) {
+  mpsc_node* n;
+  while((n = mpsc_pop(&r->commands))) {
+    reactor_command* c = (reactor_command*)n;
+    switch(c->type) {
+      case REACTOR_COMMAND_ADD:
+        add_solver(r, c->solver, c->userdata);
+        break;
+      case REACTOR_COMMAND_STOP:
+        r->stopping = true;
+        break;
+    }
+    free(c);
+  }
+}
+
+static void
+handle_ready(quapi_reactor* r, const reactor_ready* ready) {
+  size_t index = (ready->tag & UINT32_MAX) >> 3;
+  size_t fd_index = ready->tag & 7;
+  uint32_t generation = ready->tag >> 32;
+
+  if(index >= r->slots_size)
+    return;
+  reactor_slot* slot = &r->slots[index];
+  if(!slot->active || slot->generation != generation)
+    return;
+
+  int result;
+  if(!quapi_process_events(slot->solver, &result)) {
+    if(ready->rearm)
+      backend_rearm(r, slot->fds[fd_index], ready->tag);
+    watch_new_fds(r, slot, index);
+    return;
+  }
+
+  quapi_poller_event ev = { .solver = slot->solver,
+                            .userdata = slot->userdata,
+                            .result = result,
+                            .terminated = quapi_was_terminated(slot->solver) };
+  unregister_slot(r, slot, index);
+  deliver(r, &ev);
+}
+
+static void*
+reactor_thread(void* arg) {
+  quapi_reactor* r = arg;
+  reactor_ready ready[REACTOR_MAX_READY];
+
+  while(!r->stopping) {
+    int n = backend_wait(r, ready, REACTOR_MAX_READY);
+    if(n == -1) {
+      if(errno == EINTR)
+        continue;
+      err("Reactor could not wait for events! Error: %s", strerror(errno));
+      break;
+    }
+
+    for(int i = 0; i < n; ++i) {
+      if(ready[i].tag == TAG_WAKEUP) {
+        if(ready[i].rearm)
+          backend_rearm(r, r->wakeup_fd, TAG_WAKEUP);
+        drain_eventfd(r->wakeup_fd);
+        handle_commands(r);
+      } else {
+        handle_ready(r, &ready[i]);
+      }
+    }
+  }
+
+  return NULL;
+}
+
+static void
+free_reactor(quapi_reactor* r) {
+  mpsc_node* n;
+  while((n = mpsc_pop(&r->commands)))
+    free(n);
+  while((n = mpsc_pop(&r->results)))
+    free(n);
+
+#ifdef HAVE_IO_URING
+  uring_release(&r->ring);
+#endif
+  if(r->epfd != -1)
+    close(r->epfd);
+  if(r->wakeup_fd != -1)
+    close(r->wakeup_fd);
+  if(r->results_fd != -1)
+    close(r->results_fd);
+  free(r->slots);
+  free(r);
+}
+
+QUAPI_EXPORT quapi_reactor*
+quapi_reactor_init(quapi_reactor_backend backend,
+                   quapi_reactor_cb cb,
+                   void* cb_userdata) {
+  quapi_reactor* r = calloc(1, sizeof(quapi_reactor));
+  if(!r) {
+    err("Could not allocate reactor!");
+    return NULL;
+  }
+  r->epfd = -1;
+#ifdef HAVE_IO_URING
+  r->ring.fd = -1;
+#endif
+  r->cb = cb;
+  r->cb_userdata = cb_userdata;
+  mpsc_init(&r->commands);
+  mpsc_init(&r->results);
+
+  r->wakeup_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  r->results_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if(r->wakeup_fd == -1 || r->results_fd == -1) {
+    err("Could not create eventfd! Error: %s", strerror(errno));
+    goto ERROR;
+  }
+
+  r->backend = QUAPI_REACTOR_EPOLL;
+#ifdef HAVE_IO_URING
+  if(backend == QUAPI_REACTOR_IO_URING && uring_setup(&r->ring))
+    r->backend = QUAPI_REACTOR_IO_URING;
+#else
+  (void)backend;
+#endif
+
+  if(r->backend == QUAPI_REACTOR_EPOLL) {
+    r->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if(r->epfd == -1) {
+      err("Could not create epoll instance! Error: %s", strerror(errno));
+      goto ERROR;
+    }
+  }
+
+  if(!backend_add(r, r->wakeup_fd, TAG_WAKEUP)) {
+    err("Could not watch reactor wakeup fd!");
+    goto ERROR;
+  }
+
+  int e = pthread_create(&r->thread, NULL, reactor_thread, r);
+  if(e != 0) {
+    err("Could not start reactor thread! Error: %s", strerror(e));
+    goto ERROR;
+  }
+  r->thread_started = true;
+
+  return r;
+ERROR:
+  free_reactor(r);
+  return NULL;
+}
+
+static bool
+push_command(quapi_reactor* r,
+             reactor_command_type type,
+             quapi_solver* s,
+             void* userdata) {
+  reactor_command* c = malloc(sizeof(reactor_command));
+  if(!c) {
+    err("Could not allocate reactor command!");
+    return false;
+  }
+  c->type = type;
+  c->solver = s;
+  c->userdata = userdata;
+  mpsc_push(&r->commands, &c->node);
+  signal_eventfd(r->wakeup_fd);
+  return true;
+}
+
+QUAPI_EXPORT void
+quapi_reactor_release(quapi_reactor* r) {
+  assert(r);
+  if(r->thread_started) {
+    while(!push_command(r, REACTOR_COMMAND_STOP, NULL, NULL)) {
+    }
+    pthread_join(r->thread, NULL);
+  }
+  free_reactor(r);
+}
+
+QUAPI_EXPORT quapi_reactor_backend
+quapi_reactor_get_backend(quapi_reactor* r) {
+  assert(r);
+  return r->backend;
+}
+
+QUAPI_EXPORT bool
+quapi_reactor_add(quapi_reactor* r, quapi_solver* s, void* userdata) {
+  assert(r);
+  assert(s);
+
+  if(quapi_get_state(s) != QUAPI_WORKING) {
+    err("Solver is in invalid state %s for adding it to a reactor!",
+        quapi_state_str(quapi_get_state(s)));
+    return false;
+  }
+
+  return push_command(r, REACTOR_COMMAND_ADD, s, userdata);
+}
+
+static int
+pop_results(quapi_reactor* r, quapi_poller_event* events, int max_events) {
+  int n = 0;
+  mpsc_node* node;
+  while(n < max_events && (node = mpsc_pop(&r->results))) {
+    reactor_result* res = (reactor_result*)node;
+    events[n++] = res->event;
+    free(res);
+  }
+  return n;
+}
+
+QUAPI_EXPORT int
+quapi_reactor_wait(quapi_reactor* r,
+                   quapi_poller_event* events,
+                   int max_events,
+                   int timeout_ms) {
+  assert(r);
+  assert(events);
+
+  for(;;) {
+    drain_eventfd(r->results_fd);
+
+    int n = pop_results(r, events, max_events);
+    if(n == max_events) {
+      // There may be more results, keep the fd readable.
+      signal_eventfd(r->results_fd);
+    }
+    if(n > 0 || timeout_ms == 0)
+      return n;
+
+    struct pollfd pfd = { .fd = r->results_fd, .events = POLLIN };
+    int p = poll(&pfd, 1, timeout_ms);
+    if(p == -1)
+      return errno == EINTR ? 0 : -1;
+    if(p == 0)
+      return 0;
+    timeout_ms = 0;
+  }
+}
+
+QUAPI_EXPORT int
+quapi_reactor_get_fd(quapi_reactor* r) {
+  assert(r);
+  return r->results_fd;
+}
@@ -0,0 +1,227 @@
+#include <quapi_export.h>
+
+#include "stats.h"
+
+// Linear sub-buckets per power of two.
+#define SUB_BUCKET_BITS 3
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+
+uint64_t
+stats_now_ns() {
+  return quapi_now_ns();
+}
+
+static size_t
+bucket_of(uint64_t v) {
+  if(v < SUB_BUCKETS)
+    return v;
+  unsigned e = 63 - __builtin_clzll(v);
+  return (size_t)(e - SUB_BUCKET_BITS + 1) * SUB_BUCKETS +
+         ((v >> (e - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+}
+
+/* Largest value that falls into the bucket. */
+static uint64_t
+bucket_max(size_t bucket) {
+  if(bucket < SUB_BUCKETS)
+    return bucket;
+  unsigned e = bucket / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+  uint64_t sub = bucket % SUB_BUCKETS;
+  uint64_t width = 1ULL << (e - SUB_BUCKET_BITS);
+  return ((SUB_BUCKETS + sub) << (e - SUB_BUCKET_BITS)) + width - 1;
+}
+
+QUAPI_EXPORT void
+quapi_histogram_record(quapi_histogram* h, uint64_t ns) {
+  if(h->count == 0 || ns < h->min_ns)
+    h->min_ns = ns;
+  if(ns > h->max_ns)
+    h->max_ns = ns;
+  ++h->count;
+  h->sum_ns += ns;
+  ++h->buckets[bucket_of(ns)];
+}
+
+QUAPI_EXPORT uint64_t
+quapi_histogram_percentile(const quapi_histogram* h, double percentile) {
+  if(h->count == 0)
+    return 0;
+  if(percentile < 0)
+    percentile = 0;
+  if(percentile > 100)
+    percentile = 100;
+
+  // Nearest rank, rounded up, so the median of 3 values is the second one.
+  double exact_rank = percentile / 100 * h->count;
+  uint64_t rank = exact_rank;
+  if(rank < exact_rank)
+    ++rank;
+  if(rank == 0)
+    rank = 1;
+  if(rank > h->count)
+    rank = h->count;
+  uint64_t seen = 0;
+  for(size_t i = 0; i < QUAPI_HISTOGRAM_BUCKETS; ++i) {
+    seen += h->buckets[i];
+    if(seen >= rank) {
+      uint64_t v = bucket_max(i);
+      return v < h->max_ns ? v : h->max_ns;
+    }
+  }
+  return h->max_ns;
+}
+
+void
+stats_record_timestamp(solve_times* t,
+                       quapi_msg_timestamp stamp,
+                       uint64_t now_ns) {
+  // The event happened shortly before the message was received.
+  uint64_t now_us = now_ns / 1000;
+  uint64_t age_us =
+    (now_us - stamp.time_us) & ((1ULL << QUAPI_TIMESTAMP_BITS) - 1);
+  uint64_t ns = (now_us - age_us) * 1000;
+
+  // Stamps of aborted solver children arrive late, drop everything from
+  // before the solve started. The stamp is truncated to microseconds.
+  if(t->start == 0 || ns + 1000 <= t->start)
+    return;
+
+  switch((quapi_timestamp_event)stamp.event) {
+    case QUAPI_TIMESTAMP_FORK_READ:
+      t->fork_read = ns;
+      break;
+    case QUAPI_TIMESTAMP_FORKED:
+      t->forked = ns;
+      break;
+    case QUAPI_TIMESTAMP_SOLVE_READ:
+      t->solve_read = ns;
+      break;
+    case QUAPI_TIMESTAMP_CHILD_EXITED:
+      t->child_exited = ns;
+      break;
+  }
+}
+
+void
+stats_record_rusage(quapi_rusage* r, quapi_msg_rusage msg) {
+  const uint64_t low = (1ULL << QUAPI_RUSAGE_BITS) - 1;
+  uint64_t v = msg.value;
+  switch((quapi_rusage_field)msg.field) {
+    case QUAPI_RUSAGE_USER_LOW:
+      r->user_us = (r->user_us & ~low) | v;
+      break;
+    case QUAPI_RUSAGE_USER_HIGH:
+      r->user_us = (r->user_us & low) | v << QUAPI_RUSAGE_BITS;
+      break;
+    case QUAPI_RUSAGE_SYSTEM_LOW:
+      r->system_us = (r->system_us & ~low) | v;
+      break;
+    case QUAPI_RUSAGE_SYSTEM_HIGH:
+      r->system_us = (r->system_us & low) | v << QUAPI_RUSAGE_BITS;
+      break;
+    case QUAPI_RUSAGE_MAX_RSS:
+      r->max_rss_kib = v;
+      break;
+    case QUAPI_RUSAGE_MINOR_FAULTS:
+      r->minor_faults = v;
+      break;
+    case QUAPI_RUSAGE_MAJOR_FAULTS:
+      r->major_faults = v;
+      break;
+    case QUAPI_RUSAGE_VOLUNTARY_SWITCHES:
+      r->voluntary_switches = v;
+      break;
+    case QUAPI_RUSAGE_INVOLUNTARY_SWITCHES:
+      r->involuntary_switches = v;
+      break;
+    case QUAPI_RUSAGE_FIELD_COUNT:
+      break;
+  }
+}
+
+void
+stats_record_perf(quapi_perf_counters* p, quapi_msg_perf msg) {
+  uint64_t* counter;
+  switch((quapi_perf_counter)msg.counter) {
+    case QUAPI_PERF_CYCLES:
+      counter = &p->cycles;
+      break;
+    case QUAPI_PERF_INSTRUCTIONS:
+      counter = &p->instructions;
+      break;
+    case QUAPI_PERF_CACHE_MISSES:
+      counter = &p->cache_misses;
+      break;
+    case QUAPI_PERF_PAGE_FAULTS:
+      counter = &p->page_faults;
+      break;
+    default:
+      return;
+  }
+  const uint64_t low = (1ULL << QUAPI_PERF_BITS) - 1;
+  uint64_t v = msg.value;
+  if(msg.high)
+    *counter = (*counter & low) | v << QUAPI_PERF_BITS;
+  else
+    *counter = (*counter & ~low) | v;
+}
+
+static uint64_t
+span(uint64_t from, uint64_t to) {
+  return from && to > from ? to - from : 0;
+}
+
+void
+stats_finish_solve(quapi_stats* stats,
+                   quapi_solve_stats* current,
+                   const solve_times* t,
+                   uint64_t result_ns) {
+  uint64_t assumptions_begin = t->forked ? t->forked : t->start;
+  uint64_t solver_begin = t->solve_read ? t->solve_read : t->solve_sent;
+  uint64_t solver_end = t->child_exited   ? t->child_exited
+                        : t->output_read ? t->output_read
+                                         : result_ns;
+
+  uint64_t* phase = current->phase_ns;
+  phase[QUAPI_PHASE_FORMULA] = span(t->fork_sent, t->fork_read);
+  phase[QUAPI_PHASE_FORK] = span(t->fork_read, t->forked);
+  phase[QUAPI_PHASE_ASSUMPTIONS] = span(assumptions_begin, solver_begin);
+  phase[QUAPI_PHASE_SOLVER] = span(solver_begin, solver_end);
+  phase[QUAPI_PHASE_RESULT] = span(solver_end, result_ns);
+  current->latency_ns = span(t->start, result_ns);
+
+  quapi_solve_stats* total = &stats->total;
+  for(size_t i = 0; i < QUAPI_PHASE_COUNT; ++i) {
+    total->phase_ns[i] += phase[i];
+    // Unmeasured phases would distort the distribution.
+    if(phase[i] > 0)
+      quapi_histogram_record(&stats->phases[i], phase[i]);
+  }
+  total->latency_ns += current->latency_ns;
+  total->messages_sent += current->messages_sent;
+  total->bytes_sent += current->bytes_sent;
+  total->stdout_bytes += current->stdout_bytes;
+
+  const quapi_rusage* ru = &current->rusage;
+  quapi_rusage* total_ru = &total->rusage;
+  total_ru->user_us += ru->user_us;
+  total_ru->system_us += ru->system_us;
+  if(ru->max_rss_kib > total_ru->max_rss_kib)
+    total_ru->max_rss_kib = ru->max_rss_kib;
+  total_ru->minor_faults += ru->minor_faults;
+  total_ru->major_faults += ru->major_faults;
+  total_ru->voluntary_switches += ru->voluntary_switches;
+  total_ru->involuntary_switches += ru->involuntary_switches;
+
+  total->perf.cycles += current->perf.cycles;
+  total->perf.instructions += current->perf.instructions;
+  total->perf.cache_misses += current->perf.cache_misses;
+  total->perf.page_faults += current->perf.page_faults;
+  total->numa_node = current->numa_node;
+  total->solverchild_cpu = current->solverchild_cpu;
+  quapi_histogram_record(&stats->latency, current->latency_ns);
+
+  ++stats->solves;
+  stats->last = *current;
+  *current = (quapi_solve_stats){ 0 };
+}
@@ -0,0 +1,50 @@
+#ifndef QUAPI_STATS_H
+#define QUAPI_STATS_H
+
+#include <stdint.h>
+
+#include <quapi/message.h>
+#include <quapi/quapi.h>
+
+/* CLOCK_MONOTONIC timestamps of a solve in ns, 0 for events that did not
+ * happen (yet). Events of the preloaded runtime are reported through
+ * TIMESTAMP messages. */
+typedef struct solve_times {
+  // First assumption or solve call.
+  uint64_t start;
+  uint64_t fork_sent;
+  uint64_t fork_read;
+  uint64_t forked;
+  uint64_t solve_read;
+  uint64_t solve_sent;
+  uint64_t child_exited;
+  // Last read of solver child output.
+  uint64_t output_read;
+} solve_times;
+
+uint64_t
+stats_now_ns();
+
+/* Record the event of a TIMESTAMP message received at now_ns. */
+void
+stats_record_timestamp(solve_times* t,
+                       quapi_msg_timestamp stamp,
+                       uint64_t now_ns);
+
+/* Record a field of a RUSAGE message. */
+void
+stats_record_rusage(quapi_rusage* r, quapi_msg_rusage msg);
+
+/* Record a part of a PERF message. */
+void
+stats_record_perf(quapi_perf_counters* p, quapi_msg_perf msg);
+
+/* Derive the phases of a solve that ended at result_ns into current and add
+ * them to stats, which then holds current as last solve. */
+void
+stats_finish_solve(quapi_stats* stats,
+                   quapi_solve_stats* current,
+                   const solve_times* t,
+                   uint64_t result_ns);
+
+#endif
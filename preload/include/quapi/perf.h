@@ -0,0 +1,39 @@
+#ifndef QUAPI_PERF_H_
+#define QUAPI_PERF_H_
+
+#include <quapi/message.h>
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/** @file
+ *
+ * Performance counters of solver children. If the QUAPI_PERF_COUNTERS
+ * environment variable is set, the seeding process attaches counters to every
+ * solver child it waits for, using perf_event_open() with inherit, so threads
+ * and processes of the solver are counted too. Only user space is counted,
+ * which perf_event_paranoid up to 2 allows for own processes. Counters the
+ * kernel does not permit or support are left out.
+ */
+
+typedef struct quapi_perf_child {
+  int fds[QUAPI_PERF_COUNTER_COUNT];
+} quapi_perf_child;
+
+/** Check which counters are permitted and supported, once in the seeding
+ * process. */
+void
+quapi_perf_init();
+
+/** Attach the counters to a freshly forked child. The first instructions of
+ * the child may run before the counters are attached. */
+void
+quapi_perf_attach(quapi_perf_child* p, pid_t child);
+
+/** Read the counters of the reaped child into msgs, which has room for
+ * 2 * QUAPI_PERF_COUNTER_COUNT messages, and close them. Returns the number
+ * of PERF messages, 0 if no counter was attached. */
+size_t
+quapi_perf_read(quapi_perf_child* p, quapi_msg* msgs);
+
+#endif
@@ -65,6 +65,10 @@ typedef struct quapi_runtime {
   char outbuf_stack[64];
   char filler_clause[64];
   size_t filler_clause_len;
+  // Copies of the filler clause, so that a large unused clause budget is
+  // padded in few reads. Built on the first solve.
+  char filler_block[4096];
+  size_t filler_block_clauses;
   ssize_t outbuf_len;
   ssize_t outbuf_written;
   pid_t solver_child_pid;
@@ -72,6 +76,20 @@ typedef struct quapi_runtime {
   bool repeat_state;
   size_t quantifier_count;
 
+  // Write ends of the pipes the snapshots of all checkpoints wait on, oldest
+  // first.
+  int checkpoint_wake[QUAPI_MAX_CHECKPOINTS];
+  size_t checkpoints;
+
+  // Regular solver children report when they read SOLVE, probes do not.
+  bool send_solve_timestamp;
+
+  // Timeline spans: whether this is the seeding process and currently reads
+  // the formula, and the fork id of a regular solver child (-1 otherwise).
+  bool seeding;
+  bool feeding;
+  int64_t solve_id;
+
   // Old stdout before fork or STDOUT in parent process. Always available for
   // writing messages.
   int old_stdout;
@@ -1,6 +1,10 @@
 #ifndef QUAPI_TIMING_H_
 #define QUAPI_TIMING_H_
 
+#include <quapi/message.h>
+
+#include <sys/resource.h>
+
 /** @file
  *
  * Provide some time-tracking utilities for analyzing the overhead of solver
@@ -19,4 +23,13 @@ quapi_timing_header();
 void
 quapi_timing_msg_after_header();
 
+/** Fill msg with a TIMESTAMP message of the current time for the library.
+ * Independent of QUAPI_TIMING. */
+void
+quapi_timing_stamp(quapi_msg* msg, quapi_timestamp_event event);
+
+/** Fill msgs with the QUAPI_RUSAGE_FIELD_COUNT RUSAGE messages of ru. */
+void
+quapi_timing_rusage(quapi_msg* msgs, const struct rusage* ru);
+
 #endif
@@ -6,6 +6,7 @@
 #include "quapi/definitions.h"
 #include <quapi/message.h>
 #include <quapi/runtime.h>
+#include <quapi/timeline.h>
 
 #include <quapi_preload_export.h>
 
@@ -55,6 +56,9 @@ on_destructed(void) {
   }
 #endif
 
+  if(global_runtime.solve_id >= 0)
+    quapi_timeline_end("solve", global_runtime.solve_id);
+
   // This message can be turned off when there is no REGEX to match against. In
   // that case, the PID is waited on using waitpid() and an
   // QUAPI_MSG_EXIT_CODE message is sent to the grandparent of this process
@@ -0,0 +1,126 @@
+#include <quapi/definitions.h>
+#include <quapi/perf.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+
+static const struct {
+  uint32_t type;
+  uint64_t config;
+} counters[QUAPI_PERF_COUNTER_COUNT] = {
+  [QUAPI_PERF_CYCLES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+  [QUAPI_PERF_INSTRUCTIONS] = { PERF_TYPE_HARDWARE,
+                                PERF_COUNT_HW_INSTRUCTIONS },
+  [QUAPI_PERF_CACHE_MISSES] = { PERF_TYPE_HARDWARE,
+                                PERF_COUNT_HW_CACHE_MISSES },
+  [QUAPI_PERF_PAGE_FAULTS] = { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+};
+
+static bool enabled = false;
+// Counters the kernel does not permit or support are not tried again.
+static bool unavailable[QUAPI_PERF_COUNTER_COUNT];
+
+static int
+open_counter(quapi_perf_counter c, pid_t pid) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = counters[c].type;
+  attr.config = counters[c].config;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  // Counters are multiplexed if there are not enough of them.
+  attr.read_format =
+    PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+void
+quapi_perf_init() {
+  if(!getenv("QUAPI_PERF_COUNTERS"))
+    return;
+
+  bool not_permitted = false;
+  for(int i = 0; i < QUAPI_PERF_COUNTER_COUNT; ++i) {
+    int fd = open_counter(i, 0);
+    if(fd != -1) {
+      close(fd);
+      enabled = true;
+      continue;
+    }
+    unavailable[i] = true;
+    if(errno == EACCES || errno == EPERM)
+      not_permitted = true;
+    else
+      dbg("Performance counter %d is not supported. Error: %s",
+          i,
+          strerror(errno));
+  }
+
+  if(not_permitted)
+    err("Not permitted to open %s performance counters! Check "
+        "/proc/sys/kernel/perf_event_paranoid.",
+        enabled ? "some" : "any");
+}
+
+void
+quapi_perf_attach(quapi_perf_child* p, pid_t child) {
+  for(int i = 0; i < QUAPI_PERF_COUNTER_COUNT; ++i)
+    p->fds[i] = -1;
+  if(!enabled || child <= 0)
+    return;
+
+  for(int i = 0; i < QUAPI_PERF_COUNTER_COUNT; ++i) {
+    if(unavailable[i])
+      continue;
+    p->fds[i] = open_counter(i, child);
+    // E.g. if the child is already gone.
+    if(p->fds[i] == -1)
+      dbg("Could not attach performance counter %d to %d. Error: %s",
+          i,
+          child,
+          strerror(errno));
+  }
+}
+
+size_t
+quapi_perf_read(quapi_perf_child* p, quapi_msg* msgs) {
+  const uint64_t low = (1u << QUAPI_PERF_BITS) - 1;
+  size_t n = 0;
+  for(int i = 0; i < QUAPI_PERF_COUNTER_COUNT; ++i) {
+    if(p->fds[i] == -1)
+      continue;
+
+    // Value, time enabled and time running.
+    uint64_t values[3];
+    uint64_t v = 0;
+    if(read(p->fds[i], values, sizeof(values)) == sizeof(values) &&
+       values[2] > 0) {
+      v = values[0];
+      if(values[2] < values[1])
+        v = (double)v * values[1] / values[2];
+    }
+    close(p->fds[i]);
+    p->fds[i] = -1;
+
+    uint64_t high = v >> QUAPI_PERF_BITS;
+    msgs[n++] = (quapi_msg){ .msg.type = QUAPI_MSG_PERF,
+                             .msg.data.perf = { .counter = i,
+                                                .high = 0,
+                                                .value = v & low } };
+    msgs[n++] = (quapi_msg){ .msg.type = QUAPI_MSG_PERF,
+                             .msg.data.perf = { .counter = i,
+                                                .high = 1,
+                                                .value = high < low ? high
+                                                                    : low } };
+  }
+  return n;
+}
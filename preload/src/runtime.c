@@ -2,20 +2,27 @@
 
 #include <quapi/definitions.h>
 #include <quapi/message.h>
+#include <quapi/perf.h>
 #include <quapi/runtime.h>
+#include <quapi/timeline.h>
 #include <quapi/timing.h>
+#include <quapi/trace.h>
 
 #include <assert.h>
 #include <dlfcn.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <poll.h>
 #include <string.h>
 #include <unistd.h>
 
+#include <sys/resource.h>
+#include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
@@ -34,11 +41,19 @@ QUAPI_PRELOAD_NO_EXPORT quapi_runtime global_runtime = { .fopen = NULL,
                                                            &WAITING_FOR_HEADER,
 
                                                          .filler_clause_len = 0,
+                                                         .filler_block_clauses =
+                                                           0,
                                                          .outbuf_len = 0,
                                                          .outbuf_written = 0,
                                                          .written_clauses = 0,
                                                          .repeat_state = false,
                                                          .quantifier_count = 0,
+                                                         .checkpoints = 0,
+                                                         .send_solve_timestamp =
+                                                           false,
+                                                         .seeding = false,
+                                                         .feeding = false,
+                                                         .solve_id = -1,
 
                                                          .old_stdout = 0,
                                                          .initiated = false };
@@ -249,8 +264,10 @@ update_buf(quapi_runtime* r, char* buf, size_t buflen) {
     memcpy(buf, r->outbuf + r->outbuf_written, len);
     r->outbuf_written += len;
 
+    quapi_trace(QUAPI_TRACE_SOLVER_READ, len, buflen);
+
     // Nice trace messages.
-    if(quapi_check_trace()) {
+    if(QUAPI_TRACE_LEVEL >= 2 && quapi_check_trace()) {
       if(len + 1 < buflen) {
         int str_trace = process_buf_for_dbg_print(buf, len, buflen);
         if(str_trace > 0) {
@@ -299,6 +316,13 @@ advance_state(quapi_runtime* r) {
       exit(EXIT_SUCCESS);
     }
 
+    // Feeding resumes with the first clause after a fork.
+    if(r->seeding && !r->feeding && (msg->msg.type == QUAPI_MSG_LITERAL ||
+                                     msg->msg.type == QUAPI_MSG_QUANTIFIER)) {
+      quapi_timeline_begin("feed", -1);
+      r->feeding = true;
+    }
+
     r->outbuf_len = 0;
     while(r->outbuf_len == 0) {
       quapi_preload_state before = quapi_preload_state_func_to_state(r->state);
@@ -307,12 +331,7 @@ advance_state(quapi_runtime* r) {
 
       quapi_preload_state after = quapi_preload_state_func_to_state(r->state);
 
-      if(before != after)
-        trc("State transition from %s to %s",
-            quapi_preload_state_str(before),
-            quapi_preload_state_str(after));
-      else
-        trc("State stayed in %s", quapi_preload_state_str(before));
+      quapi_trace(QUAPI_TRACE_STATE, before, after);
     }
   }
 }
@@ -345,8 +364,246 @@ static bool sighandler_sigchld_initialized = false;
 static void
 sighandler_sigchld(int sig) {}
 
+static void
+drain_solver_child_input(quapi_runtime* r) {
+  struct pollfd pfd = { .fd = r->header_data.forked_child_read_pipe[0],
+                        .events = POLLIN };
+  char buf[4096];
+  while(poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN)) {
+    if(r->read(pfd.fd, buf, sizeof(buf)) <= 0)
+      break;
+  }
+}
+
+/** Drop input of earlier solver children until the BEGIN message of this
+ * child. */
+static void
+skip_to_begin(quapi_runtime* r, uint32_t fork_id) {
+  for(;;) {
+    quapi_msg* msg = read_msg(r);
+    if(!msg) {
+      dbg("Exit because the assumptions of the child never arrived.");
+      exit(EXIT_SUCCESS);
+    }
+    if(msg->msg.type == QUAPI_MSG_BEGIN &&
+       msg->msg.data.begin.fork_id == fork_id)
+      return;
+    dbg("Skipping message of type %s meant for an earlier solver child.",
+        quapi_msg_type_str(msg->msg.type));
+  }
+}
+
+/** Wait for a child, fill ru with the resources it used and return its exit
+ * code. Children killed by the library report 0. */
+static int
+wait_for_exit_status(pid_t pid, struct rusage* ru) {
+  int status = 0;
+  memset(ru, 0, sizeof(*ru));
+  int waitpid_return = wait4(pid, &status, 0, ru);
+  if(waitpid_return == -1) {
+    err("wait4(%d) for solver child failed with error %s",
+        pid,
+        strerror(errno));
+  }
+  int exit_status = 0;
+  // SIGKILL and SIGTERM are sent by the library on aborts and timeouts,
+  // they are no errors.
+  if(WIFEXITED(status)) {
+    dbg("Child terminated normally.");
+    exit_status = WEXITSTATUS(status);
+  } else if(WIFSIGNALED(status) && WTERMSIG(status) != SIGKILL &&
+            WTERMSIG(status) != SIGTERM) {
+    err("Child NOT terminated normally!");
+    if(WIFSIGNALED(status)) {
+      int signal = WTERMSIG(status);
+      err("Child was signaled! Signal: %d (%s)", signal, strsignal(signal));
+    }
+  }
+  dbg("Waited for child to exit and got exit code %d", exit_status);
+  return exit_status;
+}
+
+/** Continue as solver child, reading assumptions from in_fd and writing the
+ * output of the solver to out_fd. */
+static void
+become_solver_child(quapi_runtime* r, int in_fd, int out_fd) {
+  close(STDIN_FILENO);
+  close(STDOUT_FILENO);
+
+  dup2(in_fd, STDIN_FILENO);
+  close(in_fd);
+
+  dup2(out_fd, STDOUT_FILENO);
+  close(out_fd);
+
+#ifdef USING_ZEROCOPY
+  if(r->in_stream)
+    quapi_zerocopy_pipe_close(r->in_stream);
+  r->in_stream = quapi_zerocopy_pipe_fdopen(STDIN_FILENO, "rb");
+#else
+  r->in_stream = fdopen(STDIN_FILENO, "rb");
+#endif
+
+  dbg("Forked into solver child and logging this message from there.");
+}
+
+/** Pass fds to the library over the probe socket. Sending no fds tells the
+ * library that the probe could not be started. */
+static void
+send_probe_fds(quapi_runtime* r, const int* fds, size_t count) {
+  char byte = 0;
+  struct iovec iov = { .iov_base = &byte, .iov_len = 1 };
+  union {
+    char buf[CMSG_SPACE(sizeof(int) * 3)];
+    struct cmsghdr align;
+  } control;
+  struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+
+  if(count > 0) {
+    assert(count <= 3);
+    msg.msg_control = control.buf;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * count);
+  }
+
+  if(sendmsg(r->header_data.probe_socket[1], &msg, 0) == -1)
+    err("Could not send probe fds! Error: %s", strerror(errno));
+}
+
+/** Fork a probe child. Unlike regular solver children, probes have their own
+ * input, output and status pipes, so several of them can run at once. A
+ * waiter process forks the probe, reports its PID and exit code through the
+ * status pipe and exits, so the seeding process never blocks. */
+static void
+fork_probe_child(quapi_runtime* r) {
+  while(waitpid(-1, NULL, WNOHANG) > 0) {
+  }
+
+  int in[2], out[2], status[2];
+  if(pipe2(in, O_CLOEXEC) == -1) {
+    err("Could not create probe pipes! Error: %s", strerror(errno));
+    send_probe_fds(r, NULL, 0);
+    return;
+  }
+  if(pipe2(out, O_CLOEXEC) == -1) {
+    err("Could not create probe pipes! Error: %s", strerror(errno));
+    close(in[0]);
+    close(in[1]);
+    send_probe_fds(r, NULL, 0);
+    return;
+  }
+  if(pipe2(status, O_CLOEXEC) == -1) {
+    err("Could not create probe pipes! Error: %s", strerror(errno));
+    close(in[0]);
+    close(in[1]);
+    close(out[0]);
+    close(out[1]);
+    send_probe_fds(r, NULL, 0);
+    return;
+  }
+
+  pid_t waiter = fork();
+  if(waiter == 0) {
+    r->seeding = false;
+    r->feeding = false;
+    close(in[1]);
+    close(out[0]);
+    close(status[0]);
+
+    // Solvers like bash reap children in their SIGCHLD handler, which would
+    // steal the exit code from the waiter. Keep SIGCHLD blocked until the
+    // waiter dropped that handler.
+    sigset_t sigchld, old_mask;
+    sigemptyset(&sigchld);
+    sigaddset(&sigchld, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &sigchld, &old_mask);
+
+    pid_t child = fork();
+    if(child == 0) {
+      sigprocmask(SIG_SETMASK, &old_mask, NULL);
+      close(status[1]);
+      quapi_timeline_process_name("probe child");
+      // The waiter reports the exit code instead.
+      quapi_runtime_send_destructed_msg = false;
+      become_solver_child(r, in[0], out[1]);
+      return;
+    }
+
+    quapi_perf_child perf;
+    quapi_perf_attach(&perf, child);
+
+    close(in[0]);
+    close(out[1]);
+
+    signal(SIGCHLD, SIG_DFL);
+    signal(SIGPIPE, SIG_IGN);
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+
+    quapi_msg fork_report_msg = { .msg.type = QUAPI_MSG_FORK_REPORT,
+                                  .msg.data.fork_report.solver_child_pid =
+                                    child };
+    quapi_write_msg_to_fd(status[1], &fork_report_msg, NULL);
+
+    struct rusage ru = { 0 };
+    int exit_status = child > 0 ? wait_for_exit_status(child, &ru) : 0;
+    if(child == -1)
+      err("Fork of probe child failed!");
+
+    // The library closes the status pipe of probes it is no longer
+    // interested in.
+    struct pollfd pfd = { .fd = status[1], .events = 0 };
+    if(poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLERR))
+      _exit(0);
+
+    quapi_msg exit_msgs[QUAPI_RUSAGE_FIELD_COUNT +
+                        2 * QUAPI_PERF_COUNTER_COUNT + 1];
+    quapi_timing_rusage(exit_msgs, &ru);
+    size_t n = QUAPI_RUSAGE_FIELD_COUNT;
+    n += quapi_perf_read(&perf, &exit_msgs[n]);
+    exit_msgs[n++] =
+      (quapi_msg){ .msg.type = QUAPI_MSG_EXIT_CODE,
+                   .msg.data.exit_code.exit_code = exit_status };
+    quapi_write_msgs_to_fd(status[1], exit_msgs, n);
+    _exit(0);
+  }
+
+  if(waiter > 0) {
+    const int fds[] = { in[1], out[0], status[0] };
+    send_probe_fds(r, fds, 3);
+    dbg("Forked probe waiter %d.", waiter);
+  } else {
+    err("Fork of probe waiter failed!");
+    send_probe_fds(r, NULL, 0);
+  }
+
+  close(in[0]);
+  close(in[1]);
+  close(out[0]);
+  close(out[1]);
+  close(status[0]);
+  close(status[1]);
+}
+
 static void
 fork_solving_child(quapi_runtime* r, quapi_msg_fork fork_msg) {
+  if(r->feeding) {
+    quapi_timeline_end("feed", -1);
+    r->feeding = false;
+  }
+
+  if(fork_msg.probe) {
+    fork_probe_child(r);
+    return;
+  }
+
+  // Timestamps are sent together with the report.
+  quapi_msg report_msgs[3];
+  quapi_timing_stamp(&report_msgs[0], QUAPI_TIMESTAMP_FORK_READ);
+
   if(fork_msg.wait_for_exit_code_and_report) {
     if(!sighandler_sigchld_initialized) {
       signal(SIGCHLD, &sighandler_sigchld);
@@ -355,14 +612,34 @@ fork_solving_child(quapi_runtime* r, quapi_msg_fork fork_msg) {
 
     quapi_runtime_send_destructed_msg = false;
   }
+
+  // Children that report through their output are not waited for. Reap the
+  // ones that exited since the last fork, so they do not stay zombies.
+  while(waitpid(-1, NULL, WNOHANG) > 0) {
+  }
+
+  // Assumptions of a child that was killed before reading them must not reach
+  // the next child. Pipelined children skip them on their own.
+  if(!fork_msg.pipelined)
+    drain_solver_child_input(r);
+
+  quapi_timeline_begin("fork", fork_msg.fork_id);
   r->solver_child_pid = fork();
   if(r->solver_child_pid > 0) {// Parent (seeding process that spawns new
                                // childs. Remains in full contact with parent)
-    quapi_msg fork_report_msg = { .msg.type = QUAPI_MSG_FORK_REPORT,
+    quapi_timeline_end("fork", fork_msg.fork_id);
+    quapi_timing_stamp(&report_msgs[1], QUAPI_TIMESTAMP_FORKED);
+
+    // Only children that are waited for report their counters.
+    quapi_perf_child perf;
+    if(fork_msg.wait_for_exit_code_and_report)
+      quapi_perf_attach(&perf, r->solver_child_pid);
+
+    report_msgs[2] = (quapi_msg){ .msg.type = QUAPI_MSG_FORK_REPORT,
                                   .msg.data.fork_report.solver_child_pid =
                                     r->solver_child_pid };
-    quapi_write_msg_to_fd(
-      r->header_data.message_to_parent_pipe[1], &fork_report_msg, NULL);
+    quapi_write_msgs_to_fd(
+      r->header_data.message_to_parent_pipe[1], report_msgs, 3);
 
     dbg("Fork successful, new pid of forked solver child: %d",
         r->solver_child_pid);
@@ -371,52 +648,158 @@ fork_solving_child(quapi_runtime* r, quapi_msg_fork fork_msg) {
       signal(SIGCHLD, &sighandler_sigchld);
 
       dbg("Waiting for exit of child to collect exit code.");
-      int status = 0;
-      int waitpid_return = waitpid(r->solver_child_pid, &status, 0);
-      if(waitpid_return == -1) {
-        err("waitpid(%d) for solver child failed with error %s",
-            r->solver_child_pid,
-            strerror(errno));
-      }
-      int exit_status = 0;
-      if(WIFEXITED(status)) {
-        dbg("Child terminated normally.");
-        exit_status = WEXITSTATUS(status);
-      } else if(WIFSIGNALED(status) && WTERMSIG(status) != SIGKILL) {
-        err("Child NOT terminated normally!");
-        if(WIFSIGNALED(status)) {
-          int signal = WTERMSIG(status);
-          err("Child was signaled! Signal: %d (%s)", signal, strsignal(signal));
-        }
-      }
-      dbg("Waited for child to exit and got exit code %d", exit_status);
-      quapi_msg exit_code_msg = { .msg.type = QUAPI_MSG_EXIT_CODE,
-                                  .msg.data.exit_code.exit_code = exit_status };
-      quapi_write_msg_to_fd(
-        r->header_data.message_to_parent_pipe[1], &exit_code_msg, NULL);
+      quapi_timeline_begin("wait", fork_msg.fork_id);
+      struct rusage ru;
+      int exit_status = wait_for_exit_status(r->solver_child_pid, &ru);
+      quapi_timeline_end("wait", fork_msg.fork_id);
+      // The resource usage directly precedes the exit code it belongs to.
+      quapi_msg exit_msgs[QUAPI_RUSAGE_FIELD_COUNT +
+                          2 * QUAPI_PERF_COUNTER_COUNT + 2];
+      quapi_timing_stamp(&exit_msgs[0], QUAPI_TIMESTAMP_CHILD_EXITED);
+      quapi_timing_rusage(&exit_msgs[1], &ru);
+      size_t n = QUAPI_RUSAGE_FIELD_COUNT + 1;
+      n += quapi_perf_read(&perf, &exit_msgs[n]);
+      exit_msgs[n++] =
+        (quapi_msg){ .msg.type = QUAPI_MSG_EXIT_CODE,
+                     .msg.data.exit_code.exit_code = exit_status };
+      quapi_write_msgs_to_fd(
+        r->header_data.message_to_parent_pipe[1], exit_msgs, n);
     }
   } else if(r->solver_child_pid == 0) {// Solving child. Reads more literals.
-    close(STDIN_FILENO);
-    close(STDOUT_FILENO);
+    r->send_solve_timestamp = true;
+    r->seeding = false;
+    r->solve_id = fork_msg.fork_id;
+    quapi_timeline_process_name("solver child");
+    quapi_timeline_begin("assumptions", r->solve_id);
+    become_solver_child(r,
+                        r->header_data.forked_child_read_pipe[0],
+                        r->header_data.forked_child_write_pipe[1]);
+    if(fork_msg.pipelined)
+      skip_to_begin(r, fork_msg.fork_id);
+  } else {
+    err("Fork failed!");
+  }
+}
 
-    dup2(r->header_data.forked_child_read_pipe[0], STDIN_FILENO);
-    close(r->header_data.forked_child_read_pipe[0]);
+static void
+send_checkpoint_report(quapi_runtime* r, pid_t seeding_pid) {
+  quapi_msg report_msg = { .msg.type = QUAPI_MSG_CHECKPOINT_REPORT,
+                           .msg.data.checkpoint_report.seeding_pid =
+                             seeding_pid };
+  quapi_write_msg_to_fd(
+    r->header_data.message_to_parent_pipe[1], &report_msg, NULL);
+}
 
-    dup2(r->header_data.forked_child_write_pipe[1], STDOUT_FILENO);
-    close(r->header_data.forked_child_read_pipe[1]);
+/** Fork at the current position in the formula. The parent stays as snapshot
+ * and waits on a wake pipe, the child continues as seeding process. Once the
+ * snapshot reads 'r', it forks a new seeding process from the saved state and
+ * waits again. Anything else ends it, including EOF once all processes below
+ * it exited. */
+static void
+checkpoint(quapi_runtime* r, uint32_t depth) {
+  if(depth != r->checkpoints + 1 || depth > QUAPI_MAX_CHECKPOINTS) {
+    err("Invalid checkpoint depth %u with %zu checkpoints!",
+        depth,
+        r->checkpoints);
+    send_checkpoint_report(r, -1);
+    return;
+  }
 
-#ifdef USING_ZEROCOPY
-    if(r->in_stream)
-      quapi_zerocopy_pipe_close(r->in_stream);
-    r->in_stream = quapi_zerocopy_pipe_fdopen(STDIN_FILENO, "rb");
-#else
-    r->in_stream = fdopen(STDIN_FILENO, "rb");
-#endif
+  bool feed_ended = false;
+  for(;;) {
+    int wake[2];
+    if(pipe2(wake, O_CLOEXEC) == -1) {
+      err("Could not create wake pipe of checkpoint %u! Error: %s",
+          depth,
+          strerror(errno));
+      r->checkpoints = depth - 1;
+      send_checkpoint_report(r, -1);
+      return;
+    }
 
-    dbg("Forked into solver child and logging this message from there.");
-  } else {
-    err("Fork failed!");
+    pid_t pid = fork();
+    if(pid == 0) {
+      close(wake[0]);
+      r->checkpoint_wake[depth - 1] = wake[1];
+      r->checkpoints = depth;
+      quapi_timeline_process_name("seeding process");
+      if(r->feeding)
+        quapi_timeline_begin("feed", -1);
+      dbg("Continuing as seeding process after checkpoint %u.", depth);
+      send_checkpoint_report(r, getpid());
+      return;
+    }
+
+    close(wake[1]);
+    if(pid == -1) {
+      // Without a snapshot, this process just stays the seeding process.
+      err("Fork of checkpoint %u failed! Error: %s", depth, strerror(errno));
+      close(wake[0]);
+      r->checkpoints = depth - 1;
+      send_checkpoint_report(r, -1);
+      return;
+    }
+
+    // The new seeding process continues the feed span on its own track.
+    if(r->feeding && !feed_ended) {
+      quapi_timeline_end("feed", -1);
+      feed_ended = true;
+    }
+
+    char c = 0;
+    ssize_t n;
+    while((n = r->read(wake[0], &c, 1)) == -1 && errno == EINTR) {
+    }
+    close(wake[0]);
+    while(waitpid(-1, NULL, WNOHANG) > 0) {
+    }
+
+    if(n != 1 || c != 'r') {
+      dbg("Dropping snapshot of checkpoint %u.", depth);
+      _exit(EXIT_SUCCESS);
+    }
+    dbg("Rolling back to checkpoint %u.", depth);
+  }
+}
+
+static void
+wake_snapshot(quapi_runtime* r, size_t depth, char c) {
+  int fd = r->checkpoint_wake[depth - 1];
+  if(write(fd, &c, 1) != 1)
+    err("Could not wake snapshot of checkpoint %zu! Error: %s",
+        depth,
+        strerror(errno));
+  close(fd);
+}
+
+/** Drop all snapshots newer than the given checkpoint. Then either continue
+ * from the snapshot of the checkpoint and exit, or drop it too. */
+static void
+rollback(quapi_runtime* r, quapi_msg_rollback msg) {
+  if(msg.depth == 0 || msg.depth > r->checkpoints) {
+    err("Cannot roll back to checkpoint %u, there are only %zu!",
+        msg.depth,
+        r->checkpoints);
+    if(!msg.drop)
+      send_checkpoint_report(r, -1);
+    return;
+  }
+
+  // Other processes may still hold the write ends, so snapshots are ended
+  // explicitly instead of waiting for EOF.
+  for(size_t depth = r->checkpoints; depth > msg.depth; --depth)
+    wake_snapshot(r, depth, 'q');
+  r->checkpoints = msg.depth - 1;
+
+  if(msg.drop) {
+    wake_snapshot(r, msg.depth, 'q');
+    return;
   }
+
+  // Everything this process parsed since the checkpoint is dropped with it.
+  // The snapshot reports the seeding process it forks instead.
+  wake_snapshot(r, msg.depth, 'r');
+  _exit(EXIT_SUCCESS);
 }
 
 static void*
@@ -435,6 +818,11 @@ WAITING_FOR_HEADER(quapi_runtime* r, quapi_msg_inner* msg) {
   switch(msg->type) {
     case QUAPI_MSG_HEADER:
       quapi_timing_header();
+      r->seeding = true;
+      r->feeding = true;
+      quapi_perf_init();
+      quapi_timeline_process_name("seeding process");
+      quapi_timeline_begin("feed", -1);
       if(msg->data.header.api_version == QUAPI_API_VERSION) {
         dbg("API versions match! Both runtime and application use %d",
             QUAPI_API_VERSION);
@@ -496,6 +884,14 @@ READING_PREFIX(quapi_runtime* r, quapi_msg_inner* msg) {
       r->outbuf_len = -1;
       fork_solving_child(r, msg->data.fork);
       return READING_PREFIX;
+    case QUAPI_MSG_CHECKPOINT:
+      r->outbuf_len = -1;
+      checkpoint(r, msg->data.checkpoint.depth);
+      return READING_PREFIX;
+    case QUAPI_MSG_ROLLBACK:
+      r->outbuf_len = -1;
+      rollback(r, msg->data.rollback);
+      return READING_PREFIX;
     case QUAPI_MSG_SOLVE:
       // Directly continue in READING_MATRIX.
       r->repeat_state = true;
@@ -597,6 +993,16 @@ READING_CLAUSE(quapi_runtime* r, quapi_msg_inner* msg) {
   }
   return NULL;
 }
+static void
+build_filler_block(quapi_runtime* r) {
+  size_t n = sizeof(r->filler_block) / r->filler_clause_len;
+  for(size_t i = 0; i < n; ++i)
+    memcpy(r->filler_block + i * r->filler_clause_len,
+           r->filler_clause,
+           r->filler_clause_len);
+  r->filler_block_clauses = n;
+}
+
 static void*
 READING_MATRIX(quapi_runtime* r, quapi_msg_inner* msg) {
   switch(msg->type) {
@@ -613,18 +1019,31 @@ READING_MATRIX(quapi_runtime* r, quapi_msg_inner* msg) {
       // Request another message to be read.
       r->outbuf_len = -1;
       return READING_MATRIX;
+    case QUAPI_MSG_CHECKPOINT:
+      checkpoint(r, msg->data.checkpoint.depth);
+      r->outbuf_len = -1;
+      return READING_MATRIX;
+    case QUAPI_MSG_ROLLBACK:
+      rollback(r, msg->data.rollback);
+      r->outbuf_len = -1;
+      return READING_MATRIX;
     case QUAPI_MSG_SOLVE:
       // Now, all assumptions have to be filled out! If they aren't, this has to
       // loop until they are.
       if(r->written_clauses < r->header_data.clauses) {
+        if(r->filler_block_clauses == 0)
+          build_filler_block(r);
+        size_t n = MIN((size_t)(r->header_data.clauses - r->written_clauses),
+                       r->filler_block_clauses);
         dbg("Not written enough clauses! Require %d, have %d. Literals: %d. "
-            "Writing filler clause.",
+            "Writing %zu filler clauses.",
             r->header_data.clauses,
             r->written_clauses,
-            r->header_data.literals);
-        memcpy(r->outbuf, r->filler_clause, r->filler_clause_len);
-        r->outbuf_len = r->filler_clause_len;
-        ++r->written_clauses;
+            r->header_data.literals,
+            n);
+        r->outbuf = r->filler_block;
+        r->outbuf_len = n * r->filler_clause_len;
+        r->written_clauses += n;
         r->repeat_state = true;
         return READING_MATRIX;
       } else {
@@ -633,6 +1052,14 @@ READING_MATRIX(quapi_runtime* r, quapi_msg_inner* msg) {
             r->header_data.clauses,
             r->written_clauses,
             r->header_data.literals);
+        if(r->send_solve_timestamp) {
+          quapi_timeline_end("assumptions", r->solve_id);
+          quapi_timeline_begin("solve", r->solve_id);
+          quapi_msg stamp_msg;
+          quapi_timing_stamp(&stamp_msg, QUAPI_TIMESTAMP_SOLVE_READ);
+          quapi_write_msg_to_fd(
+            r->header_data.message_to_parent_pipe[1], &stamp_msg, NULL);
+        }
       }
       return WORKING;
     default:
@@ -100,6 +100,49 @@ quapi_timing_msg_after_header() {
   end_timing();
 }
 
+void
+quapi_timing_stamp(quapi_msg* msg, quapi_timestamp_event event) {
+  struct timespec now;
+  gettime_into("now", &now);
+  *msg = (quapi_msg){ .msg.type = QUAPI_MSG_TIMESTAMP,
+                      .msg.data.timestamp = {
+                        .event = event,
+                        .time_us = (timespec_to_nanos(&now) / 1000) &
+                                   ((1u << QUAPI_TIMESTAMP_BITS) - 1) } };
+}
+
+static uint32_t
+saturate(uint64_t v) {
+  const uint64_t max = (1u << QUAPI_RUSAGE_BITS) - 1;
+  return v < max ? v : max;
+}
+
+void
+quapi_timing_rusage(quapi_msg* msgs, const struct rusage* ru) {
+  const uint64_t low = (1u << QUAPI_RUSAGE_BITS) - 1;
+  uint64_t user =
+    (uint64_t)ru->ru_utime.tv_sec * 1000000 + ru->ru_utime.tv_usec;
+  uint64_t system =
+    (uint64_t)ru->ru_stime.tv_sec * 1000000 + ru->ru_stime.tv_usec;
+
+  uint32_t values[QUAPI_RUSAGE_FIELD_COUNT] = {
+    [QUAPI_RUSAGE_USER_LOW] = user & low,
+    [QUAPI_RUSAGE_USER_HIGH] = saturate(user >> QUAPI_RUSAGE_BITS),
+    [QUAPI_RUSAGE_SYSTEM_LOW] = system & low,
+    [QUAPI_RUSAGE_SYSTEM_HIGH] = saturate(system >> QUAPI_RUSAGE_BITS),
+    [QUAPI_RUSAGE_MAX_RSS] = saturate(ru->ru_maxrss),
+    [QUAPI_RUSAGE_MINOR_FAULTS] = saturate(ru->ru_minflt),
+    [QUAPI_RUSAGE_MAJOR_FAULTS] = saturate(ru->ru_majflt),
+    [QUAPI_RUSAGE_VOLUNTARY_SWITCHES] = saturate(ru->ru_nvcsw),
+    [QUAPI_RUSAGE_INVOLUNTARY_SWITCHES] = saturate(ru->ru_nivcsw),
+  };
+
+  for(int i = 0; i < QUAPI_RUSAGE_FIELD_COUNT; ++i)
+    msgs[i] = (quapi_msg){ .msg.type = QUAPI_MSG_RUSAGE,
+                           .msg.data.rusage = { .field = i,
+                                                .value = values[i] } };
+}
+
 #undef GETTIME_INFO
 #undef xstr
 #undef str
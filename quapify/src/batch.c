@@ -0,0 +1,662 @@
+#define _GNU_SOURCE
+
+#include "batch.h"
+#include "common.h"
+#include "cubes.h"
+#include "formula.h"
+#include "json.h"
+#include "progress.h"
+#include "utilities.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <quapi/quapi.h>
+
+typedef struct batch_formula {
+  char* path;
+  formula f;
+  pthread_mutex_t mutex;
+  bool loaded;
+  bool failed;
+
+  // Count of unfinished entries using this formula. The clause arena is
+  // released once it drops to 0.
+  size_t users;
+} batch_formula;
+
+typedef struct batch_entry {
+  size_t line;
+  char* name;
+  batch_formula* formula;
+
+  cubes cubes;
+  intsplits intsplits;
+  bool cubes_ready;
+  int** cube_starts;
+
+  const char* solver;
+  char** solver_argv;
+  bool owns_solver;
+
+  int priority;
+  size_t slots;
+  double timeout;
+
+  // Cube count known from the manifest, before intsplits are inflated.
+  size_t expected_cubes;
+
+  size_t next_cube;
+  size_t active;
+  size_t done;
+  bool failed;
+  bool finished;
+} batch_entry;
+
+struct batch;
+
+typedef struct batch_worker {
+  struct batch* batch;
+  pthread_t thread;
+
+  batch_entry* loaded;
+  quapi_solver* solver;
+} batch_worker;
+
+typedef struct batch {
+  const batch_options* opts;
+
+  batch_entry* entries;
+  size_t entries_size;
+
+  batch_formula** formulas;
+  size_t formulas_size;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+
+  batch_worker* workers;
+  size_t workers_size;
+
+  progress* progress;
+
+  bool failed;
+} batch;
+
+static batch_formula*
+get_formula(batch* b, const char* path) {
+  for(size_t i = 0; i < b->formulas_size; ++i) {
+    if(strcmp(b->formulas[i]->path, path) == 0)
+      return b->formulas[i];
+  }
+
+  batch_formula* f = calloc(1, sizeof(batch_formula));
+  b->formulas =
+    realloc(b->formulas, (b->formulas_size + 1) * sizeof(batch_formula*));
+  if(!f || !b->formulas) {
+    fprintf(stderr, "Could not allocate batch formula!\n");
+    exit(EXIT_FAILURE);
+  }
+  b->formulas[b->formulas_size++] = f;
+
+  f->path = strdup(path);
+  formula_init(&f->f, true);
+  pthread_mutex_init(&f->mutex, NULL);
+  return f;
+}
+
+static bool
+read_int_array(const json_value* v, size_t line, const char* key, cubes* tgt) {
+  for(size_t i = 0; i < v->size; ++i) {
+    const json_value* lit = &v->items[i];
+    if(lit->type != JSON_NUMBER || lit->number != (int)lit->number) {
+      fprintf(stderr,
+              "Manifest line %zu: \"%s\" must only contain integers!\n",
+              line,
+              key);
+      return false;
+    }
+    if(lit->number != 0)
+      cubes_add(tgt, (int)lit->number);
+  }
+  cubes_add(tgt, 0);
+  return true;
+}
+
+static bool
+parse_entry(batch* b, batch_entry* e, const json_value* v) {
+  if(v->type != JSON_OBJECT) {
+    fprintf(stderr, "Manifest line %zu: entry must be an object!\n", e->line);
+    return false;
+  }
+
+  const json_value* formula = json_get(v, "formula");
+  if(!formula || formula->type != JSON_STRING) {
+    fprintf(
+      stderr, "Manifest line %zu: \"formula\" string is required!\n", e->line);
+    return false;
+  }
+  e->formula = get_formula(b, formula->string);
+  ++e->formula->users;
+
+  const json_value* name = json_get(v, "name");
+  if(name && name->type == JSON_STRING) {
+    e->name = strdup(name->string);
+  } else {
+    e->name = strdup(formula->string);
+  }
+
+  const json_value* cubes = json_get(v, "cubes");
+  if(cubes) {
+    if(cubes->type != JSON_ARRAY) {
+      fprintf(
+        stderr, "Manifest line %zu: \"cubes\" must be an array!\n", e->line);
+      return false;
+    }
+    for(size_t i = 0; i < cubes->size; ++i) {
+      if(cubes->items[i].type != JSON_ARRAY) {
+        fprintf(stderr,
+                "Manifest line %zu: \"cubes\" must contain arrays!\n",
+                e->line);
+        return false;
+      }
+      if(!read_int_array(&cubes->items[i], e->line, "cubes", &e->cubes))
+        return false;
+    }
+  }
+
+  const json_value* intsplits = json_get(v, "intsplits");
+  if(intsplits) {
+    if(cubes) {
+      fprintf(stderr,
+              "Manifest line %zu: only one of \"cubes\" and \"intsplits\" may "
+              "be given!\n",
+              e->line);
+      return false;
+    }
+    if(intsplits->type != JSON_ARRAY) {
+      fprintf(stderr,
+              "Manifest line %zu: \"intsplits\" must be an array!\n",
+              e->line);
+      return false;
+    }
+    for(size_t i = 0; i < intsplits->size; ++i) {
+      const json_value* s = &intsplits->items[i];
+      if(s->type != JSON_NUMBER || !intsplits_add(&e->intsplits, s->number)) {
+        fprintf(stderr,
+                "Manifest line %zu: intsplits need to be integers > 0!\n",
+                e->line);
+        return false;
+      }
+    }
+  }
+
+  const json_value* solver = json_get(v, "solver");
+  if(solver && solver->type == JSON_STRING) {
+    e->solver = strdup(solver->string);
+    e->solver_argv = calloc(1, sizeof(char*));
+    e->owns_solver = true;
+  } else if(solver && solver->type == JSON_ARRAY && solver->size > 0) {
+    e->solver_argv = calloc(solver->size, sizeof(char*));
+    e->owns_solver = true;
+    for(size_t i = 0; i < solver->size; ++i) {
+      if(solver->items[i].type != JSON_STRING) {
+        fprintf(stderr,
+                "Manifest line %zu: \"solver\" must only contain strings!\n",
+                e->line);
+        return false;
+      }
+      if(i == 0)
+        e->solver = strdup(solver->items[i].string);
+      else
+        e->solver_argv[i - 1] = strdup(solver->items[i].string);
+    }
+  } else if(b->opts->default_solver) {
+    e->solver = b->opts->default_solver;
+    e->solver_argv = b->opts->default_solver_argv;
+  } else {
+    fprintf(stderr,
+            "Manifest line %zu: no \"solver\" given and no default solver "
+            "supplied after --!\n",
+            e->line);
+    return false;
+  }
+
+  const json_value* priority = json_get(v, "priority");
+  if(priority && priority->type == JSON_NUMBER)
+    e->priority = priority->number;
+
+  const json_value* slots = json_get(v, "slots");
+  if(slots && slots->type == JSON_NUMBER && slots->number >= 1)
+    e->slots = slots->number;
+  else
+    e->slots = SIZE_MAX;
+
+  e->timeout = b->opts->default_timeout;
+  const json_value* timeout = json_get(v, "timeout");
+  if(timeout && timeout->type == JSON_NUMBER && timeout->number > 0)
+    e->timeout = timeout->number;
+
+  return true;
+}
+
+static int
+compare_entries(const void* a_, const void* b_) {
+  const batch_entry* a = a_;
+  const batch_entry* b = b_;
+  if(a->priority != b->priority)
+    return a->priority > b->priority ? -1 : 1;
+  return a->line < b->line ? -1 : a->line > b->line;
+}
+
+static bool
+read_manifest(batch* b, const char* path) {
+  FILE* f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+  if(!f) {
+    fprintf(stderr,
+            "Could not open manifest \"%s\": %s\n",
+            path,
+            strerror(errno));
+    return false;
+  }
+
+  char* line = NULL;
+  size_t line_capacity = 0;
+  size_t lineno = 0;
+  bool ok = true;
+
+  while(getline(&line, &line_capacity, f) != -1) {
+    ++lineno;
+
+    const char* p = line;
+    while(*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+      ++p;
+    if(*p == '\0')
+      continue;
+
+    json_value v;
+    const char* e = json_parse(line, &v);
+    if(e) {
+      fprintf(stderr, "Manifest line %zu: invalid JSON: %s\n", lineno, e);
+      json_release(&v);
+      ok = false;
+      break;
+    }
+
+    b->entries =
+      realloc(b->entries, (b->entries_size + 1) * sizeof(batch_entry));
+    batch_entry* entry = &b->entries[b->entries_size++];
+    memset(entry, 0, sizeof(batch_entry));
+    entry->line = lineno;
+
+    ok = parse_entry(b, entry, &v);
+    json_release(&v);
+    if(!ok)
+      break;
+  }
+
+  free(line);
+  if(f != stdin)
+    fclose(f);
+
+  if(ok)
+    qsort(b->entries, b->entries_size, sizeof(batch_entry), &compare_entries);
+
+  return ok;
+}
+
+static bool
+entry_has_pending(const batch_entry* e) {
+  return !e->failed && (!e->cubes_ready || e->next_cube < e->cubes.count);
+}
+
+static void
+finish_entry(batch* b, batch_entry* e) {
+  if(e->finished || e->active > 0)
+    return;
+  if(!e->failed && (!e->cubes_ready || e->done < e->cubes.count))
+    return;
+
+  e->finished = true;
+
+  batch_formula* f = e->formula;
+  pthread_mutex_lock(&f->mutex);
+  if(--f->users == 0)
+    formula_release(&f->f);
+  pthread_mutex_unlock(&f->mutex);
+}
+
+static void
+fail_entry(batch* b, batch_entry* e) {
+  pthread_mutex_lock(&b->mutex);
+  if(!e->failed && e->expected_cubes > e->next_cube)
+    progress_cubes_skipped(b->progress, e->expected_cubes - e->next_cube);
+  e->failed = true;
+  b->failed = true;
+  --e->active;
+  finish_entry(b, e);
+  pthread_cond_broadcast(&b->cond);
+  pthread_mutex_unlock(&b->mutex);
+}
+
+/* Must be called with b->mutex held. Prefers entries the worker already has a
+ * loaded solver for, as long as no entry with a higher priority waits. */
+static batch_entry*
+pick_entry(batch* b, batch_entry* preferred, bool* any_pending) {
+  batch_entry* best = NULL;
+  *any_pending = false;
+  for(size_t i = 0; i < b->entries_size; ++i) {
+    batch_entry* e = &b->entries[i];
+    if(!entry_has_pending(e))
+      continue;
+    *any_pending = true;
+    if(e->active >= e->slots)
+      continue;
+    if(!best)
+      best = e;
+    else if(e == preferred && e->priority == best->priority)
+      best = e;
+  }
+  return best;
+}
+
+static bool
+prepare_entry(batch* b, batch_entry* e) {
+  batch_formula* f = e->formula;
+  bool ok = true;
+
+  pthread_mutex_lock(&f->mutex);
+
+  if(!f->loaded && !f->failed) {
+    if(formula_parse(&f->f, f->path, b->opts->strictness)) {
+      f->loaded = true;
+    } else {
+      fprintf(stderr, "Could not parse formula \"%s\"!\n", f->path);
+      f->failed = true;
+    }
+  }
+
+  if(f->failed) {
+    ok = false;
+  } else if(!e->cubes_ready && !e->cube_starts) {
+    if(e->intsplits.size > 0) {
+      if(!f->f.quantifiers) {
+        fprintf(stderr,
+                "Formula \"%s\" of entry \"%s\" does not have quantifiers, but "
+                "needing quantifiers for intsplits!\n",
+                f->path,
+                e->name);
+        ok = false;
+      } else {
+        ok = intsplits_inflate(&e->intsplits,
+                               f->f.quantifiers,
+                               f->f.quantifiers_size,
+                               &e->cubes);
+      }
+    } else if(e->cubes.count == 0) {
+      cubes_add(&e->cubes, 0);
+    }
+
+    if(ok) {
+      e->cube_starts = calloc(e->cubes.count, sizeof(int*));
+      size_t c = 0;
+      int* start = e->cubes.lits;
+      for(size_t i = 0; i < e->cubes.size; ++i) {
+        int lit = e->cubes.lits[i];
+        if(lit == 0) {
+          e->cube_starts[c++] = start;
+          start = &e->cubes.lits[i + 1];
+        } else if(ABS(lit) > f->f.varcount) {
+          fprintf(stderr,
+                  "Cannot assume %d in entry \"%s\", as it is larger than the "
+                  "variable count %zu!\n",
+                  lit,
+                  e->name,
+                  f->f.varcount);
+          ok = false;
+          break;
+        }
+      }
+    }
+  }
+
+  pthread_mutex_unlock(&f->mutex);
+  return ok;
+}
+
+static void
+worker_release_solver(batch_worker* w) {
+  if(w->solver) {
+    quapi_release(w->solver);
+    w->solver = NULL;
+  }
+  w->loaded = NULL;
+}
+
+static bool
+worker_load(batch_worker* w, batch_entry* e) {
+  if(w->loaded == e && w->solver)
+    return true;
+
+  worker_release_solver(w);
+
+  const formula* f = &e->formula->f;
+  quapi_solver* s = quapi_init(e->solver,
+                               (const char**)e->solver_argv,
+                               NULL,
+                               f->varcount,
+                               f->clausecount,
+                               e->cubes.max_cube_size,
+                               NULL,
+                               NULL);
+  if(!s) {
+    fprintf(stderr,
+            "Quapi solver for entry \"%s\" could not be initialized!\n",
+            e->name);
+    return false;
+  }
+
+  formula_feed(f, s);
+
+  if(e->timeout > 0)
+    quapi_set_timeout(s, e->timeout * 1e9);
+
+  w->solver = s;
+  w->loaded = e;
+  return true;
+}
+
+static int
+worker_solve(batch_worker* w, int* cube, double* solve_time) {
+  for(int* lit = cube; *lit != 0; ++lit) {
+    if(!quapi_assume(w->solver, *lit)) {
+      fprintf(stderr, "quapi_assume(solver, %d) returned false!\n", *lit);
+      return -1;
+    }
+  }
+
+  double before_time = tai_time();
+  int result = quapi_solve(w->solver);
+  double after_time = tai_time();
+
+  *solve_time = after_time - before_time;
+
+  // Timed out cubes are reported as unknown.
+  return result == QUAPI_TIMEOUT ? 0 : result;
+}
+
+static void*
+worker_main(void* arg) {
+  batch_worker* w = arg;
+  batch* b = w->batch;
+
+  for(;;) {
+    pthread_mutex_lock(&b->mutex);
+    batch_entry* e = NULL;
+    for(;;) {
+      bool any_pending;
+      e = pick_entry(b, w->loaded, &any_pending);
+      if(e || !any_pending)
+        break;
+      pthread_cond_wait(&b->cond, &b->mutex);
+    }
+    if(!e) {
+      pthread_mutex_unlock(&b->mutex);
+      break;
+    }
+    ++e->active;
+    pthread_mutex_unlock(&b->mutex);
+
+    if(!prepare_entry(b, e)) {
+      fail_entry(b, e);
+      continue;
+    }
+
+    pthread_mutex_lock(&b->mutex);
+    if(!e->cubes_ready) {
+      e->cubes_ready = true;
+      pthread_cond_broadcast(&b->cond);
+    }
+    if(e->failed || e->next_cube >= e->cubes.count) {
+      --e->active;
+      finish_entry(b, e);
+      pthread_cond_broadcast(&b->cond);
+      pthread_mutex_unlock(&b->mutex);
+      continue;
+    }
+    size_t idx = e->next_cube++;
+    pthread_mutex_unlock(&b->mutex);
+
+    progress_cube_started(b->progress);
+
+    if(!worker_load(w, e)) {
+      progress_cube_finished(b->progress, -1, 0);
+      fail_entry(b, e);
+      continue;
+    }
+
+    double solve_time = 0;
+    int result = worker_solve(w, e->cube_starts[idx], &solve_time);
+    progress_cube_finished(b->progress, result, solve_time);
+    if(result == -1) {
+      worker_release_solver(w);
+      fail_entry(b, e);
+      continue;
+    }
+
+    quapi_solve_stats stats;
+    output_result_line(stdout,
+                       &b->opts->output,
+                       e->name,
+                       solve_time,
+                       result,
+                       output_last_stats(w->solver, &stats),
+                       idx,
+                       e->cube_starts[idx]);
+
+    pthread_mutex_lock(&b->mutex);
+    --e->active;
+    ++e->done;
+    finish_entry(b, e);
+    pthread_cond_broadcast(&b->cond);
+    pthread_mutex_unlock(&b->mutex);
+  }
+
+  worker_release_solver(w);
+
+  return NULL;
+}
+
+static void
+release_batch(batch* b) {
+  for(size_t i = 0; i < b->entries_size; ++i) {
+    batch_entry* e = &b->entries[i];
+    free(e->name);
+    cubes_release(&e->cubes);
+    intsplits_release(&e->intsplits);
+    free(e->cube_starts);
+    if(e->owns_solver) {
+      free((char*)e->solver);
+      for(char** a = e->solver_argv; a && *a; ++a)
+        free(*a);
+      free(e->solver_argv);
+    }
+  }
+  free(b->entries);
+
+  for(size_t i = 0; i < b->formulas_size; ++i) {
+    batch_formula* f = b->formulas[i];
+    formula_release(&f->f);
+    pthread_mutex_destroy(&f->mutex);
+    free(f->path);
+    free(f);
+  }
+  free(b->formulas);
+  free(b->workers);
+
+  pthread_mutex_destroy(&b->mutex);
+  pthread_cond_destroy(&b->cond);
+}
+
+int
+batch_run(const char* manifest_path, const batch_options* opts) {
+  batch b;
+  memset(&b, 0, sizeof(b));
+  b.opts = opts;
+  pthread_mutex_init(&b.mutex, NULL);
+  pthread_cond_init(&b.cond, NULL);
+
+  if(!read_manifest(&b, manifest_path)) {
+    release_batch(&b);
+    return EXIT_FAILURE;
+  }
+
+  size_t total_cubes = 0;
+  for(size_t i = 0; i < b.entries_size; ++i) {
+    batch_entry* e = &b.entries[i];
+    if(e->intsplits.size > 0) {
+      e->expected_cubes = 1;
+      for(size_t j = 0; j < e->intsplits.size; ++j)
+        e->expected_cubes *= e->intsplits.splits[j];
+    } else {
+      e->expected_cubes = MAX(e->cubes.count, (size_t)1);
+    }
+    total_cubes += e->expected_cubes;
+  }
+
+  // Entries may run several cubes at once, bounded by their own slots.
+  b.workers_size = MIN(opts->slots, MAX(total_cubes, (size_t)1));
+  b.workers = calloc(b.workers_size, sizeof(batch_worker));
+
+  message("Running %zu manifest entries (%zu cubes) over %zu solver slots",
+          b.entries_size,
+          total_cubes,
+          b.workers_size);
+
+  if(opts->print_header) {
+    output_header(stdout, &opts->output, true);
+  }
+
+  b.progress = progress_start(&opts->progress, total_cubes);
+
+  for(size_t i = 0; i < b.workers_size; ++i) {
+    b.workers[i].batch = &b;
+    pthread_create(&b.workers[i].thread, NULL, &worker_main, &b.workers[i]);
+  }
+  for(size_t i = 0; i < b.workers_size; ++i) {
+    pthread_join(b.workers[i].thread, NULL);
+  }
+
+  progress_stop(b.progress);
+
+  fflush(stdout);
+
+  int r = b.failed ? EXIT_FAILURE : EXIT_SUCCESS;
+  release_batch(&b);
+  return r;
+}
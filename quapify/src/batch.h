@@ -0,0 +1,47 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "output.h"
+#include "parse.h"
+#include "progress.h"
+
+/** @file
+ *
+ * Batch mode: run many formulas with their cubes over a shared pool of solver
+ * slots. The manifest contains one JSON object per line:
+ *
+ *   {"name": "x", "formula": "f.qdimacs", "intsplits": [3, 3],
+ *    "solver": ["./solver", "--arg"], "priority": 1, "slots": 2,
+ *    "timeout": 10}
+ *
+ * "formula" is required. Cubes are given either explicitly ("cubes": [[1, 2],
+ * [-1]]) or as intsplits. Without both, the formula is solved once without
+ * assumptions. Entries with higher priority are scheduled first, "slots" limits
+ * how many solver slots an entry may occupy at once and "timeout" limits the
+ * wall-clock time of every cube in seconds.
+ */
+
+typedef struct batch_options {
+  size_t slots;
+  bool print_header;
+  output_options output;
+  strictness strictness;
+  progress_options progress;
+
+  // Timeout in seconds for entries that do not specify one. 0 means none.
+  double default_timeout;
+
+  // Used for entries that do not specify a solver. May be NULL.
+  const char* default_solver;
+  char** default_solver_argv;
+} batch_options;
+
+/** @brief Run all entries of the manifest. Returns the process exit code.
+ */
+int
+batch_run(const char* manifest_path, const batch_options* opts);
+
+#endif
@@ -0,0 +1,233 @@
+#include "cubes.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+void
+cubes_release(cubes* c) {
+  free(c->lits);
+  memset(c, 0, sizeof(*c));
+}
+
+void
+cubes_add(cubes* c, int lit) {
+  if(lit == 0) {
+    if(c->current_cube_size > c->max_cube_size) {
+      c->max_cube_size = c->current_cube_size;
+    }
+    ++c->count;
+    c->current_cube_size = 0;
+  } else {
+    ++c->current_cube_size;
+  }
+
+  if(c->size == c->capacity) {
+    if(c->capacity == 0) {
+      c->capacity = 16;
+    } else {
+      c->capacity *= 2;
+    }
+    c->lits = realloc(c->lits, sizeof(int) * c->capacity);
+  }
+  c->lits[c->size++] = lit;
+}
+
+bool
+intsplits_add(intsplits* s, int split) {
+  if(split <= 0)
+    return false;
+
+  if(split > s->highest)
+    s->highest = split;
+
+  if(s->size == s->capacity) {
+    if(s->capacity == 0) {
+      s->capacity = 8;
+    } else {
+      s->capacity *= 2;
+    }
+    s->splits = realloc(s->splits, s->capacity * sizeof(int));
+  }
+
+  s->splits[s->size++] = split;
+  return true;
+}
+
+void
+intsplits_release(intsplits* s) {
+  free(s->splits);
+  memset(s, 0, sizeof(*s));
+}
+
+// https://stackoverflow.com/a/15327567
+static inline int
+ceil_log2(unsigned long long x) {
+  static const unsigned long long t[6] = {
+    0xFFFFFFFF00000000ull, 0x00000000FFFF0000ull, 0x000000000000FF00ull,
+    0x00000000000000F0ull, 0x000000000000000Cull, 0x0000000000000002ull
+  };
+
+  int y = (((x & (x - 1)) == 0) ? 0 : 1);
+  int j = 32;
+  int i;
+
+  for(i = 0; i < 6; i++) {
+    int k = (((x & t[i]) == 0) ? 0 : j);
+    y += k;
+    x >>= k;
+    j >>= 1;
+  }
+
+  return y;
+}
+
+static unsigned char
+get_bit(unsigned int n, unsigned int b) {
+  if(b >= sizeof(int) * CHAR_BIT)
+    return -1;
+  return (n >> b) & 1;
+};
+
+size_t
+intsplits_current_length(const intsplits* s, size_t index) {
+  assert(index < s->size);
+  int intSplit = s->splits[index];
+  if(intSplit != 0) {
+    return ceil_log2(intSplit);
+  }
+  return 1;
+}
+
+size_t
+intsplits_summed_length(const intsplits* s, size_t index) {
+  size_t l = 0;
+  for(size_t i = 0; i < index; ++i) {
+    l += intsplits_current_length(s, i);
+  }
+  return l;
+}
+
+bool
+intsplits_state_to_cube(const intsplits* s,
+                        const int* state,
+                        size_t state_size,
+                        const int* quantifiers,
+                        size_t quantifiers_size,
+                        cubes* tgt) {
+  const size_t l = intsplits_summed_length(s, state_size);
+  if(l > quantifiers_size) {
+    fprintf(stderr,
+            "Error: Intsplits too big! Length of %zu surpasses quantifier "
+            "count %zu!\n",
+            l,
+            quantifiers_size);
+    return false;
+  }
+
+  int assumption[l];
+  memcpy(assumption, quantifiers, l * sizeof(int));
+
+  // Check for validity of intsplit (not over multiple different quantifiers!),
+  // convert to absolutes and set the sign to the correct bit for the intsplit.
+  size_t assumption_i = 0;
+  for(size_t i = 0; i < state_size; ++i) {
+    size_t cl = intsplits_current_length(s, i);
+    for(size_t bit = cl - 1, li = 0; li < cl; ++assumption_i, --bit, ++li) {
+      if(li < cl - 1 &&
+         (quantifiers[assumption_i] ^ quantifiers[assumption_i + 1]) < 0) {
+        fprintf(stderr,
+                "Error: Intsplit at index %zu (%d) spanning multiple different "
+                "quantifier "
+                "blocks! (sign change from quantifier %zu (%d) to %zu (%d)).\n",
+                i,
+                s->splits[i],
+                assumption_i,
+                quantifiers[assumption_i],
+                assumption_i + 1,
+                quantifiers[assumption_i + 1]);
+        return false;
+      }
+
+      if(get_bit(state[i], bit) == 0)
+        assumption[assumption_i] = -abs(assumption[assumption_i]);
+      else
+        assumption[assumption_i] = abs(assumption[assumption_i]);
+    }
+  }
+
+  for(size_t i = 0; i < l; ++i) {
+    cubes_add(tgt, assumption[i]);
+  }
+  cubes_add(tgt, 0);
+
+  return true;
+}
+
+bool
+intsplits_inflate(const intsplits* s,
+                  const int* quantifiers,
+                  size_t quantifiers_size,
+                  cubes* tgt) {
+  assert(quantifiers);
+  assert(s->splits);
+
+  // This instplit-implementation is inspired from Paracooba and tries to
+  // reinterpret the first few quantifiers as integers. This is very nice for
+  // game-playing and planning.
+
+  // What this means in practice:
+  // Let's have alternating prefix: ForAll 1 2, Exists 3 4, ...
+  // Intsplit -i 3 -i 3 would generate these assumptions:
+  // -1 -2 -3 -4   i.e. 0 0
+  // -1 -2 -3 4    i.e. 0 1
+  // -1 -2 3 -4    i.e. 0 2
+  // -1 2 -3 -4    i.e. 1 0
+  // ...
+
+  int intsplits_state[s->size];
+  memset(intsplits_state, 0, sizeof(intsplits_state));
+  int last = s->size - 1;
+
+  while(intsplits_state[0] <= s->splits[0] - 1) {
+    if(!intsplits_state_to_cube(
+         s, intsplits_state, s->size, quantifiers, quantifiers_size, tgt))
+      return false;
+
+    ++intsplits_state[last];
+    for(int d = last; intsplits_state[d] == s->splits[d] + (d == 0 ? 1 : 0);
+        --d) {
+      intsplits_state[d] = 0;
+      if(d > 0) {
+        ++intsplits_state[d - 1];
+      }
+    }
+  }
+
+  return true;
+}
+
+int*
+cube_print(FILE* f, int* cube) {
+  bool first = true;
+  while(*cube != 0) {
+    if(first)
+      first = false;
+    else
+      fprintf(f, " ");
+
+    fprintf(f, "%d", *(cube++));
+  }
+  return cube + 1;
+}
+
+void
+cubes_print(FILE* f, const cubes* c) {
+  int* cube = c->lits;
+  int* end = c->lits + c->size;
+  while(cube != end) {
+    cube = cube_print(f, cube);
+    fprintf(f, "\n");
+  }
+}
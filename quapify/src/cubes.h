@@ -0,0 +1,80 @@
+#ifndef CUBES_H
+#define CUBES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/** @brief A list of zero-terminated cubes (assumption sets).
+ */
+typedef struct cubes {
+  size_t count;
+  size_t max_cube_size;
+  size_t current_cube_size;
+  size_t size;
+  size_t capacity;
+  int* lits;
+} cubes;
+
+/** @brief Nesting levels for integer-split-based cube generation.
+ */
+typedef struct intsplits {
+  size_t highest;
+  size_t size;
+  size_t capacity;
+  int* splits;
+} intsplits;
+
+void
+cubes_release(cubes* c);
+
+/** @brief Append a literal to the current cube, 0 ends the cube.
+ */
+void
+cubes_add(cubes* c, int lit);
+
+/** @brief Add a new nesting level. Returns false for invalid splits <= 0.
+ */
+bool
+intsplits_add(intsplits* s, int split);
+
+void
+intsplits_release(intsplits* s);
+
+/** @brief Length of the prefix covered by the first index nesting levels.
+ */
+size_t
+intsplits_summed_length(const intsplits* s, size_t index);
+
+/** @brief Number of literals the nesting level at index sets.
+ */
+size_t
+intsplits_current_length(const intsplits* s, size_t index);
+
+/** @brief Convert the state (one integer per nesting level) into a cube.
+ */
+bool
+intsplits_state_to_cube(const intsplits* s,
+                        const int* state,
+                        size_t state_size,
+                        const int* quantifiers,
+                        size_t quantifiers_size,
+                        cubes* tgt);
+
+/** @brief Append all cubes generated by the intsplits to tgt.
+ */
+bool
+intsplits_inflate(const intsplits* s,
+                  const int* quantifiers,
+                  size_t quantifiers_size,
+                  cubes* tgt);
+
+/** @brief Print a zero-terminated cube and return a pointer to the next one.
+ */
+int*
+cube_print(FILE* f, int* cube);
+
+void
+cubes_print(FILE* f, const cubes* c);
+
+#endif
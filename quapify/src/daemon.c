@@ -0,0 +1,194 @@
+#define _GNU_SOURCE
+
+#include "daemon.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+int
+daemon_connect(const char* path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+
+  if(strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Socket path \"%s\" is too long!\n", path);
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if(fd == -1) {
+    fprintf(stderr, "Could not create socket: %s\n", strerror(errno));
+    return -1;
+  }
+
+  if(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+    fprintf(stderr,
+            "Could not connect to quapid at \"%s\": %s\n",
+            path,
+            strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+const char*
+daemon_parse_cube(const char* s, cubes* tgt) {
+  for(;;) {
+    char* end;
+    errno = 0;
+    long lit = strtol(s, &end, 10);
+    if(end == s || errno || lit < -INT_MAX || lit > INT_MAX)
+      return NULL;
+    s = end;
+    cubes_add(tgt, lit);
+    if(lit == 0)
+      return s;
+  }
+}
+
+static bool
+send_arg(FILE* f, const char* arg) {
+  if(strchr(arg, '\n')) {
+    fprintf(stderr,
+            "Solver arguments containing newlines cannot be sent to quapid!\n");
+    return false;
+  }
+  fprintf(f, "arg %s\n", arg);
+  return true;
+}
+
+static bool
+send_request(FILE* f, const daemon_request* req) {
+  char formula[PATH_MAX];
+  if(!realpath(req->formula, formula)) {
+    fprintf(stderr,
+            "Could not resolve formula path \"%s\": %s\n",
+            req->formula,
+            strerror(errno));
+    return false;
+  }
+
+  // The daemon has a different working directory, so relative solver paths
+  // are resolved here. Plain names are looked up in the daemon's PATH.
+  char solver[PATH_MAX];
+  const char* solver_path = req->solver;
+  if(strchr(req->solver, '/')) {
+    if(!realpath(req->solver, solver)) {
+      fprintf(stderr,
+              "Could not resolve solver path \"%s\": %s\n",
+              req->solver,
+              strerror(errno));
+      return false;
+    }
+    solver_path = solver;
+  }
+
+  fprintf(f, "quapid %d\n", QUAPID_PROTOCOL_VERSION);
+  fprintf(f, "formula %s\n", formula);
+  fprintf(f, "strictness %d\n", (int)req->strictness);
+
+  if(!send_arg(f, solver_path))
+    return false;
+  for(char** a = req->solver_argv; a && *a; ++a) {
+    if(!send_arg(f, *a))
+      return false;
+  }
+
+  const int* end = req->cubes->lits + req->cubes->size;
+  bool line_open = false;
+  for(const int* l = req->cubes->lits; l != end; ++l) {
+    if(!line_open) {
+      fputs("cube", f);
+      line_open = true;
+    }
+    fprintf(f, " %d", *l);
+    if(*l == 0) {
+      fputc('\n', f);
+      line_open = false;
+    }
+  }
+
+  for(size_t i = 0; i < req->intsplits->size; ++i)
+    fprintf(f, "intsplit %d\n", req->intsplits->splits[i]);
+
+  fprintf(f, "select %d\n", req->selected_cube);
+  fprintf(f, "solve\n");
+
+  return fflush(f) == 0;
+}
+
+int
+daemon_client_run(const char* socket_path,
+                  const daemon_request* req,
+                  const output_options* o,
+                  bool print_header) {
+  int fd = daemon_connect(socket_path);
+  if(fd == -1)
+    return EXIT_FAILURE;
+
+  FILE* out = fdopen(dup(fd), "w");
+  FILE* in = fdopen(fd, "r");
+  if(!out || !in) {
+    fprintf(stderr, "Could not open socket streams: %s\n", strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  int exit_code = EXIT_FAILURE;
+  if(!send_request(out, req))
+    goto CLEANUP;
+
+  if(print_header)
+    output_header(stdout, o, false);
+
+  char* line = NULL;
+  size_t line_capacity = 0;
+  cubes cube;
+  memset(&cube, 0, sizeof(cube));
+  bool done = false;
+
+  while(!done && getline(&line, &line_capacity, in) != -1) {
+    int id, result, n;
+    double solve_time;
+    if(sscanf(line, "result %d %lf %d%n", &id, &solve_time, &result, &n) == 3) {
+      cube.size = 0;
+      cube.count = 0;
+      if(!daemon_parse_cube(line + n, &cube)) {
+        fprintf(stderr, "Malformed result from quapid: %s", line);
+        break;
+      }
+      // quapid does not report resource usages or performance counters.
+      output_result_line(
+        stdout, o, NULL, solve_time, result, NULL, id, cube.lits);
+    } else if(strncmp(line, "error ", 6) == 0) {
+      fprintf(stderr, "quapid: %s", line + 6);
+    } else if(sscanf(line, "done %d", &exit_code) == 1) {
+      done = true;
+    } else {
+      fprintf(stderr, "Malformed response from quapid: %s", line);
+      break;
+    }
+  }
+
+  if(!done) {
+    fprintf(stderr,
+            "Connection to quapid closed before the request was done!\n");
+    exit_code = EXIT_FAILURE;
+  }
+
+  free(line);
+  cubes_release(&cube);
+
+CLEANUP:
+  fclose(out);
+  fclose(in);
+  return exit_code;
+}
@@ -0,0 +1,71 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "cubes.h"
+#include "output.h"
+#include "parse.h"
+
+/** @file
+ *
+ * Line-based protocol between quapify --daemon (client) and quapid (server)
+ * over a Unix stream socket. The client sends one request and then reads
+ * responses until "done".
+ *
+ * Request, one command per line:
+ *
+ *   quapid <version>
+ *   formula <absolute path>
+ *   strictness <0|1|2>
+ *   arg <solver path or argument>    (repeated, in argv order)
+ *   cube <lit>* 0                    (repeated)
+ *   intsplit <n>                     (repeated)
+ *   select <index>                   (optional, -1 for all)
+ *   solve
+ *
+ * Responses:
+ *
+ *   result <id> <solve time [s]> <result> <lit>* 0
+ *   error <message>
+ *   done <exit code>
+ */
+
+#define QUAPID_PROTOCOL_VERSION 1
+
+typedef struct daemon_request {
+  const char* formula;
+  strictness strictness;
+
+  const char* solver;
+  char** solver_argv;
+
+  const cubes* cubes;
+  const intsplits* intsplits;
+  int selected_cube;
+} daemon_request;
+
+/** @brief Connect to the Unix socket at path. Returns the fd or -1.
+ */
+int
+daemon_connect(const char* path);
+
+/** @brief Send the request to quapid at socket_path and print all results.
+ *
+ * Returns the process exit code.
+ */
+int
+daemon_client_run(const char* socket_path,
+                  const daemon_request* req,
+                  const output_options* o,
+                  bool print_header);
+
+/** @brief Parse a zero-terminated list of literals from s into tgt.
+ *
+ * Returns a pointer behind the terminating 0, or NULL on malformed input.
+ */
+const char*
+daemon_parse_cube(const char* s, cubes* tgt);
+
+#endif
@@ -0,0 +1,229 @@
+#define _GNU_SOURCE
+
+#include "estimate.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Two-sided 95% quantile of the normal distribution.
+#define Z_95 1.959964
+
+static estimate_stratum*
+add_stratum(estimate* e, size_t begin, size_t end) {
+  e->strata =
+    realloc(e->strata, (e->strata_size + 1) * sizeof(estimate_stratum));
+  estimate_stratum* s = &e->strata[e->strata_size++];
+  memset(s, 0, sizeof(*s));
+  s->begin = begin;
+  s->end = end;
+  return s;
+}
+
+static size_t
+stratum_population(const estimate_stratum* s) {
+  return s->end - s->begin;
+}
+
+/* Selection sampling (Knuth, TAOCP Vol. 2, Algorithm S). Draws n distinct
+ * indices in ascending order, so that the sample is solved in the same order as
+ * a full run would.
+ */
+static void
+draw_samples(estimate_stratum* s, size_t n, unsigned short xsubi[3]) {
+  size_t population = stratum_population(s);
+  s->samples = malloc(n * sizeof(size_t));
+  s->samples_size = 0;
+
+  for(size_t t = 0; s->samples_size < n; ++t) {
+    double u = erand48(xsubi);
+    if((population - t) * u < n - s->samples_size)
+      s->samples[s->samples_size++] = s->begin + t;
+  }
+}
+
+/* Proportional allocation of n samples to the strata. Every stratum gets at
+ * least one sample, the rest is distributed by the largest remainder.
+ */
+static void
+allocate(const estimate* e, size_t n, size_t* alloc) {
+  double quota[e->strata_size];
+  size_t assigned = 0;
+
+  for(size_t h = 0; h < e->strata_size; ++h) {
+    size_t population = stratum_population(&e->strata[h]);
+    quota[h] = (double)n * population / e->population;
+    alloc[h] = quota[h] < 1 ? 1 : (size_t)quota[h];
+    if(alloc[h] > population)
+      alloc[h] = population;
+    assigned += alloc[h];
+  }
+
+  while(assigned != n) {
+    size_t best = e->strata_size;
+    double best_diff = 0;
+    for(size_t h = 0; h < e->strata_size; ++h) {
+      size_t population = stratum_population(&e->strata[h]);
+      double diff = assigned > n ? alloc[h] - quota[h] : quota[h] - alloc[h];
+      bool possible = assigned > n ? alloc[h] > 1 : alloc[h] < population;
+      if(possible && (best == e->strata_size || diff > best_diff)) {
+        best = h;
+        best_diff = diff;
+      }
+    }
+    if(best == e->strata_size)
+      break;
+
+    if(assigned > n) {
+      --alloc[best];
+      --assigned;
+    } else {
+      ++alloc[best];
+      ++assigned;
+    }
+  }
+}
+
+void
+estimate_init(estimate* e,
+              size_t cube_count,
+              size_t explicit_count,
+              const intsplits* s,
+              size_t n,
+              unsigned int seed) {
+  memset(e, 0, sizeof(*e));
+  e->population = cube_count;
+
+  if(explicit_count > 0)
+    add_stratum(e, 0, explicit_count);
+
+  size_t generated = cube_count - explicit_count;
+  if(generated > 0 && s->size > 0) {
+    size_t levels = s->splits[0];
+    size_t per_level = generated / levels;
+    for(size_t i = 0; i < levels; ++i) {
+      size_t begin = explicit_count + i * per_level;
+      add_stratum(e, begin, i + 1 == levels ? cube_count : begin + per_level);
+    }
+  } else if(generated > 0) {
+    add_stratum(e, explicit_count, cube_count);
+  }
+
+  if(n > cube_count)
+    n = cube_count;
+
+  // Too few samples to cover every stratum, fall back to simple random
+  // sampling over all cubes.
+  if(n < e->strata_size) {
+    free(e->strata);
+    e->strata = NULL;
+    e->strata_size = 0;
+    add_stratum(e, 0, cube_count);
+  }
+
+  unsigned short xsubi[3] = { 0x330e, seed & 0xffff, seed >> 16 };
+  size_t alloc[e->strata_size];
+  allocate(e, n, alloc);
+  for(size_t h = 0; h < e->strata_size; ++h)
+    draw_samples(&e->strata[h], alloc[h], xsubi);
+}
+
+void
+estimate_release(estimate* e) {
+  for(size_t h = 0; h < e->strata_size; ++h)
+    free(e->strata[h].samples);
+  free(e->strata);
+  memset(e, 0, sizeof(*e));
+}
+
+void
+estimate_record(estimate* e, size_t stratum, double solve_time) {
+  estimate_stratum* s = &e->strata[stratum];
+  ++s->solved;
+  s->sum += solve_time;
+  s->sum_sq += solve_time * solve_time;
+  if(solve_time > s->max)
+    s->max = solve_time;
+}
+
+static double
+sample_variance(size_t n, double sum, double sum_sq) {
+  if(n < 2)
+    return 0;
+  double v = (sum_sq - sum * sum / n) / (n - 1);
+  return v < 0 ? 0 : v;
+}
+
+void
+estimate_report(FILE* f, const estimate* e, size_t slots) {
+  size_t solved = 0;
+  double sum = 0, sum_sq = 0, max = 0;
+  for(size_t h = 0; h < e->strata_size; ++h) {
+    const estimate_stratum* s = &e->strata[h];
+    solved += s->solved;
+    sum += s->sum;
+    sum_sq += s->sum_sq;
+    if(s->max > max)
+      max = s->max;
+  }
+
+  if(solved == 0) {
+    fprintf(f, "c estimate: no cubes were sampled\n");
+    return;
+  }
+
+  // Strata with a single sample have no own variance estimate and use the
+  // variance of the whole sample instead.
+  const double pooled_mean = sum / solved;
+  const double pooled_variance = sample_variance(solved, sum, sum_sq);
+
+  double total = 0, variance = 0;
+  for(size_t h = 0; h < e->strata_size; ++h) {
+    const estimate_stratum* s = &e->strata[h];
+    const double population = stratum_population(s);
+
+    if(s->solved == 0) {
+      total += population * pooled_mean;
+      variance += population * population * pooled_variance;
+      continue;
+    }
+
+    const double mean = s->sum / s->solved;
+    const double v = s->solved > 1
+                       ? sample_variance(s->solved, s->sum, s->sum_sq)
+                       : pooled_variance;
+    const double fpc = 1.0 - s->solved / population;
+
+    total += population * mean;
+    variance += population * population * fpc * v / s->solved;
+  }
+
+  const double margin = Z_95 * sqrt(variance);
+  const double lower = total - margin < sum ? sum : total - margin;
+  const double upper = total + margin;
+
+  fprintf(f,
+          "c estimate: sampled %zu of %zu cubes in %zu strata\n",
+          solved,
+          e->population,
+          e->strata_size);
+  fprintf(f,
+          "c estimate: mean cube time %fs, max sampled cube time %fs\n",
+          pooled_mean,
+          max);
+  fprintf(f,
+          "c estimate: total cube time %fs (95%% CI %fs - %fs)\n",
+          total,
+          lower,
+          upper);
+
+  // List scheduling finishes within the perfect split of the work plus the
+  // longest single cube.
+  const double makespan = total / slots > max ? total / slots : max;
+  fprintf(f,
+          "c estimate: makespan with %zu slots %fs (up to %fs)\n",
+          slots,
+          makespan,
+          upper / slots + max);
+}
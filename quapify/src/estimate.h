@@ -0,0 +1,69 @@
+#ifndef ESTIMATE_H
+#define ESTIMATE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "cubes.h"
+
+/** @file
+ *
+ * Runtime estimation for a cube set from a stratified random sample.
+ *
+ * Cubes generated from intsplits are stratified by the value of the first
+ * nesting level, i.e. every value of the outermost integer is one stratum.
+ * Explicitly given cubes (-a) form one additional stratum. Samples are
+ * allocated proportionally to the stratum sizes, with at least one sample per
+ * stratum if the sample size allows it.
+ */
+
+typedef struct estimate_stratum {
+  // Cube indices of the stratum are [begin, end).
+  size_t begin;
+  size_t end;
+
+  // Sampled cube indices.
+  size_t* samples;
+  size_t samples_size;
+
+  size_t solved;
+  double sum;
+  double sum_sq;
+  double max;
+} estimate_stratum;
+
+typedef struct estimate {
+  estimate_stratum* strata;
+  size_t strata_size;
+  size_t population;
+} estimate;
+
+/** @brief Build strata over all cubes and draw a sample of size n.
+ *
+ * explicit_count is the number of explicitly given cubes, which come before
+ * the cubes generated by the intsplits.
+ */
+void
+estimate_init(estimate* e,
+              size_t cube_count,
+              size_t explicit_count,
+              const intsplits* s,
+              size_t n,
+              unsigned int seed);
+
+void
+estimate_release(estimate* e);
+
+/** @brief Record the solve time of a sampled cube of the given stratum.
+ */
+void
+estimate_record(estimate* e, size_t stratum, double solve_time);
+
+/** @brief Print the extrapolated sum of the wall times of all cubes with its
+ * 95% confidence interval and the predicted makespan when running on the given
+ * number of slots.
+ */
+void
+estimate_report(FILE* f, const estimate* e, size_t slots);
+
+#endif
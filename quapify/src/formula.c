@@ -0,0 +1,158 @@
+#include "formula.h"
+#include "common.h"
+#include "file.h"
+#include "utilities.h"
+
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The parser reports into add_quantifier and add_lit. The target is thread
+// local, so that multiple formulas may be parsed concurrently in batch mode.
+static _Thread_local formula* target_formula = NULL;
+static _Thread_local quapi_solver* target_solver = NULL;
+
+static void
+push_int(int** arr, size_t* size, size_t* capacity, int val) {
+  if(*size == *capacity) {
+    if(*capacity == 0) {
+      *capacity = 8;
+    } else {
+      *capacity *= 2;
+    }
+
+    *arr = realloc(*arr, *capacity * sizeof(int));
+    if(!*arr) {
+      fprintf(stderr, "Could not allocate formula storage!\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  (*arr)[(*size)++] = val;
+}
+
+void
+add_quantifier(int lit) {
+  if(target_solver) {
+    quapi_quantify(target_solver, lit);
+  } else if(target_formula) {
+    formula* f = target_formula;
+    push_int(
+      &f->quantifiers, &f->quantifiers_size, &f->quantifiers_capacity, lit);
+  }
+}
+
+void
+add_lit(int lit) {
+  if(target_solver) {
+    quapi_add(target_solver, lit);
+  } else if(target_formula) {
+    formula* f = target_formula;
+    if(lit == 0) {
+      ++f->clausecount;
+    } else {
+      size_t abslit = ABS(lit);
+      if(abslit > f->varcount)
+        f->varcount = abslit;
+    }
+    if(f->keep_clauses)
+      push_int(&f->lits, &f->lits_size, &f->lits_capacity, lit);
+  }
+}
+
+void
+formula_init(formula* f, bool keep_clauses) {
+  memset(f, 0, sizeof(*f));
+  f->keep_clauses = keep_clauses;
+}
+
+void
+formula_release(formula* f) {
+  free(f->quantifiers);
+  free(f->lits);
+  memset(f, 0, sizeof(*f));
+}
+
+static bool
+run_kissat_parser(const char* path, strictness strictness) {
+  file f;
+
+  if(strcmp(path, "-") == 0) {
+    kissat_read_already_open_file(&f, stdin, "/dev/stdin");
+  } else {
+    if(!kissat_open_to_read_file(&f, path)) {
+      fprintf(stderr, "Error: Kissat reader could not open file \"%s\"!", path);
+      return false;
+    }
+  }
+
+  uint64_t lineno = 0;
+  int max_var;
+  const char* result = kissat_parse_dimacs(strictness, &f, &lineno, &max_var);
+
+  kissat_close_file(&f);
+
+  if(result) {
+    fprintf(stderr,
+            "Error: Kissat reader returned message: %s (%s:%" PRIu64 ")\n",
+            result,
+            path,
+            lineno);
+    return false;
+  }
+
+  return true;
+}
+
+bool
+formula_parse(formula* f, const char* path, strictness strictness) {
+  target_formula = f;
+  bool r = run_kissat_parser(path, strictness);
+  target_formula = NULL;
+  return r;
+}
+
+bool
+formula_parse_into_solver(quapi_solver* solver,
+                          const char* path,
+                          strictness strictness) {
+  target_solver = solver;
+  bool r = run_kissat_parser(path, strictness);
+  target_solver = NULL;
+  return r;
+}
+
+void
+formula_feed(const formula* f, quapi_solver* solver) {
+  assert(f->keep_clauses);
+
+  for(size_t i = 0; i < f->quantifiers_size; ++i)
+    quapi_quantify(solver, f->quantifiers[i]);
+  for(size_t i = 0; i < f->lits_size; ++i)
+    quapi_add(solver, f->lits[i]);
+}
+
+static uint64_t
+fnv1a(uint64_t h, const int* arr, size_t size) {
+  const unsigned char* p = (const unsigned char*)arr;
+  const unsigned char* end = p + size * sizeof(int);
+  for(; p != end; ++p) {
+    h ^= *p;
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+uint64_t
+formula_hash(const formula* f) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  h = fnv1a(h, f->quantifiers, f->quantifiers_size);
+  // Separate the prefix from the matrix, so that moving a literal from one to
+  // the other changes the hash.
+  const int separator = INT_MIN;
+  h = fnv1a(h, &separator, 1);
+  h = fnv1a(h, f->lits, f->lits_size);
+  return h;
+}
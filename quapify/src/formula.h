@@ -0,0 +1,64 @@
+#ifndef FORMULA_H
+#define FORMULA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <quapi/quapi.h>
+
+#include "parse.h"
+
+/** @brief A (Q)DIMACS formula as read by the Kissat parser.
+ *
+ * The quantifier prefix is always kept, as it is required to build
+ * intsplits. Clauses are only kept in the zero-terminated clause arena if
+ * keep_clauses is set. Otherwise, only the counts are collected, which is
+ * enough for the two-pass mode that does not keep the formula in RAM.
+ */
+typedef struct formula {
+  int* quantifiers;
+  size_t quantifiers_size;
+  size_t quantifiers_capacity;
+
+  int* lits;
+  size_t lits_size;
+  size_t lits_capacity;
+
+  size_t varcount;
+  size_t clausecount;
+
+  bool keep_clauses;
+} formula;
+
+void
+formula_init(formula* f, bool keep_clauses);
+
+void
+formula_release(formula* f);
+
+/** @brief Parse the file at path ("-" for stdin) into the formula.
+ *
+ * Returns false and prints an error if the file could not be parsed.
+ */
+bool
+formula_parse(formula* f, const char* path, strictness strictness);
+
+/** @brief Parse the file at path and directly stream it into the solver.
+ */
+bool
+formula_parse_into_solver(quapi_solver* solver,
+                          const char* path,
+                          strictness strictness);
+
+/** @brief Feed a formula with a kept clause arena into the solver.
+ */
+void
+formula_feed(const formula* f, quapi_solver* solver);
+
+/** @brief FNV-1a hash over the prefix and the clause arena.
+ */
+uint64_t
+formula_hash(const formula* f);
+
+#endif
@@ -0,0 +1,219 @@
+#include "json.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct json_parser {
+  const char* p;
+} json_parser;
+
+static const char*
+parse_value(json_parser* jp, json_value* tgt);
+
+static void
+skip_ws(json_parser* jp) {
+  while(isspace((unsigned char)*jp->p))
+    ++jp->p;
+}
+
+static const char*
+parse_string(json_parser* jp, char** tgt) {
+  assert(*jp->p == '"');
+  ++jp->p;
+
+  size_t capacity = 16, size = 0;
+  char* s = malloc(capacity);
+  if(!s)
+    return "out of memory";
+
+  for(;;) {
+    char c = *jp->p++;
+    if(c == '\0') {
+      free(s);
+      return "unterminated string";
+    }
+    if(c == '"')
+      break;
+    if(c == '\\') {
+      c = *jp->p++;
+      switch(c) {
+        case '"':
+        case '\\':
+        case '/':
+          break;
+        case 'n':
+          c = '\n';
+          break;
+        case 't':
+          c = '\t';
+          break;
+        case 'r':
+          c = '\r';
+          break;
+        case 'b':
+          c = '\b';
+          break;
+        case 'f':
+          c = '\f';
+          break;
+        default:
+          free(s);
+          return "unsupported escape sequence in string";
+      }
+    }
+    if(size + 1 == capacity) {
+      capacity *= 2;
+      char* n = realloc(s, capacity);
+      if(!n) {
+        free(s);
+        return "out of memory";
+      }
+      s = n;
+    }
+    s[size++] = c;
+  }
+  s[size] = '\0';
+  *tgt = s;
+  return NULL;
+}
+
+static const char*
+append_item(json_value* tgt, json_value** item) {
+  json_value* items = realloc(tgt->items, (tgt->size + 1) * sizeof(json_value));
+  if(!items)
+    return "out of memory";
+  tgt->items = items;
+  if(tgt->type == JSON_OBJECT) {
+    char** keys = realloc(tgt->keys, (tgt->size + 1) * sizeof(char*));
+    if(!keys)
+      return "out of memory";
+    tgt->keys = keys;
+    tgt->keys[tgt->size] = NULL;
+  }
+  *item = &tgt->items[tgt->size++];
+  memset(*item, 0, sizeof(json_value));
+  return NULL;
+}
+
+static const char*
+parse_container(json_parser* jp, json_value* tgt, char close) {
+  ++jp->p;
+  skip_ws(jp);
+  if(*jp->p == close) {
+    ++jp->p;
+    return NULL;
+  }
+
+  for(;;) {
+    const char* e;
+    json_value* item;
+    if((e = append_item(tgt, &item)))
+      return e;
+
+    skip_ws(jp);
+    if(tgt->type == JSON_OBJECT) {
+      if(*jp->p != '"')
+        return "expected string key in object";
+      if((e = parse_string(jp, &tgt->keys[tgt->size - 1])))
+        return e;
+      skip_ws(jp);
+      if(*jp->p != ':')
+        return "expected ':' after key";
+      ++jp->p;
+    }
+
+    if((e = parse_value(jp, item)))
+      return e;
+
+    skip_ws(jp);
+    if(*jp->p == ',') {
+      ++jp->p;
+      continue;
+    }
+    if(*jp->p == close) {
+      ++jp->p;
+      return NULL;
+    }
+    return close == ']' ? "expected ',' or ']' in array"
+                        : "expected ',' or '}' in object";
+  }
+}
+
+static const char*
+parse_value(json_parser* jp, json_value* tgt) {
+  skip_ws(jp);
+  memset(tgt, 0, sizeof(*tgt));
+
+  char c = *jp->p;
+  if(c == '{') {
+    tgt->type = JSON_OBJECT;
+    return parse_container(jp, tgt, '}');
+  } else if(c == '[') {
+    tgt->type = JSON_ARRAY;
+    return parse_container(jp, tgt, ']');
+  } else if(c == '"') {
+    tgt->type = JSON_STRING;
+    return parse_string(jp, &tgt->string);
+  } else if(c == '-' || isdigit((unsigned char)c)) {
+    char* end = NULL;
+    tgt->type = JSON_NUMBER;
+    tgt->number = strtod(jp->p, &end);
+    if(end == jp->p)
+      return "invalid number";
+    jp->p = end;
+    return NULL;
+  } else if(strncmp(jp->p, "true", 4) == 0) {
+    tgt->type = JSON_BOOL;
+    tgt->boolean = true;
+    jp->p += 4;
+    return NULL;
+  } else if(strncmp(jp->p, "false", 5) == 0) {
+    tgt->type = JSON_BOOL;
+    tgt->boolean = false;
+    jp->p += 5;
+    return NULL;
+  } else if(strncmp(jp->p, "null", 4) == 0) {
+    tgt->type = JSON_NULL;
+    jp->p += 4;
+    return NULL;
+  }
+  return "unexpected character";
+}
+
+const char*
+json_parse(const char* text, json_value* tgt) {
+  json_parser jp = { .p = text };
+  const char* e = parse_value(&jp, tgt);
+  if(e)
+    return e;
+  skip_ws(&jp);
+  if(*jp.p != '\0')
+    return "trailing characters after value";
+  return NULL;
+}
+
+void
+json_release(json_value* v) {
+  for(size_t i = 0; i < v->size; ++i) {
+    json_release(&v->items[i]);
+    if(v->keys)
+      free(v->keys[i]);
+  }
+  free(v->items);
+  free(v->keys);
+  free(v->string);
+  memset(v, 0, sizeof(*v));
+}
+
+const json_value*
+json_get(const json_value* obj, const char* key) {
+  if(obj->type != JSON_OBJECT)
+    return NULL;
+  for(size_t i = 0; i < obj->size; ++i) {
+    if(obj->keys[i] && strcmp(obj->keys[i], key) == 0)
+      return &obj->items[i];
+  }
+  return NULL;
+}
@@ -0,0 +1,51 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Minimal JSON reader for the batch manifest. Only supports what a manifest
+ * line may contain: objects, arrays, strings (without unicode escapes),
+ * numbers, booleans and null.
+ */
+
+typedef enum json_type {
+  JSON_NULL,
+  JSON_BOOL,
+  JSON_NUMBER,
+  JSON_STRING,
+  JSON_ARRAY,
+  JSON_OBJECT,
+} json_type;
+
+typedef struct json_value json_value;
+
+struct json_value {
+  json_type type;
+  bool boolean;
+  double number;
+  char* string;
+
+  // Children of arrays and objects. Objects also have keys.
+  size_t size;
+  json_value* items;
+  char** keys;
+};
+
+/** @brief Parse a NUL-terminated JSON text.
+ *
+ * Returns NULL on success or a static error message on failure. The value must
+ * be released with json_release, also after failures.
+ */
+const char*
+json_parse(const char* text, json_value* tgt);
+
+void
+json_release(json_value* v);
+
+/** @brief Look up a key in an object. Returns NULL if absent.
+ */
+const json_value*
+json_get(const json_value* obj, const char* key);
+
+#endif
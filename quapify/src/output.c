@@ -0,0 +1,129 @@
+#include "output.h"
+#include "cubes.h"
+
+#include <stddef.h>
+#include <time.h>
+
+const char*
+output_result_str(int result) {
+  switch(result) {
+    case 10:
+      return "SAT";
+    case 20:
+      return "UNSAT";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+void
+output_header(FILE* f, const output_options* o, bool with_entry) {
+  if(with_entry)
+    fprintf(f, "Entry ");
+  fprintf(f, "SolveTime[ns] SolveTime[s] Result ");
+  if(o->print_rusage)
+    fprintf(f,
+            "UserTime[s] SystemTime[s] MaxRSS[KiB] MinorFaults MajorFaults "
+            "VoluntarySwitches InvoluntarySwitches ");
+  if(o->print_perf)
+    fprintf(f, "Cycles Instructions CacheMisses PageFaults ");
+  fprintf(f, "Assumption\n");
+}
+
+const quapi_solve_stats*
+output_last_stats(quapi_solver* solver, quapi_solve_stats* stats) {
+  quapi_stats all;
+  quapi_get_stats(solver, &all);
+  *stats = all.last;
+  return stats;
+}
+
+static void
+print_rusage(FILE* f, const quapi_rusage* r) {
+  // Every process has a resident set.
+  if(!r || r->max_rss_kib == 0) {
+    fprintf(f, "- - - - - - - ");
+    return;
+  }
+  fprintf(f,
+          "%f %f %llu %llu %llu %llu %llu ",
+          r->user_us / 1e6,
+          r->system_us / 1e6,
+          (unsigned long long)r->max_rss_kib,
+          (unsigned long long)r->minor_faults,
+          (unsigned long long)r->major_faults,
+          (unsigned long long)r->voluntary_switches,
+          (unsigned long long)r->involuntary_switches);
+}
+
+static void
+print_counter(FILE* f, const quapi_perf_counters* p, uint64_t v) {
+  if(!p || (p->cycles == 0 && p->instructions == 0 && p->cache_misses == 0 &&
+            p->page_faults == 0))
+    fprintf(f, "- ");
+  else
+    fprintf(f, "%llu ", (unsigned long long)v);
+}
+
+static void
+print_perf(FILE* f, const quapi_perf_counters* p) {
+  print_counter(f, p, p ? p->cycles : 0);
+  print_counter(f, p, p ? p->instructions : 0);
+  print_counter(f, p, p ? p->cache_misses : 0);
+  print_counter(f, p, p ? p->page_faults : 0);
+}
+
+void
+output_result_line(FILE* f,
+                   const output_options* o,
+                   const char* prefix,
+                   double solve_time,
+                   int result,
+                   const quapi_solve_stats* stats,
+                   int assumption_id,
+                   int* assumption) {
+  flockfile(f);
+
+  if(prefix)
+    fprintf(f, "%s ", prefix);
+
+  fprintf(f, "%zu %f ", (size_t)(solve_time * 1000000000), solve_time);
+
+  if(o->stringify_result) {
+    fprintf(f, "%s ", output_result_str(result));
+  } else {
+    fprintf(f, "%d ", result);
+  }
+
+  if(o->print_rusage)
+    print_rusage(f, stats ? &stats->rusage : NULL);
+  if(o->print_perf)
+    print_perf(f, stats ? &stats->perf : NULL);
+
+  if(o->wrap_assumption)
+    fprintf(f, "\"");
+
+  fprintf(f, "%d ", assumption_id);
+
+  if(o->print_assumptions) {
+    cube_print(f, assumption);
+  }
+
+  if(o->wrap_assumption)
+    fprintf(f, "\"");
+
+  fprintf(f, "\n");
+
+  funlockfile(f);
+}
+
+double
+tai_time(void) {
+  double res = -1;
+  struct timespec ts;
+  if(!clock_gettime(CLOCK_TAI, &ts)) {
+    res = 1e-9 * ts.tv_nsec;
+    res += ts.tv_sec;
+  }
+  return res;
+}
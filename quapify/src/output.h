@@ -0,0 +1,54 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <quapi/quapi.h>
+
+typedef struct output_options {
+  bool print_assumptions;
+  bool stringify_result;
+  bool wrap_assumption;
+  bool print_rusage;
+  bool print_perf;
+} output_options;
+
+/** @brief Stringify a QuAPI result code (SAT, UNSAT or UNKNOWN).
+ */
+const char*
+output_result_str(int result);
+
+/** @brief Print the header of the output table.
+ *
+ * If with_entry is set, it starts with the entry column of batch mode.
+ */
+void
+output_header(FILE* f, const output_options* o, bool with_entry);
+
+/** @brief Get the statistics of the last solve of solver.
+ */
+const quapi_solve_stats*
+output_last_stats(quapi_solver* solver, quapi_solve_stats* stats);
+
+/** @brief Print one result line.
+ *
+ * If prefix is not NULL, it is printed as first column (used for the entry
+ * name in batch mode). The resource usage and performance counter columns are
+ * only printed with print_rusage and print_perf, as "-" if stats is NULL or
+ * they were not measured.
+ */
+void
+output_result_line(FILE* f,
+                   const output_options* o,
+                   const char* prefix,
+                   double solve_time,
+                   int result,
+                   const quapi_solve_stats* stats,
+                   int assumption_id,
+                   int* assumption);
+
+double
+tai_time(void);
+
+#endif
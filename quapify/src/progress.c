@@ -0,0 +1,331 @@
+#define _GNU_SOURCE
+
+#include "progress.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <quapi/quapi.h>
+
+struct progress {
+  progress_options opts;
+  bool tty;
+
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  bool stopping;
+
+  double start_time;
+  double last_report_time;
+  size_t last_report_done;
+
+  size_t total;
+  size_t in_flight;
+  size_t done;
+  size_t skipped;
+  size_t sat;
+  size_t unsat;
+  size_t unknown;
+  size_t failed;
+  double time_sum;
+
+  // Solve times of cubes that did not fail.
+  quapi_histogram histogram;
+};
+
+static double
+monotonic_time(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+
+static void
+format_duration(char* buf, size_t size, double seconds) {
+  if(seconds < 0) {
+    snprintf(buf, size, "?");
+    return;
+  }
+  uint64_t s = seconds + 0.5;
+  if(s >= 3600)
+    snprintf(buf,
+             size,
+             "%" PRIu64 "h%02" PRIu64 "m%02" PRIu64 "s",
+             s / 3600,
+             s / 60 % 60,
+             s % 60);
+  else if(s >= 60)
+    snprintf(buf, size, "%" PRIu64 "m%02" PRIu64 "s", s / 60, s % 60);
+  else
+    snprintf(buf, size, "%.1fs", seconds);
+}
+
+typedef struct status {
+  size_t total, in_flight, done, pending, sat, unsat, unknown, failed;
+  double elapsed, throughput, recent_throughput, eta, p50, p99, time_sum;
+} status;
+
+// Mutex must be held.
+static status
+take_status(progress* p) {
+  status s;
+  double now = monotonic_time();
+  s.total = p->total;
+  s.in_flight = p->in_flight;
+  s.done = p->done;
+  size_t accounted = p->done + p->in_flight + p->skipped;
+  s.pending = p->total > accounted ? p->total - accounted : 0;
+  s.sat = p->sat;
+  s.unsat = p->unsat;
+  s.unknown = p->unknown;
+  s.failed = p->failed;
+  s.time_sum = p->time_sum;
+  s.elapsed = now - p->start_time;
+  s.throughput = s.elapsed > 0 ? p->done / s.elapsed : 0;
+
+  double interval = now - p->last_report_time;
+  s.recent_throughput =
+    interval > 0 ? (p->done - p->last_report_done) / interval : 0;
+  p->last_report_time = now;
+  p->last_report_done = p->done;
+
+  size_t remaining = s.pending + s.in_flight;
+  s.eta = remaining == 0     ? 0
+          : s.throughput > 0 ? remaining / s.throughput
+                             : -1;
+  s.p50 = quapi_histogram_percentile(&p->histogram, 50) * 1e-9;
+  s.p99 = quapi_histogram_percentile(&p->histogram, 99) * 1e-9;
+  return s;
+}
+
+static void
+print_line(const progress* p, const status* s, bool final) {
+  char eta[32], elapsed[32];
+  format_duration(eta, sizeof(eta), s->eta);
+  format_duration(elapsed, sizeof(elapsed), s->elapsed);
+
+  flockfile(stderr);
+  if(p->tty)
+    fputs("\r\033[K", stderr);
+  fprintf(stderr,
+          "[QUAPIFY] %zu/%zu done, %zu in flight, %zu pending | SAT %zu UNSAT "
+          "%zu UNKNOWN %zu",
+          s->done,
+          s->total,
+          s->in_flight,
+          s->pending,
+          s->sat,
+          s->unsat,
+          s->unknown);
+  if(s->failed)
+    fprintf(stderr, " FAILED %zu", s->failed);
+  fprintf(stderr,
+          " | %.2f cubes/s (now %.2f) | p50 %.3fs p99 %.3fs | ",
+          s->throughput,
+          s->recent_throughput,
+          s->p50,
+          s->p99);
+  if(final)
+    fprintf(stderr, "took %s", elapsed);
+  else
+    fprintf(stderr, "elapsed %s, ETA %s", elapsed, eta);
+  if(!p->tty || final)
+    fputc('\n', stderr);
+  fflush(stderr);
+  funlockfile(stderr);
+}
+
+static void
+write_metrics(const progress* p, const status* s) {
+  const char* path = p->opts.metrics_path;
+  size_t tmp_size = strlen(path) + 5;
+  char tmp[tmp_size];
+  snprintf(tmp, tmp_size, "%s.tmp", path);
+
+  FILE* f = fopen(tmp, "w");
+  if(!f) {
+    fprintf(stderr,
+            "Could not write metrics to \"%s\": %s\n",
+            tmp,
+            strerror(errno));
+    return;
+  }
+
+  fprintf(f, "# HELP quapify_cubes Cubes of this run by state.\n");
+  fprintf(f, "# TYPE quapify_cubes gauge\n");
+  fprintf(f, "quapify_cubes{state=\"total\"} %zu\n", s->total);
+  fprintf(f, "quapify_cubes{state=\"done\"} %zu\n", s->done);
+  fprintf(f, "quapify_cubes{state=\"in_flight\"} %zu\n", s->in_flight);
+  fprintf(f, "quapify_cubes{state=\"pending\"} %zu\n", s->pending);
+  fprintf(f, "# HELP quapify_results_total Finished cubes by result.\n");
+  fprintf(f, "# TYPE quapify_results_total counter\n");
+  fprintf(f, "quapify_results_total{result=\"sat\"} %zu\n", s->sat);
+  fprintf(f, "quapify_results_total{result=\"unsat\"} %zu\n", s->unsat);
+  fprintf(f, "quapify_results_total{result=\"unknown\"} %zu\n", s->unknown);
+  fprintf(f, "quapify_results_total{result=\"failed\"} %zu\n", s->failed);
+  fprintf(f, "# HELP quapify_cube_seconds Solve time of a cube.\n");
+  fprintf(f, "# TYPE quapify_cube_seconds summary\n");
+  fprintf(f, "quapify_cube_seconds{quantile=\"0.5\"} %f\n", s->p50);
+  fprintf(f, "quapify_cube_seconds{quantile=\"0.99\"} %f\n", s->p99);
+  fprintf(f, "quapify_cube_seconds_sum %f\n", s->time_sum);
+  fprintf(f, "quapify_cube_seconds_count %zu\n", s->done - s->failed);
+  fprintf(f,
+          "# HELP quapify_throughput_cubes_per_second Finished cubes per "
+          "second since the start.\n");
+  fprintf(f, "# TYPE quapify_throughput_cubes_per_second gauge\n");
+  fprintf(f, "quapify_throughput_cubes_per_second %f\n", s->throughput);
+  fprintf(f, "# HELP quapify_elapsed_seconds Time since the start.\n");
+  fprintf(f, "# TYPE quapify_elapsed_seconds gauge\n");
+  fprintf(f, "quapify_elapsed_seconds %f\n", s->elapsed);
+  fprintf(f,
+          "# HELP quapify_eta_seconds Estimated remaining time, -1 if "
+          "unknown.\n");
+  fprintf(f, "# TYPE quapify_eta_seconds gauge\n");
+  fprintf(f, "quapify_eta_seconds %f\n", s->eta);
+
+  if(fclose(f) != 0 || rename(tmp, path) != 0) {
+    fprintf(stderr,
+            "Could not write metrics to \"%s\": %s\n",
+            path,
+            strerror(errno));
+    unlink(tmp);
+  }
+}
+
+static void
+report(progress* p, bool final) {
+  pthread_mutex_lock(&p->mutex);
+  status s = take_status(p);
+  pthread_mutex_unlock(&p->mutex);
+
+  if(p->opts.print)
+    print_line(p, &s, final);
+  if(p->opts.metrics_path)
+    write_metrics(p, &s);
+}
+
+static void*
+progress_main(void* arg) {
+  progress* p = arg;
+
+  pthread_mutex_lock(&p->mutex);
+  while(!p->stopping) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    double t = deadline.tv_sec + 1e-9 * deadline.tv_nsec + p->opts.interval;
+    deadline.tv_sec = t;
+    deadline.tv_nsec = (t - deadline.tv_sec) * 1e9;
+
+    int r = 0;
+    while(!p->stopping && r != ETIMEDOUT)
+      r = pthread_cond_timedwait(&p->cond, &p->mutex, &deadline);
+    if(p->stopping)
+      break;
+
+    pthread_mutex_unlock(&p->mutex);
+    report(p, false);
+    pthread_mutex_lock(&p->mutex);
+  }
+  pthread_mutex_unlock(&p->mutex);
+
+  return NULL;
+}
+
+progress*
+progress_start(const progress_options* o, size_t total) {
+  if(!o->print && !o->metrics_path)
+    return NULL;
+
+  progress* p = calloc(1, sizeof(progress));
+  p->opts = *o;
+  if(p->opts.interval <= 0)
+    p->opts.interval = 1;
+  p->tty = isatty(STDERR_FILENO);
+  p->total = total;
+  p->start_time = monotonic_time();
+  p->last_report_time = p->start_time;
+
+  pthread_mutex_init(&p->mutex, NULL);
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&p->cond, &attr);
+  pthread_condattr_destroy(&attr);
+
+  pthread_create(&p->thread, NULL, &progress_main, p);
+  return p;
+}
+
+void
+progress_stop(progress* p) {
+  if(!p)
+    return;
+
+  pthread_mutex_lock(&p->mutex);
+  p->stopping = true;
+  pthread_cond_signal(&p->cond);
+  pthread_mutex_unlock(&p->mutex);
+  pthread_join(p->thread, NULL);
+
+  report(p, true);
+
+  pthread_mutex_destroy(&p->mutex);
+  pthread_cond_destroy(&p->cond);
+  free(p);
+}
+
+void
+progress_cube_started(progress* p) {
+  if(!p)
+    return;
+  pthread_mutex_lock(&p->mutex);
+  ++p->in_flight;
+  pthread_mutex_unlock(&p->mutex);
+}
+
+void
+progress_cube_finished(progress* p, int result, double solve_time) {
+  if(!p)
+    return;
+  pthread_mutex_lock(&p->mutex);
+  --p->in_flight;
+  ++p->done;
+  switch(result) {
+    case -1:
+      ++p->failed;
+      break;
+    case 10:
+      ++p->sat;
+      break;
+    case 20:
+      ++p->unsat;
+      break;
+    default:
+      ++p->unknown;
+      break;
+  }
+  if(result != -1) {
+    p->time_sum += solve_time;
+    quapi_histogram_record(&p->histogram,
+                           solve_time > 0 ? solve_time * 1e9 : 0);
+  }
+  pthread_mutex_unlock(&p->mutex);
+}
+
+void
+progress_cubes_skipped(progress* p, size_t count) {
+  if(!p)
+    return;
+  pthread_mutex_lock(&p->mutex);
+  p->skipped += count;
+  pthread_mutex_unlock(&p->mutex);
+}
@@ -0,0 +1,51 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/** @file
+ *
+ * Periodic progress reporting for long runs. A background thread prints a
+ * status line to stderr and optionally rewrites a metrics file in the
+ * Prometheus text format. The file is written to a temporary file first and
+ * renamed afterwards, so readers never see a partially written file.
+ *
+ * All functions accept NULL as progress, in which case they do nothing.
+ */
+
+typedef struct progress progress;
+
+typedef struct progress_options {
+  // Print a status line to stderr.
+  bool print;
+  // Seconds between two reports.
+  double interval;
+  // Rewrite this file with Prometheus metrics on every report. May be NULL.
+  const char* metrics_path;
+} progress_options;
+
+/** @brief Start the reporting thread for a run of total cubes.
+ */
+progress*
+progress_start(const progress_options* o, size_t total);
+
+/** @brief Report a last time, stop the thread and free the progress.
+ */
+void
+progress_stop(progress* p);
+
+void
+progress_cube_started(progress* p);
+
+/** @brief A started cube finished. A result of -1 marks a failed cube.
+ */
+void
+progress_cube_finished(progress* p, int result, double solve_time);
+
+/** @brief Cubes that will never be started, e.g. because their entry failed.
+ */
+void
+progress_cubes_skipped(progress* p, size_t count);
+
+#endif
@@ -0,0 +1,699 @@
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <quapi/quapi.h>
+
+#include "cubes.h"
+#include "daemon.h"
+#include "formula.h"
+#include "output.h"
+#include "utilities.h"
+
+bool option_verbose = false;
+
+/* A snapshot is a seeding process that already received the whole formula.
+ * Solving a cube on it only costs a fork of the seeding process. Snapshots are
+ * keyed by the solver argv, the formula hash and the prefix depth (the prefix
+ * depth changes the header and quantifier types sent to the solver). A
+ * snapshot serves one request at a time, concurrent requests for the same key
+ * load further instances, which stay warm as well.
+ */
+typedef struct snapshot {
+  char** argv;
+  uint64_t hash;
+  size_t prefixdepth;
+
+  // Only the prefix and the counts are kept, the clauses live in the seeding
+  // process.
+  formula f;
+  quapi_solver* solver;
+
+  // Guarded by the global mutex. Busy snapshots are loading or solving a
+  // request.
+  bool busy;
+  uint64_t last_used;
+  bool removed;
+} snapshot;
+
+/* Remembers the hash of formula files, so that a warm request for an unchanged
+ * file does not have to parse it again.
+ */
+typedef struct known_file {
+  char* path;
+  dev_t dev;
+  ino_t ino;
+  off_t size;
+  struct timespec mtime;
+  uint64_t hash;
+} known_file;
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static snapshot** snapshots = NULL;
+static size_t snapshots_size = 0;
+static known_file* known_files = NULL;
+static size_t known_files_size = 0;
+static uint64_t use_clock = 0;
+static size_t memory_budget = 1024ull * 1024 * 1024;
+
+typedef struct request {
+  char* formula;
+  strictness strictness;
+  char** argv;
+  size_t argc;
+  cubes cubes;
+  intsplits intsplits;
+  int selected_cube;
+} request;
+
+static void
+print_qdbg(const char* fmt, va_list* ap) {
+  fputs("[QUAPID] ", stderr);
+  vfprintf(stderr, fmt, *ap);
+  fputc('\n', stderr);
+  fflush(stderr);
+}
+
+static void
+qdbg(const char* fmt, ...) {
+  if(!option_verbose)
+    return;
+  va_list ap;
+  va_start(ap, fmt);
+  print_qdbg(fmt, &ap);
+  va_end(ap);
+}
+
+static void
+help() {
+  fprintf(stderr,
+          "quapid - Keep QuAPI solvers with parsed formulas warm for "
+          "quapify\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "USAGE:\n");
+  fprintf(stderr, "  quapid <socket> [OPTIONS]\n");
+  fprintf(stderr, "OPTIONS:\n");
+  fprintf(stderr, "  -v\t\tverbose output\n");
+  fprintf(stderr, "  -d\t\tenable QuAPI debug using QUAPI_DEBUG envvar\n");
+  fprintf(stderr, "  -t\t\tenable QuAPI trace using QUAPI_TRACE envvar\n");
+  fprintf(stderr,
+          "  -m <MiB>\tmemory budget for idle snapshots (default: 1024)\n");
+  fprintf(stderr, "EXAMPLES:\n");
+  fprintf(stderr, "  ./quapid /tmp/quapid.sock -m 4096 &\n");
+  fprintf(stderr,
+          "  ./quapify --daemon /tmp/quapid.sock input.cnf -i 4 -I 3 -- "
+          "./solver\n");
+}
+
+static size_t
+rss_of_pid(int pid) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/statm", pid);
+  FILE* f = fopen(path, "r");
+  if(!f)
+    return 0;
+  unsigned long pages = 0;
+  if(fscanf(f, "%*lu %lu", &pages) != 1)
+    pages = 0;
+  fclose(f);
+  return pages * sysconf(_SC_PAGESIZE);
+}
+
+static bool
+argv_equal(char** a, char** b) {
+  for(; *a && *b; ++a, ++b) {
+    if(strcmp(*a, *b) != 0)
+      return false;
+  }
+  return *a == *b;
+}
+
+static void
+snapshot_free(snapshot* s) {
+  qdbg("Releasing snapshot %016llx of %s",
+       (unsigned long long)s->hash,
+       s->argv[0]);
+  if(s->solver)
+    quapi_release(s->solver);
+  formula_release(&s->f);
+  for(char** a = s->argv; *a; ++a)
+    free(*a);
+  free(s->argv);
+  free(s);
+}
+
+static void
+snapshot_unlink(snapshot* s) {
+  for(size_t i = 0; i < snapshots_size; ++i) {
+    if(snapshots[i] == s) {
+      snapshots[i] = snapshots[--snapshots_size];
+      break;
+    }
+  }
+  s->removed = true;
+}
+
+// Global mutex must be held.
+static bool
+known_hash(const char* path, const struct stat* st, uint64_t* hash) {
+  for(size_t i = 0; i < known_files_size; ++i) {
+    known_file* k = &known_files[i];
+    if(strcmp(k->path, path) != 0)
+      continue;
+    if(k->dev == st->st_dev && k->ino == st->st_ino &&
+       k->size == st->st_size && k->mtime.tv_sec == st->st_mtim.tv_sec &&
+       k->mtime.tv_nsec == st->st_mtim.tv_nsec) {
+      *hash = k->hash;
+      return true;
+    }
+    return false;
+  }
+  return false;
+}
+
+// Global mutex must be held.
+static void
+remember_hash(const char* path, const struct stat* st, uint64_t hash) {
+  known_file* k = NULL;
+  for(size_t i = 0; i < known_files_size; ++i) {
+    if(strcmp(known_files[i].path, path) == 0) {
+      k = &known_files[i];
+      break;
+    }
+  }
+  if(!k) {
+    known_files =
+      realloc(known_files, (known_files_size + 1) * sizeof(known_file));
+    k = &known_files[known_files_size++];
+    k->path = strdup(path);
+  }
+  k->dev = st->st_dev;
+  k->ino = st->st_ino;
+  k->size = st->st_size;
+  k->mtime = st->st_mtim;
+  k->hash = hash;
+}
+
+// Global mutex must be held. Returns an idle snapshot, which is then busy.
+static snapshot*
+find_snapshot(char** argv, uint64_t hash, size_t prefixdepth) {
+  for(size_t i = 0; i < snapshots_size; ++i) {
+    snapshot* s = snapshots[i];
+    if(!s->busy && s->hash == hash && s->prefixdepth == prefixdepth &&
+       argv_equal(s->argv, argv)) {
+      s->busy = true;
+      return s;
+    }
+  }
+  return NULL;
+}
+
+/* Evicts idle snapshots in LRU order until their seeding processes fit into
+ * the memory budget. Busy snapshots do not count towards it. The most recently
+ * used snapshot is always kept.
+ */
+static void
+evict(void) {
+  pthread_mutex_lock(&mutex);
+  snapshot** victims = malloc((snapshots_size + 1) * sizeof(snapshot*));
+  size_t victims_size = 0;
+
+  size_t total = 0;
+  for(size_t i = 0; i < snapshots_size; ++i) {
+    if(snapshots[i]->solver && !snapshots[i]->busy)
+      total += rss_of_pid(quapi_get_pid(snapshots[i]->solver));
+  }
+
+  while(total > memory_budget && snapshots_size > 1) {
+    snapshot* lru = NULL;
+    for(size_t i = 0; i < snapshots_size; ++i) {
+      snapshot* s = snapshots[i];
+      if(!s->busy && (!lru || s->last_used < lru->last_used))
+        lru = s;
+    }
+    if(!lru || lru->last_used == use_clock)
+      break;
+
+    size_t rss = rss_of_pid(quapi_get_pid(lru->solver));
+    total = rss < total ? total - rss : 0;
+    snapshot_unlink(lru);
+    victims[victims_size++] = lru;
+    qdbg("Evicting snapshot %016llx (%zu bytes RSS, %zu bytes in total)",
+         (unsigned long long)lru->hash,
+         rss,
+         total + rss);
+  }
+  pthread_mutex_unlock(&mutex);
+
+  for(size_t i = 0; i < victims_size; ++i)
+    snapshot_free(victims[i]);
+  free(victims);
+}
+
+static void
+snapshot_put(snapshot* s) {
+  pthread_mutex_lock(&mutex);
+  s->last_used = ++use_clock;
+  s->busy = false;
+  bool free_it = s->removed;
+  pthread_mutex_unlock(&mutex);
+
+  if(free_it)
+    snapshot_free(s);
+}
+
+static bool
+snapshot_load(snapshot* s, formula* f) {
+  qdbg("Loading snapshot %016llx of %s with %zu variables, %zu clauses and "
+       "prefix depth %zu",
+       (unsigned long long)s->hash,
+       s->argv[0],
+       f->varcount,
+       f->clausecount,
+       s->prefixdepth);
+
+  s->solver = quapi_init(s->argv[0],
+                         (const char**)s->argv,
+                         NULL,
+                         f->varcount,
+                         f->clausecount,
+                         s->prefixdepth,
+                         NULL,
+                         NULL);
+  if(!s->solver)
+    return false;
+
+  formula_feed(f, s->solver);
+
+  // The seeding process now owns the clauses.
+  s->f = *f;
+  free(s->f.lits);
+  s->f.lits = NULL;
+  s->f.lits_size = 0;
+  s->f.lits_capacity = 0;
+  s->f.keep_clauses = false;
+  formula_init(f, true);
+  return true;
+}
+
+/* Returns a busy snapshot for the request, loading a new one if there is no
+ * idle one. */
+static snapshot*
+acquire_snapshot(request* r, FILE* out) {
+  struct stat st;
+  if(stat(r->formula, &st) == -1) {
+    fprintf(out, "error Cannot stat \"%s\": %s\n", r->formula, strerror(errno));
+    return NULL;
+  }
+
+  size_t prefixdepth = r->cubes.max_cube_size;
+  if(r->intsplits.size > 0) {
+    size_t l = intsplits_summed_length(&r->intsplits, r->intsplits.size);
+    if(l > prefixdepth)
+      prefixdepth = l;
+  }
+
+  formula f;
+  formula_init(&f, true);
+  bool parsed = false;
+  uint64_t hash;
+
+  pthread_mutex_lock(&mutex);
+  bool known = known_hash(r->formula, &st, &hash);
+  snapshot* s = known ? find_snapshot(r->argv, hash, prefixdepth) : NULL;
+  pthread_mutex_unlock(&mutex);
+
+  if(!s) {
+    if(!formula_parse(&f, r->formula, r->strictness)) {
+      fprintf(out, "error Could not parse formula \"%s\"\n", r->formula);
+      formula_release(&f);
+      return NULL;
+    }
+    parsed = true;
+    hash = formula_hash(&f);
+
+    pthread_mutex_lock(&mutex);
+    remember_hash(r->formula, &st, hash);
+    s = find_snapshot(r->argv, hash, prefixdepth);
+    if(!s) {
+      s = calloc(1, sizeof(snapshot));
+      s->argv = calloc(r->argc + 1, sizeof(char*));
+      for(size_t i = 0; i < r->argc; ++i)
+        s->argv[i] = strdup(r->argv[i]);
+      s->hash = hash;
+      s->prefixdepth = prefixdepth;
+      s->busy = true;
+
+      snapshots =
+        realloc(snapshots, (snapshots_size + 1) * sizeof(snapshot*));
+      snapshots[snapshots_size++] = s;
+      pthread_mutex_unlock(&mutex);
+
+      bool loaded = snapshot_load(s, &f);
+      formula_release(&f);
+
+      if(!loaded) {
+        pthread_mutex_lock(&mutex);
+        snapshot_unlink(s);
+        pthread_mutex_unlock(&mutex);
+        fprintf(out, "error Could not initialize solver %s\n", r->argv[0]);
+        snapshot_put(s);
+        return NULL;
+      }
+
+      // Loading may have pushed memory over the budget.
+      evict();
+      return s;
+    }
+    pthread_mutex_unlock(&mutex);
+  }
+
+  if(parsed)
+    formula_release(&f);
+
+  qdbg("Reusing snapshot %016llx", (unsigned long long)s->hash);
+  return s;
+}
+
+static int
+solve_request(request* r, snapshot* s, FILE* out) {
+  if(r->intsplits.size > 0) {
+    if(!s->f.quantifiers) {
+      fprintf(out,
+              "error Formula \"%s\" does not have quantifiers, but needing "
+              "quantifiers for intsplits!\n",
+              r->formula);
+      return EXIT_FAILURE;
+    }
+    if(!intsplits_inflate(
+         &r->intsplits, s->f.quantifiers, s->f.quantifiers_size, &r->cubes)) {
+      fprintf(out, "error Could not inflate intsplits\n");
+      return EXIT_FAILURE;
+    }
+  }
+  if(r->cubes.count == 0)
+    cubes_add(&r->cubes, 0);
+
+  int* end = r->cubes.lits + r->cubes.size;
+  int *lit = r->cubes.lits, *cube = r->cubes.lits;
+  int cube_id = 0;
+
+  for(; lit != end; ++lit) {
+    bool selected = r->selected_cube < 0 || cube_id == r->selected_cube;
+    if(*lit != 0) {
+      if(!selected)
+        continue;
+      if(ABS(*lit) > s->f.varcount) {
+        fprintf(out,
+                "error Cannot assume %d, as it is larger than the variable "
+                "count %zu!\n",
+                *lit,
+                s->f.varcount);
+        quapi_reset_assumptions(s->solver);
+        return EXIT_FAILURE;
+      }
+      if(!quapi_assume(s->solver, *lit)) {
+        fprintf(out, "error quapi_assume(solver, %d) returned false!\n", *lit);
+        quapi_reset_assumptions(s->solver);
+        return EXIT_FAILURE;
+      }
+      continue;
+    }
+
+    if(selected) {
+      double before_time = tai_time();
+      int result = quapi_solve(s->solver);
+      double after_time = tai_time();
+
+      fprintf(out,
+              "result %d %.9f %d",
+              cube_id,
+              after_time - before_time,
+              result);
+      for(int* l = cube; *l != 0; ++l)
+        fprintf(out, " %d", *l);
+      fprintf(out, " 0\n");
+      if(fflush(out) != 0) {
+        qdbg("Client went away, stopping request.");
+        return EXIT_FAILURE;
+      }
+    }
+
+    cube = lit + 1;
+    ++cube_id;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+static bool
+read_request(FILE* in, FILE* out, request* r) {
+  char* line = NULL;
+  size_t line_capacity = 0;
+  ssize_t len;
+  bool ok = false;
+
+  while((len = getline(&line, &line_capacity, in)) != -1) {
+    if(len > 0 && line[len - 1] == '\n')
+      line[--len] = '\0';
+
+    char* arg = strchr(line, ' ');
+    if(arg)
+      *arg++ = '\0';
+    else
+      arg = line + len;
+
+    if(strcmp(line, "quapid") == 0) {
+      if(atoi(arg) != QUAPID_PROTOCOL_VERSION) {
+        fprintf(out,
+                "error Protocol version %s is not supported, expected %d\n",
+                arg,
+                QUAPID_PROTOCOL_VERSION);
+        break;
+      }
+    } else if(strcmp(line, "formula") == 0) {
+      free(r->formula);
+      r->formula = strdup(arg);
+    } else if(strcmp(line, "strictness") == 0) {
+      r->strictness = atoi(arg);
+    } else if(strcmp(line, "arg") == 0) {
+      r->argv = realloc(r->argv, (r->argc + 2) * sizeof(char*));
+      r->argv[r->argc++] = strdup(arg);
+      r->argv[r->argc] = NULL;
+    } else if(strcmp(line, "cube") == 0) {
+      const char* rest = daemon_parse_cube(arg, &r->cubes);
+      if(!rest || *rest != '\0') {
+        fprintf(out, "error Malformed cube: %s\n", arg);
+        break;
+      }
+    } else if(strcmp(line, "intsplit") == 0) {
+      if(!intsplits_add(&r->intsplits, atoi(arg))) {
+        fprintf(out, "error Intsplits need to be > 0!\n");
+        break;
+      }
+    } else if(strcmp(line, "select") == 0) {
+      r->selected_cube = atoi(arg);
+    } else if(strcmp(line, "solve") == 0) {
+      ok = r->formula && r->argc > 0;
+      if(!ok)
+        fprintf(out, "error Request requires a formula and a solver\n");
+      break;
+    } else {
+      fprintf(out, "error Unknown command \"%s\"\n", line);
+      break;
+    }
+  }
+
+  free(line);
+  return ok;
+}
+
+static void
+request_release(request* r) {
+  free(r->formula);
+  for(size_t i = 0; i < r->argc; ++i)
+    free(r->argv[i]);
+  free(r->argv);
+  cubes_release(&r->cubes);
+  intsplits_release(&r->intsplits);
+}
+
+static void*
+client_thread(void* arg) {
+  int fd = (intptr_t)arg;
+  FILE* in = fdopen(fd, "r");
+  FILE* out = fdopen(dup(fd), "w");
+  if(!in || !out) {
+    if(in)
+      fclose(in);
+    else
+      close(fd);
+    return NULL;
+  }
+
+  request r;
+  memset(&r, 0, sizeof(r));
+  r.strictness = NORMAL_PARSING;
+  r.selected_cube = -1;
+
+  int exit_code = EXIT_FAILURE;
+  if(read_request(in, out, &r)) {
+    snapshot* s = acquire_snapshot(&r, out);
+    if(s) {
+      exit_code = solve_request(&r, s, out);
+      snapshot_put(s);
+      evict();
+    }
+  }
+
+  fprintf(out, "done %d\n", exit_code);
+  request_release(&r);
+  fclose(out);
+  fclose(in);
+  return NULL;
+}
+
+static int
+listen_on(const char* path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if(strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Socket path \"%s\" is too long!\n", path);
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if(fd == -1) {
+    fprintf(stderr, "Could not create socket: %s\n", strerror(errno));
+    return -1;
+  }
+
+  // A socket file without a listening daemon is left over from an earlier run.
+  if(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+    fprintf(stderr, "Another quapid is already listening on \"%s\"!\n", path);
+    close(fd);
+    return -1;
+  }
+  unlink(path);
+
+  if(bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1 ||
+     listen(fd, SOMAXCONN) == -1) {
+    fprintf(stderr, "Could not listen on \"%s\": %s\n", path, strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+int
+main(int argc, char* argv[]) {
+  if(argc < 2 || strcmp(argv[1], "-h") == 0 ||
+     strcmp(argv[1], "--help") == 0) {
+    help();
+    return argc < 2 ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+
+  const char* socket_path = argv[1];
+  ++argv;
+  --argc;
+
+  int c;
+  while((c = getopt(argc, argv, "vdtm:")) != -1)
+    switch(c) {
+      case 'v':
+        option_verbose = true;
+        break;
+      case 'd':
+        setenv("QUAPI_DEBUG", "1", 1);
+        break;
+      case 't':
+        setenv("QUAPI_TRACE", "1", 1);
+        break;
+      case 'm':
+        memory_budget = strtoull(optarg, NULL, 10) * 1024 * 1024;
+        break;
+      default:
+        help();
+        return EXIT_FAILURE;
+    }
+
+  signal(SIGPIPE, SIG_IGN);
+
+  // Handle termination in the accept loop, all threads inherit the mask.
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  sigaddset(&mask, SIGHUP);
+  pthread_sigmask(SIG_BLOCK, &mask, NULL);
+  int sfd = signalfd(-1, &mask, SFD_CLOEXEC);
+
+  int lfd = listen_on(socket_path);
+  if(lfd == -1 || sfd == -1)
+    return EXIT_FAILURE;
+
+  qdbg("Listening on \"%s\" with a memory budget of %zu MiB",
+       socket_path,
+       memory_budget / 1024 / 1024);
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  struct pollfd fds[2] = { { .fd = lfd, .events = POLLIN },
+                           { .fd = sfd, .events = POLLIN } };
+  for(;;) {
+    if(poll(fds, 2, -1) == -1) {
+      if(errno == EINTR)
+        continue;
+      fprintf(stderr, "poll failed: %s\n", strerror(errno));
+      break;
+    }
+    if(fds[1].revents)
+      break;
+    if(fds[0].revents & POLLIN) {
+      int cfd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+      if(cfd == -1)
+        continue;
+      pthread_t t;
+      if(pthread_create(&t, &attr, &client_thread, (void*)(intptr_t)cfd) != 0)
+        close(cfd);
+    }
+  }
+
+  qdbg("Shutting down.");
+  close(lfd);
+  unlink(socket_path);
+
+  // Snapshots in use by clients are left to the OS, idle ones are released
+  // cleanly so that their seeding processes terminate.
+  pthread_mutex_lock(&mutex);
+  for(size_t i = 0; i < snapshots_size; ++i) {
+    snapshot* s = snapshots[i];
+    if(!s->busy) {
+      quapi_release(s->solver);
+      s->solver = NULL;
+    }
+  }
+  pthread_mutex_unlock(&mutex);
+
+  return EXIT_SUCCESS;
+}
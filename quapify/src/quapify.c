@@ -1,5 +1,6 @@
 #include <ctype.h>
 #include <errno.h>
+#include <getopt.h>
 #include <limits.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -10,19 +11,20 @@
 
 #include <quapi/quapi.h>
 
+#include "batch.h"
+#include "cubes.h"
+#include "daemon.h"
+#include "estimate.h"
+#include "file.h"
+#include "formula.h"
+#include "output.h"
 #include "parse.h"
+#include "progress.h"
+#include "symmetry.h"
 #include "utilities.h"
 
 bool option_verbose = false;
 
-static quapi_solver* solver = NULL;
-static size_t varcount = 0;
-static size_t clausecount = 0;
-
-static int* quantifiers = NULL;
-static size_t quantifiers_size = 0;
-static size_t quantifiers_capacity = 0;
-
 static void
 print_ydbg(const char* fmt, va_list* ap) {
   fputs("[QUAPIFY] ", stderr);
@@ -41,40 +43,6 @@ ydbg(const char* fmt, ...) {
   va_end(ap);
 }
 
-void
-add_quantifier(int lit) {
-  if(!solver) {
-    if(quantifiers_size == quantifiers_capacity) {
-      if(quantifiers_capacity == 0) {
-        quantifiers_capacity = 8;
-      } else {
-        quantifiers_capacity *= 2;
-      }
-
-      quantifiers = realloc(quantifiers, quantifiers_capacity * sizeof(int));
-    }
-
-    quantifiers[quantifiers_size++] = lit;
-  } else {
-    quapi_quantify(solver, lit);
-  }
-}
-
-void
-add_lit(int lit) {
-  if(!solver) {
-    if(lit == 0) {
-      ++clausecount;
-    } else {
-      int abslit = ABS(lit);
-      if(abslit > varcount)
-        varcount = abslit;
-    }
-  } else {
-    quapi_add(solver, lit);
-  }
-}
-
 static void
 help() {
   fprintf(stderr,
@@ -90,6 +58,12 @@ help() {
   fprintf(stderr, "USAGE:\n");
   fprintf(stderr,
           "  quapify <input formula> [OPTIONS] -- solver [solver args]:\n");
+  fprintf(stderr,
+          "  quapify --batch <manifest.jsonl> [OPTIONS] [-- solver [solver "
+          "args]]:\n");
+  fprintf(stderr,
+          "  quapify --daemon <socket> <input formula> [OPTIONS] -- solver "
+          "[solver args]:\n");
   fprintf(stderr, "OPTIONS:\n");
   fprintf(stderr, "  -p\t\tprint whole assumption, not just its index\n");
   fprintf(stderr, "  -v\t\tverbose output\n");
@@ -107,252 +81,90 @@ help() {
   fprintf(stderr, "  -W\t\twrap assumption in \"\"\n");
   fprintf(stderr,
           "  -g\t\tjust generate a list of assumptions without solving\n");
+  fprintf(stderr,
+          "  -j <int>\tsolver slots in batch mode (default: online CPUs)\n");
+  fprintf(stderr,
+          "  --estimate <int>\n\t\tsolve a stratified sample of this many "
+          "cubes and estimate\n\t\tthe total cube time and the makespan "
+          "with -j slots\n");
+  fprintf(stderr,
+          "  --progress[=<seconds>]\n\t\tprint a status line to stderr "
+          "every <seconds> (default 1)\n");
+  fprintf(stderr,
+          "  --metrics <file>\n\t\trewrite <file> with Prometheus metrics "
+          "on every status update\n");
+  fprintf(stderr,
+          "  --symmetry <file>\n\t\tread symmetry generators (cycle "
+          "notation) and only solve one\n\t\tcube per orbit, copying "
+          "its result to the others\n");
+  fprintf(stderr,
+          "  --detect-symmetry\n\t\tdetect interchangeable cube variables "
+          "from the clauses\n");
+  fprintf(stderr,
+          "  --timeout <seconds>\n\t\tstop every cube after <seconds> and "
+          "report it as unknown,\n\t\talso the default for batch "
+          "entries\n");
+  fprintf(stderr,
+          "  --rusage\tadd CPU time, max RSS, page fault and context switch "
+          "columns\n\t\tof the solver child after the result (\"-\" if "
+          "unknown)\n");
+  fprintf(stderr,
+          "  --perf\tadd cycle, instruction, cache miss and page fault "
+          "columns of\n\t\tthe solver child, counted with perf_event_open "
+          "(\"-\" if not\n\t\tpermitted)\n");
   fprintf(stderr, "OUTPUT FORMAT:\n");
   fprintf(stderr,
           "  Space separated fields: SOLVERSTATUS SOLVETIME[s] ASSUMPTION\n");
+  fprintf(stderr,
+          "  Batch mode prefixes every line with the name of the entry.\n");
+  fprintf(stderr, "BATCH MANIFEST (one JSON object per line):\n");
+  fprintf(stderr,
+          "  {\"name\": \"n\", \"formula\": \"f.qdimacs\", \"intsplits\": [3], "
+          "\"cubes\": [[1, 2]],\n   \"solver\": [\"./solver\", \"--arg\"], "
+          "\"priority\": 0, \"slots\": 2, \"timeout\": 10}\n");
   fprintf(stderr, "EXAMPLES:\n");
   fprintf(stderr, "  ./quapify input.cnf -a 1 -a -1 -- ./solver --cnf\n");
   fprintf(stderr, "  ./quapify input.cnf -a 1 0 -1 0 -- ./solver --cnf\n");
+  fprintf(stderr, "  ./quapify --batch manifest.jsonl -j 8 -- ./solver\n");
+  fprintf(stderr,
+          "  ./quapify --daemon /tmp/quapid.sock input.cnf -i 4 -I 3 -- "
+          "./solver\n");
+  fprintf(stderr, "DAEMON MODE:\n");
+  fprintf(stderr,
+          "  Solves on warm solver snapshots kept by a running quapid, which "
+          "only\n  forks per cube instead of parsing the formula again.\n");
 }
 
 struct config {
-  size_t assumptions_count;
-  size_t assumptions_max_assumption_size;
-  size_t assumptions_size;
-  size_t assumptions_capacity;
-  int* assumptions;
-
-  size_t intsplits_highest_intsplit;
-  size_t intsplits_size;
-  size_t intsplits_capacity;
-  int* intsplits;
-
-  bool print_assumptions;
-  bool stringify_result;
+  cubes assumptions;
+  intsplits intsplits;
+
   bool print_header;
-  bool wrap_assumption;
   bool generate_assumption_list;
   int selected_assumption;
+  output_options output;
 
   strictness strictness;
 
-  const char* input;
-  const char* solver;
-  char** solver_argv;
-};
-
-static inline void
-add_to_assumptions(struct config* cfg, int assumption) {
-  static size_t current_assumption_size = 0;
-  if(assumption == 0) {
-    if(current_assumption_size > cfg->assumptions_max_assumption_size) {
-      cfg->assumptions_max_assumption_size = current_assumption_size;
-    }
-    ++cfg->assumptions_count;
-    current_assumption_size = 0;
-  } else {
-    ++current_assumption_size;
-  }
-
-  if(cfg->assumptions_size == cfg->assumptions_capacity) {
-    if(cfg->assumptions_capacity == 0) {
-      cfg->assumptions_capacity = 16;
-    } else {
-      cfg->assumptions_capacity *= 2;
-    }
-    cfg->assumptions =
-      realloc(cfg->assumptions, sizeof(int) * cfg->assumptions_capacity);
-  }
-  cfg->assumptions[cfg->assumptions_size++] = assumption;
-}
-
-static inline void
-add_intsplit_nesting_level(struct config* cfg, int intsplit) {
-  if(intsplit <= 0) {
-    err("Intsplits need to be > 0! Ignoring the split %d.", intsplit);
-    return;
-  }
-
-  if(intsplit > cfg->intsplits_highest_intsplit)
-    cfg->intsplits_highest_intsplit = intsplit;
-
-  if(cfg->intsplits_size == cfg->intsplits_capacity) {
-    if(cfg->intsplits_capacity == 0) {
-      cfg->intsplits_capacity = 8;
-    } else {
-      cfg->intsplits_capacity *= 2;
-    }
-    cfg->intsplits =
-      realloc(cfg->intsplits, cfg->intsplits_capacity * sizeof(int));
-  }
-
-  cfg->intsplits[cfg->intsplits_size++] = intsplit;
-}
+  const char* batch;
+  size_t slots;
 
-// https://stackoverflow.com/a/15327567
-static inline int
-ceil_log2(unsigned long long x) {
-  static const unsigned long long t[6] = {
-    0xFFFFFFFF00000000ull, 0x00000000FFFF0000ull, 0x000000000000FF00ull,
-    0x00000000000000F0ull, 0x000000000000000Cull, 0x0000000000000002ull
-  };
+  const char* daemon;
 
-  int y = (((x & (x - 1)) == 0) ? 0 : 1);
-  int j = 32;
-  int i;
+  size_t estimate;
+  progress_options progress;
+  progress* running_progress;
 
-  for(i = 0; i < 6; i++) {
-    int k = (((x & t[i]) == 0) ? 0 : j);
-    y += k;
-    x >>= k;
-    j >>= 1;
-  }
+  const char* symmetry_file;
+  bool detect_symmetry;
 
-  return y;
-}
+  double timeout;
 
-unsigned char
-get_bit(unsigned int n, unsigned int b) {
-  if(b < 0 || b >= sizeof(int) * CHAR_BIT)
-    return -1;
-  return (n >> b) & 1;
+  const char* input;
+  const char* solver;
+  char** solver_argv;
 };
 
-static size_t
-intsplits_current_length(struct config* cfg, size_t index) {
-  assert(index < cfg->intsplits_size);
-  int intSplit = cfg->intsplits[index];
-  if(intSplit != 0) {
-    return ceil_log2(intSplit);
-  }
-  return 1;
-}
-
-static size_t
-intsplits_summed_length(struct config* cfg, size_t index) {
-  size_t l = 0;
-  for(size_t i = 0; i < index; ++i) {
-    l += intsplits_current_length(cfg, i);
-  }
-  return l;
-}
-
-static bool
-intsplit_state_to_assumption(struct config* cfg,
-                             int* state,
-                             size_t state_size) {
-  const size_t l = intsplits_summed_length(cfg, state_size);
-  if(l > quantifiers_size) {
-    fprintf(stderr,
-            "Error: Intsplits too big! Length of %zu surpasses quantifier "
-            "count %zu!\n",
-            l,
-            quantifiers_size);
-    return false;
-  }
-
-  int assumption[l];
-  memcpy(assumption, quantifiers, l * sizeof(int));
-
-  // Check for validity of intsplit (not over multiple different quantifiers!),
-  // convert to absolutes and set the sign to the correct bit for the intsplit.
-  size_t assumption_i = 0;
-  for(size_t i = 0; i < state_size; ++i) {
-    size_t cl = intsplits_current_length(cfg, i);
-    for(size_t bit = cl - 1, li = 0; li < cl; ++assumption_i, --bit, ++li) {
-      if(li < cl - 1 &&
-         (quantifiers[assumption_i] ^ quantifiers[assumption_i + 1]) < 0) {
-        fprintf(stderr,
-                "Error: Intsplit at index %zu (%d) spanning multiple different "
-                "quantifier "
-                "blocks! (sign change from quantifier %zu (%d) to %zu (%d)).\n",
-                i,
-                cfg->intsplits[i],
-                assumption_i,
-                quantifiers[assumption_i],
-                assumption_i + 1,
-                quantifiers[assumption_i + 1]);
-        return false;
-      }
-
-      if(get_bit(state[i], bit) == 0)
-        assumption[assumption_i] = -abs(assumption[assumption_i]);
-      else
-        assumption[assumption_i] = abs(assumption[assumption_i]);
-    }
-  }
-
-  for(size_t i = 0; i < l; ++i) {
-    add_to_assumptions(cfg, assumption[i]);
-  }
-  add_to_assumptions(cfg, 0);
-
-  return true;
-}
-
-static bool
-inflate_intsplits(struct config* cfg) {
-  assert(quantifiers);
-  assert(cfg->intsplits);
-
-  // This instplit-implementation is inspired from Paracooba and tries to
-  // reinterpret the first few quantifiers as integers. This is very nice for
-  // game-playing and planning.
-
-  // What this means in practice:
-  // Let's have alternating prefix: ForAll 1 2, Exists 3 4, ...
-  // Intsplit -i 3 -i 3 would generate these assumptions:
-  // -1 -2 -3 -4   i.e. 0 0
-  // -1 -2 -3 4    i.e. 0 1
-  // -1 -2 3 -4    i.e. 0 2
-  // -1 2 -3 -4    i.e. 1 0
-  // ...
-
-  int intsplits_state[cfg->intsplits_size];
-  memset(intsplits_state, 0, sizeof(intsplits_state));
-  int last = cfg->intsplits_size - 1;
-
-  while(intsplits_state[0] <= cfg->intsplits[0] - 1) {
-    if(!intsplit_state_to_assumption(cfg, intsplits_state, cfg->intsplits_size))
-      return false;
-
-    ++intsplits_state[last];
-    for(int d = last;
-        intsplits_state[d] == cfg->intsplits[d] + (d == 0 ? 1 : 0);
-        --d) {
-      intsplits_state[d] = 0;
-      if(d > 0) {
-        ++intsplits_state[d - 1];
-      }
-    }
-  }
-
-  return true;
-}
-
-static int*
-print_assumption(FILE* f, int* assumption) {
-  bool first = true;
-  while(*assumption != 0) {
-    if(first)
-      first = false;
-    else
-      fprintf(f, " ");
-
-    fprintf(f, "%d", *(assumption++));
-  }
-  return assumption + 1;
-}
-
-static void
-print_assumptions(FILE* f, int* assumptions, size_t length) {
-  int* end = assumptions + length;
-  while(assumptions != end) {
-    assumptions = print_assumption(f, assumptions);
-    fprintf(f, "\n");
-  }
-}
-
 static struct config
 parse_cli(int argc, char* argv[]) {
   struct config cfg;
@@ -361,6 +173,9 @@ parse_cli(int argc, char* argv[]) {
 
   cfg.strictness = NORMAL_PARSING;
 
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  cfg.slots = cpus > 0 ? cpus : 1;
+
   int c;
 
   if(argc >= 2) {
@@ -370,20 +185,59 @@ parse_cli(int argc, char* argv[]) {
       exit(EXIT_SUCCESS);
     }
 
-    cfg.input = argv[1];
-    ++argv;
-    --argc;
+    if(strcmp(argv[1], "--batch") == 0) {
+      if(argc < 3) {
+        fprintf(stderr, "--batch requires a manifest file!\n");
+        exit(EXIT_FAILURE);
+      }
+      cfg.batch = argv[2];
+      argv += 2;
+      argc -= 2;
 
-    if(!kissat_file_exists(cfg.input)) {
-      fprintf(
-        stderr,
-        "File \"%s\" does not exist! First parameter must be input file.\n",
-        cfg.input);
-      exit(EXIT_FAILURE);
+      if(strcmp(cfg.batch, "-") != 0 && !kissat_file_exists(cfg.batch)) {
+        fprintf(stderr, "Manifest \"%s\" does not exist!\n", cfg.batch);
+        exit(EXIT_FAILURE);
+      }
+    } else {
+      if(strcmp(argv[1], "--daemon") == 0) {
+        if(argc < 4) {
+          fprintf(stderr,
+                  "--daemon requires a socket and an input formula!\n");
+          exit(EXIT_FAILURE);
+        }
+        cfg.daemon = argv[2];
+        argv += 2;
+        argc -= 2;
+      }
+
+      cfg.input = argv[1];
+      ++argv;
+      --argc;
+
+      if(!kissat_file_exists(cfg.input)) {
+        fprintf(
+          stderr,
+          "File \"%s\" does not exist! First parameter must be input file.\n",
+          cfg.input);
+        exit(EXIT_FAILURE);
+      }
     }
   }
 
-  while((c = getopt(argc, argv, "dtrgsSHWvph:a:i:I:")) != -1)
+  static const struct option long_options[] = {
+    { "estimate", required_argument, NULL, 'E' },
+    { "progress", optional_argument, NULL, 'P' },
+    { "metrics", required_argument, NULL, 'M' },
+    { "symmetry", required_argument, NULL, 'Y' },
+    { "detect-symmetry", no_argument, NULL, 'Z' },
+    { "timeout", required_argument, NULL, 'O' },
+    { "rusage", no_argument, NULL, 'R' },
+    { "perf", no_argument, NULL, 'C' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  while((c = getopt_long(
+           argc, argv, "dtrgsSHWvph:a:i:I:j:", long_options, NULL)) != -1)
     switch(c) {
       case 'a': {
         if(strcmp(optarg, "--") == 0) {
@@ -409,10 +263,10 @@ parse_cli(int argc, char* argv[]) {
               argv[optind]);
             exit(EXIT_FAILURE);
           }
-          add_to_assumptions(&cfg, l);
+          cubes_add(&cfg.assumptions, l);
         }
         if(l != 0) {
-          add_to_assumptions(&cfg, 0);
+          cubes_add(&cfg.assumptions, 0);
         }
         break;
       }
@@ -429,7 +283,7 @@ parse_cli(int argc, char* argv[]) {
         setenv("QUAPI_TRACE", "1", 1);
         break;
       case 'p':
-        cfg.print_assumptions = true;
+        cfg.output.print_assumptions = true;
         break;
       case 'g':
         cfg.generate_assumption_list = true;
@@ -441,20 +295,65 @@ parse_cli(int argc, char* argv[]) {
         cfg.strictness = PEDANTIC_PARSING;
         break;
       case 'S':
-        cfg.stringify_result = true;
+        cfg.output.stringify_result = true;
         break;
       case 'H':
         cfg.print_header = true;
         break;
       case 'W':
-        cfg.wrap_assumption = true;
+        cfg.output.wrap_assumption = true;
         break;
-      case 'i':
-        add_intsplit_nesting_level(&cfg, atoi(optarg));
+      case 'i': {
+        int split = atoi(optarg);
+        if(!intsplits_add(&cfg.intsplits, split))
+          err("Intsplits need to be > 0! Ignoring the split %d.", split);
         break;
+      }
       case 'I':
         cfg.selected_assumption = atoi(optarg);
         break;
+      case 'j':
+        if(atoi(optarg) < 1) {
+          fprintf(stderr, "-j requires at least 1 solver slot!\n");
+          exit(EXIT_FAILURE);
+        }
+        cfg.slots = atoi(optarg);
+        break;
+      case 'E':
+        if(atoi(optarg) < 1) {
+          fprintf(stderr, "--estimate requires at least 1 sample!\n");
+          exit(EXIT_FAILURE);
+        }
+        cfg.estimate = atoi(optarg);
+        break;
+      case 'P':
+        cfg.progress.print = true;
+        if(optarg)
+          cfg.progress.interval = atof(optarg);
+        break;
+      case 'M':
+        cfg.progress.metrics_path = optarg;
+        break;
+      case 'Y':
+        cfg.symmetry_file = optarg;
+        break;
+      case 'Z':
+        cfg.detect_symmetry = true;
+        break;
+      case 'O':
+        cfg.timeout = atof(optarg);
+        if(cfg.timeout <= 0) {
+          fprintf(stderr, "--timeout requires a positive number of seconds!\n");
+          exit(EXIT_FAILURE);
+        }
+        break;
+      case 'R':
+        cfg.output.print_rusage = true;
+        break;
+      case 'C':
+        cfg.output.print_perf = true;
+        setenv("QUAPI_PERF_COUNTERS", "1", 1);
+        break;
       case '?':
         if(optopt == 'a')
           fprintf(stderr, "Option -%c requires argument.\n", optopt);
@@ -467,8 +366,16 @@ parse_cli(int argc, char* argv[]) {
         exit(EXIT_FAILURE);
     }
 
-  if(cfg.assumptions_count == 0 && cfg.intsplits_size == 0) {
-    add_to_assumptions(&cfg, 0);
+  if(cfg.batch) {
+    if(optind < argc) {
+      cfg.solver = argv[optind];
+      cfg.solver_argv = &argv[optind + 1];
+    }
+    return cfg;
+  }
+
+  if(cfg.assumptions.count == 0 && cfg.intsplits.size == 0) {
+    cubes_add(&cfg.assumptions, 0);
   }
 
   if(!cfg.generate_assumption_list && optind >= argc) {
@@ -482,58 +389,186 @@ parse_cli(int argc, char* argv[]) {
   return cfg;
 }
 
-static bool
-run_kissat_parser(struct config* cfg) {
-  file f;
+static int
+run_batch(struct config* cfg) {
+  batch_options opts = { .slots = cfg->slots,
+                         .print_header = cfg->print_header,
+                         .output = cfg->output,
+                         .strictness = cfg->strictness,
+                         .progress = cfg->progress,
+                         .default_timeout = cfg->timeout,
+                         .default_solver = cfg->solver,
+                         .default_solver_argv = cfg->solver_argv };
+  return batch_run(cfg->batch, &opts);
+}
 
-  if(strcmp(cfg->input, "-") == 0) {
-    kissat_read_already_open_file(&f, stdin, "/dev/stdin");
-  } else {
-    if(!kissat_open_to_read_file(&f, cfg->input)) {
+static int
+run_daemon(struct config* cfg) {
+  daemon_request req = { .formula = cfg->input,
+                         .strictness = cfg->strictness,
+                         .solver = cfg->solver,
+                         .solver_argv = cfg->solver_argv,
+                         .cubes = &cfg->assumptions,
+                         .intsplits = &cfg->intsplits,
+                         .selected_cube = cfg->selected_assumption };
+  return daemon_client_run(cfg->daemon, &req, &cfg->output, cfg->print_header);
+}
+
+static bool
+solve_cube(struct config* cfg,
+           quapi_solver* solver,
+           size_t varcount,
+           int assumption_id,
+           int* cube,
+           double* solve_time,
+           int* solve_result) {
+  for(int* ass = cube; *ass != 0; ++ass) {
+    if(ABS(*ass) > varcount) {
       fprintf(
-        stderr, "Error: Kissat reader could not open file \"%s\"!", cfg->input);
+        stderr,
+        "Cannot assume %d, as it is larger than the variable count %zu!\n",
+        *ass,
+        varcount);
+      return false;
+    }
+    if(!quapi_assume(solver, *ass)) {
+      fprintf(stderr, "quapi_assume(solver, %d) returned false!\n", *ass);
       return false;
     }
   }
 
-  uint64_t lineno = 0;
-  int max_var;
-  const char* result =
-    kissat_parse_dimacs(cfg->strictness, &f, &lineno, &max_var);
+  progress_cube_started(cfg->running_progress);
 
-  if(result) {
-    fprintf(stderr, "Error: Kissat reader returned message: %s", result);
-    return false;
-  }
+  double before_time = tai_time();
+  int result = quapi_solve(solver);
+  double after_time = tai_time();
+
+  if(result == QUAPI_TIMEOUT)
+    result = 0;
+
+  progress_cube_finished(
+    cfg->running_progress, result, after_time - before_time);
+
+  quapi_solve_stats stats;
+  output_result_line(stdout,
+                     &cfg->output,
+                     NULL,
+                     after_time - before_time,
+                     result,
+                     output_last_stats(solver, &stats),
+                     assumption_id,
+                     cube);
+
+  if(solve_time)
+    *solve_time = after_time - before_time;
+  if(solve_result)
+    *solve_result = result;
 
   return true;
 }
 
-static double
-tai_time(void) {
-  double res = -1;
-  struct timespec ts;
-  if(!clock_gettime(CLOCK_TAI, &ts)) {
-    res = 1e-9 * ts.tv_nsec;
-    res += ts.tv_sec;
+static size_t*
+compute_representatives(struct config* cfg, formula* f) {
+  symmetry sym;
+  memset(&sym, 0, sizeof(sym));
+
+  if(cfg->symmetry_file &&
+     !symmetry_read(&sym, cfg->symmetry_file, f->varcount)) {
+    symmetry_release(&sym);
+    return NULL;
+  }
+  if(cfg->detect_symmetry) {
+    size_t detected = symmetry_detect(&sym, f, &cfg->assumptions);
+    ydbg("Detected %zu interchangeable pairs of cube variables", detected);
+  }
+
+  size_t* representatives = symmetry_representatives(&sym, &cfg->assumptions);
+
+  size_t orbits = 0;
+  for(size_t i = 0; i < cfg->assumptions.count; ++i)
+    orbits += representatives[i] == i;
+  ydbg("%zu generators group %zu cubes into %zu orbits",
+       sym.generators_size,
+       cfg->assumptions.count,
+       orbits);
+
+  symmetry_release(&sym);
+  return representatives;
+}
+
+static bool
+run_estimate(struct config* cfg,
+             quapi_solver* solver,
+             size_t varcount,
+             size_t explicit_cubes) {
+  // There may be millions of cubes, too many for the stack.
+  int** cubes = malloc(cfg->assumptions.count * sizeof(int*));
+  if(!cubes) {
+    fprintf(stderr, "Could not allocate the cube index for --estimate!\n");
+    return false;
+  }
+  int* cube = cfg->assumptions.lits;
+  for(size_t i = 0; i < cfg->assumptions.count; ++i) {
+    cubes[i] = cube;
+    while(*cube != 0)
+      ++cube;
+    ++cube;
+  }
+
+  estimate e;
+  estimate_init(&e,
+                cfg->assumptions.count,
+                explicit_cubes,
+                &cfg->intsplits,
+                cfg->estimate,
+                time(NULL) ^ getpid());
+
+  bool ok = true;
+  for(size_t h = 0; ok && h < e.strata_size; ++h) {
+    const estimate_stratum* s = &e.strata[h];
+    for(size_t i = 0; ok && i < s->samples_size; ++i) {
+      size_t id = s->samples[i];
+      double solve_time;
+      ok = solve_cube(
+        cfg, solver, varcount, id, cubes[id], &solve_time, NULL);
+      if(ok)
+        estimate_record(&e, h, solve_time);
+    }
   }
-  return res;
+
+  estimate_report(stdout, &e, cfg->slots);
+  estimate_release(&e);
+  free(cubes);
+  return ok;
 }
 
 int
 main(int argc, char* argv[]) {
   struct config cfg = parse_cli(argc, argv);
 
+  if(cfg.batch)
+    return run_batch(&cfg);
+
+  if(cfg.daemon && !cfg.generate_assumption_list)
+    return run_daemon(&cfg);
+
   // Run through once. Both to check if the file is okay and to only get
   // information at the beginning. We don't want to save the whole formula to
   // RAM in Quapify.
+  formula f;
+  formula_init(&f, cfg.detect_symmetry);
 
-  if(!run_kissat_parser(&cfg))
+  if(!formula_parse(&f, cfg.input, cfg.strictness))
     return EXIT_FAILURE;
 
-  if(cfg.intsplits_size > 0) {
-    if(quantifiers) {
-      if(!inflate_intsplits(&cfg)) {
+  const size_t explicit_cubes = cfg.assumptions.count;
+
+  if(cfg.intsplits.size > 0) {
+    if(f.quantifiers) {
+      if(!intsplits_inflate(&cfg.intsplits,
+                            f.quantifiers,
+                            f.quantifiers_size,
+                            &cfg.assumptions)) {
         return EXIT_FAILURE;
       }
     } else {
@@ -546,17 +581,17 @@ main(int argc, char* argv[]) {
   }
 
   if(cfg.generate_assumption_list) {
-    print_assumptions(stdout, cfg.assumptions, cfg.assumptions_size);
+    cubes_print(stdout, &cfg.assumptions);
     return EXIT_SUCCESS;
   }
 
   if(option_verbose) {
-    if(cfg.assumptions_size) {
+    if(cfg.assumptions.size) {
       ydbg("Assumptions:");
-      print_assumptions(stderr, cfg.assumptions, cfg.assumptions_size);
+      cubes_print(stderr, &cfg.assumptions);
     }
 
-    ydbg("Max Assumption Length: %zu", cfg.assumptions_max_assumption_size);
+    ydbg("Max Assumption Length: %zu", cfg.assumptions.max_cube_size);
     ydbg("Input: \"%s\"", cfg.input);
     ydbg("Solver: \"%s\"", cfg.solver);
 
@@ -567,106 +602,105 @@ main(int argc, char* argv[]) {
     }
   }
 
-  solver = quapi_init(cfg.solver,
-                      (const char**)cfg.solver_argv,
-                      NULL,
-                      varcount,
-                      clausecount,
-                      cfg.assumptions_max_assumption_size,
-                      NULL,
-                      NULL);
+  quapi_solver* solver = quapi_init(cfg.solver,
+                                    (const char**)cfg.solver_argv,
+                                    NULL,
+                                    f.varcount,
+                                    f.clausecount,
+                                    cfg.assumptions.max_cube_size,
+                                    NULL,
+                                    NULL);
 
   if(!solver) {
     fprintf(stderr, "Quapi solver could not be initialized!\n");
     return EXIT_FAILURE;
   }
 
+  if(cfg.timeout > 0)
+    quapi_set_timeout(solver, cfg.timeout * 1e9);
+
+  // Freed on every path to ERROR.
+  size_t* representatives = NULL;
+
   ydbg("Initialized quapi, parsing formula again.");
 
-  if(!run_kissat_parser(&cfg))
+  if(!formula_parse_into_solver(solver, cfg.input, cfg.strictness))
     goto ERROR;
 
-  int* end = cfg.assumptions + cfg.assumptions_size;
-  int *ass = cfg.assumptions, *assstart = cfg.assumptions;
-
   if(cfg.print_header) {
-    printf("SolveTime[ns] SolveTime[s] Result Assumption\n");
+    output_header(stdout, &cfg.output, false);
   }
 
-  int assumption_id = 0;
-
-  while(ass != end) {
-    if(*ass != 0) {
-      if(cfg.selected_assumption == -1 ||
-         cfg.selected_assumption >= 0 &&
-           assumption_id == cfg.selected_assumption) {
-        if(ABS(*ass) > varcount) {
-          fprintf(
-            stderr,
-            "Cannot assume %d, as it is larger than the variable count %zu!\n",
-            *ass,
-            varcount);
-          goto ERROR;
-        }
-        if(!quapi_assume(solver, *ass)) {
-          fprintf(stderr, "quapi_assume(solver, %d) returned false!\n", *ass);
-          goto ERROR;
-        }
-      }
-    } else {
-      if(cfg.selected_assumption == -1 ||
-         cfg.selected_assumption >= 0 &&
-           assumption_id == cfg.selected_assumption) {
-        double before_time = tai_time();
-        int result = quapi_solve(solver);
-        double after_time = tai_time();
-
-        printf("%zu %f ",
-               (size_t)((after_time - before_time) * 1000000000),
-               after_time - before_time);
-
-        if(cfg.stringify_result) {
-          const char* result_str = "UNKNOWN";
-          switch(result) {
-            case 10:
-              result_str = "SAT";
-              break;
-            case 20:
-              result_str = "UNSAT";
-              break;
-            default:
-              result_str = "UNKNOWN";
-              break;
-          }
-          printf("%s ", result_str);
-        } else {
-          printf("%d ", result);
-        }
-
-        if(cfg.wrap_assumption)
-          printf("\"");
-
-        printf("%d ", assumption_id);
+  // Symmetry pruning only pays off when solving all cubes.
+  if((cfg.symmetry_file || cfg.detect_symmetry) &&
+     cfg.selected_assumption == -1 && cfg.estimate == 0) {
+    representatives = compute_representatives(&cfg, &f);
+    if(!representatives)
+      goto ERROR;
+  }
 
-        if(cfg.print_assumptions) {
-          print_assumption(stdout, assstart);
+  size_t cubes_to_solve = cfg.assumptions.count;
+  if(representatives) {
+    cubes_to_solve = 0;
+    for(size_t i = 0; i < cfg.assumptions.count; ++i)
+      cubes_to_solve += representatives[i] == i;
+  }
+  if(cfg.estimate > 0)
+    cubes_to_solve = MIN(cfg.estimate, cubes_to_solve);
+  else if(cfg.selected_assumption >= 0)
+    cubes_to_solve = cfg.selected_assumption < cubes_to_solve ? 1 : 0;
+  cfg.running_progress = progress_start(&cfg.progress, cubes_to_solve);
+
+  if(cfg.estimate > 0) {
+    if(!run_estimate(&cfg, solver, f.varcount, explicit_cubes))
+      goto ERROR;
+  } else {
+    int* end = cfg.assumptions.lits + cfg.assumptions.size;
+    int* cube = cfg.assumptions.lits;
+    int* results = representatives
+                     ? malloc(cfg.assumptions.count * sizeof(int))
+                     : NULL;
+
+    for(int assumption_id = 0; cube != end; ++assumption_id) {
+      if(representatives && representatives[assumption_id] != assumption_id) {
+        // The representative is always the smallest index of the orbit and
+        // was solved before.
+        results[assumption_id] = results[representatives[assumption_id]];
+        output_result_line(stdout,
+                           &cfg.output,
+                           NULL,
+                           0,
+                           results[assumption_id],
+                           NULL,
+                           assumption_id,
+                           cube);
+      } else if(cfg.selected_assumption == -1 ||
+                cfg.selected_assumption >= 0 &&
+                  assumption_id == cfg.selected_assumption) {
+        int* result = results ? &results[assumption_id] : NULL;
+        if(!solve_cube(
+             &cfg, solver, f.varcount, assumption_id, cube, NULL, result)) {
+          free(results);
+          goto ERROR;
         }
-
-        if(cfg.wrap_assumption)
-          printf("\"");
-
-        printf("\n");
       }
-
-      assstart = ass + 1;
-      ++assumption_id;
+      while(*cube != 0)
+        ++cube;
+      ++cube;
     }
-    ++ass;
+
+    free(results);
   }
 
-  free(cfg.assumptions);
+  progress_stop(cfg.running_progress);
+  free(representatives);
+  cubes_release(&cfg.assumptions);
+  formula_release(&f);
   return EXIT_SUCCESS;
 ERROR:
-  free(cfg.assumptions);
+  progress_stop(cfg.running_progress);
+  free(representatives);
+  cubes_release(&cfg.assumptions);
+  formula_release(&f);
   return EXIT_FAILURE;
 }
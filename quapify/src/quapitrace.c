@@ -0,0 +1,307 @@
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <quapi/trace.h>
+
+typedef struct event {
+  quapi_trace_record record;
+  int32_t pid;
+  // Position among all collected events, oldest first within a ring.
+  size_t index;
+} event;
+
+typedef struct events {
+  event* data;
+  size_t size;
+  size_t capacity;
+} events;
+
+/* Concatenated lines of timeline files, each ending with ",\n". */
+typedef struct timeline {
+  char* data;
+  size_t size;
+  size_t capacity;
+} timeline;
+
+static bool chrome = false;
+// Only events of this process are written, 0 for all.
+static int only_pid = 0;
+static timeline tl = { 0 };
+
+static void
+help() {
+  fprintf(stderr,
+          "quapitrace - Decode binary trace ring buffers written by QuAPI "
+          "processes\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "USAGE:\n");
+  fprintf(stderr, "  quapitrace [OPTIONS] <file or directory>...\n");
+  fprintf(stderr, "OPTIONS:\n");
+  fprintf(stderr, "  -p <pid>\tonly print events of the given process\n");
+  fprintf(stderr,
+          "  -a\t\tprint absolute CLOCK_MONOTONIC timestamps instead of "
+          "offsets to the first event\n");
+  fprintf(stderr,
+          "  -c\t\twrite a Chrome trace of the given timelines and rings for "
+          "chrome://tracing\n\t\tor Perfetto\n");
+  fprintf(stderr,
+          "Events of all given rings are merged by time. Directories are "
+          "searched for\nquapi-trace-<pid>.bin files, as written with "
+          "QUAPI_TRACE_DIR, and with -c also for\nquapi-timeline-<pid>.json "
+          "files, as written with QUAPI_TIMELINE_DIR.\n");
+  fprintf(stderr, "EXAMPLES:\n");
+  fprintf(stderr,
+          "  QUAPI_TRACE_DIR=/tmp/trace ./quapify input.cnf -i 4 -- "
+          "./solver\n");
+  fprintf(stderr, "  ./quapitrace /tmp/trace | less\n");
+  fprintf(stderr,
+          "  QUAPI_TIMELINE_DIR=/tmp/trace ./quapify input.cnf -i 4 -- "
+          "./solver\n");
+  fprintf(stderr, "  ./quapitrace -c /tmp/trace > trace.json\n");
+}
+
+static void
+collect(const quapi_trace_ring* ring,
+        const quapi_trace_record* record,
+        void* userdata) {
+  events* e = userdata;
+  if(e->size == e->capacity) {
+    e->capacity = e->capacity ? e->capacity * 2 : 1024;
+    e->data = realloc(e->data, e->capacity * sizeof(event));
+    if(!e->data) {
+      fprintf(stderr, "Out of memory!\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  e->data[e->size] =
+    (event){ .record = *record, .pid = ring->pid, .index = e->size };
+  ++e->size;
+}
+
+static bool
+read_ring(const char* path, events* e) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if(fd == -1) {
+    fprintf(stderr, "Could not open \"%s\": %s\n", path, strerror(errno));
+    return false;
+  }
+  struct stat st;
+  void* data = MAP_FAILED;
+  if(fstat(fd, &st) == 0 && st.st_size > 0)
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(data == MAP_FAILED) {
+    fprintf(stderr, "Could not map \"%s\"!\n", path);
+    return false;
+  }
+
+  bool ok = quapi_trace_ring_foreach(data, st.st_size, &collect, e);
+  if(!ok)
+    fprintf(stderr, "\"%s\" is no QuAPI trace ring buffer!\n", path);
+  munmap(data, st.st_size);
+  return ok;
+}
+
+static void
+append(timeline* t, const char* data, size_t size) {
+  if(t->size + size > t->capacity) {
+    while(t->size + size > t->capacity)
+      t->capacity = t->capacity ? t->capacity * 2 : 65536;
+    t->data = realloc(t->data, t->capacity);
+    if(!t->data) {
+      fprintf(stderr, "Out of memory!\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  memcpy(t->data + t->size, data, size);
+  t->size += size;
+}
+
+/* Every timeline event names its process. */
+static int
+line_pid(const char* line) {
+  const char* p = strstr(line, "\"pid\":");
+  return p ? atoi(p + 6) : 0;
+}
+
+static bool
+read_timeline(const char* path) {
+  FILE* f = fopen(path, "r");
+  if(!f) {
+    fprintf(stderr, "Could not open \"%s\": %s\n", path, strerror(errno));
+    return false;
+  }
+  char* line = NULL;
+  size_t line_size = 0;
+  ssize_t len;
+  while((len = getline(&line, &line_size, f)) > 0) {
+    // Processes that were killed while writing may leave an incomplete line.
+    if(line[len - 1] != '\n') {
+      fprintf(
+        stderr, "Dropped incomplete event at the end of \"%s\".\n", path);
+      break;
+    }
+    if(!only_pid || line_pid(line) == only_pid)
+      append(&tl, line, len);
+  }
+  free(line);
+  fclose(f);
+  return true;
+}
+
+static bool
+has_suffix(const char* name, const char* suffix) {
+  size_t len = strlen(name), suffix_len = strlen(suffix);
+  return len >= suffix_len && strcmp(name + len - suffix_len, suffix) == 0;
+}
+
+static bool
+read_dir(const char* path, events* e) {
+  DIR* dir = opendir(path);
+  if(!dir) {
+    fprintf(stderr, "Could not open \"%s\": %s\n", path, strerror(errno));
+    return false;
+  }
+  bool ok = true;
+  struct dirent* ent;
+  while((ent = readdir(dir))) {
+    char file[PATH_MAX];
+    snprintf(file, sizeof(file), "%s/%s", path, ent->d_name);
+    if(strncmp(ent->d_name, "quapi-trace-", 12) == 0 &&
+       has_suffix(ent->d_name, ".bin"))
+      ok = read_ring(file, e) && ok;
+    else if(chrome && strncmp(ent->d_name, "quapi-timeline-", 15) == 0 &&
+            has_suffix(ent->d_name, ".json"))
+      ok = read_timeline(file) && ok;
+  }
+  closedir(dir);
+  return ok;
+}
+
+static int
+compare_events(const void* a, const void* b) {
+  const event* l = a;
+  const event* r = b;
+  if(l->record.time_ns != r->record.time_ns)
+    return l->record.time_ns < r->record.time_ns ? -1 : 1;
+  if(l->pid != r->pid)
+    return l->pid < r->pid ? -1 : 1;
+  if(l->index != r->index)
+    return l->index < r->index ? -1 : 1;
+  return 0;
+}
+
+/* Ring events become instant events on the track of their process. The
+ * timeline uses the same clock, so both line up. */
+static void
+write_chrome_trace(const events* e) {
+  char line[512], args[128];
+  for(size_t i = 0; i < e->size; ++i) {
+    const event* ev = &e->data[i];
+    if(only_pid && ev->pid != only_pid)
+      continue;
+    quapi_trace_format_args(&ev->record, args, sizeof(args));
+    int len = snprintf(line,
+                       sizeof(line),
+                       "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\","
+                       "\"ts\":%llu.%03u,\"pid\":%d,\"tid\":%d,"
+                       "\"args\":{\"detail\":\"%s\"}},\n",
+                       quapi_trace_event_str(ev->record.event),
+                       (unsigned long long)(ev->record.time_ns / 1000),
+                       (unsigned)(ev->record.time_ns % 1000),
+                       ev->pid,
+                       ev->pid,
+                       args);
+    append(&tl, line, len);
+  }
+
+  // Drop the separator after the last event.
+  if(tl.size >= 2)
+    tl.size -= 2;
+  printf("{\"traceEvents\":[\n");
+  fwrite(tl.data, 1, tl.size, stdout);
+  printf("\n],\"displayTimeUnit\":\"ns\"}\n");
+}
+
+int
+main(int argc, char* argv[]) {
+  bool absolute = false;
+
+  int c;
+  while((c = getopt(argc, argv, "hacp:")) != -1)
+    switch(c) {
+      case 'a':
+        absolute = true;
+        break;
+      case 'c':
+        chrome = true;
+        break;
+      case 'p':
+        only_pid = atoi(optarg);
+        break;
+      case 'h':
+        help();
+        return EXIT_SUCCESS;
+      default:
+        help();
+        return EXIT_FAILURE;
+    }
+
+  if(optind == argc) {
+    help();
+    return EXIT_FAILURE;
+  }
+
+  events e = { 0 };
+  bool ok = true;
+  for(int i = optind; i < argc; ++i) {
+    struct stat st;
+    if(stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode))
+      ok = read_dir(argv[i], &e) && ok;
+    else if(chrome && has_suffix(argv[i], ".json"))
+      ok = read_timeline(argv[i]) && ok;
+    else
+      ok = read_ring(argv[i], &e) && ok;
+  }
+
+  // Events of one process may share a timestamp. qsort is not stable, the
+  // ring order breaks these ties.
+  qsort(e.data, e.size, sizeof(event), &compare_events);
+
+  if(chrome) {
+    write_chrome_trace(&e);
+    free(e.data);
+    free(tl.data);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  uint64_t begin = e.size && !absolute ? e.data[0].record.time_ns : 0;
+  char args[128];
+  for(size_t i = 0; i < e.size; ++i) {
+    const event* ev = &e.data[i];
+    if(only_pid && ev->pid != only_pid)
+      continue;
+    uint64_t t = ev->record.time_ns - begin;
+    quapi_trace_format_args(&ev->record, args, sizeof(args));
+    printf("%llu.%09llu %d %s %s\n",
+           (unsigned long long)(t / 1000000000),
+           (unsigned long long)(t % 1000000000),
+           ev->pid,
+           quapi_trace_event_str(ev->record.event),
+           args);
+  }
+
+  free(e.data);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,462 @@
+#define _GNU_SOURCE
+
+#include "symmetry.h"
+#include "common.h"
+#include "utilities.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Detection checks all pairs of cube variables, so their count is capped.
+#define MAX_DETECTION_VARIABLES 1024
+
+static int
+compare_int(const void* a_, const void* b_) {
+  int a = *(const int*)a_;
+  int b = *(const int*)b_;
+  return (a > b) - (a < b);
+}
+
+// Cubes are sets of literals, sort them by variable to get a canonical form.
+static int
+compare_lit(const void* a_, const void* b_) {
+  int a = *(const int*)a_;
+  int b = *(const int*)b_;
+  int va = ABS(a), vb = ABS(b);
+  if(va != vb)
+    return (va > vb) - (va < vb);
+  return (a > b) - (a < b);
+}
+
+static uint64_t
+hash_ints(const int* arr, size_t size) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  for(size_t i = 0; i < size; ++i) {
+    h ^= (uint32_t)arr[i];
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+/* Open addressing hash set of int arrays, which all live in one arena. */
+typedef struct int_array_set {
+  const int* arena;
+  const size_t* starts;
+  const size_t* sizes;
+  size_t* slots;
+  size_t mask;
+} int_array_set;
+
+static void
+set_init(int_array_set* set,
+         const int* arena,
+         const size_t* starts,
+         const size_t* sizes,
+         size_t count) {
+  size_t capacity = 16;
+  while(capacity < count * 2)
+    capacity *= 2;
+  set->arena = arena;
+  set->starts = starts;
+  set->sizes = sizes;
+  set->slots = calloc(capacity, sizeof(size_t));
+  set->mask = capacity - 1;
+
+  for(size_t i = 0; i < count; ++i) {
+    size_t slot = hash_ints(arena + starts[i], sizes[i]) & set->mask;
+    while(set->slots[slot])
+      slot = (slot + 1) & set->mask;
+    set->slots[slot] = i + 1;
+  }
+}
+
+// Returns the index of the equal array, or SIZE_MAX.
+static size_t
+set_find(const int_array_set* set, const int* arr, size_t size) {
+  size_t slot = hash_ints(arr, size) & set->mask;
+  for(; set->slots[slot]; slot = (slot + 1) & set->mask) {
+    size_t i = set->slots[slot] - 1;
+    if(set->sizes[i] == size &&
+       memcmp(set->arena + set->starts[i], arr, size * sizeof(int)) == 0)
+      return i;
+  }
+  return SIZE_MAX;
+}
+
+static int
+generator_image(const symmetry_generator* g, int lit) {
+  int v = ABS(lit);
+  size_t lo = 0, hi = g->size;
+  while(lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if(g->from[mid] < v)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if(lo < g->size && g->from[lo] == v)
+    return lit < 0 ? -g->to[lo] : g->to[lo];
+  return lit;
+}
+
+static void
+add_generator(symmetry* s, int* from, int* to, size_t size) {
+  s->generators = realloc(
+    s->generators, (s->generators_size + 1) * sizeof(symmetry_generator));
+  symmetry_generator* g = &s->generators[s->generators_size++];
+  g->from = from;
+  g->to = to;
+  g->size = size;
+}
+
+void
+symmetry_release(symmetry* s) {
+  for(size_t i = 0; i < s->generators_size; ++i) {
+    free(s->generators[i].from);
+    free(s->generators[i].to);
+  }
+  free(s->generators);
+  memset(s, 0, sizeof(*s));
+}
+
+typedef struct mapping {
+  int from;
+  int to;
+} mapping;
+
+static int
+compare_mapping(const void* a_, const void* b_) {
+  const mapping* a = a_;
+  const mapping* b = b_;
+  return (a->from > b->from) - (a->from < b->from);
+}
+
+static bool
+parse_generator(symmetry* s,
+                const char* line,
+                size_t lineno,
+                const char* path,
+                size_t varcount) {
+  mapping* maps = NULL;
+  size_t maps_size = 0;
+  int* cycle = NULL;
+  size_t cycle_size = 0;
+  bool in_cycle = false;
+  const char* error = NULL;
+
+  for(const char* p = line; *p && !error;) {
+    if(isspace(*p)) {
+      ++p;
+    } else if(*p == '(') {
+      if(in_cycle)
+        error = "nested cycle";
+      in_cycle = true;
+      cycle_size = 0;
+      ++p;
+    } else if(*p == ')') {
+      if(!in_cycle)
+        error = "unopened cycle";
+      in_cycle = false;
+      maps = realloc(maps, (maps_size + cycle_size) * sizeof(mapping));
+      for(size_t i = 0; i < cycle_size; ++i) {
+        int from = cycle[i], to = cycle[(i + 1) % cycle_size];
+        if(from < 0) {
+          from = -from;
+          to = -to;
+        }
+        if(from != to)
+          maps[maps_size++] = (mapping){ from, to };
+      }
+      ++p;
+    } else {
+      char* end;
+      errno = 0;
+      long lit = strtol(p, &end, 10);
+      if(end == p || errno || !in_cycle || lit == 0 || lit < -INT_MAX ||
+         lit > INT_MAX || (size_t)labs(lit) > varcount) {
+        error = "invalid literal";
+        break;
+      }
+      cycle = realloc(cycle, (cycle_size + 1) * sizeof(int));
+      cycle[cycle_size++] = lit;
+      p = end;
+    }
+  }
+  if(!error && in_cycle)
+    error = "unclosed cycle";
+
+  if(!error && maps_size > 0) {
+    qsort(maps, maps_size, sizeof(mapping), &compare_mapping);
+    int* from = malloc(maps_size * sizeof(int));
+    int* to = malloc(maps_size * sizeof(int));
+    size_t size = 0;
+    for(size_t i = 0; i < maps_size && !error; ++i) {
+      if(size > 0 && from[size - 1] == maps[i].from) {
+        // Cycles over negative literals repeat the positive ones.
+        if(to[size - 1] != maps[i].to)
+          error = "literal mapped to different images";
+        continue;
+      }
+      from[size] = maps[i].from;
+      to[size] = maps[i].to;
+      ++size;
+    }
+    if(error) {
+      free(from);
+      free(to);
+    } else {
+      add_generator(s, from, to, size);
+    }
+  }
+
+  if(error)
+    fprintf(stderr,
+            "Error: Invalid generator in symmetry file \"%s\" on line %zu: "
+            "%s!\n",
+            path,
+            lineno,
+            error);
+
+  free(maps);
+  free(cycle);
+  return !error;
+}
+
+bool
+symmetry_read(symmetry* s, const char* path, size_t varcount) {
+  FILE* f = fopen(path, "r");
+  if(!f) {
+    fprintf(stderr,
+            "Error: Could not open symmetry file \"%s\": %s\n",
+            path,
+            strerror(errno));
+    return false;
+  }
+
+  char* line = NULL;
+  size_t line_capacity = 0;
+  size_t lineno = 0;
+  bool ok = true;
+
+  while(ok && getline(&line, &line_capacity, f) != -1) {
+    ++lineno;
+    const char* p = line;
+    while(isspace(*p))
+      ++p;
+    if(*p == '\0' || *p == 'c' || *p == '#')
+      continue;
+    ok = parse_generator(s, p, lineno, path, varcount);
+  }
+
+  free(line);
+  fclose(f);
+  return ok;
+}
+
+static bool
+pair_is_symmetric(int x,
+                  int y,
+                  const size_t* occurrences_x,
+                  const size_t* occurrences_y,
+                  size_t occurrences_size,
+                  const int_array_set* clauses,
+                  int* buf) {
+  symmetry_generator swap = { .from = (int[]){ MIN(x, y), MAX(x, y) },
+                              .to = (int[]){ MAX(x, y), MIN(x, y) },
+                              .size = 2 };
+
+  for(int side = 0; side < 2; ++side) {
+    const size_t* occurrences = side == 0 ? occurrences_x : occurrences_y;
+    for(size_t i = 0; i < occurrences_size; ++i) {
+      size_t c = occurrences[i];
+      const int* clause = clauses->arena + clauses->starts[c];
+      size_t size = clauses->sizes[c];
+      for(size_t j = 0; j < size; ++j)
+        buf[j] = generator_image(&swap, clause[j]);
+      qsort(buf, size, sizeof(int), &compare_int);
+      if(set_find(clauses, buf, size) == SIZE_MAX)
+        return false;
+    }
+  }
+  return true;
+}
+
+size_t
+symmetry_detect(symmetry* s, const formula* f, const cubes* c) {
+  assert(f->keep_clauses);
+
+  // Variables of the cubes, in order of their first appearance.
+  int* slot_of = malloc((f->varcount + 1) * sizeof(int));
+  memset(slot_of, -1, (f->varcount + 1) * sizeof(int));
+  int* vars = NULL;
+  size_t vars_size = 0;
+  for(size_t i = 0; i < c->size; ++i) {
+    int v = ABS(c->lits[i]);
+    if(v == 0 || v > f->varcount || slot_of[v] != -1)
+      continue;
+    if(vars_size == MAX_DETECTION_VARIABLES) {
+      message("Symmetry detection only considers the first %d cube variables",
+              MAX_DETECTION_VARIABLES);
+      break;
+    }
+    vars = realloc(vars, (vars_size + 1) * sizeof(int));
+    slot_of[v] = vars_size;
+    vars[vars_size++] = v;
+  }
+
+  // Quantifier blocks, free variables are in block 0.
+  int* block = calloc(f->varcount + 1, sizeof(int));
+  int current_block = 0, previous_sign = 0;
+  for(size_t i = 0; i < f->quantifiers_size; ++i) {
+    int q = f->quantifiers[i];
+    int sign = q < 0 ? -1 : 1;
+    if(sign != previous_sign)
+      ++current_block;
+    previous_sign = sign;
+    if(ABS(q) <= f->varcount)
+      block[ABS(q)] = current_block;
+  }
+
+  // Sorted clauses and the occurrences of the cube variables.
+  int* sorted = malloc(f->lits_size * sizeof(int) + 1);
+  memcpy(sorted, f->lits, f->lits_size * sizeof(int));
+  size_t* starts = malloc((f->clausecount + 1) * sizeof(size_t));
+  size_t* sizes = malloc((f->clausecount + 1) * sizeof(size_t));
+  size_t** occurrences = calloc(vars_size, sizeof(size_t*));
+  size_t* occurrences_size = calloc(vars_size, sizeof(size_t));
+  size_t clauses = 0, max_clause_size = 0;
+
+  for(size_t start = 0, i = 0; i < f->lits_size; ++i) {
+    int lit = sorted[i];
+    if(lit != 0) {
+      int slot = slot_of[ABS(lit)];
+      if(slot != -1) {
+        size_t n = occurrences_size[slot]++;
+        occurrences[slot] =
+          realloc(occurrences[slot], (n + 1) * sizeof(size_t));
+        occurrences[slot][n] = clauses;
+      }
+      continue;
+    }
+    starts[clauses] = start;
+    sizes[clauses] = i - start;
+    qsort(sorted + start, i - start, sizeof(int), &compare_int);
+    max_clause_size = MAX(max_clause_size, i - start);
+    ++clauses;
+    start = i + 1;
+  }
+
+  int_array_set set;
+  set_init(&set, sorted, starts, sizes, clauses);
+  int* buf = malloc((max_clause_size + 1) * sizeof(int));
+
+  size_t added = 0;
+  for(size_t i = 0; i < vars_size; ++i) {
+    for(size_t j = i + 1; j < vars_size; ++j) {
+      int x = vars[i], y = vars[j];
+      if(block[x] != block[y] || occurrences_size[i] != occurrences_size[j])
+        continue;
+      if(!pair_is_symmetric(x,
+                            y,
+                            occurrences[i],
+                            occurrences[j],
+                            occurrences_size[i],
+                            &set,
+                            buf))
+        continue;
+
+      int* from = malloc(2 * sizeof(int));
+      int* to = malloc(2 * sizeof(int));
+      from[0] = MIN(x, y);
+      from[1] = to[0] = MAX(x, y);
+      to[1] = MIN(x, y);
+      add_generator(s, from, to, 2);
+      ++added;
+    }
+  }
+
+  for(size_t i = 0; i < vars_size; ++i)
+    free(occurrences[i]);
+  free(occurrences);
+  free(occurrences_size);
+  free(set.slots);
+  free(buf);
+  free(sorted);
+  free(starts);
+  free(sizes);
+  free(block);
+  free(vars);
+  free(slot_of);
+
+  return added;
+}
+
+static size_t
+find_root(size_t* parent, size_t i) {
+  while(parent[i] != i) {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
+
+size_t*
+symmetry_representatives(const symmetry* s, const cubes* c) {
+  // Canonical (sorted) copies of all cubes.
+  int* sorted = malloc((c->size + 1) * sizeof(int));
+  memcpy(sorted, c->lits, c->size * sizeof(int));
+  size_t* starts = malloc((c->count + 1) * sizeof(size_t));
+  size_t* sizes = malloc((c->count + 1) * sizeof(size_t));
+  for(size_t cube = 0, start = 0, i = 0; i < c->size; ++i) {
+    if(c->lits[i] != 0)
+      continue;
+    starts[cube] = start;
+    sizes[cube] = i - start;
+    qsort(sorted + start, i - start, sizeof(int), &compare_lit);
+    ++cube;
+    start = i + 1;
+  }
+
+  int_array_set set;
+  set_init(&set, sorted, starts, sizes, c->count);
+
+  // Union-find, the root is always the smallest index of the set.
+  size_t* parent = malloc((c->count + 1) * sizeof(size_t));
+  for(size_t i = 0; i < c->count; ++i)
+    parent[i] = i;
+
+  int* image = malloc((c->max_cube_size + 1) * sizeof(int));
+  for(size_t i = 0; i < c->count; ++i) {
+    const int* cube = sorted + starts[i];
+    for(size_t g = 0; g < s->generators_size; ++g) {
+      for(size_t l = 0; l < sizes[i]; ++l)
+        image[l] = generator_image(&s->generators[g], cube[l]);
+      qsort(image, sizes[i], sizeof(int), &compare_lit);
+
+      size_t j = set_find(&set, image, sizes[i]);
+      if(j == SIZE_MAX)
+        continue;
+      size_t ri = find_root(parent, i), rj = find_root(parent, j);
+      if(ri < rj)
+        parent[rj] = ri;
+      else
+        parent[ri] = rj;
+    }
+  }
+
+  for(size_t i = 0; i < c->count; ++i)
+    parent[i] = find_root(parent, i);
+
+  free(image);
+  free(set.slots);
+  free(sorted);
+  free(starts);
+  free(sizes);
+  return parent;
+}
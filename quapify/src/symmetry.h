@@ -0,0 +1,69 @@
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cubes.h"
+#include "formula.h"
+
+/** @file
+ *
+ * Symmetry-aware cube pruning. If a permutation of literals maps the formula
+ * onto itself, a cube and its image under the permutation have the same
+ * result. Cubes are grouped into orbits under the generators, only the first
+ * cube of every orbit is solved and its result is copied to the others.
+ *
+ * Symmetry files contain one generator per line in cycle notation over
+ * literals, as printed by common symmetry detection tools:
+ *
+ *   (1 2)(-1 -2)
+ *   ( 3 5 7 ) ( -3 -5 -7 )
+ *
+ * Cycles over positive literals imply the same cycles over negative literals.
+ * Lines starting with 'c' or '#' are comments.
+ *
+ * For QBF, generators must respect the quantifier prefix, which is not checked
+ * for user supplied generators.
+ */
+
+typedef struct symmetry_generator {
+  // Sorted variables moved by the generator and the literal each one maps to.
+  int* from;
+  int* to;
+  size_t size;
+} symmetry_generator;
+
+typedef struct symmetry {
+  symmetry_generator* generators;
+  size_t generators_size;
+} symmetry;
+
+void
+symmetry_release(symmetry* s);
+
+/** @brief Read generators from a symmetry file. Returns false on errors.
+ */
+bool
+symmetry_read(symmetry* s, const char* path, size_t varcount);
+
+/** @brief Detect interchangeable pairs of cube variables.
+ *
+ * Two variables are interchangeable if they are in the same quantifier block
+ * and swapping them maps the clause set onto itself. Every such pair is added
+ * as a transposition. Requires a formula with kept clauses. Returns the number
+ * of added generators.
+ */
+size_t
+symmetry_detect(symmetry* s, const formula* f, const cubes* c);
+
+/** @brief Compute the representative of every cube.
+ *
+ * Returns an array with one entry per cube, containing the index of the
+ * smallest cube in the same orbit. Orbits are connected through cubes of the
+ * given set only, so the grouping may be finer than the real orbits.
+ */
+size_t*
+symmetry_representatives(const symmetry* s, const cubes* c);
+
+#endif
@@ -1,4 +1,5 @@
 #include "catch.hpp"
+#include "util.hpp"
 
 #include <chrono>
 #include <thread>
@@ -41,3 +42,40 @@ TEST_CASE("abort a solver") {
 
   REQUIRE(quapi_get_state(s.get()) == QUAPI_INPUT_LITERALS);
 }
+
+TEST_CASE("reset assumptions of a running solver child") {
+  QuAPISolver s = make_bash_solver(READ_UNIT_1_SCRIPT
+                                   "if [ $u = 1 ]; then sleep 10; fi; exit 10");
+
+  auto before = std::chrono::steady_clock::now();
+
+  quapi_assume(s.get(), 1);
+  quapi_reset_assumptions(s.get());
+  REQUIRE(quapi_get_state(s.get()) == QUAPI_INPUT_LITERALS);
+
+  quapi_assume(s.get(), -1);
+  REQUIRE(quapi_solve(s.get()) == 10);
+
+  auto after = std::chrono::steady_clock::now();
+  REQUIRE(std::chrono::duration<double>(after - before).count() < 5);
+}
+
+#ifndef WITHOUT_PCRE2
+TEST_CASE("notice a solver child killed before printing a result") {
+  const char* argv[] = {
+    "bash", "-c", "while read -r l; do :; done; kill -9 $$", NULL
+  };
+
+  QuAPISolver s(quapi_init(
+    "bash", argv, NULL, 2, 1, 1, "^s SATISFIABLE", "^s UNSATISFIABLE"));
+  REQUIRE(s.get());
+
+  quapi_add(s.get(), 1);
+  quapi_add(s.get(), 2);
+  quapi_add(s.get(), 0);
+
+  quapi_assume(s.get(), 1);
+  REQUIRE(quapi_solve(s.get()) == 0);
+  REQUIRE(quapi_get_state(s.get()) == QUAPI_INPUT_LITERALS);
+}
+#endif
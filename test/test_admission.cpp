@@ -0,0 +1,107 @@
+#include "catch.hpp"
+#include "util.hpp"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <quapi/poller.h>
+#include <quapi/quapi.h>
+
+static QuAPISolver
+make_solver(const char* seconds) {
+  std::string script =
+    std::string("while read -r l; do :; done; sleep ") + seconds + "; exit 10";
+  return make_bash_solver(script.c_str(), 1);
+}
+
+TEST_CASE("limit the number of concurrent solver children", "[admission]") {
+  quapi_admission a = {};
+  a.max_children = 1;
+  quapi_set_admission(&a);
+
+  QuAPISolver s1 = make_solver("0.5");
+  QuAPISolver s2 = make_solver("0.5");
+
+  auto before = std::chrono::steady_clock::now();
+
+  int r1 = 0, r2 = 0;
+  std::thread t([&] {
+    quapi_assume(s1.get(), 1);
+    r1 = quapi_solve(s1.get());
+  });
+  quapi_assume(s2.get(), 1);
+  r2 = quapi_solve(s2.get());
+  t.join();
+
+  auto after = std::chrono::steady_clock::now();
+  quapi_set_admission(NULL);
+
+  REQUIRE(r1 == 10);
+  REQUIRE(r2 == 10);
+  REQUIRE(quapi_get_admitted_children() == 0);
+
+  // Both solves ran one after the other.
+  REQUIRE(std::chrono::duration<double>(after - before).count() >= 1.0);
+}
+
+TEST_CASE("queue non-blocking solves waiting for admission", "[admission]") {
+  quapi_admission a = {};
+  a.max_children = 1;
+  quapi_set_admission(&a);
+
+  QuAPISolver s1 = make_solver("0.5");
+  QuAPISolver s2 = make_solver("0.5");
+  QuAPIPoller p(quapi_poller_init());
+  REQUIRE(p.get());
+
+  auto before = std::chrono::steady_clock::now();
+
+  // A single thread, which must not block in any of these calls.
+  REQUIRE(quapi_assume(s1.get(), 1));
+  REQUIRE(quapi_solve_start(s1.get()));
+  REQUIRE(quapi_poller_add(p.get(), s1.get(), NULL));
+  REQUIRE(quapi_assume(s2.get(), 1));
+  REQUIRE(quapi_solve_start(s2.get()));
+  REQUIRE(quapi_poller_add(p.get(), s2.get(), NULL));
+  REQUIRE(quapi_get_admitted_children() == 1);
+
+  int done = 0;
+  quapi_poller_event events[2];
+  while(done < 2) {
+    // Wakeups that do not finish a solve return 0 events.
+    int n = quapi_poller_wait(p.get(), events, 2, 5000);
+    REQUIRE(n >= 0);
+    REQUIRE(std::chrono::steady_clock::now() - before <
+            std::chrono::seconds(10));
+    for(int i = 0; i < n; ++i)
+      REQUIRE(events[i].result == 10);
+    done += n;
+  }
+
+  auto after = std::chrono::steady_clock::now();
+  quapi_set_admission(NULL);
+
+  REQUIRE(quapi_get_admitted_children() == 0);
+  REQUIRE(std::chrono::duration<double>(after - before).count() >= 1.0);
+}
+
+TEST_CASE("stop the youngest child when memory runs low", "[admission]") {
+  QuAPISolver s = make_solver("10");
+
+  // Pretend memory is always low.
+  quapi_admission a = {};
+  a.kill_below_available = UINT64_MAX;
+  quapi_set_admission(&a);
+
+  unsigned stopped = quapi_get_stopped_children();
+
+  quapi_assume(s.get(), 1);
+  int r = quapi_solve(s.get());
+
+  quapi_set_admission(NULL);
+
+  REQUIRE(r == 0);
+  REQUIRE(quapi_was_terminated(s.get()));
+  REQUIRE(quapi_get_stopped_children() == stopped + 1);
+}
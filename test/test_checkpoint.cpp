@@ -0,0 +1,111 @@
+#include "catch.hpp"
+#include "util.hpp"
+
+#include <quapi/quapi.h>
+
+#include <chrono>
+
+static void
+add_unit(quapi_solver* s, int32_t lit) {
+  quapi_add(s, lit);
+  quapi_add(s, 0);
+}
+
+TEST_CASE("roll back clauses added after a checkpoint", "[checkpoint]") {
+  QuAPISolver s = make_bash_solver(units_script, 2, 2, NULL, NULL, 2);
+
+  int seeding_pid = quapi_get_pid(s.get());
+  REQUIRE(quapi_checkpoint(s.get()) == 1);
+  REQUIRE(quapi_get_pid(s.get()) != seeding_pid);
+
+  add_unit(s.get(), -1);
+  REQUIRE(solve_cube(s.get(), { -2 }) == 20);
+
+  // The checkpoint stays available after a rollback.
+  for(int i = 0; i < 2; ++i) {
+    REQUIRE(quapi_rollback(s.get(), 1));
+    REQUIRE(solve_cube(s.get(), { -2 }) == 10);
+    add_unit(s.get(), -2);
+    REQUIRE(solve_cube(s.get(), { -1 }) == 20);
+    REQUIRE(quapi_rollback(s.get(), 1));
+    REQUIRE(solve_cube(s.get(), { -1 }) == 10);
+  }
+
+  REQUIRE_FALSE(quapi_rollback(s.get(), 2));
+  REQUIRE_FALSE(quapi_rollback(s.get(), 0));
+}
+
+TEST_CASE("nest and drop checkpoints", "[checkpoint]") {
+  QuAPISolver s = make_bash_solver(units_script, 2, 2, NULL, NULL, 2);
+
+  REQUIRE(quapi_checkpoint(s.get()) == 1);
+  add_unit(s.get(), -1);
+  REQUIRE(quapi_checkpoint(s.get()) == 2);
+  add_unit(s.get(), -2);
+  REQUIRE(solve_cube(s.get(), {}) == 20);
+
+  REQUIRE(quapi_rollback(s.get(), 2));
+  REQUIRE(solve_cube(s.get(), {}) == 10);
+  REQUIRE(solve_cube(s.get(), { -2 }) == 20);
+
+  // Rolling back to the outer checkpoint drops the inner one.
+  REQUIRE(quapi_rollback(s.get(), 1));
+  REQUIRE(solve_cube(s.get(), { -2 }) == 10);
+  REQUIRE_FALSE(quapi_rollback(s.get(), 2));
+
+  // Dropping a checkpoint keeps the clauses added after it.
+  REQUIRE(quapi_checkpoint(s.get()) == 2);
+  add_unit(s.get(), -2);
+  REQUIRE(quapi_drop_checkpoint(s.get(), 2));
+  REQUIRE_FALSE(quapi_rollback(s.get(), 2));
+  REQUIRE(solve_cube(s.get(), { -1 }) == 20);
+
+  REQUIRE(quapi_rollback(s.get(), 1));
+  REQUIRE(solve_cube(s.get(), { -1 }) == 10);
+}
+
+TEST_CASE("refinement with rollbacks and with re-fed solvers",
+          "[.][benchmark][checkpoint]") {
+  const int clauses = 2000;
+  const int rounds = 50;
+  const char* argv[] = { "bash", "-c", units_script, NULL };
+
+  auto feed = [&](quapi_solver* s) {
+    for(int i = 0; i < clauses; ++i) {
+      quapi_add(s, 1);
+      quapi_add(s, 2);
+      quapi_add(s, 0);
+    }
+  };
+
+  auto before = std::chrono::steady_clock::now();
+  for(int i = 0; i < rounds; ++i) {
+    QuAPISolver s(
+      quapi_init_reserved("bash", argv, NULL, 2, clauses, 2, 1, NULL, NULL));
+    REQUIRE(s.get());
+    feed(s.get());
+    add_unit(s.get(), -1);
+    REQUIRE(solve_cube(s.get(), { -2 }) == 20);
+  }
+  auto after = std::chrono::steady_clock::now();
+  WARN("Re-fed solvers: "
+       << std::chrono::duration<double>(after - before).count() * 1e3 / rounds
+       << "ms per round");
+
+  QuAPISolver s(
+    quapi_init_reserved("bash", argv, NULL, 2, clauses, 2, 1, NULL, NULL));
+  REQUIRE(s.get());
+  feed(s.get());
+  REQUIRE(quapi_checkpoint(s.get()) == 1);
+
+  before = std::chrono::steady_clock::now();
+  for(int i = 0; i < rounds; ++i) {
+    add_unit(s.get(), -1);
+    REQUIRE(solve_cube(s.get(), { -2 }) == 20);
+    REQUIRE(quapi_rollback(s.get(), 1));
+  }
+  after = std::chrono::steady_clock::now();
+  WARN("Rollbacks: "
+       << std::chrono::duration<double>(after - before).count() * 1e3 / rounds
+       << "ms per round");
+}
@@ -0,0 +1,135 @@
+#include "catch.hpp"
+#include "util.hpp"
+
+#include <quapi/quapi.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// UNSAT if both 1 and 3 are assumed, SAT otherwise.
+static const char* core_script =
+  "a=0; c=0; while read -r l; do case \"$l\" in \"1 0\") a=1;; "
+  "\"3 0\") c=1;; esac; done; "
+  "if [ $a = 1 ] && [ $c = 1 ]; then echo 's UNSATISFIABLE'; exit 20; fi; "
+  "echo 's SATISFIABLE'; exit 10";
+
+static std::vector<int32_t>
+failed_core(quapi_solver* s,
+            const std::vector<int32_t>& assumptions,
+            unsigned parallel,
+            bool* found) {
+  std::vector<int32_t> core(assumptions.size());
+  size_t core_size = 0;
+  *found = quapi_failed_core(s,
+                             assumptions.data(),
+                             assumptions.size(),
+                             parallel,
+                             core.data(),
+                             &core_size);
+  core.resize(*found ? core_size : 0);
+  std::sort(core.begin(), core.end());
+  return core;
+}
+
+TEST_CASE("extract failed assumption cores", "[failed_core]") {
+  QuAPISolver s = make_bash_solver(core_script, 5, 5);
+  const std::vector<int32_t> assumptions = { 5, 3, 4, 1, 2 };
+  const std::vector<int32_t> expected = { 1, 3 };
+
+  for(unsigned parallel : { 1u, 2u, 3u, 8u }) {
+    CAPTURE(parallel);
+    bool found = false;
+    REQUIRE(failed_core(s.get(), assumptions, parallel, &found) == expected);
+    REQUIRE(found);
+  }
+
+  bool found = true;
+  failed_core(s.get(), { 1, 2, 4 }, 4, &found);
+  REQUIRE(!found);
+
+  // Regular solves are not disturbed by probes.
+  quapi_assume(s.get(), 1);
+  quapi_assume(s.get(), 3);
+  REQUIRE(quapi_solve(s.get()) == 20);
+  quapi_assume(s.get(), 3);
+  REQUIRE(quapi_solve(s.get()) == 10);
+}
+
+TEST_CASE("keep assumptions of probes that time out", "[failed_core]") {
+  // Hangs if 1 and 3 but not 2 are assumed.
+  QuAPISolver s = make_bash_solver(
+    "a=0; b=0; c=0; while read -r l; do case \"$l\" in \"1 0\") a=1;; "
+    "\"2 0\") b=1;; \"3 0\") c=1;; esac; done; "
+    "if [ $a = 1 ] && [ $c = 1 ]; then "
+    "if [ $b = 0 ]; then exec sleep 100; fi; exit 20; fi; exit 10",
+    5,
+    5);
+  quapi_set_timeout(s.get(), 200000000);
+
+  bool found = false;
+  REQUIRE(failed_core(s.get(), { 1, 2, 3, 4, 5 }, 8, &found) ==
+          std::vector<int32_t>{ 1, 2, 3 });
+  REQUIRE(found);
+}
+
+TEST_CASE("keep universal assumptions in failed cores", "[failed_core]") {
+  // UNSAT if 3 is assumed. 1 is universal and stays in the core anyway.
+  QuAPISolver s = make_bash_solver(
+    "c=0; while read -r l; do if [ \"$l\" = \"3 0\" ]; then c=1; fi; done; "
+    "if [ $c = 1 ]; then exit 20; fi; exit 10",
+    5,
+    5,
+    NULL,
+    NULL,
+    0,
+    { -1, 2, 3, 4, 5 });
+
+  bool found = false;
+  REQUIRE(failed_core(s.get(), { 1, 2, 3, 4 }, 3, &found) ==
+          std::vector<int32_t>{ 1, 3 });
+  REQUIRE(found);
+}
+
+TEST_CASE("admit probes of failed cores", "[failed_core]") {
+  quapi_admission a = {};
+  a.max_children = 1;
+  quapi_set_admission(&a);
+
+  QuAPISolver s = make_bash_solver(core_script, 5, 5);
+
+  std::atomic<bool> done(false);
+  unsigned max_admitted = 0;
+  std::thread watcher([&] {
+    while(!done) {
+      max_admitted = std::max(max_admitted, quapi_get_admitted_children());
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+
+  bool found = false;
+  std::vector<int32_t> core =
+    failed_core(s.get(), { 5, 3, 4, 1, 2 }, 8, &found);
+  done = true;
+  watcher.join();
+  quapi_set_admission(NULL);
+
+  REQUIRE(found);
+  REQUIRE(core == std::vector<int32_t>{ 1, 3 });
+  REQUIRE(max_admitted <= 1);
+  REQUIRE(quapi_get_admitted_children() == 0);
+}
+
+#ifndef WITHOUT_PCRE2
+TEST_CASE("extract failed assumption cores using regexes", "[failed_core]") {
+  QuAPISolver s = make_bash_solver(
+    core_script, 5, 5, "^s SATISFIABLE", "^s UNSATISFIABLE");
+
+  bool found = false;
+  REQUIRE(failed_core(s.get(), { 2, 1, 4, 3 }, 0, &found) ==
+          std::vector<int32_t>{ 1, 3 });
+  REQUIRE(found);
+}
+#endif
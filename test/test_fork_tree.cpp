@@ -0,0 +1,90 @@
+#include "catch.hpp"
+#include "util.hpp"
+
+#include <quapi/fork_tree.h>
+
+#include <vector>
+
+// UNSAT if both 2 and 3 are assumed, SAT otherwise.
+static const char* fork_tree_script =
+  "b=0; c=0; while read -r l; do case \"$l\" in \"2 0\") b=1;; "
+  "\"3 0\") c=1;; esac; done; "
+  "if [ $b = 1 ] && [ $c = 1 ]; then exit 20; fi; exit 10";
+
+static int
+solve_cube(quapi_fork_tree* t, std::vector<int32_t> cube) {
+  return quapi_fork_tree_solve(t, cube.data(), cube.size());
+}
+
+TEST_CASE("solve cubes through a fork tree", "[fork_tree]") {
+  QuAPISolver s = make_bash_solver(fork_tree_script, 3, 3);
+  QuAPIForkTree t(quapi_fork_tree_init(s.get(), 0));
+  REQUIRE(t.get());
+
+  REQUIRE(solve_cube(t.get(), { 1, 2, 3 }) == 20);
+  // Nodes for the prefixes 1 and 1 2.
+  REQUIRE(quapi_fork_tree_size(t.get()) == 2);
+  REQUIRE(solve_cube(t.get(), { 1, 2, -3 }) == 10);
+  REQUIRE(quapi_fork_tree_size(t.get()) == 2);
+  REQUIRE(solve_cube(t.get(), { 1, -2, 3 }) == 10);
+  REQUIRE(solve_cube(t.get(), { 1, -2, -3 }) == 10);
+  REQUIRE(quapi_fork_tree_size(t.get()) == 3);
+
+  // Shorter cubes and cubes without nodes.
+  REQUIRE(solve_cube(t.get(), { 2, 3 }) == 20);
+  REQUIRE(solve_cube(t.get(), { 3 }) == 10);
+  REQUIRE(solve_cube(t.get(), {}) == 10);
+
+  // Regular solves still work next to the tree.
+  quapi_assume(s.get(), 2);
+  quapi_assume(s.get(), 3);
+  REQUIRE(quapi_solve(s.get()) == 20);
+}
+
+TEST_CASE("evict fork tree nodes under a memory budget", "[fork_tree]") {
+  QuAPISolver s = make_bash_solver(fork_tree_script, 3, 3);
+  QuAPIForkTree t(quapi_fork_tree_init(s.get(), 1));
+  REQUIRE(t.get());
+
+  REQUIRE(solve_cube(t.get(), { 1, 2, 3 }) == 20);
+  REQUIRE(solve_cube(t.get(), { -1, 2, -3 }) == 10);
+  // Only the nodes of the last cube are kept.
+  REQUIRE(quapi_fork_tree_size(t.get()) == 2);
+  REQUIRE(solve_cube(t.get(), { 1, 2, 3 }) == 20);
+  REQUIRE(quapi_fork_tree_size(t.get()) == 2);
+}
+
+TEST_CASE("drop fork tree nodes once clauses are added", "[fork_tree]") {
+  QuAPISolver s =
+    make_bash_solver(fork_tree_script, 3, 3, NULL, NULL, 1);
+  QuAPIForkTree t(quapi_fork_tree_init(s.get(), 0));
+  REQUIRE(t.get());
+
+  REQUIRE(solve_cube(t.get(), { 1, 3, 2 }) == 20);
+  REQUIRE(quapi_fork_tree_size(t.get()) == 2);
+
+  // The unit 2 makes every cube with 3 UNSAT.
+  quapi_add(s.get(), 2);
+  quapi_add(s.get(), 0);
+  REQUIRE(solve_cube(t.get(), { 1, 3, -2 }) == 20);
+  REQUIRE(quapi_fork_tree_size(t.get()) == 2);
+}
+
+TEST_CASE("find fork tree nodes among many", "[fork_tree]") {
+  QuAPISolver s =
+    make_bash_solver("while read -r l; do :; done; exit 10", 5, 5);
+  QuAPIForkTree t(quapi_fork_tree_init(s.get(), 0));
+  REQUIRE(t.get());
+
+  // All cubes over 5 variables need 2 + 4 + 8 + 16 nodes, which are found
+  // again for the second round.
+  for(int round = 0; round < 2; ++round) {
+    for(int32_t bits = 0; bits < 32; ++bits) {
+      std::vector<int32_t> cube;
+      for(int32_t v = 1; v <= 5; ++v)
+        cube.push_back(bits & (1 << (v - 1)) ? v : -v);
+      REQUIRE(solve_cube(t.get(), cube) == 10);
+    }
+    REQUIRE(quapi_fork_tree_size(t.get()) == 30);
+  }
+}
@@ -1,5 +1,7 @@
 #include "catch.hpp"
 
+#include <signal.h>
+
 #include <quapi/quapi.h>
 
 TEST_CASE("init and release") {
@@ -7,3 +9,14 @@ TEST_CASE("init and release") {
     quapi_init(nullptr, NULL, NULL, 0, 0, 0, NULL, NULL);
   REQUIRE(!solver);
 }
+
+TEST_CASE("seeding process pid") {
+  const char* argv[] = { "bash", "-c", "while read line; do :; done", NULL };
+
+  QuAPISolver s(quapi_init("bash", argv, NULL, 1, 1, 1, NULL, NULL));
+  REQUIRE(s.get());
+
+  int pid = quapi_get_pid(s.get());
+  REQUIRE(pid > 0);
+  REQUIRE(kill(pid, 0) == 0);
+}
@@ -0,0 +1,74 @@
+#include "catch.hpp"
+#include "util.hpp"
+
+#include <quapi/quapi.h>
+
+TEST_CASE("read the model from value lines", "[model]") {
+  // Prints a model if the assumption 1 was given, is UNSAT otherwise.
+  QuAPISolver s = make_bash_solver(
+    READ_UNIT_1_SCRIPT
+    "if [ $u = 0 ]; then echo 's UNSATISFIABLE'; exit 20; fi; "
+    "echo 's SATISFIABLE'; echo 'v 1 -2'; echo 'v 3 0'; exit 10",
+    3);
+
+  REQUIRE(quapi_val(s.get(), 1) == 0);
+  REQUIRE(quapi_track_model(s.get(), true));
+
+  quapi_assume(s.get(), 1);
+  REQUIRE(quapi_solve(s.get()) == 10);
+  REQUIRE(quapi_val(s.get(), 1) == 1);
+  REQUIRE(quapi_val(s.get(), -1) == 1);
+  REQUIRE(quapi_val(s.get(), 2) == -2);
+  REQUIRE(quapi_val(s.get(), -2) == -2);
+  REQUIRE(quapi_val(s.get(), 3) == 3);
+  REQUIRE(quapi_val(s.get(), 4) == 0);
+
+  // The model is dropped once the next solve starts.
+  quapi_assume(s.get(), -1);
+  REQUIRE(quapi_solve(s.get()) == 20);
+  REQUIRE(quapi_val(s.get(), 1) == 0);
+}
+
+TEST_CASE("read multi-digit literals from long value lines", "[model]") {
+  // Long lines are parsed 8 bytes at a time, so literals cross chunk
+  // boundaries. Values beyond UINT32_MAX must not wrap around to the small
+  // variables 5 and 7.
+  QuAPISolver s = make_bash_solver(
+    "while read -r l; do :; done; echo 's SATISFIABLE'; l=v; "
+    "for ((i = 100000; i < 100200; ++i)); do "
+    "if [ $((i % 2)) = 0 ]; then l=\"$l $i\"; else l=\"$l -$i\"; fi; "
+    "done; echo \"$l\"; "
+    "echo 'v 5 -4294967301 -7 18446744073709551623 -0000000000123456 0'; "
+    "exit 10",
+    200000);
+
+  REQUIRE(quapi_track_model(s.get(), true));
+
+  quapi_assume(s.get(), 1);
+  REQUIRE(quapi_solve(s.get()) == 10);
+  for(int32_t i = 100000; i < 100200; ++i)
+    REQUIRE(quapi_val(s.get(), i) == (i % 2 == 0 ? i : -i));
+  REQUIRE(quapi_val(s.get(), 5) == 5);
+  REQUIRE(quapi_val(s.get(), 7) == -7);
+  REQUIRE(quapi_val(s.get(), 123456) == -123456);
+}
+
+#ifndef WITHOUT_PCRE2
+TEST_CASE("wait for the model after the result line", "[model]") {
+  QuAPISolver s = make_bash_solver(
+    "while read -r l; do :; done; echo 's SATISFIABLE'; sleep 0.2; "
+    "echo 'v -1 2'; sleep 0.2; echo 'v -3 0'; sleep 10",
+    3,
+    1,
+    "^s SATISFIABLE",
+    "^s UNSATISFIABLE");
+
+  REQUIRE(quapi_track_model(s.get(), true));
+
+  quapi_assume(s.get(), 1);
+  REQUIRE(quapi_solve(s.get()) == 10);
+  REQUIRE(quapi_val(s.get(), 1) == -1);
+  REQUIRE(quapi_val(s.get(), 2) == 2);
+  REQUIRE(quapi_val(s.get(), 3) == -3);
+}
+#endif
@@ -0,0 +1,91 @@
+#include "catch.hpp"
+#include "util.hpp"
+
+#include <quapi/quapi.h>
+
+#include <chrono>
+#include <poll.h>
+
+static QuAPISolver
+make_units_solver(const char* script, bool pipelined) {
+  QuAPISolver s = make_bash_solver(script, 2, 2);
+  REQUIRE(quapi_set_pipelined_fork(s.get(), pipelined));
+  return s;
+}
+
+TEST_CASE("solve cubes with pipelined forks", "[pipelined]") {
+  QuAPISolver s = make_units_solver(units_script, true);
+
+  for(int i = 0; i < 3; ++i) {
+    REQUIRE(solve_cube(s.get(), { -1, -2 }) == 20);
+    REQUIRE(solve_cube(s.get(), { 1 }) == 10);
+    REQUIRE(solve_cube(s.get(), { -1, 2 }) == 10);
+  }
+
+  REQUIRE(quapi_assume(s.get(), -1));
+  quapi_reset_assumptions(s.get());
+  REQUIRE(solve_cube(s.get(), { -2 }) == 10);
+
+  // The PID of the child is known once the solve can be waited for.
+  REQUIRE(quapi_assume(s.get(), -1));
+  REQUIRE(quapi_assume(s.get(), -2));
+  REQUIRE(quapi_solve_start(s.get()));
+  REQUIRE_FALSE(quapi_set_pipelined_fork(s.get(), false));
+  int fds[QUAPI_MAX_FDS];
+  size_t count = quapi_get_fds(s.get(), fds, QUAPI_MAX_FDS);
+  REQUIRE(count > 0);
+  int result = 0;
+  while(!quapi_process_events(s.get(), &result)) {
+    struct pollfd pfds[QUAPI_MAX_FDS];
+    for(size_t i = 0; i < count; ++i)
+      pfds[i] = { fds[i], POLLIN, 0 };
+    poll(pfds, count, -1);
+  }
+  REQUIRE(result == 20);
+}
+
+TEST_CASE("skip assumptions of aborted pipelined children", "[pipelined]") {
+  QuAPISolver s = make_bash_solver(units_script, 600, 600);
+  REQUIRE(quapi_set_pipelined_fork(s.get(), true));
+
+  // Enough assumptions to be flushed before the child is aborted, so they
+  // may still be in the pipe when the next child starts.
+  for(int i = 0; i < 3; ++i) {
+    for(int32_t lit = 2; lit <= 500; ++lit)
+      REQUIRE(quapi_assume(s.get(), -lit));
+    quapi_reset_assumptions(s.get());
+    REQUIRE(solve_cube(s.get(), { -1 }) == 10);
+  }
+  REQUIRE(solve_cube(s.get(), { -1, -2 }) == 20);
+}
+
+#ifndef WITHOUT_PCRE2
+TEST_CASE("match results of pipelined children", "[pipelined][regex]") {
+  QuAPISolver s = make_bash_solver(
+    result_line_script, 1, 1, "^s SATISFIABLE", "^s UNSATISFIABLE");
+  REQUIRE(quapi_set_pipelined_fork(s.get(), true));
+
+  for(int i = 0; i < 4; ++i) {
+    REQUIRE(solve_cube(s.get(), { -1 }) == 20);
+    quapi_terminate(s.get());
+    REQUIRE(solve_cube(s.get(), { 1 }) == 10);
+  }
+}
+#endif
+
+TEST_CASE("latency of tiny cubes with and without pipelined forks",
+          "[.][benchmark][pipelined]") {
+  const int cubes = 500;
+  for(bool pipelined : { false, true }) {
+    QuAPISolver s = make_units_solver(units_script, pipelined);
+
+    auto before = std::chrono::steady_clock::now();
+    for(int i = 0; i < cubes; ++i)
+      REQUIRE(solve_cube(s.get(), { i % 2 ? 1 : -1, -2 }) == (i % 2 ? 10 : 20));
+    auto after = std::chrono::steady_clock::now();
+    WARN((pipelined ? "Pipelined" : "Synchronous")
+         << " forks: "
+         << std::chrono::duration<double>(after - before).count() * 1e6 / cubes
+         << "us per cube");
+  }
+}
@@ -0,0 +1,63 @@
+#include "catch.hpp"
+
+#include <sched.h>
+
+#include <quapi/quapi.h>
+
+TEST_CASE("place seeding process and solver child", "[placement]") {
+  auto policy =
+    GENERATE(QUAPI_PLACEMENT_ROUND_ROBIN, QUAPI_PLACEMENT_LEAST_LOADED);
+
+  quapi_placement p = { policy, -1, false };
+  quapi_set_placement(&p);
+
+  const char* argv[] = {
+    "bash", "-c", "while read -r l; do :; done; exit 10", NULL
+  };
+  QuAPISolver s(quapi_init("bash", argv, NULL, 1, 1, 1, NULL, NULL));
+
+  // Placement is process-wide, do not affect other tests.
+  quapi_set_placement(NULL);
+
+  REQUIRE(s.get());
+  REQUIRE(quapi_get_numa_node(s.get()) >= 0);
+  REQUIRE(quapi_get_solverchild_cpu(s.get()) == -1);
+
+  quapi_add(s.get(), 1);
+  quapi_add(s.get(), 0);
+  quapi_assume(s.get(), 1);
+
+  REQUIRE(quapi_solve(s.get()) == 10);
+
+  int cpu = quapi_get_solverchild_cpu(s.get());
+  REQUIRE(cpu >= 0);
+
+  // The solver child runs on one of the CPUs of the seeding process.
+  cpu_set_t seeding;
+  int pid = quapi_get_pid(s.get());
+  REQUIRE(sched_getaffinity(pid, sizeof(seeding), &seeding) == 0);
+  REQUIRE(CPU_ISSET(cpu, &seeding));
+
+  quapi_stats stats;
+  quapi_get_stats(s.get(), &stats);
+  REQUIRE(stats.last.numa_node == quapi_get_numa_node(s.get()));
+  REQUIRE(stats.last.solverchild_cpu == cpu);
+}
+
+TEST_CASE("solvers are not placed by default", "[placement]") {
+  const char* argv[] = {
+    "bash", "-c", "while read -r l; do :; done; exit 10", NULL
+  };
+  QuAPISolver s(quapi_init("bash", argv, NULL, 1, 1, 1, NULL, NULL));
+  REQUIRE(s.get());
+  REQUIRE(quapi_get_numa_node(s.get()) == -1);
+
+  quapi_add(s.get(), 1);
+  quapi_add(s.get(), 0);
+  REQUIRE(quapi_solve(s.get()) == 10);
+
+  quapi_stats stats;
+  quapi_get_stats(s.get(), &stats);
+  REQUIRE(stats.last.numa_node == -1);
+  REQUIRE(stats.last.solverchild_cpu == -1);
+}
@@ -0,0 +1,111 @@
+#include "catch.hpp"
+#include "util.hpp"
+
+#include <chrono>
+#include <vector>
+
+#include <quapi/poller.h>
+#include <quapi/quapi.h>
+
+TEST_CASE("drive many solvers from one thread using a poller", "[poller]") {
+  const size_t count = 8;
+
+  QuAPIPoller p(quapi_poller_init());
+  REQUIRE(p.get());
+
+  std::vector<QuAPISolver> solvers;
+  std::vector<int> results(count, -1);
+
+  for(size_t i = 0; i < count; ++i) {
+    solvers.push_back(make_bash_solver(exit_code_script));
+    quapi_solver* s = solvers.back().get();
+
+    quapi_assume(s, i % 2 ? 1 : -1);
+
+    REQUIRE(quapi_solve_start(s));
+    REQUIRE(quapi_get_state(s) == QUAPI_WORKING);
+    REQUIRE(quapi_poller_add(p.get(), s, &results[i]));
+  }
+
+  REQUIRE(quapi_poller_size(p.get()) == count);
+
+  quapi_poller_event events[4];
+  while(quapi_poller_size(p.get()) > 0) {
+    int n = quapi_poller_wait(p.get(), events, 4, -1);
+    REQUIRE(n >= 0);
+    for(int i = 0; i < n; ++i) {
+      REQUIRE(!events[i].terminated);
+      *static_cast<int*>(events[i].userdata) = events[i].result;
+      REQUIRE(quapi_get_state(events[i].solver) == QUAPI_INPUT_LITERALS);
+    }
+  }
+
+  for(size_t i = 0; i < count; ++i) {
+    REQUIRE(results[i] == (i % 2 ? 20 : 10));
+  }
+
+  // Solvers can be re-used with the blocking API afterwards.
+  quapi_assume(solvers[0].get(), 1);
+  REQUIRE(quapi_solve(solvers[0].get()) == 20);
+}
+
+TEST_CASE("terminate a solver added to a poller", "[poller]") {
+  QuAPIPoller p(quapi_poller_init());
+  REQUIRE(p.get());
+
+  QuAPISolver s = make_bash_solver("while read -r l; do :; done; sleep 10");
+  quapi_assume(s.get(), 2);
+
+  REQUIRE(quapi_solve_start(s.get()));
+  REQUIRE(quapi_poller_add(p.get(), s.get(), NULL));
+
+  quapi_poller_event ev;
+  REQUIRE(quapi_poller_wait(p.get(), &ev, 1, 50) == 0);
+
+  quapi_terminate(s.get());
+
+  int n;
+  do {
+    n = quapi_poller_wait(p.get(), &ev, 1, -1);
+  } while(n == 0);
+
+  REQUIRE(n == 1);
+  REQUIRE(ev.solver == s.get());
+  REQUIRE(ev.terminated);
+  REQUIRE(ev.result == 0);
+  REQUIRE(quapi_get_state(s.get()) == QUAPI_INPUT_LITERALS);
+}
+
+#ifndef WITHOUT_PCRE2
+TEST_CASE("notice pipelined solver children dying without a result",
+          "[poller][pipelined]") {
+  QuAPIPoller p(quapi_poller_init());
+  REQUIRE(p.get());
+
+  // With a SAT regex, only the pidfd tells that the child died.
+  QuAPISolver s =
+    make_bash_solver("while read -r l; do :; done; kill -9 $BASHPID",
+                     2,
+                     1,
+                     "^s SATISFIABLE",
+                     "^s UNSATISFIABLE");
+  REQUIRE(quapi_set_pipelined_fork(s.get(), true));
+
+  for(int i = 0; i < 3; ++i) {
+    quapi_assume(s.get(), 1);
+    REQUIRE(quapi_solve_start(s.get()));
+    REQUIRE(quapi_poller_add(p.get(), s.get(), NULL));
+
+    auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    quapi_poller_event ev;
+    int n = 0;
+    while(n == 0 && std::chrono::steady_clock::now() < deadline)
+      n = quapi_poller_wait(p.get(), &ev, 1, 100);
+
+    REQUIRE(n == 1);
+    REQUIRE(ev.solver == s.get());
+    REQUIRE(quapi_get_state(s.get()) == QUAPI_INPUT_LITERALS);
+  }
+}
+#endif
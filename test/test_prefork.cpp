@@ -0,0 +1,63 @@
+#include "catch.hpp"
+#include "util.hpp"
+
+#include <quapi/quapi.h>
+
+#include <chrono>
+
+TEST_CASE("solve cubes with pre-forked children", "[prefork]") {
+  QuAPISolver s = make_bash_solver(units_script, 2, 2, NULL, NULL, 1);
+  REQUIRE(quapi_set_prefork(s.get(), 2));
+
+  for(int i = 0; i < 3; ++i) {
+    REQUIRE(solve_cube(s.get(), { -1, -2 }) == 20);
+    REQUIRE(solve_cube(s.get(), { 1 }) == 10);
+    REQUIRE(solve_cube(s.get(), { -1, 2 }) == 10);
+  }
+
+  // Assumptions of a reset cube must not reach the next pool child.
+  REQUIRE(quapi_assume(s.get(), -1));
+  quapi_reset_assumptions(s.get());
+  REQUIRE(solve_cube(s.get(), { -2 }) == 10);
+
+  // Children forked before the clause was added must not solve.
+  quapi_add(s.get(), -2);
+  quapi_add(s.get(), 0);
+  REQUIRE(solve_cube(s.get(), { -1 }) == 20);
+  REQUIRE(solve_cube(s.get(), {}) == 10);
+
+  REQUIRE(quapi_set_prefork(s.get(), 0));
+  REQUIRE(solve_cube(s.get(), { -1 }) == 20);
+}
+
+#ifndef WITHOUT_PCRE2
+TEST_CASE("match results of pre-forked children", "[prefork][regex]") {
+  // The child keeps running after printing its result.
+  QuAPISolver s = make_bash_solver(
+    result_line_script, 1, 1, "^s SATISFIABLE", "^s UNSATISFIABLE");
+  REQUIRE(quapi_set_prefork(s.get(), 1));
+
+  for(int i = 0; i < 4; ++i) {
+    REQUIRE(solve_cube(s.get(), { -1 }) == 20);
+    REQUIRE(solve_cube(s.get(), { 1 }) == 10);
+  }
+}
+#endif
+
+TEST_CASE("latency of tiny cubes with and without pre-forking",
+          "[.][benchmark][prefork]") {
+  const int cubes = 500;
+  for(unsigned prefork : { 0, 4 }) {
+    QuAPISolver s = make_bash_solver(units_script, 2, 2);
+    REQUIRE(quapi_set_prefork(s.get(), prefork));
+
+    auto before = std::chrono::steady_clock::now();
+    for(int i = 0; i < cubes; ++i)
+      REQUIRE(solve_cube(s.get(), { i % 2 ? 1 : -1, -2 }) == (i % 2 ? 10 : 20));
+    auto after = std::chrono::steady_clock::now();
+    WARN(prefork << " pre-forked children: "
+                 << std::chrono::duration<double>(after - before).count() *
+                      1e6 / cubes
+                 << "us per cube");
+  }
+}
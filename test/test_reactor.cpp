@@ -0,0 +1,114 @@
+#include "catch.hpp"
+#include "util.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <quapi/quapi.h>
+#include <quapi/reactor.h>
+
+static QuAPISolver
+start_solver(int assumption) {
+  QuAPISolver s = make_bash_solver(exit_code_script);
+  quapi_assume(s.get(), assumption);
+  REQUIRE(quapi_solve_start(s.get()));
+  return s;
+}
+
+TEST_CASE("reactor delivers results to a queue", "[reactor]") {
+  auto backend = GENERATE(QUAPI_REACTOR_EPOLL, QUAPI_REACTOR_IO_URING);
+  const size_t count = 6;
+
+  QuAPIReactor r(quapi_reactor_init(backend, NULL, NULL));
+  REQUIRE(r.get());
+  if(backend == QUAPI_REACTOR_EPOLL)
+    REQUIRE(quapi_reactor_get_backend(r.get()) == QUAPI_REACTOR_EPOLL);
+
+  std::vector<QuAPISolver> solvers;
+  std::vector<int> results(count, -1);
+  for(size_t i = 0; i < count; ++i) {
+    solvers.emplace_back(start_solver(i % 2 ? 1 : -1));
+    REQUIRE(quapi_reactor_add(r.get(), solvers.back().get(), &results[i]));
+  }
+
+  size_t received = 0;
+  quapi_poller_event events[4];
+  while(received < count) {
+    int n = quapi_reactor_wait(r.get(), events, 4, -1);
+    REQUIRE(n >= 0);
+    for(int i = 0; i < n; ++i) {
+      *static_cast<int*>(events[i].userdata) = events[i].result;
+      REQUIRE(quapi_get_state(events[i].solver) == QUAPI_INPUT_LITERALS);
+    }
+    received += n;
+  }
+
+  for(size_t i = 0; i < count; ++i) {
+    REQUIRE(results[i] == (i % 2 ? 20 : 10));
+  }
+
+  REQUIRE(quapi_reactor_wait(r.get(), events, 4, 0) == 0);
+}
+
+TEST_CASE("reactor delivers results to a callback", "[reactor]") {
+  struct Results {
+    std::atomic<int> sat{ 0 };
+    std::atomic<int> unsat{ 0 };
+  } results;
+
+  QuAPIReactor r(quapi_reactor_init(
+    QUAPI_REACTOR_IO_URING,
+    [](const quapi_poller_event* ev, void* userdata) {
+      Results& res = *static_cast<Results*>(userdata);
+      if(ev->result == 10)
+        ++res.sat;
+      else if(ev->result == 20)
+        ++res.unsat;
+    },
+    &results));
+  REQUIRE(r.get());
+
+  QuAPISolver s1 = start_solver(1);
+  QuAPISolver s2 = start_solver(-1);
+  REQUIRE(quapi_reactor_add(r.get(), s1.get(), NULL));
+  REQUIRE(quapi_reactor_add(r.get(), s2.get(), NULL));
+
+  while(results.sat + results.unsat < 2) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  REQUIRE(results.sat == 1);
+  REQUIRE(results.unsat == 1);
+}
+
+#ifndef WITHOUT_PCRE2
+TEST_CASE("reactor notices pipelined solver children dying without a result",
+          "[reactor][pipelined]") {
+  auto backend = GENERATE(QUAPI_REACTOR_EPOLL, QUAPI_REACTOR_IO_URING);
+
+  QuAPIReactor r(quapi_reactor_init(backend, NULL, NULL));
+  REQUIRE(r.get());
+
+  // With a SAT regex, only the pidfd tells that the child died.
+  QuAPISolver s =
+    make_bash_solver("while read -r l; do :; done; kill -9 $BASHPID",
+                     2,
+                     1,
+                     "^s SATISFIABLE",
+                     "^s UNSATISFIABLE");
+  REQUIRE(quapi_set_pipelined_fork(s.get(), true));
+
+  for(int i = 0; i < 3; ++i) {
+    quapi_assume(s.get(), 1);
+    REQUIRE(quapi_solve_start(s.get()));
+    REQUIRE(quapi_reactor_add(r.get(), s.get(), NULL));
+
+    quapi_poller_event ev;
+    REQUIRE(quapi_reactor_wait(r.get(), &ev, 1, 10000) == 1);
+    REQUIRE(ev.solver == s.get());
+    REQUIRE(quapi_get_state(s.get()) == QUAPI_INPUT_LITERALS);
+  }
+}
+#endif
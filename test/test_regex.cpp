@@ -0,0 +1,52 @@
+#include "catch.hpp"
+#include "util.hpp"
+
+#include <chrono>
+
+#include <quapi/quapi.h>
+
+#ifndef WITHOUT_PCRE2
+static int
+solve_with_output(const char* script,
+                  const char* SAT_regex,
+                  const char* UNSAT_regex) {
+  QuAPISolver s = make_bash_solver(script, 1, 1, SAT_regex, UNSAT_regex);
+  quapi_assume(s.get(), 1);
+  return quapi_solve(s.get());
+}
+
+TEST_CASE("match results with anchored regexes", "[regex]") {
+  const char* script = "while read -r l; do :; done; echo 'c s SATISFIABLE'; "
+                       "echo 'v 1 0'; echo 's UNSATISFIABLE'; sleep 10";
+  REQUIRE(solve_with_output(script, "^s SATISFIABLE", "^s UNSATISFIABLE") ==
+          20);
+}
+
+TEST_CASE("match results with groups and back references", "[regex]") {
+  const char* script =
+    "while read -r l; do :; done; echo 'c x'; echo 's SAT SAT'; sleep 10";
+  REQUIRE(solve_with_output(script, "^s (UNSAT)", "^s (SAT)") == 20);
+  REQUIRE(solve_with_output(script, "^s (SAT) \\1$", "^s UNSAT") == 10);
+  REQUIRE(solve_with_output(script, "SAT SAT", "UNSAT") == 10);
+}
+
+TEST_CASE("match results after large outputs", "[.][benchmark][regex]") {
+  // 200000 comment lines and 100 value lines with 10000 literals each.
+  const char* script =
+    "while read -r l; do :; done; awk 'BEGIN { "
+    "for(i = 0; i < 200000; ++i) print \"c comment line\", i; "
+    "for(i = 0; i < 100; ++i) { printf \"v\"; "
+    "for(j = 1; j <= 10000; ++j) printf \" %d\", j; print \"\" } "
+    "print \"s SATISFIABLE\" }'; sleep 10";
+
+  for(int i = 0; i < 3; ++i) {
+    auto before = std::chrono::steady_clock::now();
+    int result =
+      solve_with_output(script, "^s SATISFIABLE", "^s UNSATISFIABLE");
+    auto after = std::chrono::steady_clock::now();
+    REQUIRE(result == 10);
+    WARN("Solved with "
+         << std::chrono::duration<double>(after - before).count() << "s");
+  }
+}
+#endif
@@ -0,0 +1,77 @@
+#include "catch.hpp"
+
+#include <quapi/quapi.h>
+
+#include <string>
+
+// Checks the header and the number of clauses, UNSAT if the unit clause -1 was
+// read.
+static std::string
+counting_script(int clauses) {
+  std::string c = std::to_string(clauses);
+  return "h=''; n=0; u=0; while read -r l; do case \"$l\" in "
+         "p*) h=\"$l\";; \"-1 0\") n=$((n+1)); u=1;; *) n=$((n+1));; esac; "
+         "done; [ \"$h\" = \"p cnf 2 " +
+         c + "\" ] || exit 30; [ $n = " + c +
+         " ] || exit 31; [ $u = 1 ] && exit 20; exit 10";
+}
+
+TEST_CASE("add clauses between solves", "[reserved]") {
+  std::string script = counting_script(4);
+  const char* argv[] = { "bash", "-c", script.c_str(), NULL };
+  QuAPISolver s(
+    quapi_init_reserved("bash", argv, NULL, 2, 1, 1, 2, NULL, NULL));
+  REQUIRE(s.get());
+
+  quapi_add(s.get(), 1);
+  quapi_add(s.get(), 2);
+  quapi_add(s.get(), 0);
+  REQUIRE(quapi_solve(s.get()) == 10);
+
+  quapi_add(s.get(), -1);
+  quapi_add(s.get(), 0);
+  REQUIRE(quapi_solve(s.get()) == 20);
+
+  quapi_add(s.get(), 2);
+  quapi_add(s.get(), 0);
+  REQUIRE(quapi_assume(s.get(), 2));
+  REQUIRE(quapi_solve(s.get()) == 20);
+}
+
+TEST_CASE("pad a large clause budget", "[reserved]") {
+  std::string script = counting_script(20002);
+  const char* argv[] = { "bash", "-c", script.c_str(), NULL };
+  QuAPISolver s(
+    quapi_init_reserved("bash", argv, NULL, 2, 1, 1, 20000, NULL, NULL));
+  REQUIRE(s.get());
+
+  quapi_add(s.get(), 1);
+  quapi_add(s.get(), 0);
+  REQUIRE(quapi_solve(s.get()) == 10);
+
+  quapi_add(s.get(), -1);
+  quapi_add(s.get(), 0);
+  REQUIRE(quapi_assume(s.get(), 2));
+  REQUIRE(quapi_solve(s.get()) == 20);
+}
+
+TEST_CASE("drop clauses beyond the budget", "[reserved]") {
+  std::string script = counting_script(3);
+  const char* argv[] = { "bash", "-c", script.c_str(), NULL };
+  QuAPISolver s(
+    quapi_init_reserved("bash", argv, NULL, 2, 1, 1, 1, NULL, NULL));
+  REQUIRE(s.get());
+
+  quapi_add(s.get(), 1);
+  quapi_add(s.get(), 0);
+  quapi_add(s.get(), -1);
+  quapi_add(s.get(), 0);
+  REQUIRE(quapi_solve(s.get()) == 20);
+
+  // The dropped clause does not take the place of the assumption.
+  quapi_add(s.get(), 2);
+  quapi_add(s.get(), 1);
+  quapi_add(s.get(), 0);
+  REQUIRE(quapi_assume(s.get(), 2));
+  REQUIRE(quapi_solve(s.get()) == 20);
+}
@@ -0,0 +1,177 @@
+#include "catch.hpp"
+#include "util.hpp"
+
+#include <quapi/quapi.h>
+
+TEST_CASE("collect phase timings of solves", "[stats]") {
+  QuAPISolver s = make_bash_solver(units_script, 2, 2);
+
+  quapi_stats stats;
+  quapi_get_stats(s.get(), &stats);
+  REQUIRE(stats.exec_ns > 0);
+  REQUIRE(stats.solves == 0);
+
+  REQUIRE(solve_cube(s.get(), { -1, -2 }) == 20);
+  REQUIRE(solve_cube(s.get(), { -1 }) == 10);
+  REQUIRE(solve_cube(s.get(), {}) == 10);
+
+  quapi_get_stats(s.get(), &stats);
+  REQUIRE(stats.solves == 3);
+  // FORK and SOLVE, no assumptions.
+  REQUIRE(stats.last.messages_sent == 2);
+  // Messages are 5 bytes on the wire.
+  REQUIRE(stats.last.bytes_sent == 2 * 5);
+  // The formula was sent before the first solve.
+  REQUIRE(stats.total.messages_sent > 2 + 4 + 2);
+
+  for(size_t i = 0; i < QUAPI_PHASE_COUNT; ++i) {
+    INFO("Phase " << i);
+    REQUIRE(stats.last.phase_ns[i] > 0);
+    REQUIRE(stats.phases[i].count == 3);
+  }
+  uint64_t phases = 0;
+  for(size_t i = 0; i < QUAPI_PHASE_COUNT; ++i)
+    phases += stats.last.phase_ns[i];
+  REQUIRE(phases <= stats.last.latency_ns);
+  REQUIRE(stats.latency.count == 3);
+  REQUIRE(stats.latency.sum_ns == stats.total.latency_ns);
+
+  quapi_reset_stats(s.get());
+  quapi_get_stats(s.get(), &stats);
+  REQUIRE(stats.solves == 0);
+  REQUIRE(stats.latency.count == 0);
+  REQUIRE(stats.exec_ns > 0);
+}
+
+TEST_CASE("aborted solves are not counted", "[stats]") {
+  QuAPISolver s = make_bash_solver(units_script, 2, 2);
+
+  REQUIRE(quapi_assume(s.get(), -1));
+  quapi_reset_assumptions(s.get());
+  REQUIRE(solve_cube(s.get(), { -2 }) == 10);
+
+  quapi_stats stats;
+  quapi_get_stats(s.get(), &stats);
+  REQUIRE(stats.solves == 1);
+  REQUIRE(stats.latency.count == 1);
+}
+
+namespace {
+// Record by hand, the same way the library does.
+void
+record_us(quapi_histogram& h, uint64_t us) {
+  uint64_t ns = us * 1000;
+  unsigned e = 63 - __builtin_clzll(ns);
+  size_t bucket = (e - 2) * 8 + ((ns >> (e - 3)) & 7);
+  ++h.buckets[bucket];
+  ++h.count;
+  if(ns > h.max_ns)
+    h.max_ns = ns;
+}
+}
+
+TEST_CASE("percentiles of latency histograms", "[stats]") {
+  quapi_histogram h = {};
+  REQUIRE(quapi_histogram_percentile(&h, 50) == 0);
+
+  for(uint64_t v = 1; v <= 1000; ++v)
+    record_us(h, v);
+
+  // Buckets are at most 12.5% wide.
+  uint64_t p50 = quapi_histogram_percentile(&h, 50);
+  REQUIRE(p50 >= 500000);
+  REQUIRE(p50 <= 500000 * 1.125);
+  uint64_t p99 = quapi_histogram_percentile(&h, 99);
+  REQUIRE(p99 >= 990000);
+  REQUIRE(p99 <= 1000000);
+  REQUIRE(quapi_histogram_percentile(&h, 100) == 1000000);
+}
+
+TEST_CASE("median of an odd number of values", "[stats]") {
+  quapi_histogram h = {};
+  record_us(h, 1);
+  record_us(h, 100);
+  record_us(h, 1000);
+
+  uint64_t p50 = quapi_histogram_percentile(&h, 50);
+  REQUIRE(p50 >= 100000);
+  REQUIRE(p50 <= 100000 * 1.125);
+  REQUIRE(quapi_histogram_percentile(&h, 0) <= 1000 * 1.125);
+  REQUIRE(quapi_histogram_percentile(&h, 100) == 1000000);
+}
+
+#ifndef WITHOUT_PCRE2
+TEST_CASE("collect solver output volume in regex mode", "[stats]") {
+  QuAPISolver s = make_bash_solver(
+    "while read -r l; do :; done; echo 'c noise'; echo 's SATISFIABLE'",
+    1,
+    1,
+    "s SATISFIABLE",
+    "s UNSATISFIABLE");
+
+  REQUIRE(solve_cube(s.get(), { 1 }) == 10);
+
+  quapi_stats stats;
+  quapi_get_stats(s.get(), &stats);
+  REQUIRE(stats.solves == 1);
+  REQUIRE(stats.last.stdout_bytes > 0);
+  REQUIRE(stats.last.phase_ns[QUAPI_PHASE_SOLVER] > 0);
+}
+#endif
+
+TEST_CASE("report resource usage of solver children", "[stats]") {
+  // Pre-forked children are reported by their waiter.
+  bool prefork = GENERATE(false, true);
+  INFO("Pre-forked: " << prefork);
+  QuAPISolver s =
+    make_bash_solver("while read -r l; do :; done; i=0; "
+                     "while [ $i -lt 20000 ]; do i=$((i+1)); done; exit 10",
+                     2,
+                     2);
+
+  if(prefork)
+    REQUIRE(quapi_set_prefork(s.get(), 1));
+
+  REQUIRE(solve_cube(s.get(), { -1 }) == 10);
+  REQUIRE(solve_cube(s.get(), { -2 }) == 10);
+
+  quapi_stats stats;
+  quapi_get_stats(s.get(), &stats);
+  REQUIRE(stats.solves == 2);
+  const quapi_rusage& last = stats.last.rusage;
+  REQUIRE(last.user_us > 0);
+  REQUIRE(last.max_rss_kib > 0);
+  REQUIRE(last.minor_faults > 0);
+
+  const quapi_rusage& total = stats.total.rusage;
+  REQUIRE(total.user_us > last.user_us);
+  REQUIRE(total.minor_faults > last.minor_faults);
+  REQUIRE(total.max_rss_kib >= last.max_rss_kib);
+}
+
+TEST_CASE("count performance events of solver children", "[stats]") {
+  setenv("QUAPI_PERF_COUNTERS", "1", 1);
+  QuAPISolver s =
+    make_bash_solver("while read -r l; do :; done; i=0; "
+                     "while [ $i -lt 20000 ]; do i=$((i+1)); done; exit 10",
+                     2,
+                     2);
+  unsetenv("QUAPI_PERF_COUNTERS");
+
+  // Solves must also work if perf_event_paranoid forbids the counters.
+  REQUIRE(solve_cube(s.get(), { -1 }) == 10);
+  REQUIRE(solve_cube(s.get(), { -2 }) == 10);
+
+  quapi_stats stats;
+  quapi_get_stats(s.get(), &stats);
+  REQUIRE(stats.solves == 2);
+  const quapi_perf_counters& last = stats.last.perf;
+  if(last.page_faults == 0) {
+    WARN("Performance counters are not available.");
+    return;
+  }
+  // Hardware counters are often missing in virtual machines.
+  if(last.instructions > 0)
+    REQUIRE(last.cycles > 0);
+  REQUIRE(stats.total.perf.page_faults > last.page_faults);
+}
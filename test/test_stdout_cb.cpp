@@ -1,5 +1,7 @@
 #include "catch.hpp"
 
+#include <cstring>
+
 #include <quapi/quapi.h>
 
 TEST_CASE("stdout callback function", "[cb]") {
@@ -35,3 +37,43 @@ TEST_CASE("stdout callback function", "[cb]") {
   REQUIRE(retcode == 1);
   REQUIRE(stdout_cb_opened);
 }
+
+TEST_CASE("stdout callback with very long lines", "[cb]") {
+  // Prints a comment, a value line with 500000 literals and the result.
+  const char* argv[] = { "bash",
+                         "-c",
+                         "while read -r line; do :; done; echo 'c comment'; "
+                         "awk 'BEGIN { printf \"v\"; for(i = 1; i <= 500000; "
+                         "++i) printf \" %d\", i; print \"\" }'; "
+                         "echo 's SATISFIABLE'",
+                         NULL };
+
+  struct seen_lines {
+    size_t count = 0;
+    size_t value_line_length = 0;
+  } seen;
+
+  QuAPISolver s(quapi_init("bash", argv, NULL, 1, 1, 1, NULL, NULL));
+  REQUIRE(s.get());
+
+  quapi_add(s.get(), 1);
+  quapi_add(s.get(), 0);
+
+  quapi_set_stdout_cb(
+    s.get(),
+    [](const char* line, void* userdata) {
+      seen_lines& seen = *static_cast<seen_lines*>(userdata);
+      ++seen.count;
+      if(line[0] == 'v')
+        seen.value_line_length = strlen(line);
+      return line[0] == 's' ? 10 : 0;
+    },
+    &seen);
+
+  quapi_assume(s.get(), 1);
+
+  REQUIRE(quapi_solve(s.get()) == 10);
+  REQUIRE(seen.count == 3);
+  // "v" and the numbers 1 to 500000, each with a leading space.
+  REQUIRE(seen.value_line_length == 1 + 500000 + 2888895);
+}
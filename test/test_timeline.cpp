@@ -0,0 +1,114 @@
+#include "catch.hpp"
+
+#include <quapi/quapi.h>
+#include <quapi/timeline.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include <dirent.h>
+#include <unistd.h>
+
+namespace {
+struct TimelineDir {
+  std::string path;
+
+  TimelineDir() {
+    char tmpl[] = "/tmp/quapi-timeline-test-XXXXXX";
+    REQUIRE(mkdtemp(tmpl));
+    path = tmpl;
+    setenv("QUAPI_TIMELINE_DIR", path.c_str(), 1);
+    quapi_timeline_reopen();
+  }
+  ~TimelineDir() {
+    unsetenv("QUAPI_TIMELINE_DIR");
+    quapi_timeline_reopen();
+    DIR* dir = opendir(path.c_str());
+    while(struct dirent* ent = readdir(dir))
+      if(ent->d_name[0] != '.')
+        unlink((path + "/" + ent->d_name).c_str());
+    closedir(dir);
+    rmdir(path.c_str());
+  }
+
+  /** Contents of all timeline files by PID. */
+  std::map<int, std::string> read() const {
+    std::map<int, std::string> files;
+    DIR* dir = opendir(path.c_str());
+    while(struct dirent* ent = readdir(dir)) {
+      int pid = 0;
+      if(sscanf(ent->d_name, "quapi-timeline-%d.json", &pid) != 1)
+        continue;
+      std::ifstream f(path + "/" + ent->d_name);
+      std::stringstream ss;
+      ss << f.rdbuf();
+      files[pid] = ss.str();
+    }
+    closedir(dir);
+    return files;
+  }
+};
+
+bool
+contains(const std::string& s, const std::string& part) {
+  return s.find(part) != std::string::npos;
+}
+}
+
+TEST_CASE("processes write timelines of solves", "[timeline]") {
+  TimelineDir dir;
+  int seeding_pid;
+  {
+    const char* argv[] = {
+      "bash", "-c", "while read -r l; do :; done; exit 10", NULL
+    };
+    QuAPISolver s(quapi_init("bash", argv, NULL, 2, 2, 1, NULL, NULL));
+    REQUIRE(s.get());
+    seeding_pid = quapi_get_pid(s.get());
+    quapi_add(s.get(), 1);
+    quapi_add(s.get(), 2);
+    quapi_add(s.get(), 0);
+    quapi_assume(s.get(), 2);
+    REQUIRE(quapi_solve(s.get()) == 10);
+    quapi_add(s.get(), -1);
+    quapi_add(s.get(), 0);
+    quapi_assume(s.get(), 1);
+    REQUIRE(quapi_solve(s.get()) == 10);
+  }
+
+  auto files = dir.read();
+  REQUIRE(files.count(seeding_pid));
+  const std::string& seeding = files[seeding_pid];
+  REQUIRE(contains(seeding, "\"args\":{\"name\":\"seeding process\"}"));
+  REQUIRE(contains(seeding, "{\"name\":\"feed\",\"ph\":\"B\""));
+  REQUIRE(contains(seeding, "{\"name\":\"feed\",\"ph\":\"E\""));
+  REQUIRE(contains(seeding, "{\"name\":\"fork\",\"ph\":\"B\""));
+  REQUIRE(contains(seeding, "\"args\":{\"solve\":0}"));
+  REQUIRE(contains(seeding, "\"args\":{\"solve\":1}"));
+
+  // Every line is one complete event.
+  std::istringstream lines(seeding);
+  for(std::string line; std::getline(lines, line);) {
+    REQUIRE(line.front() == '{');
+    REQUIRE(line.substr(line.size() - 2) == "},");
+  }
+
+  size_t solver_children = 0;
+  for(const auto& [pid, timeline] : files) {
+    if(!contains(timeline, "\"args\":{\"name\":\"solver child\"}"))
+      continue;
+    ++solver_children;
+    REQUIRE(contains(timeline, "{\"name\":\"assumptions\",\"ph\":\"B\""));
+    REQUIRE(contains(timeline, "{\"name\":\"solve\",\"ph\":\"B\""));
+    REQUIRE(contains(timeline, "{\"name\":\"solve\",\"ph\":\"E\""));
+  }
+  REQUIRE(solver_children == 2);
+
+  REQUIRE(files.count(getpid()));
+  const std::string& library = files[getpid()];
+  REQUIRE(contains(library, "{\"name\":\"exec\",\"ph\":\"X\""));
+  REQUIRE(contains(library, "{\"name\":\"solve\",\"ph\":\"X\""));
+}
@@ -0,0 +1,69 @@
+#include "catch.hpp"
+#include "util.hpp"
+
+#include <chrono>
+#include <time.h>
+
+#include <quapi/quapi.h>
+
+static double
+timed_solve(quapi_solver* s, int* result) {
+  auto before = std::chrono::steady_clock::now();
+  *result = quapi_solve(s);
+  auto after = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(after - before).count();
+}
+
+TEST_CASE("solve with a timeout", "[timeout]") {
+  QuAPISolver s = make_bash_solver(READ_UNIT_1_SCRIPT
+                                   "if [ $u = 1 ]; then sleep 10; fi; exit 10");
+
+  quapi_set_timeout(s.get(), 200000000);
+
+  int result;
+  quapi_assume(s.get(), 1);
+  double t = timed_solve(s.get(), &result);
+  REQUIRE(result == QUAPI_TIMEOUT);
+  REQUIRE(t < 5);
+  REQUIRE(quapi_get_state(s.get()) == QUAPI_INPUT_LITERALS);
+
+  // The solver is usable afterwards and not affected by the old solve.
+  quapi_assume(s.get(), -1);
+  timed_solve(s.get(), &result);
+  REQUIRE(result == 10);
+}
+
+TEST_CASE("kill a solver ignoring SIGTERM after the grace period",
+          "[timeout]") {
+  QuAPISolver s = make_bash_solver(
+    "trap '' TERM; while read -r l; do :; done; sleep 10; exit 10");
+
+  quapi_set_timeout(s.get(), 100000000);
+  quapi_set_kill_grace_period(s.get(), 100000000);
+
+  int result;
+  quapi_assume(s.get(), 1);
+  double t = timed_solve(s.get(), &result);
+  REQUIRE(result == QUAPI_TIMEOUT);
+  REQUIRE(t < 5);
+}
+
+TEST_CASE("solve with a deadline for a single call", "[timeout]") {
+  QuAPISolver s = make_bash_solver(READ_UNIT_1_SCRIPT
+                                   "if [ $u = 1 ]; then sleep 1; fi; exit 10");
+
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  uint64_t now_ns = (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+  quapi_set_deadline(s.get(), now_ns + 100000000);
+
+  int result;
+  quapi_assume(s.get(), 1);
+  timed_solve(s.get(), &result);
+  REQUIRE(result == QUAPI_TIMEOUT);
+
+  // The deadline only applied to the last call.
+  quapi_assume(s.get(), 1);
+  timed_solve(s.get(), &result);
+  REQUIRE(result == 10);
+}
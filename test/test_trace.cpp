@@ -0,0 +1,170 @@
+#include "catch.hpp"
+
+#include <quapi/message.h>
+#include <quapi/quapi.h>
+#include <quapi/trace.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+struct TraceDir {
+  std::string path;
+
+  TraceDir() {
+    char tmpl[] = "/tmp/quapi-trace-test-XXXXXX";
+    REQUIRE(mkdtemp(tmpl));
+    path = tmpl;
+    setenv("QUAPI_TRACE_DIR", path.c_str(), 1);
+  }
+  ~TraceDir() {
+    unsetenv("QUAPI_TRACE_DIR");
+    DIR* dir = opendir(path.c_str());
+    while(struct dirent* ent = readdir(dir))
+      if(ent->d_name[0] != '.')
+        unlink((path + "/" + ent->d_name).c_str());
+    closedir(dir);
+    rmdir(path.c_str());
+  }
+};
+
+std::vector<quapi_trace_record>
+read_ring(const std::string& path) {
+  std::vector<quapi_trace_record> records;
+  int fd = open(path.c_str(), O_RDONLY);
+  REQUIRE(fd != -1);
+  struct stat st;
+  REQUIRE(fstat(fd, &st) == 0);
+  void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  REQUIRE(data != MAP_FAILED);
+  REQUIRE(quapi_trace_ring_foreach(
+    static_cast<const quapi_trace_ring*>(data),
+    st.st_size,
+    [](const quapi_trace_ring*, const quapi_trace_record* r, void* userdata) {
+      static_cast<std::vector<quapi_trace_record>*>(userdata)->push_back(*r);
+    },
+    &records));
+  munmap(data, st.st_size);
+  return records;
+}
+
+size_t
+count(const std::vector<quapi_trace_record>& records,
+      quapi_trace_event event) {
+  size_t n = 0;
+  for(const auto& r : records)
+    n += r.event == event;
+  return n;
+}
+}
+
+TEST_CASE("seeding processes record trace events", "[trace]") {
+  TraceDir dir;
+  int seeding_pid;
+  {
+    const char* argv[] = {
+      "bash", "-c", "while read -r l; do :; done; exit 10", NULL
+    };
+    QuAPISolver s(quapi_init("bash", argv, NULL, 2, 2, 1, NULL, NULL));
+    REQUIRE(s.get());
+    seeding_pid = quapi_get_pid(s.get());
+    quapi_add(s.get(), 1);
+    quapi_add(s.get(), 2);
+    quapi_add(s.get(), 0);
+    quapi_add(s.get(), -1);
+    quapi_add(s.get(), 0);
+    quapi_assume(s.get(), 2);
+    REQUIRE(quapi_solve(s.get()) == 10);
+  }
+
+  std::string file = "/quapi-trace-" + std::to_string(seeding_pid) + ".bin";
+  auto records = read_ring(dir.path + file);
+  REQUIRE(count(records, QUAPI_TRACE_HEADER_READ) == 1);
+  // Three literals and two ends of clauses, then the FORK.
+  REQUIRE(count(records, QUAPI_TRACE_MSG_READ) >= 7);
+  REQUIRE(count(records, QUAPI_TRACE_STATE) > 0);
+  REQUIRE(count(records, QUAPI_TRACE_SOLVER_READ) > 0);
+
+  for(size_t i = 1; i < records.size(); ++i)
+    REQUIRE(records[i - 1].time_ns <= records[i].time_ns);
+}
+
+TEST_CASE("decode wrapped trace ring buffers", "[trace]") {
+  const uint32_t capacity = 4;
+  std::vector<char> data(sizeof(quapi_trace_ring) +
+                         capacity * sizeof(quapi_trace_record));
+  quapi_trace_ring* ring = reinterpret_cast<quapi_trace_ring*>(data.data());
+
+  std::vector<int64_t> seen;
+  auto cb =
+    [](const quapi_trace_ring*, const quapi_trace_record* r, void* userdata) {
+      static_cast<std::vector<int64_t>*>(userdata)->push_back(r->a);
+    };
+
+  REQUIRE_FALSE(quapi_trace_ring_foreach(ring, data.size(), cb, &seen));
+
+  ring->magic = QUAPI_TRACE_MAGIC;
+  ring->version = QUAPI_TRACE_VERSION;
+  ring->capacity = capacity;
+  REQUIRE_FALSE(quapi_trace_ring_foreach(ring, data.size() - 1, cb, &seen));
+
+  // Six records were written, the last four are left. One of them is being
+  // overwritten.
+  ring->head = 6;
+  for(uint64_t n = 2; n < 6; ++n) {
+    quapi_trace_record* r = &ring->records[n % capacity];
+    r->seq = n + 1;
+    r->event = QUAPI_TRACE_MSG_WRITE;
+    r->a = n;
+  }
+  ring->records[4 % capacity].seq = 0;
+
+  REQUIRE(quapi_trace_ring_foreach(ring, data.size(), cb, &seen));
+  REQUIRE(seen == std::vector<int64_t>{ 2, 3, 5 });
+
+  quapi_trace_record r = {};
+  r.event = QUAPI_TRACE_MSG_READ;
+  r.a = QUAPI_MSG_LITERAL;
+  r.b = 5;
+  char buf[64];
+  quapi_trace_format_args(&r, buf, sizeof(buf));
+  REQUIRE(std::string(buf) == "type=LITERAL bytes=5");
+  REQUIRE(std::string(quapi_trace_event_str(QUAPI_TRACE_MSG_READ)) ==
+          "MSG_READ");
+}
+
+TEST_CASE("feed formulas with and without trace ring buffers",
+          "[.][benchmark][trace]") {
+  const int clauses = 200000;
+  const char* argv[] = {
+    "bash", "-c", "while read -r l; do :; done; exit 10", NULL
+  };
+
+  auto feed = [&]() {
+    QuAPISolver s(quapi_init("bash", argv, NULL, 2, clauses, 0, NULL, NULL));
+    REQUIRE(s.get());
+    auto before = std::chrono::steady_clock::now();
+    for(int i = 0; i < clauses; ++i) {
+      quapi_add(s.get(), 1);
+      quapi_add(s.get(), 2);
+      quapi_add(s.get(), 0);
+    }
+    REQUIRE(quapi_solve(s.get()) == 10);
+    auto after = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(after - before).count();
+  };
+
+  WARN("Without trace ring buffers: " << feed() << "s");
+  TraceDir dir;
+  WARN("With trace ring buffers: " << feed() << "s");
+}
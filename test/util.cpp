@@ -1,9 +1,62 @@
 #include "util.hpp"
+#include "catch.hpp"
 
 #include <sys/stat.h>
 
+const char* const exit_code_script =
+  READ_UNIT_1_SCRIPT "if [ $u = 1 ]; then exit 20; fi; exit 10";
+
+const char* const units_script =
+  "a=0; b=0; while read -r l; do case \"$l\" in "
+  "\"-1 0\") a=1;; \"-2 0\") b=1;; esac; done; "
+  "[ $a = 1 ] && [ $b = 1 ] && exit 20; exit 10";
+
+const char* const result_line_script =
+  "a=0; while read -r l; do [ \"$l\" = \"-1 0\" ] && a=1; done; "
+  "if [ $a = 1 ]; then echo 's UNSATISFIABLE'; else echo 's SATISFIABLE'; "
+  "fi; exec sleep 100";
+
 bool
 file_exists(const char* path) {
   struct stat buffer;
   return (stat(path, &buffer) == 0);
 }
+
+QuAPISolver
+make_bash_solver(const char* script,
+                 int32_t varcount,
+                 int prefixdepth,
+                 const char* SAT_regex,
+                 const char* UNSAT_regex,
+                 int reserved,
+                 std::initializer_list<int32_t> quantifiers) {
+  const char* argv[] = { "bash", "-c", script, NULL };
+  QuAPISolver s(quapi_init_reserved("bash",
+                                    argv,
+                                    NULL,
+                                    varcount,
+                                    1,
+                                    prefixdepth,
+                                    reserved,
+                                    SAT_regex,
+                                    UNSAT_regex));
+  REQUIRE(s.get());
+  if(quantifiers.size() > 0) {
+    for(int32_t lit : quantifiers)
+      quapi_quantify(s.get(), lit);
+    quapi_quantify(s.get(), 0);
+  }
+  quapi_add(s.get(), 1);
+  if(varcount > 1)
+    quapi_add(s.get(), 2);
+  quapi_add(s.get(), 0);
+  return s;
+}
+
+int
+solve_cube(quapi_solver* s, std::initializer_list<int32_t> cube) {
+  for(int32_t lit : cube)
+    if(!quapi_assume(s, lit))
+      return -1;
+  return quapi_solve(s);
+}
@@ -1,12 +1,45 @@
 #pragma once
 
 #include <functional>
+#include <initializer_list>
 #include <string_view>
 
+#include <quapi/quapi.h>
+
 bool
 file_exists(const char* path);
 
-struct quapi_solver;
+/* Start of bash solver scripts that reads the whole input and sets u to 1 if
+ * the unit clause 1 (the assumption 1) was read, to 0 otherwise. */
+#define READ_UNIT_1_SCRIPT \
+  "u=0; while read -r l; do case \"$l\" in \"1 0\") u=1;; esac; done; "
+
+/* Exits with 20 if 1 was assumed, with 10 otherwise. */
+extern const char* const exit_code_script;
+
+/* Exits with 20 once both -1 and -2 were read as unit clauses, with 10
+ * otherwise. */
+extern const char* const units_script;
+
+/* Prints the result line, UNSAT if the unit clause -1 was read, SAT
+ * otherwise, and keeps running. */
+extern const char* const result_line_script;
+
+/* Assume the literals of the cube and solve, -1 if an assumption failed. */
+int
+solve_cube(quapi_solver* s, std::initializer_list<int32_t> cube);
+
+/* Initialize bash running script as solver of a formula over varcount
+ * variables, optionally quantified, with the single clause (1 2), or (1) for
+ * one variable. */
+QuAPISolver
+make_bash_solver(const char* script,
+                 int32_t varcount = 2,
+                 int prefixdepth = 1,
+                 const char* SAT_regex = NULL,
+                 const char* UNSAT_regex = NULL,
+                 int reserved = 0,
+                 std::initializer_list<int32_t> quantifiers = {});
 
 struct FillerAndExpected {
   using Filler = std::function<void(quapi_solver*)>;